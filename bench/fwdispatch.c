@@ -0,0 +1,91 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                         ( FCode tokenizer )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Microbenchmark of the dispatch of an FWord to its handler.
+ *
+ *      The entry for  multi-line  is looked up once, and its "Active"
+ *          function is then called repeatedly, the way  tokenize_one_word()
+ *          calls it.  The handler itself only clears a flag, so the time
+ *          per call is essentially the cost of getting to it.
+ *
+ *      Usage:    fwdispatch [repetitions]
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "types.h"
+#include "ticvocab.h"
+#include "vocabfuncts.h"
+
+/* **************************************************************************
+ *
+ *      Global Variables Exported
+ *          These are defined in  toke.c , which is not linked in.
+ *
+ **************************************************************************** */
+
+bool verbose         = false;
+bool noerrors        = false;
+bool fload_list      = false;
+bool dependency_list = false;
+bool size_map        = false;
+
+#define DEFAULT_REPS  200000000L
+
+int main(int argc, char **argv)
+{
+	long reps = DEFAULT_REPS;
+	long indx;
+	tic_hdr_t *found;
+	struct timespec t0, t1;
+	double nsecs;
+
+	if ( argc > 1 )  reps = strtol( argv[1], NULL, 0);
+	if ( reps <= 0 )  reps = DEFAULT_REPS;
+
+	init_dictionary();
+	found = lookup_shared_f_exec_word( "multi-line");
+	if ( found == NULL )
+	{
+	    printf("multi-line  not found among the Shared F-Exec Words\n");
+	    return 1;
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &t0);
+	for ( indx = 0 ; indx < reps ; indx++ )
+	{
+	    found->funct( found->pfield);
+	}
+	clock_gettime( CLOCK_MONOTONIC, &t1);
+
+	nsecs = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+	printf("FWord dispatch:  %ld calls, %.2f ns per call\n",
+		reps, nsecs / reps);
+	return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                         ( FCode tokenizer )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Microbenchmark of number conversion.
+ *
+ *      Each constant in the corpus is copied into  statbuf , the way the
+ *          Scanner delivers a word, and converted by  get_number()  in
+ *          the base it is written in.  The corpus is gone through as
+ *          many times as requested, and the time per word is shown
+ *          separately for:
+ *              the hex constants,
+ *              the decimal constants,
+ *              the 8-digit hex constants, i.e., register values,
+ *                  which are also counted among the hex constants.
+ *
+ *      Usage:    numparse [repetitions [corpus-file]]
+ *
+ *      The corpus defaults to  constants.txt  in the current directory.
+ *          Its format is described at its top.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "scanner.h"
+#include "errhandler.h"
+
+/* **************************************************************************
+ *
+ *      Global Variables Exported
+ *          These are defined in  toke.c , which is not linked in.
+ *
+ **************************************************************************** */
+
+bool verbose         = false;
+bool noerrors        = false;
+bool fload_list      = false;
+bool dependency_list = false;
+bool size_map        = false;
+
+/* **************************************************************************
+ *
+ *              Internal Static Variables
+ *     corpus               The constants, as read from the corpus file
+ *     corpus_base          The base of each
+ *     corpus_size          Number of constants
+ *
+ **************************************************************************** */
+
+#define DEFAULT_REPS    5000
+#define MAX_CORPUS      100000
+#define MAX_CONST_LEN   32
+
+static char corpus[MAX_CORPUS][MAX_CONST_LEN];
+static u8   corpus_base[MAX_CORPUS];
+static int  corpus_size = 0;
+
+/* **************************************************************************
+ *
+ *      Function name:  read_corpus
+ *      Synopsis:       Read the constants from the corpus file
+ *
+ *      Inputs:
+ *         Parameters:
+ *             filename            Name of the corpus file
+ *
+ *      Outputs:
+ *         Returned Value:         TRUE if the file could be read
+ *         Local Static Variables:
+ *             corpus, corpus_base, corpus_size    Filled in
+ *
+ **************************************************************************** */
+
+static bool read_corpus( char *filename)
+{
+	FILE *cfile = fopen( filename, "r");
+	char line[128];
+	char b;
+
+	if ( cfile == NULL )  return false;
+
+	while ( fgets( line, sizeof(line), cfile) != NULL )
+	{
+	    if ( line[0] == '#' )  continue;
+	    if ( corpus_size == MAX_CORPUS )  break;
+	    if ( sscanf( line, "%c %31s", &b, corpus[corpus_size]) != 2 )
+		continue;
+	    corpus_base[corpus_size] = ( b == 'h' ) ? 16 : 10;
+	    corpus_size++;
+	}
+	fclose( cfile);
+	return true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  time_words
+ *      Synopsis:       Convert the constants that pass a filter, repeatedly,
+ *                          and show the time per word
+ *
+ *      Inputs:
+ *         Parameters:
+ *             title               What is being timed
+ *             reps                Times to go through the corpus
+ *             want_base           Base of the constants to convert
+ *             want_len            Length of those to convert, or zero for all
+ *         Global Variables:
+ *             statbuf             Where each constant is delivered
+ *             base                Set to each constant's base
+ *
+ *      Outputs:
+ *         Returned Value:         Sum of the converted values, so that the
+ *                                     work cannot be optimized away
+ *         Printout:               The time per word
+ *
+ **************************************************************************** */
+
+static long time_words( char *title, long reps, u8 want_base, size_t want_len)
+{
+	static int chosen[MAX_CORPUS];
+	int num_chosen = 0;
+	long sum = 0;
+	long rep;
+	int indx;
+	struct timespec t0, t1;
+	double nsecs;
+
+	/*  Pick the constants before starting the clock  */
+	for ( indx = 0 ; indx < corpus_size ; indx++ )
+	{
+	    if ( corpus_base[indx] != want_base )  continue;
+	    if ( want_len != 0 && strlen( corpus[indx]) != want_len )
+		continue;
+	    chosen[num_chosen++] = indx;
+	}
+	if ( num_chosen == 0 )  return 0;
+
+	base = want_base;
+	clock_gettime( CLOCK_MONOTONIC, &t0);
+	for ( rep = 0 ; rep < reps ; rep++ )
+	{
+	    for ( indx = 0 ; indx < num_chosen ; indx++ )
+	    {
+		long val;
+		strcpy( (char *)statbuf, corpus[chosen[indx]]);
+		if ( get_number( &val) )  sum += val;
+	    }
+	}
+	clock_gettime( CLOCK_MONOTONIC, &t1);
+
+	nsecs = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+	printf("%-24s %8ld words, %6.2f ns per word\n",
+	    title, reps * num_chosen, nsecs / (reps * num_chosen));
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	long reps = DEFAULT_REPS;
+	char *corpus_file = "constants.txt";
+	long sum;
+
+	if ( argc > 1 )  reps = strtol( argv[1], NULL, 0);
+	if ( reps <= 0 )  reps = DEFAULT_REPS;
+	if ( argc > 2 )  corpus_file = argv[2];
+
+	if ( ! read_corpus( corpus_file) )
+	{
+	    printf("Cannot read corpus file %s\n", corpus_file);
+	    return 1;
+	}
+
+	init_error_handler();
+	init_scanner();
+
+	sum  = time_words( "Hex constants:", reps, 16, 0);
+	sum += time_words( "Decimal constants:", reps, 10, 0);
+	sum += time_words( "8-digit hex constants:", reps, 16, 8);
+
+	printf("(Checksum of values: 0x%lx)\n", (unsigned long)sum);
+	exit_scanner();
+	return 0;
+}
@@ -36,6 +36,9 @@
  *      Functions Exported:
  *          add_fcodes_from_list           Add Vendor-Specific FCodes from
  *                                             the file whose name is supplied.
+ *          write_fcode_table              Write the Vendor-Specific FCodes
+ *                                             that were added as a compiled
+ *                                             table, for quicker loading.
  *
  **************************************************************************** */
 
@@ -50,6 +53,12 @@
  *              Add "special function" words.  So far, only one added:
  *                   double-literal   Infrastructure will support
  *                  adding others as needed.
+ *          Accept a compiled table in place of the text list.  A list is
+ *              validated once, when it is compiled; loading the table
+ *              then takes no parsing and no duplicate-checking.
+ *          Let a Vendor FCode declare the kind of operand that follows
+ *              it, so that the decoder can step over the operand instead
+ *              of taking its bytes for tokens.
  *
  **************************************************************************** */
 
@@ -80,32 +89,45 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include "detok.h"
 #include "stream.h"
+#include "outsink.h"
 #include "addfcodes.h"
 
 /* **************************************************************************
  *
  *          Internal Static Variables
- *     current_vfc_line       Line to be scanned in Vendor-FCodes buffer
+ *     current_vfc_line       Line to be scanned, copied out of the
+ *                                Vendor-FCodes buffer
+ *     vfc_line_bufr_size     Size of the memory at  current_vfc_line
  *     vfc_remainder          Remainder of Vendor-FCodes buffer to be scanned
  *     vfc_line_no            Number of current line in Vendor-FCodes buffer
  *     vfc_buf_end            Pointer to end of Vendor-FCodes buffer
  *     spcl_func_list         List of reserved Special Function names
  *     spcl_func_count        Number of reserved Special Function names
+ *     vfc_entries            The Vendor-Specific FCodes that were added,
+ *                                in order, for  write_fcode_table()
+ *     vfc_entry_count        How many there are
+ *     vfc_entry_max          How many there is room for
+ *     vfc_opnd_kinds         Operand kinds that a Vendor FCode can declare
  *
  **************************************************************************** */
 
-static char *current_vfc_line;
+static char *current_vfc_line = NULL;
+static size_t vfc_line_bufr_size = 0;
 static u8 *vfc_remainder;
 static int vfc_line_no = 0;
 static u8 *vfc_buf_end;
 
 /*  Special Functions List  */
 /*  Initial fcode-field value of  -1  guarantees they won't be used  */
+/*  Each carries how the decoder treats it, which goes into the
+ *      token_descs  table along with the FCode number.
+ */
 token_t spcl_func_list[]  =  {
-	TOKEN_ENTRY( -1, "double(lit)" ),  /*  Entry  [0]  */
+	DECODE_ENTRY( -1, "double(lit)", OPND_QUAD, 0 ),  /*  Entry  [0]  */
 };
 
 static const int spcl_func_count = (sizeof(spcl_func_list)/sizeof(token_t)) ;
@@ -117,6 +139,69 @@ static const int spcl_func_count = (sizeof(spcl_func_list)/sizeof(token_t)) ;
 
 u16 *double_lit_code = &spcl_func_list[0].fcode;
 
+typedef struct {
+	u16 fcode;
+	bool special;
+	u8 opnd_kind;
+	const char *name;
+} vfc_entry_t;
+
+/*  Operand kinds a Vendor FCode may declare, by the name used in a list  */
+typedef struct {
+	const char *name;
+	u8 opnd_kind;
+} vfc_opnd_kind_t;
+
+static const vfc_opnd_kind_t vfc_opnd_kinds[] = {
+	{ "literal", OPND_LITERAL },	/*  Four bytes, as  b(lit)      */
+	{ "string",  OPND_STRING },	/*  Counted string, as  b(")    */
+	{ "branch",  OPND_BRANCH },	/*  Offset, as  bbranch         */
+	{ "token",   OPND_TOKEN },	/*  FCode number, as  b(')      */
+	{ "double",  OPND_QUAD },	/*  Eight bytes, as  double(lit)  */
+};
+
+static const int vfc_opnd_kind_count =
+    (sizeof(vfc_opnd_kinds) / sizeof(vfc_opnd_kind_t));
+
+#define VFC_OPND_PREFIX      "operand:"
+
+static vfc_entry_t *vfc_entries = NULL;
+static int vfc_entry_count = 0;
+static int vfc_entry_max = 0;
+
+/* **************************************************************************
+ *
+ *      Layout of a compiled Vendor-FCodes table.  Numbers are stored
+ *          big-endian, as in FCode.
+ *
+ *           Offset  Length
+ *              0       8      VFC_TABLE_MAGIC
+ *              8       2      VFC_TABLE_VERSION
+ *             10       2      Number of entries
+ *             12       4      Length of the name area
+ *             16       4      Adler-32 checksum of all that follows
+ *             20              The entries, four bytes each:
+ *                                 FCode number, with  VFC_ENTRY_SPECIAL 
+ *                                     set for a Special Function name
+ *                                 Length of the name
+ *                                 Operand kind, an  opnd_kind_t ; zero
+ *                                     for none.  Zero in a table from
+ *                                     before there were operand kinds.
+ *                             The name area:  the names, in the order
+ *                                 of the entries, each followed by a null
+ *
+ *      The leading null of the magic number keeps a text list from ever
+ *          being taken for a table.
+ *
+ **************************************************************************** */
+
+#define VFC_TABLE_MAGIC      "\0VFCtbl\n"
+#define VFC_MAGIC_LEN        8
+#define VFC_TABLE_VERSION    1
+#define VFC_HEADER_LEN       20
+#define VFC_ENTRY_LEN        4
+#define VFC_ENTRY_SPECIAL    0x8000
+
 
 /* **************************************************************************
  *
@@ -160,12 +245,21 @@ static void skip_whitespace(char **string_line_ptr)
  *      Outputs:
  *         Returned Value:               FALSE if reached end of buffer
  *         Local Static Variables:
- *             current_vfc_line          Advanced to next line to be scanned
+ *             current_vfc_line          Holds a null-terminated copy of the
+ *                                           next line to be scanned
+ *             vfc_line_bufr_size        Enlarged if need be
  *             vfc_line_no               Kept in sync with line number in file
+ *         Memory Allocated
+ *             For the copy of the line, when it is longer than any before.
+ *         When Freed?
+ *             At the end of  add_fcodes_from_list()
  *
  *      Process Explanation:
  *          Comments begin with a pound-sign  ('#') or a backslash  ('\')
  *          Comment-lines or blank or empty lines will be skipped. 
+ *          The line is copied out so that it can be null-terminated
+ *              without writing into the input-data, which may be a
+ *              read-only mapping of the file.
  *
  **************************************************************************** */
 
@@ -173,18 +267,37 @@ static bool get_next_vfc_line(void)
 {
 	bool retval = false;	/*  TRUE = not at end yet  */
 	while (vfc_remainder < vfc_buf_end) {
-		current_vfc_line = (char *)vfc_remainder;
-		vfc_remainder = (u8 *)strchr((const char *)current_vfc_line, '\n');
-		*vfc_remainder = 0;
-		vfc_remainder++;
+		u8 *line_end = memchr(vfc_remainder, '\n', max - vfc_remainder);
+		size_t line_len;
+		char *line_start;
+
+		if (line_end == NULL)
+			line_end = max;
+		line_len = line_end - vfc_remainder;
+		if (line_len >= vfc_line_bufr_size) {
+			vfc_line_bufr_size = line_len + 80;
+			current_vfc_line =
+			    realloc(current_vfc_line, vfc_line_bufr_size);
+			if (current_vfc_line == NULL) {
+				out_str("Out of memory while reading "
+					"additional FCodes.\n");
+				exit(-ENOMEM);
+			}
+		}
+		memcpy(current_vfc_line, vfc_remainder, line_len);
+		current_vfc_line[line_len] = 0;
+		vfc_remainder = line_end + 1;
 		vfc_line_no++;
-		skip_whitespace((char **)&current_vfc_line);
-		if (*current_vfc_line == 0)
+
+		line_start = current_vfc_line;
+		skip_whitespace(&line_start);
+		if (*line_start == 0)
 			continue;	/*  Blank line */
-		if (*current_vfc_line == '#')
+		if (*line_start == '#')
 			continue;	/*  Comment  */
-		if (*current_vfc_line == '\\')
+		if (*line_start == '\\')
 			continue;	/*  Comment  */
+		memmove(current_vfc_line, line_start, strlen(line_start) + 1);
 		retval = true;
 		break;		/*  Found something  */
 	}
@@ -230,37 +343,360 @@ static void vfc_splash(char *vf_file_name)
 
 /* **************************************************************************
  *
- *      Function name:  add_fcodes_from_list
- *      Synopsis:       Add Vendor-Specific FCodes from the named file
- *                          to the permanent resident dictionary.
+ *      Function name:  record_vfc_entry
+ *      Synopsis:       Note a Vendor-Specific FCode that was added, so
+ *                          that it can go into a compiled table.
  *
  *      Inputs:
  *         Parameters:
- *             vf_file_name            Vendor-Specific FCodes file name
+ *             fcode                   Its FCode number
+ *             name                    Its name; kept, not copied
+ *             special                 TRUE if a Special Function name
+ *             opnd_kind               The operand it declared, if any
+ *
+ **************************************************************************** */
+
+static void record_vfc_entry(u16 fcode, const char *name, bool special,
+			     u8 opnd_kind)
+{
+	if (vfc_entry_count == vfc_entry_max) {
+		vfc_entry_t *nu_entries;
+		vfc_entry_max = vfc_entry_max ? 2 * vfc_entry_max : 256;
+		nu_entries = realloc(vfc_entries,
+				     vfc_entry_max * sizeof(vfc_entry_t));
+		if (!nu_entries) {
+			out_str("Out of memory while reading additional FCodes.\n");
+			exit(-ENOMEM);
+		}
+		vfc_entries = nu_entries;
+	}
+	vfc_entries[vfc_entry_count].fcode = fcode;
+	vfc_entries[vfc_entry_count].name = name;
+	vfc_entries[vfc_entry_count].special = special;
+	vfc_entries[vfc_entry_count].opnd_kind = opnd_kind;
+	vfc_entry_count++;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  vfc_opnd_kind_allowed
+ *      Synopsis:       Whether a Vendor FCode may declare the given
+ *                          kind of operand.
+ *
+ **************************************************************************** */
+
+static bool vfc_opnd_kind_allowed(u8 opnd_kind)
+{
+	int indx;
+
+	if (opnd_kind == OPND_NONE)
+		return (true);
+	for (indx = 0; indx < vfc_opnd_kind_count; indx++) {
+		if (vfc_opnd_kinds[indx].opnd_kind == opnd_kind)
+			return (true);
+	}
+	return (false);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  parse_vfc_opnd_kind
+ *      Synopsis:       Find the operand kind, if any, declared on a
+ *                          line of the Vendor FCodes list.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             word                    The word after the name, if any
+ *             opnd_kind               Where to put the operand kind
+ *
+ *      Outputs:
+ *         Returned Value:             FALSE if the word declared an
+ *                                         operand kind that is not known
+ *         Supplied Pointers:
+ *             *opnd_kind              The kind, or  OPND_NONE  if the
+ *                                         word did not declare one
+ *
+ *      Process Explanation:
+ *          A declaration is a word of the form  operand:<kind> ; any
+ *              other word is the start of a comment, as it always was.
+ *
+ **************************************************************************** */
+
+static bool parse_vfc_opnd_kind(const char *word, u8 *opnd_kind)
+{
+	size_t prefix_len = strlen(VFC_OPND_PREFIX);
+	int indx;
+
+	*opnd_kind = OPND_NONE;
+	if (strncmp(word, VFC_OPND_PREFIX, prefix_len) != 0)
+		return (true);
+	for (indx = 0; indx < vfc_opnd_kind_count; indx++) {
+		if (strcmp(word + prefix_len, vfc_opnd_kinds[indx].name) == 0) {
+			*opnd_kind = vfc_opnd_kinds[indx].opnd_kind;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  add_special_function
+ *      Synopsis:       If the given name is on the Special Functions List,
+ *                          assign it the given FCode number.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             vs_fc_number            The FCode number
+ *             vs_fc_name              The name
+ *
+ *      Outputs:
+ *         Returned Value:             TRUE if the name was found
+ *         Printout:
+ *             A remark that the Special Function was added.
+ *
+ **************************************************************************** */
+
+static bool add_special_function(int vs_fc_number, const char *vs_fc_name)
+{
+	int indx;
+
+	for (indx = 0; indx < spcl_func_count; indx++) {
+		if ( strcmp( vs_fc_name, spcl_func_list[indx].name) == 0 ) {
+			char strbuf[90];
+			spcl_func_list[indx].fcode = vs_fc_number;
+			link_token( &spcl_func_list[indx]);
+			record_vfc_entry(vs_fc_number, spcl_func_list[indx].name,
+					 true, OPND_NONE);
+			sprintf( strbuf,  "Added Special Function FCode "
+				 "number 0x%03x, name %s\n", vs_fc_number, vs_fc_name);
+			printremark( strbuf);
+			return (true);
+		}
+	}
+	return (false);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  get_be16 / get_be32 / put_be16 / put_be32
+ *      Synopsis:       Numbers in a compiled table, in big-endian order.
+ *
+ **************************************************************************** */
+
+static u16 get_be16(const u8 * ptr)
+{
+	return (u16) ((ptr[0] << 8) | ptr[1]);
+}
+
+static u32 get_be32(const u8 * ptr)
+{
+	return ((u32) get_be16(ptr) << 16) | get_be16(ptr + 2);
+}
+
+static void put_be16(u8 * ptr, u16 val)
+{
+	ptr[0] = val >> 8;
+	ptr[1] = val & 0xff;
+}
+
+static void put_be32(u8 * ptr, u32 val)
+{
+	put_be16(ptr, val >> 16);
+	put_be16(ptr + 2, val & 0xffff);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  vfc_table_checksum
+ *      Synopsis:       Adler-32 checksum of the body of a compiled table.
+ *
+ **************************************************************************** */
+
+static u32 vfc_table_checksum(const u8 * data, size_t len)
+{
+	u32 sum_a = 1, sum_b = 0;
+
+	while (len > 0) {
+		/*  5552 bytes is the most that cannot overflow sum_b  */
+		size_t run = (len > 5552) ? 5552 : len;
+		len -= run;
+		while (run-- > 0) {
+			sum_a += *data++;
+			sum_b += sum_a;
+		}
+		sum_a %= 65521;
+		sum_b %= 65521;
+	}
+	return (sum_b << 16) | sum_a;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  bad_fcode_table
+ *      Synopsis:       Complain that a compiled table cannot be used,
+ *                          and quit.
+ *
+ **************************************************************************** */
+
+static void bad_fcode_table(char *vf_file_name, char *reason)
+{
+	char *strbfr = malloc(strlen(vf_file_name) + strlen(reason) + 65);
+	sprintf(strbfr,
+		"Compiled Additional FCodes table %s %s\n",
+		vf_file_name, reason);
+	printremark(strbfr);
+	free(strbfr);
+	exit(1);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  load_fcode_table
+ *      Synopsis:       Add the Vendor-Specific FCodes from a compiled
+ *                          table, which is the current input-data.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             vf_file_name            Name of the table, for messages
+ *         Global Variables:
+ *             indata                  Start of the table
+ *             stream_max              Its length
+ *
+ *      Outputs:
+ *         Returned Value:             Count of FCodes added
+ *         Supplied Pointers:
+ *             *added_plain            TRUE if any besides Special
+ *                                         Functions were added
+ *         Memory Allocated
+ *             One copy of the name area, for the dictionary to point into.
+ *         When Freed?
+ *             Never.  Remains until program termination.
+ *
+ *      Error Detection:
+ *          A table of another version, or that is short or whose checksum
+ *              does not match, or that holds an FCode number out of the
+ *              range a list allows, is reported and the program exits,
+ *              as if it could not be read.
+ *          A Special Function name that this detok does not know is
+ *              reported and ignored.
+ *
+ *      Process Explanation:
+ *          The table was checked when it was compiled, so the entries go
+ *              straight into the dictionary.
+ *
+ **************************************************************************** */
+
+static int load_fcode_table(char *vf_file_name, bool *added_plain)
+{
+	u8 *entry_ptr;
+	char *names;
+	size_t names_len, names_pos;
+	int entry_count;
+	int added_fc_count = 0;
+	int indx;
+
+	if (stream_max < VFC_HEADER_LEN)
+		bad_fcode_table(vf_file_name, "is too short.");
+	if (get_be16(indata + 8) != VFC_TABLE_VERSION)
+		bad_fcode_table(vf_file_name, "is of another version.");
+	entry_count = get_be16(indata + 10);
+	names_len = get_be32(indata + 12);
+	if ((s64) (VFC_HEADER_LEN + entry_count * VFC_ENTRY_LEN + names_len)
+	    != stream_max)
+		bad_fcode_table(vf_file_name, "is the wrong length.");
+	if (get_be32(indata + 16) !=
+	    vfc_table_checksum(indata + VFC_HEADER_LEN,
+			       stream_max - VFC_HEADER_LEN))
+		bad_fcode_table(vf_file_name, "has a bad checksum.");
+
+	names = malloc(names_len + 1);
+	if (!names) {
+		out_str("Out of memory while reading additional FCodes.\n");
+		exit(-ENOMEM);
+	}
+	entry_ptr = indata + VFC_HEADER_LEN;
+	memcpy(names, entry_ptr + entry_count * VFC_ENTRY_LEN, names_len);
+	names[names_len] = 0;
+
+	names_pos = 0;
+	for (indx = 0; indx < entry_count; indx++, entry_ptr += VFC_ENTRY_LEN) {
+		u16 fcode = get_be16(entry_ptr);
+		u8 name_len = entry_ptr[2];
+		u8 opnd_kind = entry_ptr[3];
+		char *name = &names[names_pos];
+
+		bool special = (fcode & VFC_ENTRY_SPECIAL) != 0;
+
+		fcode &= ~VFC_ENTRY_SPECIAL;
+		if ((fcode < 0x10) || (fcode > 0x7ff))
+			bad_fcode_table(vf_file_name, "has a bad FCode number.");
+		if (names_pos + name_len + 1 > names_len)
+			bad_fcode_table(vf_file_name, "has a bad name area.");
+		if (!vfc_opnd_kind_allowed(opnd_kind)
+		    || (special && (opnd_kind != OPND_NONE)))
+			bad_fcode_table(vf_file_name, "has a bad operand kind.");
+		names_pos += name_len + 1;
+
+		if (special) {
+			name[name_len] = 0;
+			if (add_special_function(fcode, name)) {
+				added_fc_count++;
+			} else {
+				char *strbfr = malloc(name_len + 85);
+				sprintf(strbfr,
+					"Unknown Special Function name %s "
+					"for FCode number 0x%03x.  Ignoring.\n",
+					name, fcode);
+				printremark(strbfr);
+				free(strbfr);
+			}
+			continue;
+		}
+
+		add_token(fcode, name, name_len);
+		if (opnd_kind != OPND_NONE)
+			set_token_desc(fcode, opnd_kind, 0);
+		record_vfc_entry(fcode, name, false, opnd_kind);
+		added_fc_count++;
+		*added_plain = true;
+	}
+
+	return (added_fc_count);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_fcode_list
+ *      Synopsis:       Add the Vendor-Specific FCodes from a text list,
+ *                          which is the current input-data.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             vf_file_name            Name of the list, for messages
  *         Global Variables:
- *             verbose                 "Verbose" flag.
  *             indata                  Start of file buffer
  *             stream_max              Size of the file buffer.
  *
  *      Outputs:
- *         Returned Value:             TRUE if FCodes have actually been added
- *         Global Variables:
- *             check_tok_seq           Cleared to FALSE, then restored to TRUE
+ *         Returned Value:             Count of FCodes added
+ *         Supplied Pointers:
+ *             *added_plain            TRUE if any besides Special
+ *                                         Functions were added
  *         Local Static Variables:
  *             vfc_remainder           Initted to start of file buffer
  *             vfc_buf_end             Initted to end of file buffer
  *         Memory Allocated
  *             Permanent copy of FCode Name
  *         When Freed?
- *             Never.  Rmeains until program termination.
- *         Printout:
- *             If verbose, "Splash" line and count of added entries.
+ *             Never.  Remains until program termination.
  *
  *      Error Detection:
- *          Fail to open or read Vendor-FCodes file -- Exit program
  *          Improperly formatted input line -- print message and ignore
  *          FCode value out of valid range -- print message and ignore
  *          FCode value already in use -- print message and ignore
+ *          Unknown operand kind -- print message and add the FCode
+ *              without one
  *
  *      Process Explanation:
  *          Valid lines are formatted with the FCode number first
@@ -274,42 +710,34 @@ static void vfc_splash(char *vf_file_name)
  *          Numbers already in use will be ignored.  A Message will be
  *              printed even if the name matches the one on the line.
  *          Names may not be longer than 31 characters.
+ *          The word after the name may declare the kind of operand
+ *              that follows the FCode, as  operand:literal  for one
+ *              that is followed by four bytes, like  b(lit) .  The
+ *              kinds are in  vfc_opnd_kinds[] , above.
  *          Certain names will be reserved for special functions.
  *              Those names will be entered in the  detok_table 
  *              with a value of  -1  and again in the static 
  *              table associated with this function, below, to
  *              supply the variable that will be used to match
  *              the name with the special function.
- *             
  *
  **************************************************************************** */
 
-bool add_fcodes_from_list(char *vf_file_name)
+static int read_fcode_list(char *vf_file_name, bool *added_plain)
 {
-	bool retval = false;
 	int added_fc_count = 0;
-	check_tok_seq = false;
 
-	if (verbose)
-		vfc_splash(vf_file_name);
-
-	if (init_stream(vf_file_name) != 0) {
-		char *strbfr = malloc(strlen(vf_file_name) + 65);
-		sprintf(strbfr,
-			"Could not open Additional FCodes file:  %s\n",
-			vf_file_name);
-		printremark(strbfr);
-		free(strbfr);
-		exit(1);
-	}
 	vfc_remainder = indata;
 	vfc_buf_end = indata + stream_max - 1;
 
 	while (get_next_vfc_line()) {
 		char vs_fc_name[36];
+		char vs_fc_opnd[24];
+		u8 opnd_kind;
 		int vs_fc_number;
 		int scan_result;
-		char *lookup_result;
+		const char *lookup_result;
+		u8 lookup_len;
 		char *fc_name_cpy;
 
 		/*  For each line of input, we need to check that we have
@@ -319,19 +747,25 @@ bool add_fcodes_from_list(char *vf_file_name)
 		 */
 
 		/*    Start with a lower-case  0x    */
-		scan_result = sscanf(current_vfc_line, "0x%x %32s",
-				     &vs_fc_number, vs_fc_name);
+		/*    A third word, if any, may declare an operand    */
+		vs_fc_opnd[0] = 0;
 
-		if (scan_result != 2) {	/*  Allow a capital  0X   */
-			scan_result = sscanf(current_vfc_line, "0X%x %32s",
-					     &vs_fc_number, vs_fc_name);
+		/*    Start with a lower-case  0x    */
+		scan_result = sscanf(current_vfc_line, "0x%x %32s %20s",
+				     &vs_fc_number, vs_fc_name, vs_fc_opnd);
+
+		if (scan_result < 2) {	/*  Allow a capital  0X   */
+			scan_result = sscanf(current_vfc_line, "0X%x %32s %20s",
+					     &vs_fc_number, vs_fc_name,
+					     vs_fc_opnd);
 		}
-		if (scan_result != 2) {	/*  Try it without the  0x   */
-			scan_result = sscanf(current_vfc_line, "%x %32s",
-					     &vs_fc_number, vs_fc_name);
+		if (scan_result < 2) {	/*  Try it without the  0x   */
+			scan_result = sscanf(current_vfc_line, "%x %32s %20s",
+					     &vs_fc_number, vs_fc_name,
+					     vs_fc_opnd);
 		}
 
-		if (scan_result != 2) {	/*  That's it... */
+		if (scan_result < 2) {	/*  That's it... */
 			char *strbfr =
 			    malloc(strlen(current_vfc_line) + 65);
 			vfc_splash(vf_file_name);
@@ -354,48 +788,112 @@ bool add_fcodes_from_list(char *vf_file_name)
 			continue;
 		}
 
-		lookup_result = lookup_token((u16) vs_fc_number);
-		if (strcmp(lookup_result, "ferror") != 0) {
-			char *strbfr = malloc(strlen(lookup_result) + 85);
+		lookup_result = lookup_token((u16) vs_fc_number, &lookup_len);
+		if ((lookup_len != strlen("ferror"))
+		    || (memcmp(lookup_result, "ferror", lookup_len) != 0)) {
+			char *strbfr = malloc(lookup_len + 85);
 			vfc_splash(vf_file_name);
 			sprintf(strbfr,
 				"Line #%d.  FCode number 0x%x is already "
-				"defined as %s  Ignoring.\n",
-				vfc_line_no, vs_fc_number, lookup_result);
+				"defined as %.*s  Ignoring.\n",
+				vfc_line_no, vs_fc_number,
+				(int)lookup_len, lookup_result);
 			printremark(strbfr);
 			free(strbfr);
 			continue;
 		}
 
 		/*    Check if the name is on the "Special Functions List"  */
-		{
-			bool found_spf = false;
-			int indx;
-			for (indx = 0; indx < spcl_func_count; indx++) {
-				if ( strcmp( vs_fc_name, spcl_func_list[indx].name) == 0 ) {
-					char strbuf[90];
-					found_spf = true;
-					spcl_func_list[indx].fcode = vs_fc_number;
-					link_token( &spcl_func_list[indx]);
-					added_fc_count++;
-					sprintf( strbuf,  "Added Special Function FCode "
-						 "number 0x%03x, name %s\n", vs_fc_number, vs_fc_name);
-					printremark( strbuf);
-					break;
-				}
-			}
+		/*    Its operand is already known; any declared is ignored  */
+		if (add_special_function(vs_fc_number, vs_fc_name)) {
+			added_fc_count++;
+			continue;
+		}
 
-			if (found_spf) 
-				continue;
+		if (!parse_vfc_opnd_kind(vs_fc_opnd, &opnd_kind)) {
+			char *strbfr = malloc(strlen(vs_fc_opnd) + 85);
+			vfc_splash(vf_file_name);
+			sprintf(strbfr,
+				"Line #%d, unknown operand kind:  %s  "
+				"Adding the FCode without it.\n",
+				vfc_line_no, vs_fc_opnd);
+			printremark(strbfr);
+			free(strbfr);
 		}
 
 		/*  We've passed all the tests!  */
 		fc_name_cpy = strdup(vs_fc_name);
-		add_token((u16) vs_fc_number, fc_name_cpy);
+		add_token((u16) vs_fc_number, fc_name_cpy, strlen(fc_name_cpy));
+		if (opnd_kind != OPND_NONE)
+			set_token_desc((u16) vs_fc_number, opnd_kind, 0);
+		record_vfc_entry((u16) vs_fc_number, fc_name_cpy, false,
+				 opnd_kind);
 		added_fc_count++;
-		retval = true;
+		*added_plain = true;
 	}
 
+	free(current_vfc_line);
+	current_vfc_line = NULL;
+	vfc_line_bufr_size = 0;
+	return (added_fc_count);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  add_fcodes_from_list
+ *      Synopsis:       Add Vendor-Specific FCodes from the named file
+ *                          to the permanent resident dictionary.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             vf_file_name            Vendor-Specific FCodes file name:
+ *                                         a text list, or a table that
+ *                                         was compiled from one
+ *         Global Variables:
+ *             verbose                 "Verbose" flag.
+ *
+ *      Outputs:
+ *         Returned Value:             TRUE if FCodes have actually been added
+ *         Global Variables:
+ *             check_tok_seq           Cleared to FALSE, then restored to TRUE
+ *         Printout:
+ *             If verbose, "Splash" line and count of added entries.
+ *
+ *      Error Detection:
+ *          Fail to open or read Vendor-FCodes file -- Exit program
+ *
+ *      Process Explanation:
+ *          A compiled table is recognized by its magic number, and is
+ *              loaded by  load_fcode_table() ; anything else is taken
+ *              for a text list, and read by  read_fcode_list() .
+ *
+ **************************************************************************** */
+
+bool add_fcodes_from_list(char *vf_file_name)
+{
+	bool retval = false;
+	int added_fc_count;
+	check_tok_seq = false;
+
+	if (verbose)
+		vfc_splash(vf_file_name);
+
+	if (init_stream(vf_file_name) != 0) {
+		char *strbfr = malloc(strlen(vf_file_name) + 65);
+		sprintf(strbfr,
+			"Could not open Additional FCodes file:  %s\n",
+			vf_file_name);
+		printremark(strbfr);
+		free(strbfr);
+		exit(1);
+	}
+
+	if ((stream_max >= VFC_MAGIC_LEN)
+	    && (memcmp(indata, VFC_TABLE_MAGIC, VFC_MAGIC_LEN) == 0))
+		added_fc_count = load_fcode_table(vf_file_name, &retval);
+	else
+		added_fc_count = read_fcode_list(vf_file_name, &retval);
+
 	if (verbose) {
 		char strbfr[32]; 
 		sprintf(strbfr,
@@ -407,3 +905,94 @@ bool add_fcodes_from_list(char *vf_file_name)
 	check_tok_seq = true;
 	return (retval);
 }
+
+/* **************************************************************************
+ *
+ *      Function name:  write_fcode_table
+ *      Synopsis:       Write the Vendor-Specific FCodes that have been
+ *                          added as a compiled table.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             table_name              Name of the file to write
+ *         Local Static Variables:
+ *             vfc_entries             The FCodes that were added
+ *             vfc_entry_count         How many
+ *
+ *      Outputs:
+ *         Returned Value:             TRUE if the table was written
+ *         File Written:
+ *             The table, in the layout described near the top of this file
+ *         Printout:
+ *             A message if the table could not be written.
+ *
+ *      Process Explanation:
+ *          Only the entries that passed all the tests get this far, so
+ *              a table holds nothing that would draw a message when it
+ *              is loaded.  A table may itself be compiled again; it
+ *              comes out the same.
+ *
+ **************************************************************************** */
+
+bool write_fcode_table(char *table_name)
+{
+	size_t names_len = 0;
+	size_t table_len;
+	u8 *table;
+	u8 *entry_ptr;
+	char *name_ptr;
+	FILE *table_file;
+	bool retval;
+	int indx;
+
+	for (indx = 0; indx < vfc_entry_count; indx++)
+		names_len += strlen(vfc_entries[indx].name) + 1;
+	table_len = VFC_HEADER_LEN + vfc_entry_count * VFC_ENTRY_LEN + names_len;
+
+	table = calloc(1, table_len);
+	if (!table) {
+		out_str("Out of memory while compiling additional FCodes.\n");
+		exit(-ENOMEM);
+	}
+
+	entry_ptr = table + VFC_HEADER_LEN;
+	name_ptr = (char *)entry_ptr + vfc_entry_count * VFC_ENTRY_LEN;
+	for (indx = 0; indx < vfc_entry_count; indx++) {
+		vfc_entry_t *entry = &vfc_entries[indx];
+		size_t name_len = strlen(entry->name);
+
+		put_be16(entry_ptr, entry->fcode
+			 | (entry->special ? VFC_ENTRY_SPECIAL : 0));
+		entry_ptr[2] = (u8) name_len;
+		entry_ptr[3] = entry->opnd_kind;
+		entry_ptr += VFC_ENTRY_LEN;
+		memcpy(name_ptr, entry->name, name_len + 1);
+		name_ptr += name_len + 1;
+	}
+
+	memcpy(table, VFC_TABLE_MAGIC, VFC_MAGIC_LEN);
+	put_be16(table + 8, VFC_TABLE_VERSION);
+	put_be16(table + 10, vfc_entry_count);
+	put_be32(table + 12, names_len);
+	put_be32(table + 16, vfc_table_checksum(table + VFC_HEADER_LEN,
+						table_len - VFC_HEADER_LEN));
+
+	table_file = fopen(table_name, "wb");
+	retval = (table_file != NULL);
+	if (retval) {
+		retval = (fwrite(table, 1, table_len, table_file) == table_len);
+		if (fclose(table_file) != 0)
+			retval = false;
+	}
+	if (!retval) {
+		char *strbfr = malloc(strlen(table_name) + 65);
+		sprintf(strbfr,
+			"Could not write Additional FCodes table:  %s\n",
+			table_name);
+		printremark(strbfr);
+		free(strbfr);
+	}
+
+	free(table);
+	return (retval);
+}
@@ -54,5 +54,6 @@ extern u16 *double_lit_code;
  **************************************************************************** */
 
 bool add_fcodes_from_list(char *vf_file_name);
+bool write_fcode_table(char *table_name);
 
 #endif				/*  _DETOK_VSFCODES_H    */
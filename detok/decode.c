@@ -33,243 +33,149 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include <setjmp.h>
+#include <errno.h>
 
 #include "detok.h"
 #include "stream.h"
-#include "addfcodes.h"
-
-static int indent;		/*  Current level of indentation   */
+#include "fcsum.h"
+#include "outsink.h"
+#include "fcinsn.h"
 
 /* **************************************************************************
  *
- *      Still to be done:
- *          Handling of indent-level is not correct.  Branches should
- *              balance with their resolvers; constructs like do..loop
- *              case/of/endof/endcase are a few major examples.
- *          This will be tricky; the rules need to be carefully thought
- *              out, and the implementation might be more complex than
- *              at first meets the eye...
+ *      The decoder reads the FCode and makes a record of each thing it
+ *          finds there, which it hands to  emit_insn() ; it does not
+ *          print anything itself.  The text listing is made from those
+ *          records, in  listing.c .
+ *
+ *      A record is filled in as the operands of its token are read.  If
+ *          the input runs out before they all are, the record is sent
+ *          along as it stands, marked as partial, ahead of the record
+ *          for the end-of-file.
  *
  **************************************************************************** */
 
 static bool ended_okay = true;	/*  FALSE if finished prematurely  */
 
+bool decode_all = false;
 bool offs16 = true;
-unsigned int linenum;
 bool end_found = false;
-unsigned int token_streampos;	/*  Streampos() of currently-gotten token  */
+s64 token_streampos;	/*  Streampos() of currently-gotten token  */
 u16 last_defined_token = 0;
 
 jmp_buf eof_exception;
 
-static int fclen;
-static const char *unnamed = "(unnamed-fcode)";
+static s64 fclen;
+const char *unnamed = "(unnamed-fcode)";
 
-static void decode_indent(void)
-{
-	int i;
-	if (indent < 0) {
-#ifdef DEBUG_INDENT
-		printf("detok: error in indentation code.\n");
-#endif
-		indent = 0;
-	}
-	for (i = 0; i < indent; i++)
-		printf("    ");
-}
-
-/*  Print forth string ( [len] char[0] ... char[len] ) */
-static void pretty_print_string(void)
-{
-	u8 len;
-	u8 *strptr;
-	int indx;
-	bool in_parens = false;	/*  Are we already inside parentheses?  */
-
-	strptr = get_string(&len);
-
-	printf("( len=%s%x", len >= 10 ? "0x" : "", len);
-	if (len >= 10)
-		printf(" [%d bytes]", len);
-	printf(" )\n");
-	if (show_linenumbers)
-		printf("        ");
-	decode_indent();
-	printf("\" ");
-
-	for (indx = 0; indx < len; indx++) {
-		u8 c = *strptr++;
-		if (isprint(c)) {
-			if (in_parens) {
-				printf(" )");
-				in_parens = false;
-			}
-			printf("%c", c);
-			/*  Quote-mark must escape itself  */
-			if (c == '"')
-				printf("%c", c);
-		} else {
-			if (!in_parens) {
-				printf("\"(");
-				in_parens = true;
-			}
-			printf(" %02x", c);
-		}
-	}
-	if (in_parens)
-		printf(" )");
-	printf("\"");
-}
-
-static void decode_lines(void)
-{
-	if (show_linenumbers) {
-		printf("%6d: ",show_offsets ? token_streampos : linenum++);
-	}
-}
+static fc_insn_t insn;		/*  Record being filled in          */
+static bool insn_pending = false;	/*  Not yet sent along       */
 
 /* **************************************************************************
  *
- *      Function name:  output_token_name
- *      Synopsis:       Print the name of the token just retrieved
- *                          along with any interesting related information...
+ *      Function name:  token_is_invalid
+ *      Synopsis:       Check the token just retrieved against the last
+ *                          one defined.
  *
  *      Inputs:
  *         Global/Static Variables:
  *             fcode                  The token # just retrieved
  *             last_defined_token     Used to screen invalid tokens.
  *             token_streampos        Location of token just retrieved
- *         Global/Static Constants:
- *             unnamed                Namefield of headerless token 
  *
  *      Outputs:
- *         Printout:
- *             Print the function name (if known) and the FCode number,
- *                  if interesting.
- *             The fcode number is interesting if either
- *                 a) the token has no name
- *                           or
- *                 b) verbose mode is in effect.
- *             If the token is named, show its FCode number in
- *                 the syntax of a FORTH Comment, otherwise, its
- *                 FCode number -- in [brackets] -- acts as its name.
+ *         Returned Value:            TRUE if the token is invalid
+ *         Global/Static Variables:
+ *             Stream position        Backed up, if the token is invalid
  *
  *      Error Detection:
  *          If the token # is larger than the last defined token, it is
  *              probably an artifact of an error that was allowed in the
  *              tokenization; if it were treated normally, it would lead
- *              to a cascade of failures.  Print a message, skip the first
- *              byte, and return.
- *
- *      Revision History:
- *          Refactored.  The line number or offset (if selected) and the
- *              indent are printed in the  output_token()  routine, which
- *              calls this one.
- *          Add Error Detection
- *          
+ *              to a cascade of failures.  Skip the first byte; the listing
+ *              will say so.
  *
  **************************************************************************** */
 
-static void output_token_name(void)
+static bool token_is_invalid(void)
 {
-	char *tname;
-
 	/*  Run error detection only if last_defined_token was assigned  */
 	if ((fcode > last_defined_token) && (last_defined_token > 0)) {
-		char temp_buf[80];
-		int buf_pos;
-		u8 top_byte = fcode >> 8;
-		printf("Invalid token:  [0x%03x]\n", fcode);
-		sprintf(temp_buf, "Backing up over first byte, which is ");
-		buf_pos = strlen(temp_buf);
-		if (top_byte < 10) {
-			sprintf(&temp_buf[buf_pos], " %02x", top_byte);
-		} else {
-			sprintf(&temp_buf[buf_pos], "0x%02x ( =dec %d)",
-				top_byte, top_byte);
-		}
-		printremark(temp_buf);
 		set_streampos(token_streampos + 1);
-		return;
-	}
-
-
-	tname = lookup_token(fcode);
-	printf("%s ", tname);
-
-	/* The fcode number is interesting
-	 *  if either
-	 *  a) the token has no name
-	 *            or
-	 *  b) detok is in verbose mode.
-	 */
-	if (strcmp(tname, unnamed) == 0) {
-		printf("[0x%03x] ", fcode);
-	} else {
-		if (verbose) {
-			/*  If the token is named,
-			 *  show its fcode number in
-			 *  the syntax of a FORTH Comment
-			 */
-			printf("( 0x%03x ) ", fcode);
-		}
+		return true;
 	}
+	return false;
 }
 
 /* **************************************************************************
  *
- *      Function name:  output_token
- *      Synopsis:       Print the full line for the token just retrieved:
- *                          line number, indentation and name.
+ *      Function name:  begin_token
+ *      Synopsis:       Start the record for the token just retrieved.
+ *
+ *      Inputs:
+ *         Global/Static Variables:
+ *             fcode                  The token # just retrieved
+ *             token_streampos        Location of token just retrieved
+ *
+ *      Outputs:
+ *         Local Static Variables:
+ *             insn                   Started, with the token's name, or
+ *                                        marked invalid.
+ *             insn_pending           TRUE
  *
  *      Revision History:
- *          Updated Mon, 11 Jul 2005 by David L. Paktor
- *          Separate out  output_token_name()  for specific uses.
- *          Incorporate calls to  decode_lines()  and   decode_indent()
- *              to allow better control of indentation.
+ *          This is where the line for a token used to be started, in
+ *              the  output_token()  routine.  The printing is now done
+ *              from the record, by the listing.
  *
  **************************************************************************** */
 
-static void output_token(void)
+static void begin_token(void)
 {
-	decode_lines();
-	decode_indent();
-	output_token_name();
+	memset(&insn, 0, sizeof(insn));
+	insn.kind = INSN_TOKEN;
+	insn.offset = token_streampos;
+	insn.fcode = fcode;
+	if (token_is_invalid())
+		insn.flags |= INSN_INVALID;
+	else
+		insn.name = lookup_token(fcode, &insn.name_len);
+	insn_pending = true;
 }
 
+static void finish_token(void)
+{
+	insn_pending = false;
+	emit_insn(&insn);
+}
 
 /* **************************************************************************
  *
- *      Function name:  decode_offset
- *      Synopsis:       Gather and display an FCode-offset associated with
- *                          a branch or suchlike function.
+ *      Function name:  get_branch_operand
+ *      Synopsis:       Gather an FCode-offset associated with a branch
+ *                          or suchlike function.
  *
  *      Inputs:
  *         Parameters:                 NONE
  *         Global/Static Variables:
- *             show_offsets            Whether to show offsets in full detail
  *             offs16                  Whether 16- (or 8-) -bit offsets
  *             stream_max              Maximum valid destimation      
- *         Local Static Variables:
  *
  *      Outputs:
- *         Returned Value:             The offset, converted to signed 16-bit #
- *         Global/Static Variables:
- *             stream-position         Reset if invalid destination; otherwise,
- *                                         advanced in the normal manner.
- *         Printout:
- *             The offset and destination, if display of offsets was specified
- *                 or if the destination is invalid
+ *         Returned Value:             NONE
+ *         Record:
+ *             The offset and destination, and whether the destination
+ *                 is invalid
  *
  *      Error Detection:
  *          Crude and rudimentary:
  *          If the target-destination is outside the theoretical limits,
  *              it's obviously wrong.
- *          Notification remark is printed and the stream-position reset
- *              to the location of the offset, to allow it to be processed
- *              in the manner of normal tokens.
+ *          The record is so marked, and once it has been sent along,
+ *              decode_token()  resets the stream-position to the location
+ *              of the offset, to allow it to be processed in the manner
+ *              of normal tokens.
  *          If the offset is zero, that's obviously wrong, but don't reset
  *              the stream-position:  zero gets processed as  end0  and that
  *              is also wrong...
@@ -279,20 +185,18 @@ static void output_token(void)
  *              at the type of branch, and what should be expected in the
  *              vicinity of the destination.  (This might be best served
  *              by a separate routine).
- *         This might also help with handling the indent-level correctly...
- *              Also, if indentation were to be handled in this routine,
- *              there would be no need to return the value of the offset.
+ *
+ *      Revision History:
+ *          This used to be  decode_offset() , which also started and
+ *              finished the record; that is now done by  decode_token() .
  *
  **************************************************************************** */
 
-static s16 decode_offset(void)
+static void get_branch_operand(s64 streampos)
 {
 	s16 offs;
-	int dest;
-	bool invalid_dest;
-	int streampos = get_streampos();
+	s64 dest;
 
-	output_token();
 	offs = get_offset();
 
 	/*  The target-destination is the source-byte offset
@@ -301,6 +205,12 @@ static s16 decode_offset(void)
 	 */
 	dest = streampos + offs;
 
+	insn.opnd_kind = OPND_BRANCH;
+	insn.opnd.branch.offs = offs;
+	insn.opnd.branch.dest = dest;
+	if (offs16)
+		insn.flags |= INSN_OFFS16;
+
 	/*  A destination of zero is invalid because there must be a
 	 *      token -- such as  b(<mark)  or   b(do)  -- preceding
 	 *      the target of a backward branch.
@@ -308,265 +218,190 @@ static s16 decode_offset(void)
 	 *      theoretically possible, so we'll treat it as valid.
 	 *  An offset of zero is also, of course, invalid.
 	 */
-	invalid_dest = ((dest <= 0)
-			       || (dest > stream_max)
-			       || (offs == 0));
-
-	/*  Show the offset in hex and again as a signed decimal number.   */
-	if (offs16) {
-		printf("0x%04x (", (u16) (offs & 0xffff));
-	} else {
-		printf("0x%02x (", (u8) (offs & 0x00ff));
-	}
-	if ((offs < 0) || (offs > 9))
-		printf(" =dec %d", offs);
-	/*  If we're showing source-byte offsets, show targets of offsets  */
-	if (show_offsets || invalid_dest) {
-		printf("  dest = %d ", dest);
-	}
-	printf(")\n");
-
-	if (invalid_dest) {
-		if (offs == 0) {
-			printremark("Error:  Unresolved offset.");
-		} else {
-			printremark
-			    ("Error:  Invalid offset.  Ignoring...");
-			set_streampos(streampos);
-		}
-	}
-	return offs;
+	if ((dest <= 0) || (dest > stream_max) || (offs == 0))
+		insn.flags |= INSN_BAD_DEST;
 }
 
-static void decode_default(void)
+static void get_named_operand(void)
 {
-	output_token();
-	printf("\n");
-}
-
-static void new_token(void)
-{
-	u16 token;
-	output_token();
-	token = next_token();
-	printf("0x%03x\n", token);
-	add_token(token, strdup(unnamed));
+	/* get forth string ( [len] [char0] ... [charn] ) */
+	insn.opnd.new_token.ptr = get_string(&insn.opnd.new_token.len);
+	insn.opnd.new_token.token = next_token();
+	insn.opnd_kind = OPND_NAMED_TOKEN;
 }
 
-static void named_token(void)
+static void get_token_operand(void)
 {
 	u16 token;
-	u8 len;
-	char *string;
 
-	output_token();
-	/* get forth string ( [len] [char0] ... [charn] ) */
-	string = get_name(&len);
 	token = next_token();
-	printf("%s 0x%03x\n", string, token);
-	add_token(token, string);
-}
-
-static void bquote(void)
-{
-	output_token();
-	/* get forth string ( [len] [char0] ... [charn] ) */
-	pretty_print_string();
-	printf("\n");
-}
-
-static void blit(void)
-{
-	u32 lit;
-
-	output_token();
-	lit = get_num32();
-	printf("0x%x\n", lit);
-}
-
-static void double_length_literal(void)
-{
-	u16 quadhh, quadhl, quadlh, quadll;
-
-	output_token();
-	quadhh = get_num16();
-	quadhl = get_num16();
-	quadlh = get_num16();
-	quadll = get_num16();
-	printf("0x%04x.%04x.%04x.%04x\n", quadhh, quadhl, quadlh, quadll);
-}
-
-static void offset16(void)
-{
-	decode_default();
-	offs16 = true;
-}
-
-static void decode_branch(void)
-{
-	s16 offs;
-	offs = decode_offset();
-	if (offs >= 0)
-		indent++;
+	insn.opnd_kind = OPND_TOKEN;
+	insn.opnd.token.token = token;
+	if (token_is_invalid())
+		insn.flags |= INSN_OPND_BAD;
 	else
-		indent--;
+		insn.opnd.token.name =
+		    lookup_token(token, &insn.opnd.token.name_len);
 }
 
-static void decode_two(void)
+static void get_quad_operand(void)
 {
-	output_token();
-	next_token();
-	output_token_name();
-	printf("\n");
+	int indx;
+
+	insn.opnd_kind = OPND_QUAD;
+	for (indx = 0; indx < 4; indx++)
+		insn.opnd.quad[indx] = get_num16();
 }
 
 /* **************************************************************************
  *
  *      Function name:  decode_start
- *      Synopsis:       Display the (known valid) FCode block Header
+ *      Synopsis:       Gather the (known valid) FCode block Header
+ *
+ *      Inputs:
+ *         Parameters:
+ *             mid_block     TRUE if it was found inside an FCode block
  *
  *      Outputs:
  *         Global/Static Variables:    
  *             fclen         Length of the FCode block as shown in its Header
  *
+ *      Process Explanation:
+ *          The checksum is formed both ways, IEEE 1275 and Sun-style, so
+ *              that the listing can accept either.
+ *
  **************************************************************************** */
 
-static void decode_start(void)
+static void decode_start(bool mid_block)
 {
-	u8 fcformat;
-	u16 fcchecksum, checksum = 0;
-
-	output_token();
-	printf("  ( %d-bit offsets)\n", offs16 ? 16 : 8);
+	u64 body_sum;
 
-	token_streampos = get_streampos();
-	decode_lines();
-	fcformat = get_num8();
-	printf("  format:    0x%02x\n", fcformat);
+	begin_token();
+	insn.kind = INSN_HEADER;
+	if (offs16)
+		insn.flags |= INSN_OFFS16;
+	if (mid_block)
+		insn.flags |= INSN_MIDBLOCK;
 
+	insn.opnd.header.format = get_num8();
+	insn.opnd.header.fields = 1;
 
 	/* Check for checksum correctness. */
+	insn.opnd.header.checksum = get_num16();	/*  The stored checksum  */
+	body_sum = calc_body_sum();
+	insn.opnd.header.calc_checksum = fold_fcode_checksum(body_sum, false);
+	insn.opnd.header.sun_checksum = fold_fcode_checksum(body_sum, true);
+	insn.opnd.header.fields = 2;
 
-	token_streampos = get_streampos();
-	decode_lines();
-	fcchecksum = get_num16();	/*  Read the stored checksum  */
-	checksum = calc_checksum();	/*  Calculate the actual checksum  */
-
-	if (fcchecksum == checksum) {
-		printf("  checksum:  0x%04x (Ok)\n", fcchecksum);
-	} else {
-		printf("  checksum should be:  0x%04x, but is 0x%04x\n",
-		       checksum, fcchecksum);
-	}
-
-	token_streampos = get_streampos();
-	decode_lines();
 	fclen = get_num32();
-	printf("  len:       0x%04x ( %d bytes)\n", fclen, fclen);
+	insn.opnd.header.len = fclen;
+	insn.opnd.header.fields = 3;
+	finish_token();
 }
 
 
 /* **************************************************************************
  *
  *      Function name: decode_token
- *      Synopsis:      Display detokenization for one token.
- *                     Handle complicated cases and dispatch simple ones.
+ *      Synopsis:      Decode one token.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             token             The token, just retrieved
+ *         Global Variables:
+ *             token_descs       How the decoder treats each FCode number
+ *
+ *      Outputs:
+ *         Global/Static Variables:
+ *             end_found         Set, for  end0  or  end1
+ *             offs16            Set, for  offset16
+ *         Record:
+ *             The token and its operand
+ *
+ *      Process Explanation:
+ *          One look-up in the  token_descs  table tells what operand
+ *              follows the token, if any, and what else to do about it.
+ *              A Vendor FCode that was given an operand kind in the
+ *              Vendor FCodes list is decoded the same way as a standard
+ *              token of that kind.
+ *          A token that defines another has the new one entered into the
+ *              dictionary after its record has gone out, so that any
+ *              remark about it comes after the line for the token.
  *
  *      Revision History:
  *          Detect FCode-Starters in the middle of an FCode block.
  *          Some tuning of adjustment of indent, particularly wrt branches...
+ *              (The indentation is now done by the listing.)
+ *          Dispatch from the table of token descriptors, instead of a
+ *              switch on the token number.  The Special Function
+ *              double(lit)  is now just another entry in it.
  *
  **************************************************************************** */
 
 static void decode_token(u16 token)
 {
-	bool handy_flag = true;
-	switch (token) {
-	case 0x0b5:
-		new_token();
-		break;
-	case 0x0b6:		/*   Named Token  */
-	case 0x0ca:		/*   External Token  */
-		named_token();
-		break;
-	case 0x012:
-		bquote();
-		break;
-	case 0x010:
-		blit();
-		break;
-	case 0x0cc:
-		offset16();
-		break;
-	case 0x013:		/* bbranch */
-	case 0x014:		/* b?branch */
-		decode_branch();
-		break;
-	case 0x0b7:		/* b(:) */
-	case 0x0b1:		/* b(<mark) */
-	case 0x0c4:		/* b(case) */
-		decode_default();
-		indent++;
+	/*  A token is never more than twelve bits  */
+	const token_desc_t *desc = &token_descs[token];
+	s64 streampos = get_streampos();
+
+	if (desc->flags & DESC_STARTER) {
+		offs16 = !(desc->flags & DESC_OFFS8);
+		printremark("Unexpected FCode-Block Starter.");
+		decode_start(true);
+		printremark("  Ignoring length field.");
+		return;
+	}
+	if (desc->flags & DESC_ENDER)
+		end_found = true;
+
+	begin_token();
+	switch (desc->opnd_kind) {
+	case OPND_LITERAL:
+		insn.opnd_kind = OPND_LITERAL;
+		insn.opnd.literal = get_num32();
 		break;
-	case 0x0c2:		/* b(;) */
-	case 0x0b2:		/* b(>resolve) */
-	case 0x0c5:		/* b(endcase) */
-		indent--;
-		decode_default();
+	case OPND_BRANCH:
+		get_branch_operand(streampos);
 		break;
-	case 0x015:		/* b(loop) */
-	case 0x016:		/* b(+loop) */
-	case 0x0c6:		/* b(endof) */
-		indent--;
-		decode_offset();
+	case OPND_STRING:
+		/* get forth string ( [len] [char0] ... [charn] ) */
+		insn.opnd_kind = OPND_STRING;
+		insn.opnd.string.ptr = get_string(&insn.opnd.string.len);
 		break;
-	case 0x017:		/* b(do) */
-	case 0x018:		/* b/?do) */
-	case 0x01c:		/* b(of) */
-		decode_offset();
-		indent++;
+	case OPND_NEW_TOKEN:
+		insn.opnd.new_token.token = next_token();
+		insn.opnd_kind = OPND_NEW_TOKEN;
 		break;
-	case 0x011:		/* b(') */
-	case 0x0c3:		/* b(to) */
-		decode_two();
+	case OPND_NAMED_TOKEN:
+		get_named_operand();
 		break;
-	case 0x0fd:		/* version1 */
-		handy_flag = false;
-	case 0x0f0:		/* start0 */
-	case 0x0f1:		/* start1 */
-	case 0x0f2:		/* start2 */
-	case 0x0f3:		/* start4 */
-		offs16 = handy_flag;
-		printremark("Unexpected FCode-Block Starter.");
-		decode_start();
-		printremark("  Ignoring length field.");
+	case OPND_TOKEN:
+		get_token_operand();
 		break;
-	case 0:		/* end0  */
-	case 0xff:		/* end1  */
-		end_found = true;
-		decode_default();
+	case OPND_QUAD:
+		get_quad_operand();
 		break;
+	}
+	finish_token();
 
-#if  0  /*  Fooey on C's petty limitations!  */
-        /*  I'd like to be able to do this:  */
-	/*  Special Functions  */
-	case *double_lit_code:
-		double_length_literal();
+	switch (insn.opnd_kind) {
+	case OPND_BRANCH:
+		if ((insn.flags & INSN_BAD_DEST) && (insn.opnd.branch.offs != 0))
+			set_streampos(streampos);
 		break;
-#endif  /*  Fooey on C's petty limitations!  */
-
-	default:
-	{
-	    /*  Have to do this clumsy thing instead  */
-	    if ( token == *double_lit_code )
-	    {
-		double_length_literal();
+	case OPND_NEW_TOKEN:
+		add_token(insn.opnd.new_token.token, unnamed, strlen(unnamed));
+		break;
+	case OPND_NAMED_TOKEN:
+		/*  An embedded null ends the name  */
+		add_token(insn.opnd.new_token.token,
+			  (const char *)insn.opnd.new_token.ptr,
+			  strnlen((const char *)insn.opnd.new_token.ptr,
+				  insn.opnd.new_token.len));
 		break;
-	    }
-
-		decode_default();
 	}
-}
+	if (desc->flags & DESC_OFFS16)
+		offs16 = true;
 }
 
 
@@ -588,57 +423,39 @@ static void decode_token(u16 token)
  *                                  other valid Starters, otherwise unchanged.
  *             fclen            On error, gets set to reach end of input stream
  *                                  Otherwise, gets set by  decode_start() 
- *         Printout:
- *             On error, print a new-line to finish previous token's line.
+ *         Record:
+ *             The header, or on error, where it should have been.
  *
  *      Error Detection:
- *          First byte not a valid FCode Start:  Print message, restore
- *              input pointer to initial value, set fclen to [(end of
- *              input stream) - (input pointer)], leave offs16 unchanged.
- *              Return FALSE.
+ *          First byte not a valid FCode Start:  Restore input pointer to
+ *              initial value, set fclen to [(end of input stream) -
+ *              (input pointer)], leave offs16 unchanged.
  *
  *      Process Explanation:
  *          This routine error-checks and dispatches to the routine that
- *              does the actual printing.
- *          Refrain from showing offset until correctness of starter-byte
- *              has been confirmed.
+ *              does the actual decoding.
  *
  **************************************************************************** */
 
 static void decode_fcode_header(void)
 {
-	long err_pos;
+	s64 err_pos;
 	u16 token;
-	bool new_offs16 = true;
 
 	err_pos = get_streampos();
-	indent = 0;
 	token = next_token();
 
-	switch (token) {
-	case 0x0fd:		/* version1 */
-		new_offs16 = false;
-	case 0x0f0:		/* start0 */
-	case 0x0f1:		/* start1 */
-	case 0x0f2:		/* start2 */
-	case 0x0f3:		/* start4 */
-		offs16 = new_offs16;
-		decode_start();
-		break;
-	default:
-		{
-			char temp_bufr[128] =
-			    "Invalid FCode Start Byte.  Ignoring FCode header.";
-			set_streampos(err_pos);
-			fclen = max - pc;
-			printf("\n");
-			if (show_linenumbers) {
-				sprintf(&(temp_bufr[strlen(temp_bufr)]),
-					"  Remaining len = 0x%04x ( %d bytes)",
-					fclen, fclen);
-			}
-			printremark(temp_bufr);
-		}
+	if (token_descs[token].flags & DESC_STARTER) {
+		offs16 = !(token_descs[token].flags & DESC_OFFS8);
+		decode_start(false);
+	} else {
+		set_streampos(err_pos);
+		fclen = max - pc;
+		memset(&insn, 0, sizeof(insn));
+		insn.kind = INSN_BAD_START;
+		insn.offset = err_pos;
+		insn.opnd.header.len = fclen;
+		emit_insn(&insn);
 	}
 }
 
@@ -658,18 +475,19 @@ static void decode_fcode_header(void)
  *         Returned Value:                 NONE
  *         Global/Static Variables:
  *             end_found     Whether the END0 code was seen
- *         Printout:
- *             A summary message at the end of FCode detokenization
+ *         Record:
+ *             The end of the block, with how much of it was detokenized,
+ *                 from which the listing prints a summary message.
  *
  *      Error Detection:
  *          If the end of the FCode block, as calculated by its FCode length,
- *              was reached without encountering END0, print a message.
+ *              was reached without encountering END0, the record says so.
  *          Detect END0 that occurs before end of FCode block,
  *              even if  decode_all  is in effect.
  *
  *      Process Explanation:
  *          This routine dispatches to the routines that do the actual
- *              printing of the detokenization.
+ *              decoding of the detokenization.
  *          The  end_found  flag is not a direct input, but more of an
  *              intermediate input, so to speak...  Clear it at the start.
  *          Detection of FCode-Starters in the middle of an FCode block
@@ -680,8 +498,8 @@ static void decode_fcode_header(void)
 static void decode_fcode_block(void)
 {
 	u16 token;
-	unsigned int fc_block_start;
-	unsigned int fc_block_end;
+	s64 fc_block_start;
+	s64 fc_block_end;
 
 	end_found = false;
 	fc_block_start = get_streampos();
@@ -695,27 +513,21 @@ static void decode_fcode_block(void)
 		token = next_token();
 		decode_token(token);
 	}
-	if (!end_found) {
-		printremark("FCode-ender not found");
-	}
-	{
-		char temp_bufr[80];
-		/*  Don't use  fclen  here, in case it got corrupted
-		 *      by an "Unexpected FCode-Block Starter"
-		 */
-		if (get_streampos() == fc_block_end) {
-			sprintf(temp_bufr,
-				"Detokenization finished normally after %d bytes.",
-				fc_block_end - fc_block_start);
-		} else {
-			sprintf(temp_bufr,
-				"Detokenization finished prematurely after %d of %d bytes.",
-				get_streampos() - fc_block_start,
-				fc_block_end - fc_block_start);
-			ended_okay = false;
-		}
-		printremark(temp_bufr);
+	if (get_streampos() != fc_block_end) {
+		ended_okay = false;
 	}
+
+	/*  Don't use  fclen  here, in case it got corrupted
+	 *      by an "Unexpected FCode-Block Starter"
+	 */
+	memset(&insn, 0, sizeof(insn));
+	insn.kind = INSN_BLOCK_END;
+	insn.offset = get_streampos();
+	if (end_found)
+		insn.flags |= INSN_ENDER;
+	insn.opnd.block_end.consumed = get_streampos() - fc_block_start;
+	insn.opnd.block_end.len = fc_block_end - fc_block_start;
+	emit_insn(&insn);
 }
 
 /* **************************************************************************
@@ -779,23 +591,85 @@ static bool another_fcode_block(void)
 	return (retval);
 }
 
+/* **************************************************************************
+ *
+ *      Function name:  init_decoder
+ *      Synopsis:       Return the state that the decoder carries over
+ *                          from one image to the next to its initial
+ *                          values, so that an image comes out the same
+ *                          as it would have if it were detokenized alone.
+ *
+ **************************************************************************** */
+
+void init_decoder(void)
+{
+	ended_okay = true;
+	offs16 = true;
+	end_found = false;
+	last_defined_token = 0;
+	insn_pending = false;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  finish_at_eof
+ *      Synopsis:       When the input has run out, send along the record
+ *                          for the token being read, if any, as it
+ *                          stands, then the record for the end-of-file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             eof_kind          The value the stream routines long-jumped
+ *                                   with:  whether it was in the middle
+ *                                   of a token
+ *
+ **************************************************************************** */
+
+static void finish_at_eof(int eof_kind)
+{
+	if (insn_pending) {
+		insn.flags |= INSN_PARTIAL;
+		finish_token();
+	}
+	memset(&insn, 0, sizeof(insn));
+	insn.kind = INSN_EOF;
+	insn.offset = get_streampos();
+	if (eof_kind == EOF_PREMATURE)
+		insn.flags |= INSN_PREMATURE;
+	if (end_found)
+		insn.flags |= INSN_ENDER;
+	emit_insn(&insn);
+}
+
 /* **************************************************************************
  *
  *      Function name:  detokenize
  *      Synopsis:       Detokenize one input file 
- *                      
  *
+ *      Process Explanation:
+ *          When the input runs out, the stream routines long-jump back
+ *              here, saying whether it was in the middle of a token.
+ *              The record for the token being read, if any, goes out as
+ *              it stands, then the record for the end-of-file.
  *
  **************************************************************************** */
 
 void detokenize(void)
 {
+	int eof_kind;
+
 	fclen = stream_max;
 
-	if (setjmp(eof_exception) == 0) {
+	eof_kind = setjmp(eof_exception);
+	if (eof_kind != 0) {
+		finish_at_eof(eof_kind);
+	} else {
 		while (more_to_go()) {
 			if (ended_okay) {
 				init_fcode_block();
+				memset(&insn, 0, sizeof(insn));
+				insn.kind = INSN_RESTART;
+				emit_insn(&insn);
 			}
 			ended_okay = true;
 
@@ -816,3 +690,65 @@ void detokenize(void)
 
 
 }
+
+/* **************************************************************************
+ *
+ *      Function name:  detokenize_span
+ *      Synopsis:       Detokenize part of one FCode block, starting from
+ *                          a point at which the state of the decoder is
+ *                          known, as recorded in a sidecar index.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             header_pos        Stream position of the block's header, if
+ *                                   it is to be read first; else -1
+ *             start_pos         Where to start, if not at the header:
+ *                                   the position of a token
+ *             block_end         Stream position of the end of the block
+ *             span_end          Do not start a token at or past here
+ *         Global Variables:
+ *             offs16, end_found, last_defined_token     As they were at
+ *                                   start_pos , when the whole file was
+ *                                   detokenized
+ *             The dictionary    Likewise.
+ *
+ *      Outputs:
+ *         Record:
+ *             The tokens of the span, and if the input ran out, the
+ *                 end-of-file, just as  detokenize()  would send them
+ *
+ *      Process Explanation:
+ *          The caller has set the origin of the stream positions to that
+ *              of the block's image, so the offsets come out the same as
+ *              in a listing of the whole file.
+ *          The same tokens are decoded, the same way, as when the whole
+ *              block is:  the span stops at the end of the block, and at
+ *              the  end0  unless  decode_all  is in effect.
+ *
+ **************************************************************************** */
+
+void detokenize_span(s64 header_pos, s64 start_pos, s64 block_end,
+		     s64 span_end)
+{
+	int eof_kind;
+
+	eof_kind = setjmp(eof_exception);
+	if (eof_kind != 0) {
+		finish_at_eof(eof_kind);
+		return;
+	}
+
+	if (header_pos >= 0) {
+		set_streampos(header_pos);
+		end_found = false;
+		decode_fcode_header();
+	} else {
+		set_streampos(start_pos);
+	}
+
+	while ((!end_found || decode_all)
+	       && (get_streampos() < block_end)
+	       && (get_streampos() < span_end)) {
+		decode_token(next_token());
+	}
+}
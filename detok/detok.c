@@ -35,6 +35,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #ifdef __GLIBC__
 #define _GNU_SOURCE
@@ -44,6 +46,15 @@
 #include "detok.h"
 #include "stream.h"
 #include "addfcodes.h"
+#include "outsink.h"
+#include "workers.h"
+#include "scan.h"
+#include "verify.h"
+#include "jsonout.h"
+#include "fcindex.h"
+#include "fcdiff.h"
+#include "fcxref.h"
+#include "fcexec.h"
 
 #define DETOK_VERSION "1.0.3"
 
@@ -51,17 +62,59 @@
 		     "(C) Copyright 2006 coresystems GmbH"
 #define IBM_COPYR    "(C) Copyright 2005 IBM Corporation.  All Rights Reserved."
 
-bool verbose = false;
-bool decode_all = false;
-bool show_linenumbers = false;
-bool show_offsets = false;
+bool scan_mode = false;
+bool json_output = false;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     input_files            Names of the files to detokenize:  those on
+ *                                 the command-line, then those from the
+ *                                 file-list, if any
+ *     input_count            How many there are
+ *     output_dir             Directory into which to write a listing for
+ *                                 each file, or NULL for all to stdout
+ *     images_side_by_side    Whether to detokenize the images of a file
+ *                                 side by side.  Not when the files are.
+ *     verify_only            Whether only to check the FCode blocks'
+ *                                 headers and checksums.  Set by the
+ *                                 -C  command-line switch.
+ *     write_index            Whether to write a sidecar index of each
+ *                                 file as it is detokenized  ( -x )
+ *     index_word             Name of the definition to detokenize by
+ *                                 way of the index  ( -w ), or NULL
+ *     range_given            Whether to detokenize a range of bytes by
+ *                                 way of the index  ( -r ), which is
+ *     range_from, range_to       from here to there
+ *     diff_mode              Whether to compare the definitions in two
+ *                                 files instead  ( -D )
+ *     xref_format            How to print the cross-reference of each
+ *                                 file, in place of its listing  ( -X
+ *                                 or  -G ), or  XREF_NONE
+ *     profile_mode           Whether to run each file in a sandbox and
+ *                                 report what it costs instead  ( -p )
+ *
+ **************************************************************************** */
+
+static char **input_files = NULL;
+static int input_count = 0;
+static int input_max = 0;
+static char *output_dir = NULL;
+static bool images_side_by_side = false;
+static bool verify_only = false;
+static bool write_index = false;
+static char *index_word = NULL;
+static bool range_given = false;
+static s64 range_from;
+static s64 range_to;
+static bool diff_mode = false;
+static int xref_format = XREF_NONE;
+static bool profile_mode = false;
 
 /*   Param is FALSE when beginning to detokenize,
  *       TRUE preceding error-exit   */
 static void print_copyright(bool is_error)
 {
-	typedef void (*vfunct) (char *);	/*  Pointer to function returning void  */
-	vfunct pfunct;
 	char buffr[512];
 
 	sprintf(buffr,
@@ -72,29 +125,312 @@ static void print_copyright(bool is_error)
 		"under the terms of\nthe GNU General Public License v2. "
 		"This program has absolutely no warranty.\n\n");
 
-	pfunct = (is_error ? (vfunct) printf : printremark);
-
-	(*pfunct) (buffr);
+	if (is_error)
+		out_str(buffr);
+	else
+		printremark(buffr);
 }
 
 static void usage(char *name)
 {
-	printf("usage: %s [OPTION]... [FCODE-FILE]...\n\n"
-	       "         -v, --verbose     print fcode numbers\n"
-	       "         -a, --all         don't stop at end0\n"
-	       "         -n, --linenumbers print line numbers\n"
-	       "         -o, --offsets     print byte offsets\n"
-	       "         -f, --fcodes      add FCodes from list-file\n"
-	       "         -h, --help        print this help text\n\n", name);
+	out_printf("usage: %s [OPTION]... [FCODE-FILE]...\n\n"
+		   "         -v, --verbose     print fcode numbers\n"
+		   "         -a, --all         don't stop at end0\n"
+		   "         -n, --linenumbers print line numbers\n"
+		   "         -o, --offsets     print byte offsets\n"
+		   "         -f, --fcodes      add FCodes from list-file\n"
+		   "         -c, --compile-fcode-list TABLE\n"
+		   "                           write the -f list-file as a table\n"
+		   "         -s, --scan        find and decode images within a dump\n"
+		   "         -C, --verify-only check block headers and checksums only\n"
+		   "         -J, --json        print one JSON record per line\n"
+		   "         -x, --index       write a sidecar index of each file\n"
+		   "         -w, --word NAME   decode only the definition of NAME\n"
+		   "         -r, --range A:B   decode only from offset A up to B\n"
+		   "         -D, --diff        compare the definitions in two files\n"
+		   "         -X, --xref        print who uses what, not the listing\n"
+		   "         -G, --dot         print the call graph for Graphviz\n"
+		   "         -p, --profile     run each image and report its cost\n"
+		   "         -m, --method NAME also call method NAME, with -p\n"
+		   "         -k, --costs FILE  read the cost of each token from FILE\n"
+		   "         -j, --jobs N      decode up to N files or images at once\n"
+		   "         -l, --file-list   read more FCODE-FILE names from file\n"
+		   "         -d, --outdir DIR  write a listing per file into DIR\n"
+		   "         -h, --help        print this help text\n\n", name);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  add_input_file
+ *      Synopsis:       Add a name to the list of files to detokenize
+ *
+ **************************************************************************** */
+
+static void add_input_file(char *name)
+{
+	if (input_count == input_max) {
+		char **nu_files;
+		input_max = input_max ? 2 * input_max : 64;
+		nu_files = realloc(input_files, input_max * sizeof(char *));
+		if (!nu_files) {
+			out_str("Out of memory while reading file names.\n");
+			exit(-ENOMEM);
+		}
+		input_files = nu_files;
+	}
+	input_files[input_count++] = name;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_file_list
+ *      Synopsis:       Add the names in a file-list to the list of
+ *                          files to detokenize
+ *
+ *      Inputs:
+ *         Parameters:
+ *             list_filnam        Name of the file-list;  "-"  for stdin
+ *
+ *      Outputs:
+ *         Returned Value:        FALSE if the file-list could not be read
+ *
+ *      Process Explanation:
+ *          One name to a line.  Blank lines, and lines that begin with
+ *              a  #  sign, are ignored; so is white space at the end of
+ *              a line, but not at its start.
+ *
+ **************************************************************************** */
+
+static bool read_file_list(char *list_filnam)
+{
+	FILE *list_file;
+	char line_bufr[4096];
+
+	if (strcmp(list_filnam, "-") == 0)
+		list_file = stdin;
+	else
+		list_file = fopen(list_filnam, "r");
+	if (list_file == NULL)
+		return false;
+
+	while (fgets(line_bufr, sizeof(line_bufr), list_file) != NULL) {
+		size_t len = strlen(line_bufr);
+		char *name;
+
+		while ((len > 0) && (line_bufr[len - 1] <= ' '))
+			len--;
+		line_bufr[len] = 0;
+		if ((len == 0) || (line_bufr[0] == '#'))
+			continue;
+
+		name = strdup(line_bufr);
+		if (!name) {
+			out_str("Out of memory while reading file names.\n");
+			exit(-ENOMEM);
+		}
+		add_input_file(name);
+	}
+
+	if (list_file != stdin)
+		fclose(list_file);
+	return true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  parse_range
+ *      Synopsis:       Read the argument of the  -r  switch:  two byte
+ *                          offsets, separated by a colon.  Either may
+ *                          be in hex, with a leading  0x .
+ *
+ *      Outputs:
+ *         Returned Value:        FALSE if it was not of that form, or
+ *                                    the range is empty
+ *         Local Static Variables:
+ *             range_from, range_to
+ *
+ **************************************************************************** */
+
+static bool parse_range(char *arg)
+{
+	char *endp;
+
+	range_from = strtoll(arg, &endp, 0);
+	if ((endp == arg) || (*endp != ':'))
+		return false;
+	arg = endp + 1;
+	range_to = strtoll(arg, &endp, 0);
+	if ((endp == arg) || (*endp != 0))
+		return false;
+	return (range_from >= 0) && (range_to > range_from);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  open_listing
+ *      Synopsis:       Create the file, in the output directory, into
+ *                          which to write the listing of an input file
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *         Local Static Variables:
+ *             output_dir         The output directory
+ *
+ *      Outputs:
+ *         Returned Value:        File descriptor, or -1 if the file could
+ *                                    not be created;  a message will
+ *                                    have been printed.
+ *
+ *      Process Explanation:
+ *          The listing is named after the input file, without the path
+ *              and with its extension, if any, replaced by  .DeTok  --
+ *              the same as the testsuite names them.  Input from stdin
+ *              goes to  stdin.DeTok .  With  --json , the extension
+ *              is  .json  instead; with  --xref  or  --dot , it is
+ *              .xref  or  .dot ; with  --profile , it is  .prof .
+ *
+ **************************************************************************** */
+
+static int open_listing(char *in_filnam)
+{
+	char *base_name;
+	char *dot;
+	char *out_filnam;
+	const char *extension = "DeTok";
+	size_t base_len;
+	int out_fd;
+
+	if (strcmp(in_filnam, "-") == 0)
+		in_filnam = "stdin";
+	base_name = strrchr(in_filnam, '/');
+	base_name = base_name ? base_name + 1 : in_filnam;
+	dot = strrchr(base_name, '.');
+	base_len = (dot && (dot != base_name)) ? (size_t) (dot - base_name)
+	    : strlen(base_name);
+
+	out_filnam = malloc(strlen(output_dir) + base_len + 8);
+	if (!out_filnam) {
+		out_str("Out of memory while naming listing.\n");
+		exit(-ENOMEM);
+	}
+	if (json_output)
+		extension = "json";
+	else if (xref_format == XREF_LIST)
+		extension = "xref";
+	else if (xref_format == XREF_DOT)
+		extension = "dot";
+	else if (profile_mode)
+		extension = "prof";
+	sprintf(out_filnam, "%s/%.*s.%s", output_dir, (int) base_len,
+		base_name, extension);
+
+	out_fd = open(out_filnam, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (out_fd < 0)
+		out_printf("Could not create file \"%s\".\n", out_filnam);
+	free(out_filnam);
+	return (out_fd);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  detokenize_file
+ *      Synopsis:       Detokenize one input file.  This is the job that
+ *                          is handed to the workers.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             job_num           Index into the list of input files
+ *             job_data          Not used
+ *         Local Static Variables:
+ *             input_files       The list of input files
+ *             output_dir        Where the listing goes, if not to stdout
+ *
+ *      Outputs:
+ *         Printout:
+ *             The listing, unless it goes to a file of its own.  If it
+ *                 does, that file looks the same as the output of a run
+ *                 for that input file by itself.
+ *             With  verify_only , a report on its FCode blocks instead.
+ *         Global Variables:
+ *             job_failed        Set if the file could not be opened, or
+ *                                   if a check found something wrong
+ *
+ **************************************************************************** */
+
+static void detokenize_file(int job_num, void *job_data)
+{
+	char *in_filnam = input_files[job_num];
+	int listing_fd = -1;
+	int prev_fd = -1;
+
+	if ((write_index || index_word || range_given)
+	    && (strcmp(in_filnam, "-") == 0)) {
+		out_str("Standard input cannot be indexed.\n");
+		job_failed = true;
+		return;
+	}
+	if (init_stream(in_filnam)) {
+		out_printf("Could not open file \"%s\".\n", in_filnam);
+		job_failed = true;
+		return;
+	}
+
+	if (output_dir != NULL) {
+		listing_fd = open_listing(in_filnam);
+		if (listing_fd < 0) {
+			close_stream();
+			return;
+		}
+		prev_fd = output_to_fd(listing_fd);
+		if (verbose)
+			print_copyright(false);
+	}
+	if (json_output)
+		json_begin_file(in_filnam);
+
+	if (verify_only)
+		verify_stream(in_filnam);
+	else if (scan_mode)
+		scan_stream();
+	else if (index_word != NULL)
+		detokenize_word(in_filnam, index_word);
+	else if (range_given)
+		detokenize_range(in_filnam, range_from, range_to);
+	else if (write_index)
+		index_and_detokenize(in_filnam);
+	else if (xref_format != XREF_NONE)
+		xref_stream(in_filnam, xref_format);
+	else if (profile_mode)
+		profile_stream(in_filnam);
+	else if (images_side_by_side)
+		detokenize_images();
+	else
+		detokenize();
+	reset_dictionary();
+	close_stream();
+
+	if (listing_fd >= 0) {
+		if (!json_output)
+			out_char('\n');
+		output_to_fd(prev_fd);
+		close(listing_fd);
+	}
 }
 
 int main(int argc, char **argv)
 {
 	int c;
-	const char *optstring = "vhanof:?";
+	const char *optstring = "vhanof:c:sCJxw:r:DXGpm:k:j:l:d:?";
 	int linenumbers = 0;
 	bool add_vfcodes = false;
 	char *vfc_filnam = NULL;
+	char *list_filnam = NULL;
+	char *table_filnam = NULL;
+	char *costs_filnam = NULL;
+	bool have_methods = false;
+
+	output_to_fd(STDOUT_FILENO);
 
 	while (1) {
 #ifdef __GLIBC__
@@ -106,6 +442,22 @@ int main(int argc, char **argv)
 			{"linenumbers", 0, 0, 'n'},
 			{"offsets", 0, 0, 'o'},
 			{"fcodes", 1, 0, 'f'},
+			{"compile-fcode-list", 1, 0, 'c'},
+			{"scan", 0, 0, 's'},
+			{"verify-only", 0, 0, 'C'},
+			{"json", 0, 0, 'J'},
+			{"index", 0, 0, 'x'},
+			{"word", 1, 0, 'w'},
+			{"range", 1, 0, 'r'},
+			{"diff", 0, 0, 'D'},
+			{"xref", 0, 0, 'X'},
+			{"dot", 0, 0, 'G'},
+			{"profile", 0, 0, 'p'},
+			{"method", 1, 0, 'm'},
+			{"costs", 1, 0, 'k'},
+			{"jobs", 1, 0, 'j'},
+			{"file-list", 1, 0, 'l'},
+			{"outdir", 1, 0, 'd'},
 			{0, 0, 0, 0}
 		};
 
@@ -137,6 +489,68 @@ int main(int argc, char **argv)
 			add_vfcodes = true;
 			vfc_filnam = optarg;
 			break;
+		case 'c':
+			table_filnam = optarg;
+			break;
+		case 's':
+			scan_mode = true;
+			break;
+		case 'C':
+			verify_only = true;
+			break;
+		case 'J':
+			json_output = true;
+			break;
+		case 'x':
+			write_index = true;
+			break;
+		case 'w':
+			index_word = optarg;
+			break;
+		case 'r':
+			if (!parse_range(optarg)) {
+				print_copyright(true);
+				out_printf("%s: invalid range \"%s\".\n",
+					   argv[0], optarg);
+				usage(argv[0]);
+				return 1;
+			}
+			range_given = true;
+			break;
+		case 'D':
+			diff_mode = true;
+			break;
+		case 'X':
+			xref_format = XREF_LIST;
+			break;
+		case 'G':
+			xref_format = XREF_DOT;
+			break;
+		case 'p':
+			profile_mode = true;
+			break;
+		case 'm':
+			add_profile_method(optarg);
+			have_methods = true;
+			break;
+		case 'k':
+			costs_filnam = optarg;
+			break;
+		case 'j':
+			max_workers = atoi(optarg);
+			if (max_workers < 1) {
+				print_copyright(true);
+				out_printf("%s: invalid number of jobs.\n", argv[0]);
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'l':
+			list_filnam = optarg;
+			break;
+		case 'd':
+			output_dir = optarg;
+			break;
 		case 'h':
 		case '?':
 			print_copyright(true);
@@ -144,22 +558,106 @@ int main(int argc, char **argv)
 			return 0;
 		default:
 			print_copyright(true);
-			printf("%s: unknown option.\n", argv[0]);
+			out_printf("%s: unknown option.\n", argv[0]);
 			usage(argv[0]);
 			return 1;
 		}
 	}
 
-	if (verbose)
+	/*  Everything from here on is printed by way of the records  */
+	if (json_output)
+		set_insn_sink(json_insn, NULL);
+
+	while (optind < argc)
+		add_input_file(argv[optind++]);
+	if (list_filnam != NULL) {
+		if (!read_file_list(list_filnam)) {
+			print_copyright(true);
+			out_printf("%s: could not read file-list \"%s\".\n",
+				   argv[0], list_filnam);
+			return 1;
+		}
+	}
+
+	if ((verbose) && (output_dir == NULL))
 		print_copyright(false);
 
 	if (linenumbers > 2)
 		printremark
 		    ("Line numbers will be disabled in favour of offsets.\n");
 
-	if (optind >= argc) {
+	if (table_filnam != NULL) {
+		if (!add_vfcodes) {
+			print_copyright(true);
+			out_printf("%s: -c needs a list-file given with -f.\n",
+				   argv[0]);
+			usage(argv[0]);
+			return 1;
+		}
+		init_dictionary();
+		add_fcodes_from_list(vfc_filnam);
+		return write_fcode_table(table_filnam) ? 0 : 1;
+	}
+
+	if ((index_word != NULL) && range_given) {
 		print_copyright(true);
-		printf("%s: filename missing.\n", argv[0]);
+		out_printf("%s: -w and -r cannot be used together.\n", argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+	if ((write_index || index_word || range_given)
+	    && (scan_mode || verify_only)) {
+		print_copyright(true);
+		out_printf("%s: -x, -w and -r cannot be used with -s or -C.\n",
+			   argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+	if (diff_mode && (scan_mode || verify_only || json_output
+			  || write_index || index_word || range_given
+			  || (output_dir != NULL))) {
+		print_copyright(true);
+		out_printf("%s: -D cannot be used with -s, -C, -J, -x, -w, -r "
+			   "or -d.\n", argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+	if ((xref_format != XREF_NONE)
+	    && (scan_mode || verify_only || json_output || write_index
+		|| index_word || range_given || diff_mode)) {
+		print_copyright(true);
+		out_printf("%s: -X and -G cannot be used with -s, -C, -J, -x, "
+			   "-w, -r or -D.\n", argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+	if (profile_mode
+	    && (scan_mode || verify_only || json_output || write_index
+		|| index_word || range_given || diff_mode
+		|| (xref_format != XREF_NONE))) {
+		print_copyright(true);
+		out_printf("%s: -p cannot be used with -s, -C, -J, -x, -w, -r, "
+			   "-D, -X or -G.\n", argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+	if ((have_methods || (costs_filnam != NULL)) && !profile_mode) {
+		print_copyright(true);
+		out_printf("%s: -m and -k go with -p.\n", argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+	if (diff_mode && (input_count != 2)) {
+		print_copyright(true);
+		out_printf("%s: -D compares an old file with a new one.\n",
+			   argv[0]);
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (input_count == 0) {
+		print_copyright(true);
+		out_printf("%s: filename missing.\n", argv[0]);
 		usage(argv[0]);
 		return 1;
 	}
@@ -167,27 +665,37 @@ int main(int argc, char **argv)
 	init_dictionary();
 
 	if (add_vfcodes) {
-		if (add_fcodes_from_list(vfc_filnam)) {
-			freeze_dictionary();
-		}
+		/*  Freeze even if only Special Functions were added  */
+		add_fcodes_from_list(vfc_filnam);
+		freeze_dictionary();
 	}
 
-	while (optind < argc) {
+	/*  After the list-file, so that its names can be given costs  */
+	if ((costs_filnam != NULL) && !load_cost_model(costs_filnam)) {
+		print_copyright(true);
+		out_printf("%s: could not read cost model \"%s\".\n",
+			   argv[0], costs_filnam);
+		return 1;
+	}
 
-		if (init_stream(argv[optind])) {
-			printf("Could not open file \"%s\".\n", argv[optind]);
-			optind++;
-			continue;
-		}
-		detokenize();
-		close_stream();
+	if (diff_mode)
+		return diff_files(input_files[0], input_files[1]);
 
-		optind++;
-		reset_dictionary();
-	}
+	/*  The dictionary is complete before any worker starts, so
+	 *      each one begins with a copy of it.  Run the files side
+	 *      by side if there are several; otherwise the images,
+	 *      unless the index, the cross-reference or the profile is
+	 *      wanted, any of which takes the file whole.
+	 */
+	images_side_by_side = (max_workers > 1) && (input_count == 1)
+	    && !(write_index || index_word || range_given
+		 || (xref_format != XREF_NONE) || profile_mode);
+	run_jobs(input_count, detokenize_file, NULL);
 
-	printf("\n");
+	if ((output_dir == NULL) && !json_output)
+		out_char('\n');
 
-	return 0;
+	/*  Only a check, or a search for a word, reports its result so  */
+	return ((verify_only || (index_word != NULL)) && job_failed) ? 1 : 0;
 }
 
@@ -34,22 +34,59 @@
  **************************************************************************** */
 
 #include "types.h"
+#include "fcinsn.h"
+
+/*  The dictionary covers the entire twelve-bit FCode space  */
+#define TOKEN_TABLE_SIZE    0x1000
+
+/*  How the decoder treats a token:  what operand follows it in the
+ *      FCode, and what else it does.  One of these for each FCode
+ *      number; a token that needs none of it is all zeroes.
+ */
+typedef struct token_desc {
+	u8 opnd_kind;		/*  An  opnd_kind_t                       */
+	u8 flags;
+} token_desc_t;
+
+/*  Flags  */
+#define DESC_OUTDENT     0x01	/*  Listing indents less from here on     */
+#define DESC_INDENT      0x02	/*  Listing indents more after this       */
+#define DESC_BR_INDENT   0x04	/*  More after a forward branch,
+				 *      less after a backward one         */
+#define DESC_STARTER     0x08	/*  FCode-block Starter                   */
+#define DESC_OFFS8       0x10	/*  Starter for 8-bit branch offsets      */
+#define DESC_ENDER       0x20	/*  end0  or  end1                        */
+#define DESC_OFFS16      0x40	/*  16-bit branch offsets from here on    */
 
 /*  Structure of an entry in a token-table
  *  Consists of:
  *      (1)  Name of the token
  *      (2)  FCode of the token
- *      (3)  Link-pointer to previous entry.
+ *      (3)  How the decoder treats it
+ *  The entries are copied into the dictionary by FCode number.
  */
 
 typedef struct token {
 	char *name;
 	u16 fcode;
-	struct token *prev;
+	token_desc_t desc;
 } token_t;
 
-/*  Macro for creating an entry in a token-table data-array  */
-#define TOKEN_ENTRY(num, name)   { name, (u16)num, (token_t *)NULL }
+/*  Macros for creating an entry in a token-table data-array:
+ *      one for a plain token, one for a token with an operand or
+ *      something else the decoder has to know about.
+ */
+#define TOKEN_ENTRY(num, name)   { name, (u16)num, { OPND_NONE, 0 } }
+#define DECODE_ENTRY(num, name, opnd_kind, flags)   \
+		{ name, (u16)num, { opnd_kind, flags } }
+
+/*  What  probe_pci_image()  found out about a PCI image  */
+typedef struct pci_probe {
+	int code_offset;	/*  From start of image to start of code  */
+	s64 image_len;		/*  Limited to the data available         */
+	u8 code_type;
+	bool last_image;
+} pci_probe_t;
 
 
 /*  Prototypes for functions exported from
@@ -57,18 +94,25 @@ typedef struct token {
  */
 
 void link_token(token_t *curr_token);
-void add_token(u16 number, char *name);
+void add_token(u16 number, const char *name, u8 len);
 void init_dictionary(void);
 void reset_dictionary(void);
 void freeze_dictionary(void);
-char *lookup_token(u16 number);
+const char *lookup_token(u16 number, u8 * len);
+void set_token_desc(u16 number, u8 opnd_kind, u8 flags);
 
+void init_decoder(void);
 void detokenize(void);
+void detokenize_span(s64 header_pos, s64 start_pos, s64 block_end,
+		     s64 span_end);
 
 void printremark(char *str);
+void print_remark_text(const char *str);
 
 int handle_pci_header(u8 * data_ptr);
 void handle_pci_filler(u8 * filler_ptr);
+bool probe_pci_image(u8 * data_ptr, u8 * limit, pci_probe_t * probe);
+void describe_pci_image(u8 * data_ptr, fc_insn_t * image_insn);
 
 
 /*  External declarations for variables defined in or used by
@@ -78,16 +122,19 @@ extern bool verbose;
 extern bool decode_all;
 extern bool show_linenumbers;
 extern bool show_offsets;
+extern bool scan_mode;
+extern bool json_output;
 
 extern bool check_tok_seq;
+extern const char *unnamed;
 
 extern u16 fcode;
 extern bool offs16;
 extern bool end_found;
-extern unsigned int linenum;
 
 extern u8 *pci_image_end;
-extern unsigned int token_streampos;
+extern s64 token_streampos;
 extern u16 last_defined_token;
+extern token_desc_t token_descs[TOKEN_TABLE_SIZE];
 
 #endif				/*  _UTILS_DETOK_DETOK_H    */
@@ -32,54 +32,185 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include "detok.h"
+#include "outsink.h"
 
 bool check_tok_seq = true;
-static token_t *dictionary;	/*  Initialize dynamically to accommodate AIX  */
 
-static char *fcerror = "ferror";
+/* **************************************************************************
+ *
+ *          The dictionary is a table indexed directly by FCode number,
+ *              which covers the entire twelve-bit FCode space, so a
+ *              look-up is a single array access.
+ *
+ *          It is in two layers:
+ *              The "frozen" layer holds the names in effect when the
+ *                  dictionary was last frozen:  the Standard FCodes, and
+ *                  any Vendor FCodes that were added from a list.
+ *              The "live" layer holds the names defined since, by the
+ *                  image being detokenized.  A live entry counts only if
+ *                  it was made in the current generation; resetting the
+ *                  dictionary merely starts a new generation.
+ *
+ *          Names are not copied into the dictionary.  An entry holds
+ *              a pointer and a length:  a name given by the image is a
+ *              slice of the image itself, and is not null-terminated;
+ *              a headerless token shares the one  unnamed  string.  So
+ *              defining a token allocates nothing, and the dictionary
+ *              never has anything to free.  A live entry is good only
+ *              as long as the image it came from, which is why the
+ *              dictionary must be reset before the image is let go.
+ *
+ *          Alongside it is the table of how the decoder treats each
+ *              FCode number:  the operand that follows it and whatever
+ *              else it does.  It is filled in from the same token-table
+ *              entries as the names, and from the Vendor FCodes list;
+ *              the tokens an image defines do not change it, so it has
+ *              only the one layer.
+ *
+ **************************************************************************** */
 
-char *lookup_token(u16 number)
-{
-	token_t *curr;
+typedef struct {
+	const char *name;
+	unsigned int generation;
+	u8 len;
+} token_slot_t;
+
+/*  Initialize dynamically to accommodate AIX  */
+static token_slot_t *live_tokens = NULL;
+static token_slot_t *frozen_tokens = NULL;
+static unsigned int generation = 1;
+
+static const char *fcerror = "ferror";
+
+/* **************************************************************************
+ *
+ *          Global Variables Exported
+ *     token_descs            How the decoder treats each FCode number,
+ *                                indexed directly by it
+ *
+ **************************************************************************** */
+
+token_desc_t token_descs[TOKEN_TABLE_SIZE];
+
+/* **************************************************************************
+ *
+ *      Function name:  lookup_token
+ *      Synopsis:       Return the name of the given FCode number.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             number                      The FCode number
+ *             len                         Where to put the name's length
+ *
+ *      Outputs:
+ *         Returned Value:                 Its name, or "ferror" if it
+ *                                             is not defined.  The name
+ *                                             is not null-terminated.
+ *         Supplied Pointers:
+ *             *len                        Length of the name
+ *
+ **************************************************************************** */
 
-	for (curr = dictionary; curr != NULL; curr = curr->prev)
-		if (curr->fcode == number)
-			break;
+const char *lookup_token(u16 number, u8 * len)
+{
+	token_slot_t *slot;
 
-	if (curr)
-		return curr->name;
+	if (number < TOKEN_TABLE_SIZE) {
+		slot = &live_tokens[number];
+		if (slot->generation != generation)
+			slot = &frozen_tokens[number];
+		if (slot->name) {
+			*len = slot->len;
+			return slot->name;
+		}
+	}
 
+	*len = strlen(fcerror);
 	return fcerror;
 }
 
+/* **************************************************************************
+ *
+ *      Function name:  set_token
+ *      Synopsis:       Enter a name for an FCode number into the live
+ *                          layer of the dictionary.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             number                      Numeric value of the FCode token
+ *             name                        Name of the function to display
+ *             len                         Length of the name
+ *
+ *      Outputs:
+ *         Returned Value:                 NONE
+ *
+ **************************************************************************** */
+
+static void set_token(u16 number, const char *name, u8 len)
+{
+	token_slot_t *slot;
+
+	if (number >= TOKEN_TABLE_SIZE)
+		return;
+
+	slot = &live_tokens[number];
+	slot->name = name;
+	slot->len = len;
+	slot->generation = generation;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  set_token_desc
+ *      Synopsis:       Enter how the decoder is to treat an FCode number.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             number                      Numeric value of the FCode token
+ *             opnd_kind                   The operand that follows it
+ *             flags                       Anything else the decoder has
+ *                                             to know about it
+ *
+ **************************************************************************** */
+
+void set_token_desc(u16 number, u8 opnd_kind, u8 flags)
+{
+	if (number >= TOKEN_TABLE_SIZE)
+		return;
+
+	token_descs[number].opnd_kind = opnd_kind;
+	token_descs[number].flags = flags;
+}
+
 /* **************************************************************************
  *
  *      Function name:  link_token
- *      Synopsis:       Simply link a ready-made token-table entry to
+ *      Synopsis:       Simply enter a ready-made token-table entry into
  *                          the dictionary, without side-effects.
  *
  *      Inputs:
  *         Parameters:
- *             curr_token                  The token-table entry to link
- *         Local Static Variables:
- *             dictionary                  Pointer to the "tail" of the
- *                                             FCode-Tokens vocabulary.
+ *             curr_token                  The token-table entry to enter
  *
  *      Outputs:
  *         Returned Value:                 NONE
- *         Local Static Variables:
- *             dictionary                  Updated to point to the new entry.
+ *
+ *      Process Explanation:
+ *          The entry's name is not copied.
+ *          How the decoder treats the token is entered along with it.
  *
  **************************************************************************** */
 
 void link_token( token_t *curr_token)
 {
-	curr_token->prev  = dictionary;
-
-	dictionary = curr_token;
+	set_token(curr_token->fcode, curr_token->name,
+		  strlen(curr_token->name));
+	set_token_desc(curr_token->fcode, curr_token->desc.opnd_kind,
+		       curr_token->desc.flags);
 }
 
 /* **************************************************************************
@@ -91,6 +222,7 @@ void link_token( token_t *curr_token)
  *         Parameters:
  *             number                      Numeric value of the FCode token
  *             name                        Name of the function to display
+ *             len                         Length of the name
  *         Global/Static Variables:
  *             check_tok_seq               TRUE = "Check Token Sequence"
  *                                             A retro-fit to accommodate
@@ -100,13 +232,8 @@ void link_token( token_t *curr_token)
  *         Returned Value:                 NONE
  *         Global/Static Variables:
  *             last_defined_token          Updated to the given FCode token
- *         Memory Allocated
- *             For the new entry.
- *         When Freed?
- *             Never.  Retained for duration of the program.
  *
  *      Error Detection:
- *          Failure to allocate memory is a fatal error.
  *          If the given FCode token is not exactly one larger than the
  *              previous  last_defined_token , then there's something
  *              odd going on; print a remark to alert the user.  The
@@ -114,29 +241,16 @@ void link_token( token_t *curr_token)
  *              for additional error-checking.
  *
  *      Process Explanation:
- *          The name field pointer is presumed to already point to a stable
- *              memory-space.
- *          Memory will be allocated for the entry itself; its fields will
- *              be entered and the pointer-to-the-tail-of-the-vocabulary
- *              will be updated to point to the new entry.
+ *          The name is not copied; it has to last as long as the entry
+ *              does, which is until the dictionary is next reset, or
+ *              for good once the dictionary has been frozen.
  *          Error-check and update  last_defined_token  
  *
  **************************************************************************** */
 
-void add_token(u16 number, char *name)
+void add_token(u16 number, const char *name, u8 len)
 {
-	token_t *curr;
-
-	curr = malloc(sizeof(token_t));
-	if (!curr) {
-		printf("Out of memory while adding token.\n");
-		exit(-ENOMEM);
-	}
-
-	curr->name = name;
-	curr->fcode=number;
-
-	link_token( curr);
+	set_token(number, name, len);
 
 	if (check_tok_seq) {
 		/*  Error-check, but not for first time.  */
@@ -160,20 +274,20 @@ void add_token(u16 number, char *name)
 
 token_t detok_table[] = {
 
-	TOKEN_ENTRY(0x000, "end0"),
-	TOKEN_ENTRY(0x010, "b(lit)"),
-	TOKEN_ENTRY(0x011, "b(')"),
-	TOKEN_ENTRY(0x012, "b(\")"),
-	TOKEN_ENTRY(0x013, "bbranch"),
-	TOKEN_ENTRY(0x014, "b?branch"),
-	TOKEN_ENTRY(0x015, "b(loop)"),
-	TOKEN_ENTRY(0x016, "b(+loop)"),
-	TOKEN_ENTRY(0x017, "b(do)"),
-	TOKEN_ENTRY(0x018, "b(?do)"),
+	DECODE_ENTRY(0x000, "end0", OPND_NONE, DESC_ENDER),
+	DECODE_ENTRY(0x010, "b(lit)", OPND_LITERAL, 0),
+	DECODE_ENTRY(0x011, "b(')", OPND_TOKEN, 0),
+	DECODE_ENTRY(0x012, "b(\")", OPND_STRING, 0),
+	DECODE_ENTRY(0x013, "bbranch", OPND_BRANCH, DESC_BR_INDENT),
+	DECODE_ENTRY(0x014, "b?branch", OPND_BRANCH, DESC_BR_INDENT),
+	DECODE_ENTRY(0x015, "b(loop)", OPND_BRANCH, DESC_OUTDENT),
+	DECODE_ENTRY(0x016, "b(+loop)", OPND_BRANCH, DESC_OUTDENT),
+	DECODE_ENTRY(0x017, "b(do)", OPND_BRANCH, DESC_INDENT),
+	DECODE_ENTRY(0x018, "b(?do)", OPND_BRANCH, DESC_INDENT),
 	TOKEN_ENTRY(0x019, "i"),
 	TOKEN_ENTRY(0x01a, "j"),
 	TOKEN_ENTRY(0x01b, "b(leave)"),
-	TOKEN_ENTRY(0x01c, "b(of)"),
+	DECODE_ENTRY(0x01c, "b(of)", OPND_BRANCH, DESC_INDENT),
 	TOKEN_ENTRY(0x01d, "execute"),
 	TOKEN_ENTRY(0x01e, "+"),
 	TOKEN_ENTRY(0x01f, "-"),
@@ -322,13 +436,13 @@ token_t detok_table[] = {
 	TOKEN_ENTRY(0x0ae, "aligned"),
 	TOKEN_ENTRY(0x0af, "wbsplit"),
 	TOKEN_ENTRY(0x0b0, "bwjoin"),
-	TOKEN_ENTRY(0x0b1, "b(<mark)"),
-	TOKEN_ENTRY(0x0b2, "b(>resolve)"),
+	DECODE_ENTRY(0x0b1, "b(<mark)", OPND_NONE, DESC_INDENT),
+	DECODE_ENTRY(0x0b2, "b(>resolve)", OPND_NONE, DESC_OUTDENT),
 	TOKEN_ENTRY(0x0b3, "set-token-table"),
 	TOKEN_ENTRY(0x0b4, "set-table"),
-	TOKEN_ENTRY(0x0b5, "new-token"),
-	TOKEN_ENTRY(0x0b6, "named-token"),
-	TOKEN_ENTRY(0x0b7, "b(:)"),
+	DECODE_ENTRY(0x0b5, "new-token", OPND_NEW_TOKEN, 0),
+	DECODE_ENTRY(0x0b6, "named-token", OPND_NAMED_TOKEN, 0),
+	DECODE_ENTRY(0x0b7, "b(:)", OPND_NONE, DESC_INDENT),
 	TOKEN_ENTRY(0x0b8, "b(value)"),
 	TOKEN_ENTRY(0x0b9, "b(variable)"),
 	TOKEN_ENTRY(0x0ba, "b(constant)"),
@@ -338,17 +452,17 @@ token_t detok_table[] = {
 	TOKEN_ENTRY(0x0be, "b(field)"),
 	TOKEN_ENTRY(0x0bf, "b(code)"),
 	TOKEN_ENTRY(0x0c0, "instance"),
-	TOKEN_ENTRY(0x0c2, "b(;)"),
-	TOKEN_ENTRY(0x0c3, "b(to)"),
-	TOKEN_ENTRY(0x0c4, "b(case)"),
-	TOKEN_ENTRY(0x0c5, "b(endcase)"),
-	TOKEN_ENTRY(0x0c6, "b(endof)"),
+	DECODE_ENTRY(0x0c2, "b(;)", OPND_NONE, DESC_OUTDENT),
+	DECODE_ENTRY(0x0c3, "b(to)", OPND_TOKEN, 0),
+	DECODE_ENTRY(0x0c4, "b(case)", OPND_NONE, DESC_INDENT),
+	DECODE_ENTRY(0x0c5, "b(endcase)", OPND_NONE, DESC_OUTDENT),
+	DECODE_ENTRY(0x0c6, "b(endof)", OPND_BRANCH, DESC_OUTDENT),
 	TOKEN_ENTRY(0x0c7, "#"),
 	TOKEN_ENTRY(0x0c8, "#s"),
 	TOKEN_ENTRY(0x0c9, "#>"),
-	TOKEN_ENTRY(0x0ca, "external-token"),
+	DECODE_ENTRY(0x0ca, "external-token", OPND_NAMED_TOKEN, 0),
 	TOKEN_ENTRY(0x0cb, "$find"),
-	TOKEN_ENTRY(0x0cc, "offset16"),
+	DECODE_ENTRY(0x0cc, "offset16", OPND_NONE, DESC_OFFS16),
 	TOKEN_ENTRY(0x0cd, "evaluate"),
 	TOKEN_ENTRY(0x0d0, "c,"),
 	TOKEN_ENTRY(0x0d1, "w,"),
@@ -363,14 +477,14 @@ token_t detok_table[] = {
 	TOKEN_ENTRY(0x0dc, "state"),
 	TOKEN_ENTRY(0x0dd, "compile,"),
 	TOKEN_ENTRY(0x0de, "behavior"),
-	TOKEN_ENTRY(0x0f0, "start0"),
-	TOKEN_ENTRY(0x0f1, "start1"),
-	TOKEN_ENTRY(0x0f2, "start2"),
-	TOKEN_ENTRY(0x0f3, "start4"),
+	DECODE_ENTRY(0x0f0, "start0", OPND_NONE, DESC_STARTER),
+	DECODE_ENTRY(0x0f1, "start1", OPND_NONE, DESC_STARTER),
+	DECODE_ENTRY(0x0f2, "start2", OPND_NONE, DESC_STARTER),
+	DECODE_ENTRY(0x0f3, "start4", OPND_NONE, DESC_STARTER),
 	TOKEN_ENTRY(0x0fc, "ferror"),
-	TOKEN_ENTRY(0x0fd, "version1"),
+	DECODE_ENTRY(0x0fd, "version1", OPND_NONE, DESC_STARTER | DESC_OFFS8),
 	TOKEN_ENTRY(0x0fe, "4-byte-id"),
-	TOKEN_ENTRY(0x0ff, "end1"),
+	DECODE_ENTRY(0x0ff, "end1", OPND_NONE, DESC_ENDER),
 	TOKEN_ENTRY(0x101, "dma-alloc"),
 	TOKEN_ENTRY(0x102, "my-address"),
 	TOKEN_ENTRY(0x103, "my-space"),
@@ -549,35 +663,78 @@ token_t detok_table[] = {
 static const int dictionary_indx_max =
     (sizeof(detok_table) / sizeof(token_t));
 
-static token_t *dictionary_reset_position;
+/* **************************************************************************
+ *
+ *      Function name:  init_dictionary
+ *      Synopsis:       Allocate the dictionary and enter the Standard
+ *                          FCodes into it.
+ *
+ *      Process Explanation:
+ *          The Standard FCodes are entered into the live layer and
+ *              then frozen, so that Vendor FCodes added from a list
+ *              can take their place in the same way as if they had
+ *              been in the  detok_table .
+ *
+ **************************************************************************** */
 
 void init_dictionary(void)
 {
 	int indx;
 
-	dictionary = &detok_table[dictionary_indx_max - 1];
-	dictionary_reset_position = dictionary;
+	live_tokens = calloc(TOKEN_TABLE_SIZE, sizeof(token_slot_t));
+	frozen_tokens = calloc(TOKEN_TABLE_SIZE, sizeof(token_slot_t));
+	if (!live_tokens || !frozen_tokens) {
+		out_str("Out of memory while initializing dictionary.\n");
+		exit(-ENOMEM);
+	}
 
-	for (indx = 1; indx < dictionary_indx_max; indx++) {
-		detok_table[indx].prev = &detok_table[indx - 1];
+	memset(token_descs, 0, sizeof(token_descs));
+	for (indx = 0; indx < dictionary_indx_max; indx++) {
+		link_token(&detok_table[indx]);
 	}
+	freeze_dictionary();
 }
 
+/* **************************************************************************
+ *
+ *      Function name:  reset_dictionary
+ *      Synopsis:       Forget the tokens defined since the dictionary
+ *                          was last frozen.
+ *
+ *      Process Explanation:
+ *          Start a new generation; every live entry becomes stale.
+ *
+ **************************************************************************** */
+
 void reset_dictionary(void)
 {
-	token_t *next_t;
-
-	next_t = dictionary;
-	while (next_t != dictionary_reset_position) {
-		next_t = dictionary->prev;
-		free(dictionary->name);
-		free(dictionary);
-		dictionary = next_t;
-	}
+	generation++;
 }
 
-/*  If FCodes have been added by User, we need to update reset-position  */
+/* **************************************************************************
+ *
+ *      Function name:  freeze_dictionary
+ *      Synopsis:       Make the tokens defined so far permanent, so that
+ *                          they survive  reset_dictionary() .
+ *
+ *      Process Explanation:
+ *          Move the current live entries into the frozen layer, then
+ *              start a new generation.
+ *          If FCodes have been added by User, this must be called
+ *              once they are all in.
+ *
+ **************************************************************************** */
+
 void freeze_dictionary(void)
 {
-	dictionary_reset_position = dictionary;
+	int indx;
+
+	for (indx = 0; indx < TOKEN_TABLE_SIZE; indx++) {
+		token_slot_t *slot = &live_tokens[indx];
+		if (slot->generation == generation) {
+			frozen_tokens[indx] = *slot;
+		}
+		slot->name = NULL;
+	}
+	generation++;
 }
@@ -0,0 +1,1042 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcdiff.c - compare the definitions in two FCode images, token by
+ *                 token, rather than their listings line by line.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Support for the  --diff  option.
+ *
+ *      Two listings of different versions of a ROM differ on nearly
+ *          every line, because the offsets, and the FCode numbers the
+ *          tokenizer assigned, move whenever anything ahead of them
+ *          changes.  So each image is decoded, by the same decoder as
+ *          the listing, into a list of tokens, each kept as a line of
+ *          text from which everything that merely moves has been left
+ *          out:  the FCode numbers of definitions, and the offsets of
+ *          branches.  The names of the words a definition uses stay in.
+ *
+ *      Each line of text is kept just once, for both images, and a
+ *          token is only the number of its line and its offset in the
+ *          file, so two tokens are the same if their numbers are.
+ *
+ *      The tokens are divided into definitions the same way the  --word
+ *          option divides them:  each runs from the token that assigns
+ *          its FCode number up to the next one, or to the end of its
+ *          FCode block.  What comes before the first definition in a
+ *          block goes by itself, as the start of that block.
+ *
+ *      A definition with a name is matched with the one of the same name
+ *          in the other image; one without, with one whose tokens are
+ *          all the same; the start of a block, with the start of the
+ *          block with the same number.  Where a name is assigned more
+ *          than once, the first is matched with the first, and so on.
+ *          Two definitions that are matched but are not the same are
+ *          compared with Myers' algorithm, in the form that finds the
+ *          middle of the path and works on either half of it, so it
+ *          needs no more room than a few lists of its own.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "detok.h"
+#include "stream.h"
+#include "outsink.h"
+#include "fcinsn.h"
+#include "fcdiff.h"
+
+/*  What a unit of comparison is  */
+#define UNIT_NAMED        0	/*  A definition with a name              */
+#define UNIT_HEADERLESS   1	/*  One without                           */
+#define UNIT_BLOCK_START  2	/*  The tokens before the first of them   */
+
+#define NO_MATCH          0xffffffff
+
+/*  Edits allowed each way in finding the middle of a path.  Past
+ *      that, the search settles for the furthest point it has reached,
+ *      which bounds the time taken on definitions that have next to
+ *      nothing left in common, at the cost of an edit script that is
+ *      not always the shortest.
+ */
+#define DIFF_MAX_COST     1024
+
+typedef struct {
+	u32 first;		/*  Index of its first token        */
+	u32 count;		/*  How many tokens                 */
+	u32 name;		/*  Line of text of its name        */
+	u32 serial;		/*  Number of its block in the file */
+	u32 key;		/*  Hash it is matched by           */
+	u32 match;		/*  Unit matched in the other image */
+	u32 pos;		/*  Where it starts in the file     */
+	u8 kind;
+} diff_unit_t;
+
+typedef struct {
+	char *filnam;
+	u32 *texts;		/*  Line of text of each token      */
+	u32 *posns;		/*  Its offset in the file          */
+	u32 token_count;
+	u32 token_max;
+	diff_unit_t *units;
+	u32 unit_count;
+	u32 unit_max;
+	u32 block_count;
+	bool in_unit;		/*  Whether the next token goes on  */
+} diff_image_t;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     text_arena                  The lines of text, one after another,
+ *                                     each null-terminated
+ *     text_start                  Where each one starts in the arena
+ *     text_hash                   Hash of each one
+ *     text_table                  Open-addressed table of lines, by
+ *                                     hash; one more than the number of
+ *                                     the line, or zero for none
+ *     images                      The two images, old and new
+ *     fwd_reach, rev_reach        Lists for the comparison:  how far
+ *                                     along each diagonal the paths from
+ *                                     the start and from the end reach
+ *     diff_old, diff_new          The images being compared, and the
+ *     old_first, new_first            first tokens of the definitions
+ *
+ **************************************************************************** */
+
+static char *text_arena = NULL;
+static size_t arena_len = 0;
+static size_t arena_max = 0;
+static size_t *text_start = NULL;
+static u32 *text_hash = NULL;
+static u32 text_count = 0;
+static u32 text_max = 0;
+static u32 *text_table = NULL;
+static u32 table_size = 0;
+
+static diff_image_t images[2];
+
+static long fwd_reach[2 * DIFF_MAX_COST + 2];
+static long rev_reach[2 * DIFF_MAX_COST + 2];
+
+static const diff_image_t *diff_old;
+static const diff_image_t *diff_new;
+static u32 old_first;
+static u32 new_first;
+
+/*  Out of memory:  there is no going on  */
+static void out_of_memory(void)
+{
+	out_str("Out of memory while comparing.\n");
+	exit(-ENOMEM);
+}
+
+static void *diff_realloc(void *ptr, size_t size)
+{
+	void *nu_ptr = realloc(ptr, size);
+	if (!nu_ptr)
+		out_of_memory();
+	return nu_ptr;
+}
+
+static u32 fnv_hash(u32 hash, const u8 * ptr, size_t len)
+{
+	size_t indx;
+
+	for (indx = 0; indx < len; indx++) {
+		hash ^= ptr[indx];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+#define FNV_START  2166136261u
+
+static const char *text_of(u32 text)
+{
+	return text_arena + text_start[text];
+}
+
+/*  Not counting the null at its end  */
+static size_t text_len(u32 text)
+{
+	size_t end = (text + 1 < text_count) ? text_start[text + 1]
+	    : arena_len;
+	return end - text_start[text] - 1;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  keep_line
+ *      Synopsis:       Find a line of text among those kept, adding it
+ *                          if it is not there yet.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             str                The text
+ *             len                Its length
+ *
+ *      Outputs:
+ *         Returned Value:        The number of the line
+ *         Memory Allocated
+ *             The arena, and the lists and table that go with it, grow
+ *                 by doubling.
+ *         When Freed?
+ *             By  forget_lines() , once the comparison is done.
+ *
+ **************************************************************************** */
+
+static u32 keep_line(const char *str, size_t len)
+{
+	u32 hash = fnv_hash(FNV_START, (const u8 *)str, len);
+	u32 slot;
+	u32 text;
+
+	if (2 * (text_count + 1) > table_size) {
+		u32 indx;
+		table_size = table_size ? 2 * table_size : 0x1000;
+		free(text_table);
+		text_table = calloc(table_size, sizeof(u32));
+		if (!text_table)
+			out_of_memory();
+		for (indx = 0; indx < text_count; indx++) {
+			slot = text_hash[indx] & (table_size - 1);
+			while (text_table[slot] != 0)
+				slot = (slot + 1) & (table_size - 1);
+			text_table[slot] = indx + 1;
+		}
+	}
+
+	slot = hash & (table_size - 1);
+	while (text_table[slot] != 0) {
+		text = text_table[slot] - 1;
+		if ((text_hash[text] == hash) && (text_len(text) == len)
+		    && (memcmp(text_of(text), str, len) == 0))
+			return text;
+		slot = (slot + 1) & (table_size - 1);
+	}
+
+	if (text_count == text_max) {
+		text_max = text_max ? 2 * text_max : 0x1000;
+		text_start = diff_realloc(text_start,
+					  text_max * sizeof(size_t));
+		text_hash = diff_realloc(text_hash, text_max * sizeof(u32));
+	}
+	while (arena_len + len + 1 > arena_max) {
+		arena_max = arena_max ? 2 * arena_max : 0x10000;
+		text_arena = diff_realloc(text_arena, arena_max);
+	}
+
+	text = text_count++;
+	text_start[text] = arena_len;
+	text_hash[text] = hash;
+	memcpy(text_arena + arena_len, str, len);
+	text_arena[arena_len + len] = 0;
+	arena_len += len + 1;
+	text_table[slot] = text + 1;
+	return text;
+}
+
+static void forget_lines(void)
+{
+	free(text_arena);
+	free(text_start);
+	free(text_hash);
+	free(text_table);
+	text_arena = NULL;
+	text_start = NULL;
+	text_hash = NULL;
+	text_table = NULL;
+	arena_len = arena_max = 0;
+	text_count = text_max = table_size = 0;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  token_line
+ *      Synopsis:       Write out the line of text that stands for a
+ *                          token in the comparison.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn               The record of the token
+ *             bufr               Where to write it; room for a name,
+ *                                    and a string of 255 bytes written
+ *                                    out in hex, is enough
+ *
+ *      Outputs:
+ *         Returned Value:        Its length
+ *
+ *      Process Explanation:
+ *          Much as the listing shows it, on one line, but without the
+ *              FCode number a definition is given, or the offset of a
+ *              branch, which move with anything that comes before them.
+ *          The name of a word defined without one is the same for all
+ *              of them, and likewise for a word that uses one; which of
+ *              them it is shows only in its FCode number.
+ *
+ **************************************************************************** */
+
+static size_t token_name(char *bufr, u16 token, const char *name,
+			 u8 name_len, bool invalid)
+{
+	if (invalid)
+		return sprintf(bufr, "[invalid 0x%03x]", token);
+	memcpy(bufr, name, name_len);
+	return name_len;
+}
+
+static size_t token_line(const fc_insn_t * insn, char *bufr)
+{
+	size_t len;
+	int indx;
+
+	len = token_name(bufr, insn->fcode, insn->name, insn->name_len,
+			 (insn->flags & INSN_INVALID) != 0);
+	if (insn->flags & INSN_PARTIAL)
+		return len + sprintf(bufr + len, " (cut short)");
+
+	switch (insn->opnd_kind) {
+	case OPND_LITERAL:
+		len += sprintf(bufr + len, " 0x%x", insn->opnd.literal);
+		break;
+	case OPND_STRING:
+		bufr[len++] = ' ';
+		bufr[len++] = '"';
+		for (indx = 0; indx < insn->opnd.string.len; indx++) {
+			u8 c = insn->opnd.string.ptr[indx];
+			if (isprint(c) && (c != '"') && (c != '\\'))
+				bufr[len++] = c;
+			else
+				len += sprintf(bufr + len, "\\x%02x", c);
+		}
+		bufr[len++] = '"';
+		break;
+	case OPND_NAMED_TOKEN:
+		bufr[len++] = ' ';
+		/*  An embedded null ends the name  */
+		indx = strnlen((const char *)insn->opnd.new_token.ptr,
+			       insn->opnd.new_token.len);
+		memcpy(bufr + len, insn->opnd.new_token.ptr, indx);
+		len += indx;
+		break;
+	case OPND_TOKEN:
+		bufr[len++] = ' ';
+		len += token_name(bufr + len, insn->opnd.token.token,
+				  insn->opnd.token.name,
+				  insn->opnd.token.name_len,
+				  (insn->flags & INSN_OPND_BAD) != 0);
+		break;
+	case OPND_QUAD:
+		len += sprintf(bufr + len, " 0x%04x.%04x.%04x.%04x",
+			       insn->opnd.quad[0], insn->opnd.quad[1],
+			       insn->opnd.quad[2], insn->opnd.quad[3]);
+		break;
+	case OPND_BRANCH:
+	case OPND_NEW_TOKEN:
+	case OPND_NONE:
+	default:
+		break;
+	}
+	return len;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  start_unit
+ *      Synopsis:       Start a new unit of comparison in an image.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             image              The image
+ *             kind               UNIT_NAMED , etc.
+ *             pos                Where it starts in the file
+ *             name               Line of text of its name, if it has one
+ *
+ *      Process Explanation:
+ *          The start of a block that has no tokens before its first
+ *              definition does not count; the unit is used over.
+ *
+ **************************************************************************** */
+
+static void start_unit(diff_image_t * image, u8 kind, s64 pos, u32 name)
+{
+	diff_unit_t *unit;
+
+	if ((image->unit_count > 0)
+	    && (image->units[image->unit_count - 1].count == 0))
+		image->unit_count--;
+
+	if (image->unit_count == image->unit_max) {
+		image->unit_max = image->unit_max ? 2 * image->unit_max : 256;
+		image->units = diff_realloc(image->units,
+					    image->unit_max *
+					    sizeof(diff_unit_t));
+	}
+	unit = &image->units[image->unit_count++];
+	memset(unit, 0, sizeof(diff_unit_t));
+	unit->first = image->token_count;
+	unit->kind = kind;
+	unit->pos = (u32) pos;
+	unit->name = name;
+	unit->serial = image->block_count - 1;
+	unit->match = NO_MATCH;
+	image->in_unit = true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  diff_insn
+ *      Synopsis:       A sink that adds each token to the image being
+ *                          read, and divides them into units.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn               The record
+ *             image_data         The image, a  diff_image_t
+ *
+ *      Process Explanation:
+ *          A header found within a block does not start a new one, any
+ *              more than it does for the decoder.  Remarks, headers and
+ *              the like are left out of the comparison.
+ *
+ **************************************************************************** */
+
+static void diff_insn(const fc_insn_t * insn, void *image_data)
+{
+	diff_image_t *image = image_data;
+	s64 pos = get_stream_origin() + insn->offset;
+	char bufr[1536];
+	u32 text;
+
+	switch (insn->kind) {
+	case INSN_HEADER:
+		if (insn->flags & INSN_MIDBLOCK)
+			break;
+		/*  Fall through  */
+	case INSN_BAD_START:
+		image->block_count++;
+		start_unit(image, UNIT_BLOCK_START, pos, 0);
+		break;
+	case INSN_BLOCK_END:
+		image->in_unit = false;
+		break;
+	case INSN_TOKEN:
+		if (insn->opnd_kind == OPND_NAMED_TOKEN) {
+			size_t len = strnlen((const char *)
+					     insn->opnd.new_token.ptr,
+					     insn->opnd.new_token.len);
+			start_unit(image, UNIT_NAMED, pos,
+				   keep_line((const char *)
+					     insn->opnd.new_token.ptr, len));
+		} else if (insn->opnd_kind == OPND_NEW_TOKEN) {
+			start_unit(image, UNIT_HEADERLESS, pos, 0);
+		} else if (!image->in_unit) {
+			start_unit(image, UNIT_BLOCK_START, pos, 0);
+		}
+
+		text = keep_line(bufr, token_line(insn, bufr));
+		if (image->token_count == image->token_max) {
+			image->token_max = image->token_max
+			    ? 2 * image->token_max : 0x1000;
+			image->texts = diff_realloc(image->texts,
+						    image->token_max *
+						    sizeof(u32));
+			image->posns = diff_realloc(image->posns,
+						    image->token_max *
+						    sizeof(u32));
+		}
+		image->texts[image->token_count] = text;
+		image->posns[image->token_count] = (u32) pos;
+		image->token_count++;
+		image->units[image->unit_count - 1].count++;
+		break;
+	default:
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_image
+ *      Synopsis:       Decode an input file into a list of tokens,
+ *                          divided into units.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             image              Where to put it
+ *             in_filnam          Name of the input file
+ *
+ *      Outputs:
+ *         Returned Value:        FALSE if the file could not be read
+ *         Printout:
+ *             A message, if so
+ *
+ *      Process Explanation:
+ *          The dictionary is left as it was, for the other file.
+ *
+ **************************************************************************** */
+
+static bool read_image(diff_image_t * image, char *in_filnam)
+{
+	insn_sink_t prev_sink;
+	void *prev_sink_data;
+
+	memset(image, 0, sizeof(diff_image_t));
+	image->filnam = in_filnam;
+
+	if (init_stream(in_filnam)) {
+		out_printf("Could not open file \"%s\".\n", in_filnam);
+		return false;
+	}
+	/*  The offsets of the tokens are kept in 32 bits  */
+	if (stream_max > 0xffffffffLL) {
+		out_printf("File \"%s\" is too large to compare.\n",
+			   in_filnam);
+		close_stream();
+		return false;
+	}
+
+	prev_sink = get_insn_sink(&prev_sink_data);
+	set_insn_sink(diff_insn, image);
+	init_decoder();
+	detokenize();
+	set_insn_sink(prev_sink, prev_sink_data);
+	reset_dictionary();
+	close_stream();
+
+	if ((image->unit_count > 0)
+	    && (image->units[image->unit_count - 1].count == 0))
+		image->unit_count--;
+	return true;
+}
+
+static void free_image(diff_image_t * image)
+{
+	free(image->texts);
+	free(image->posns);
+	free(image->units);
+	memset(image, 0, sizeof(diff_image_t));
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  same_tokens
+ *      Synopsis:       Whether two units, one in each image, are made of
+ *                          the same tokens.
+ *
+ **************************************************************************** */
+
+static bool same_tokens(const diff_unit_t * old_unit,
+			const diff_unit_t * new_unit)
+{
+	return (old_unit->count == new_unit->count)
+	    && (memcmp(&images[0].texts[old_unit->first],
+		       &images[1].texts[new_unit->first],
+		       old_unit->count * sizeof(u32)) == 0);
+}
+
+/*  Whether two units, one in each image, are the ones to be matched  */
+static bool same_unit(const diff_unit_t * old_unit,
+		      const diff_unit_t * new_unit)
+{
+	if (old_unit->kind != new_unit->kind)
+		return false;
+	switch (old_unit->kind) {
+	case UNIT_NAMED:
+		return strcasecmp(text_of(old_unit->name),
+				  text_of(new_unit->name)) == 0;
+	case UNIT_HEADERLESS:
+		return same_tokens(old_unit, new_unit);
+	default:
+		return old_unit->serial == new_unit->serial;
+	}
+}
+
+/*  Hash of what a unit is to be matched by:  as  same_unit()  says  */
+static u32 unit_key(const diff_image_t * image, const diff_unit_t * unit)
+{
+	u32 hash = FNV_START ^ unit->kind;
+	const char *name;
+
+	switch (unit->kind) {
+	case UNIT_NAMED:
+		for (name = text_of(unit->name); *name != 0; name++) {
+			u8 c = tolower((u8) * name);
+			hash = fnv_hash(hash, &c, 1);
+		}
+		return hash;
+	case UNIT_HEADERLESS:
+		return fnv_hash(hash, (const u8 *)&image->texts[unit->first],
+				unit->count * sizeof(u32));
+	default:
+		return fnv_hash(hash, (const u8 *)&unit->serial, sizeof(u32));
+	}
+}
+
+/*  For sorting one image's units by kind, then key, then position  */
+static const diff_unit_t *sort_units;
+
+static int compare_units(const void *left, const void *right)
+{
+	const diff_unit_t *l_unit = &sort_units[*(const u32 *)left];
+	const diff_unit_t *r_unit = &sort_units[*(const u32 *)right];
+
+	if (l_unit->kind != r_unit->kind)
+		return l_unit->kind < r_unit->kind ? -1 : 1;
+	if (l_unit->key != r_unit->key)
+		return l_unit->key < r_unit->key ? -1 : 1;
+	return (l_unit > r_unit) - (l_unit < r_unit);
+}
+
+static u32 *sorted_units(diff_image_t * image)
+{
+	u32 *order = diff_realloc(NULL, (image->unit_count + 1)
+				  * sizeof(u32));
+	u32 indx;
+
+	for (indx = 0; indx < image->unit_count; indx++) {
+		image->units[indx].key = unit_key(image, &image->units[indx]);
+		order[indx] = indx;
+	}
+	sort_units = image->units;
+	qsort(order, image->unit_count, sizeof(u32), compare_units);
+	return order;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  match_units
+ *      Synopsis:       Match each unit in the old image with the one it
+ *                          became in the new one, if any.
+ *
+ *      Outputs:
+ *         Local Static Variables:
+ *             images             The  match  of each unit in either one
+ *
+ *      Process Explanation:
+ *          Both lists of units are sorted by kind and key, and gone
+ *              through side by side.  Within a run of units with the
+ *              same key, in order of position, each old unit takes the
+ *              first new one not yet taken that it matches; a key can
+ *              be shared by units that do not.
+ *
+ **************************************************************************** */
+
+static void match_units(void)
+{
+	diff_unit_t *old_units = images[0].units;
+	diff_unit_t *new_units = images[1].units;
+	u32 *old_order = sorted_units(&images[0]);
+	u32 *new_order = sorted_units(&images[1]);
+	u32 old_indx = 0;
+	u32 new_indx = 0;
+
+	while ((old_indx < images[0].unit_count)
+	       && (new_indx < images[1].unit_count)) {
+		diff_unit_t *old_unit = &old_units[old_order[old_indx]];
+		diff_unit_t *new_unit = &new_units[new_order[new_indx]];
+		u32 old_end = old_indx;
+		u32 new_end = new_indx;
+		u32 first_free = new_indx;
+		u32 indx;
+
+		if ((old_unit->kind != new_unit->kind)
+		    || (old_unit->key != new_unit->key)) {
+			if ((old_unit->kind < new_unit->kind)
+			    || ((old_unit->kind == new_unit->kind)
+				&& (old_unit->key < new_unit->key)))
+				old_indx++;
+			else
+				new_indx++;
+			continue;
+		}
+
+		while ((old_end < images[0].unit_count)
+		       && (old_units[old_order[old_end]].kind == old_unit->kind)
+		       && (old_units[old_order[old_end]].key == old_unit->key))
+			old_end++;
+		while ((new_end < images[1].unit_count)
+		       && (new_units[new_order[new_end]].kind == old_unit->kind)
+		       && (new_units[new_order[new_end]].key == old_unit->key))
+			new_end++;
+
+		for (; old_indx < old_end; old_indx++) {
+			old_unit = &old_units[old_order[old_indx]];
+			while ((first_free < new_end)
+			       && (new_units[new_order[first_free]].match
+				   != NO_MATCH))
+				first_free++;
+			for (indx = first_free; indx < new_end; indx++) {
+				new_unit = &new_units[new_order[indx]];
+				if ((new_unit->match == NO_MATCH)
+				    && same_unit(old_unit, new_unit)) {
+					old_unit->match = new_order[indx];
+					new_unit->match = old_order[old_indx];
+					break;
+				}
+			}
+		}
+		new_indx = new_end;
+	}
+
+	free(old_order);
+	free(new_order);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  middle_snake
+ *      Synopsis:       Find a point on a shortest path of edits from one
+ *                          list of tokens to another, about halfway
+ *                          along it.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_toks, old_len  The first list
+ *             new_toks, new_len  The second.  Neither is empty, and
+ *                                    they differ at both ends.
+ *
+ *      Outputs:
+ *         Supplied Pointers:
+ *             *old_split, *new_split     The point:  the edits for the
+ *                                    parts before and after it together
+ *                                    make up a shortest path.
+ *
+ *      Process Explanation:
+ *          Myers' "An O(ND) Difference Algorithm and Its Variations",
+ *              section 4b:  paths are followed from both ends at once,
+ *              one more edit each way at a time, until they meet.  For
+ *              each diagonal, the lists hold how far along it the path
+ *              with that many edits reaches; a diagonal that has run off
+ *              the edge of either list is dropped from then on.
+ *          If they have not met within  DIFF_MAX_COST  edits each way,
+ *              the point is the furthest the path from the start got.
+ *              The edits on either side of it are still a true account
+ *              of the change, if not always the shortest.
+ *
+ **************************************************************************** */
+
+static void middle_snake(const u32 * old_toks, long old_len,
+			 const u32 * new_toks, long new_len,
+			 long *old_split, long *new_split)
+{
+	long max_d = (old_len + new_len + 1) / 2;
+	long offset;
+	long delta = old_len - new_len;
+	bool odd = (delta % 2) != 0;
+	long fwd_start = 0, fwd_end = 0;
+	long rev_start = 0, rev_end = 0;
+	long best = -1;
+	long d, k, indx;
+
+	if (max_d > DIFF_MAX_COST)
+		max_d = DIFF_MAX_COST;
+	offset = max_d;
+	for (indx = 0; indx < 2 * max_d + 2; indx++) {
+		fwd_reach[indx] = -1;
+		rev_reach[indx] = -1;
+	}
+	fwd_reach[offset + 1] = 0;
+	rev_reach[offset + 1] = 0;
+
+	for (d = 0; d < max_d; d++) {
+		for (k = -d + fwd_start; k <= d - fwd_end; k += 2) {
+			long k_indx = offset + k;
+			long x, y;
+
+			if ((k == -d) || ((k != d) && (fwd_reach[k_indx - 1]
+						       < fwd_reach[k_indx + 1])))
+				x = fwd_reach[k_indx + 1];
+			else
+				x = fwd_reach[k_indx - 1] + 1;
+			y = x - k;
+			while ((x < old_len) && (y < new_len)
+			       && (old_toks[x] == new_toks[y])) {
+				x++;
+				y++;
+			}
+			fwd_reach[k_indx] = x;
+			if (x > old_len) {
+				fwd_end += 2;
+			} else if (y > new_len) {
+				fwd_start += 2;
+			} else {
+				long r_indx = offset + delta - k;
+				if (odd && (r_indx >= 0)
+				    && (r_indx < 2 * max_d + 2)
+				    && (rev_reach[r_indx] != -1)
+				    && (x >= old_len - rev_reach[r_indx])) {
+					*old_split = x;
+					*new_split = y;
+					return;
+				}
+				if (x + y > best) {
+					best = x + y;
+					*old_split = x;
+					*new_split = y;
+				}
+			}
+		}
+
+		for (k = -d + rev_start; k <= d - rev_end; k += 2) {
+			long k_indx = offset + k;
+			long x, y;
+
+			if ((k == -d) || ((k != d) && (rev_reach[k_indx - 1]
+						       < rev_reach[k_indx + 1])))
+				x = rev_reach[k_indx + 1];
+			else
+				x = rev_reach[k_indx - 1] + 1;
+			y = x - k;
+			while ((x < old_len) && (y < new_len)
+			       && (old_toks[old_len - x - 1]
+				   == new_toks[new_len - y - 1])) {
+				x++;
+				y++;
+			}
+			rev_reach[k_indx] = x;
+			if (x > old_len) {
+				rev_end += 2;
+			} else if (y > new_len) {
+				rev_start += 2;
+			} else if (!odd) {
+				long f_indx = offset + delta - k;
+				if ((f_indx >= 0) && (f_indx < 2 * max_d + 2)
+				    && (fwd_reach[f_indx] != -1)
+				    && (fwd_reach[f_indx] >= old_len - x)) {
+					*old_split = fwd_reach[f_indx];
+					*new_split = fwd_reach[f_indx]
+					    - (f_indx - offset);
+					return;
+				}
+			}
+		}
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  print_edit
+ *      Synopsis:       Print one line of the edit script:  a token taken
+ *                          out of the old image, or put into the new.
+ *
+ **************************************************************************** */
+
+static void print_edit(char sign, const diff_image_t * image, u32 token)
+{
+	out_printf("%c  0x%06x  %s\n", sign, image->posns[token],
+		   text_of(image->texts[token]));
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  diff_tokens
+ *      Synopsis:       Print the edits that turn one part of the old
+ *                          definition into the matching part of the new.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_lo, old_hi     The part of the old one, counted from
+ *                                    old_first
+ *             new_lo, new_hi     Likewise, of the new one
+ *         Local Static Variables:
+ *             diff_old, diff_new, old_first, new_first
+ *
+ *      Outputs:
+ *         Printout:
+ *             The tokens removed and added, in order
+ *
+ *      Process Explanation:
+ *          Whatever the two have in common at either end is set aside;
+ *              then the rest is split at the middle of a shortest path,
+ *              and each side of it is done the same way.
+ *          If the split would make no progress -- which should not
+ *              happen -- the part is shown as all removed and all added.
+ *              That is still a true account of the change, if not the
+ *              shortest.
+ *
+ **************************************************************************** */
+
+static void diff_tokens(long old_lo, long old_hi, long new_lo, long new_hi)
+{
+	const u32 *old_toks = &diff_old->texts[old_first];
+	const u32 *new_toks = &diff_new->texts[new_first];
+	long old_split = -1;
+	long new_split = -1;
+	long indx;
+
+	while ((old_lo < old_hi) && (new_lo < new_hi)
+	       && (old_toks[old_lo] == new_toks[new_lo])) {
+		old_lo++;
+		new_lo++;
+	}
+	while ((old_lo < old_hi) && (new_lo < new_hi)
+	       && (old_toks[old_hi - 1] == new_toks[new_hi - 1])) {
+		old_hi--;
+		new_hi--;
+	}
+
+	if ((old_lo < old_hi) && (new_lo < new_hi))
+		middle_snake(old_toks + old_lo, old_hi - old_lo,
+			     new_toks + new_lo, new_hi - new_lo,
+			     &old_split, &new_split);
+	if ((old_split >= 0) && (old_split <= old_hi - old_lo)
+	    && (new_split >= 0) && (new_split <= new_hi - new_lo)
+	    && ((old_split > 0) || (new_split > 0))
+	    && ((old_split < old_hi - old_lo)
+		|| (new_split < new_hi - new_lo))) {
+		diff_tokens(old_lo, old_lo + old_split,
+			    new_lo, new_lo + new_split);
+		diff_tokens(old_lo + old_split, old_hi,
+			    new_lo + new_split, new_hi);
+		return;
+	}
+
+	for (indx = old_lo; indx < old_hi; indx++)
+		print_edit('-', diff_old, old_first + indx);
+	for (indx = new_lo; indx < new_hi; indx++)
+		print_edit('+', diff_new, new_first + indx);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  unit_title
+ *      Synopsis:       Print what a unit is, for the line that starts
+ *                          its part of the report.
+ *
+ **************************************************************************** */
+
+static void unit_title(const diff_unit_t * unit)
+{
+	switch (unit->kind) {
+	case UNIT_NAMED:
+		out_str(text_of(unit->name));
+		break;
+	case UNIT_HEADERLESS:
+		out_str("(headerless)");
+		break;
+	default:
+		out_str("(start of FCode block)");
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  diff_files
+ *      Synopsis:       Compare the definitions in two input files, and
+ *                          print what was removed, added and changed.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_filnam         Name of the older file
+ *             new_filnam         Name of the newer one
+ *
+ *      Outputs:
+ *         Returned Value:        Zero if they have the same definitions,
+ *                                    one if not, two if either file
+ *                                    could not be read
+ *         Printout:
+ *             A remark for each definition removed, added or changed,
+ *                 with where it is in each file.  A changed one is
+ *                 followed by its edit script:  each token removed,
+ *                 marked with a  - , and each token added, with a  + ,
+ *                 in order, with its offset in the file.  Last, a count
+ *                 of each.
+ *
+ **************************************************************************** */
+
+int diff_files(char *old_filnam, char *new_filnam)
+{
+	u32 counts[4] = { 0, 0, 0, 0 };	/*  Same, changed, removed, added  */
+	u32 indx;
+	int retval = 2;
+
+	if (read_image(&images[0], old_filnam)
+	    && read_image(&images[1], new_filnam)) {
+		match_units();
+
+		for (indx = 0; indx < images[0].unit_count; indx++) {
+			diff_unit_t *unit = &images[0].units[indx];
+			if (unit->match != NO_MATCH)
+				continue;
+			counts[2]++;
+			out_str("\\  Removed:  ");
+			unit_title(unit);
+			out_printf(", at 0x%lx in %s  (%u tokens)\n",
+				   (unsigned long)unit->pos, old_filnam,
+				   unit->count);
+		}
+
+		for (indx = 0; indx < images[1].unit_count; indx++) {
+			diff_unit_t *unit = &images[1].units[indx];
+			diff_unit_t *old_unit;
+
+			if (unit->match == NO_MATCH) {
+				counts[3]++;
+				out_str("\\  Added:  ");
+				unit_title(unit);
+				out_printf(", at 0x%lx in %s  (%u tokens)\n",
+					   (unsigned long)unit->pos,
+					   new_filnam, unit->count);
+				continue;
+			}
+			old_unit = &images[0].units[unit->match];
+			if (same_tokens(old_unit, unit)) {
+				counts[0]++;
+				continue;
+			}
+
+			counts[1]++;
+			out_str("\\  Changed:  ");
+			unit_title(unit);
+			out_printf(", at 0x%lx in %s and at 0x%lx in %s\n",
+				   (unsigned long)old_unit->pos,
+				   old_filnam,
+				   (unsigned long)unit->pos, new_filnam);
+			diff_old = &images[0];
+			diff_new = &images[1];
+			old_first = old_unit->first;
+			new_first = unit->first;
+			diff_tokens(0, old_unit->count, 0, unit->count);
+		}
+
+		out_printf("\\  %u the same, %u changed, %u removed, "
+			   "%u added.\n", counts[0], counts[1], counts[2],
+			   counts[3]);
+		retval = (counts[1] + counts[2] + counts[3]) ? 1 : 0;
+	}
+
+	free_image(&images[0]);
+	free_image(&images[1]);
+	forget_lines();
+	return retval;
+}
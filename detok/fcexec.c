@@ -0,0 +1,3120 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcexec.c - run an FCode image in a sandbox, the way a system would
+ *                 probe it, and count what that costs.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Support for the  --profile  option.
+ *
+ *      The file is decoded once, by the same decoder as the listing,
+ *          into a list of operations:  one for each token, with its
+ *          operand, and with the destination of each branch turned into
+ *          the number of the operation it goes to.  Then each FCode
+ *          block is run as a system would run it to probe the device:
+ *          from the top, making the definitions as their defining words
+ *          are reached and running the body of a colon definition when
+ *          it is called.  Each block starts with no FCode numbers
+ *          defined, in a new node of the device tree.  After that, the
+ *          methods named with  --method  are called, in each block that
+ *          defines them, one after another.
+ *
+ *      Nothing runs on the host.  Cells are 32 bits wide.  Memory is a
+ *          space of its own, with the system variables, the dictionary
+ *          and a heap in it; an address outside of it stops the run.
+ *          The parent bus is a PCI bus.  Its configuration space holds
+ *          the Vendor and Device ID, Revision and Class Code from the
+ *          PCI Data Structure of the image, if it has one, and zeros
+ *          else; registers mapped in are plain memory that reads back
+ *          what was written.  The device tree and its properties are
+ *          kept, and shown at the end.
+ *
+ *      Only a part of the standard words is simulated:  enough for the
+ *          code that probes a device and publishes its properties.  A
+ *          word that is not stops the run of its block, with a remark
+ *          saying which it was and where.  So does anything that would
+ *          have gone wrong on a real system, such as a stack underflow,
+ *          and so does running more tokens than the limit, which is how
+ *          a loop that waits for a device that is not there ends.
+ *
+ *      Each token executed takes the time the cost model gives it, in
+ *          nanoseconds, and  ms  takes the time it waits besides.  The
+ *          time is charged to the definition that ran the token; and,
+ *          with what that called, to each definition it was called from.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "detok.h"
+#include "stream.h"
+#include "outsink.h"
+#include "fcinsn.h"
+#include "fcexec.h"
+
+/*  Tokens the run itself has to know  */
+#define FC_END0            0x000
+#define FC_B_LIT           0x010
+#define FC_B_TICK          0x011
+#define FC_B_QUOTE         0x012
+#define FC_BBRANCH         0x013
+#define FC_B_QBRANCH       0x014
+#define FC_B_LOOP          0x015
+#define FC_B_PLUS_LOOP     0x016
+#define FC_B_DO            0x017
+#define FC_B_QDO           0x018
+#define FC_B_LEAVE         0x01b
+#define FC_B_OF            0x01c
+#define FC_EXIT            0x033
+#define FC_B_MARK          0x0b1
+#define FC_B_RESOLVE       0x0b2
+#define FC_NEW_TOKEN       0x0b5
+#define FC_NAMED_TOKEN     0x0b6
+#define FC_B_COLON         0x0b7	/*  b(:)                          */
+#define FC_B_CODE          0x0bf	/*  b(code) ;  b(value)  and the
+					 *      rest come in between      */
+#define FC_INSTANCE        0x0c0
+#define FC_B_SEMICOLON     0x0c2	/*  b(;)                          */
+#define FC_B_TO            0x0c3
+#define FC_B_CASE          0x0c4
+#define FC_B_ENDCASE       0x0c5
+#define FC_B_ENDOF         0x0c6
+#define FC_EXTERNAL_TOKEN  0x0ca
+#define FC_OFFSET16        0x0cc
+#define FC_END1            0x0ff
+#define FC_MS              0x126
+
+#define FCODE_COUNT        0x1000
+#define FIRST_USER_FCODE   0x800
+#define NO_INDEX           0xffffffff
+
+/*  What a definition is.  Those made by a defining word are numbered
+ *      as its FCode is, from  b(:)  on.
+ */
+#define DEF_BLOCK          0	/*  The code of an FCode block itself  */
+#define DEF_COLON          0xb7
+#define DEF_VALUE          0xb8
+#define DEF_VARIABLE       0xb9
+#define DEF_CONSTANT       0xba
+#define DEF_CREATE         0xbb
+#define DEF_DEFER          0xbc
+#define DEF_BUFFER         0xbd
+#define DEF_FIELD          0xbe
+
+/*  The sandbox's memory:  where things are in it, and how big  */
+#define MEM_BASE           0x10000000
+#define MEM_SIZE           0x01000000
+#define BASE_VAR           0x000	/*  base                       */
+#define STATE_VAR          0x004	/*  state                      */
+#define OUT_VAR            0x008	/*  #out                       */
+#define LINE_VAR           0x00c	/*  #line                      */
+#define SPAN_VAR           0x010	/*  span                       */
+#define MASK_VAR           0x014	/*  mask                       */
+#define PAD_START          0x1000	/*  Strings from  b(")         */
+#define PAD_COUNT          16
+#define PAD_SIZE           0x100
+#define HOLD_START         0x2000	/*  Pictured numeric output    */
+#define HOLD_END           0x2100
+#define DICT_START         0x10000
+#define HEAP_START         0x100000
+
+/*  How deep, and how many  */
+#define DATA_STACK_SIZE    4096
+#define RETURN_STACK_SIZE  4096
+#define MAX_FRAMES         1024
+#define MAX_XT_NESTING     64
+#define MAX_NODES          4096
+#define MAX_PROPS          1024
+#define CONSOLE_MAX        0x4000
+#define PROP_SHOWN         64	/*  Bytes of a value shown         */
+
+/*  Unless the cost model says otherwise  */
+#define DEFAULT_COST       10		/*  Nanoseconds per token       */
+#define DEFAULT_LIMIT      10000000	/*  Tokens per run              */
+
+#define NS_PER_MS          1000000ULL
+
+/*  An operation:  a token, and what it needs of its operand  */
+typedef struct {
+	u32 pos;		/*  Where it is in the file            */
+	u16 fcode;
+	u8 opnd_kind;
+	u8 flags;
+	u32 arg;		/*  Literal, token number, operation
+				 *      branched to, or string offset;
+				 *      for  b(:) , the operation
+				 *      after its  b(;)                */
+	u32 arg2;		/*  Token defined, and the length of
+				 *      its name; length of a string;
+				 *      for a defining word, the
+				 *      definition it made             */
+} exec_op_t;
+
+/*  An FCode block, and the PCI image it is in, if any  */
+typedef struct {
+	u32 first_op;
+	u32 end_op;
+	u32 pos;
+	bool pci_data;
+	u16 vendor;
+	u16 device;
+	u16 revision;
+	u32 class_code;
+} exec_block_t;
+
+/*  A definition, made as the run reaches it; or an FCode block  */
+typedef struct {
+	const u8 *name;		/*  Into the input-data;  NULL  if
+				 *      headerless or a block          */
+	u8 name_len;
+	u8 kind;
+	u16 fcode;
+	u32 block;		/*  Number of its FCode block          */
+	u32 body;		/*  First operation of a colon def'n   */
+	u32 value;		/*  Value, address, execution token or
+				 *      offset, according to its kind  */
+	u32 active;		/*  Calls to it not yet returned from  */
+	u64 calls;
+	u64 tokens;		/*  Run by it, not by what it called   */
+	u64 self_time;		/*  The time those took                */
+	u64 total_time;		/*  And with what it called            */
+} exec_def_t;
+
+/*  A call to a colon definition  */
+typedef struct {
+	u32 def;
+	u32 return_op;
+	u32 rsp;		/*  Return-stack depth when called     */
+	u32 sp;			/*  Data-stack depth, for  catch       */
+	bool is_catch;		/*  Called by  catch                   */
+	u64 entry_time;
+} exec_frame_t;
+
+/*  A property of a node in the device tree  */
+typedef struct {
+	char *name;
+	u32 addr;		/*  Its value, in the sandbox          */
+	u32 len;
+} exec_prop_t;
+
+typedef struct {
+	u32 parent;
+	u32 first_child;
+	u32 next_peer;
+	u32 block;		/*  FCode block that made it           */
+	exec_prop_t *props;
+	u32 prop_count;
+	u32 prop_max;
+} exec_node_t;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     token_cost              Nanoseconds each token takes, if the cost
+ *                                 model lists it, or  NO_INDEX
+ *     default_cost            For those it does not
+ *     token_limit             Tokens a run may execute
+ *     methods                 The methods to call after the probe
+ *     ops, blocks             What the decoder found in the file
+ *     collecting_block        The block being collected, and the
+ *     open_colon                  b(:)  whose  b(;)  is not found yet
+ *     next_pci                The PCI image the next block is in
+ *     defs                    The definitions the runs have made
+ *     defined_as              Definition each FCode number was last
+ *                                 given to in the block, or NO_INDEX
+ *     defined_fcodes          The numbers given a definition in the
+ *     defined_count               block, so that only those need be
+ *                                 cleared for the next one
+ *     pending_fcode           Number the last  new-token  (or the like)
+ *                                 assigned, awaiting its defining word
+ *     dstack, rstack          The stacks, and how deep they are
+ *     frames                  The calls not yet returned from
+ *     ip                      The next operation to run
+ *     cur_def                 The definition running it
+ *     block_def               That of the block's own code
+ *     method_run              A method is being run, not a block
+ *     xt_nesting              execute  within  execute
+ *     memory                  The sandbox
+ *     here_ptr, heap_ptr      Where the next bytes go, in the
+ *                                 dictionary and in the heap
+ *     nodes                   The device tree;  node 0  is the root
+ *     cur_node                The node the FCode is building
+ *     my_self                 What  my-self  gives; the FCode may set it
+ *     config_space            Of the device being probed
+ *     console                 What the FCode printed
+ *     now                     Nanoseconds, since the first run started
+ *     tokens_run              Tokens executed in the run so far
+ *     stopped                 The run has ended; why, and where
+ *     token_counts            How many times each token that was not
+ *     token_times                 defined by the image ran, and how long
+ *
+ **************************************************************************** */
+
+static u32 token_cost[FCODE_COUNT];
+static bool costs_loaded = false;
+static u32 default_cost = DEFAULT_COST;
+static u64 token_limit = DEFAULT_LIMIT;
+
+static char **methods = NULL;
+static int method_count = 0;
+
+static exec_op_t *ops = NULL;
+static u32 op_count = 0;
+static u32 op_max = 0;
+static exec_block_t *blocks = NULL;
+static u32 block_count = 0;
+static u32 block_max = 0;
+static u32 collecting_block;
+static u32 open_colon;
+static exec_block_t next_pci;
+
+static exec_def_t *defs = NULL;
+static u32 def_count = 0;
+static u32 def_max = 0;
+static u32 defined_as[FCODE_COUNT];
+static u16 defined_fcodes[FCODE_COUNT];
+static u32 defined_count = 0;
+static u32 pending_fcode;
+static const u8 *pending_name;
+static u8 pending_name_len;
+
+static u32 dstack[DATA_STACK_SIZE];
+static u32 sp;
+static u32 max_sp;
+static u32 rstack[RETURN_STACK_SIZE];
+static u32 rsp;
+static u32 max_rsp;
+static exec_frame_t frames[MAX_FRAMES];
+static u32 frame_count;
+static u32 max_frames;
+static u32 ip;
+static u32 cur_def;
+static u32 block_def;
+static u32 run_block;
+static bool method_run;
+static u32 xt_nesting;
+
+static u8 *memory = NULL;
+static u32 here_ptr;
+static u32 heap_ptr;
+static u32 pad_next;
+static u32 hold_ptr;
+
+static exec_node_t *nodes = NULL;
+static u32 node_count = 0;
+static u32 node_max = 0;
+static u32 cur_node;
+static u32 my_self;
+static u8 config_space[256];
+
+static char *console = NULL;
+static size_t console_len = 0;
+static bool console_full = false;
+
+static u64 now;
+static u64 tokens_run;
+static u64 all_tokens_run;
+static bool stopped;
+static char stop_reason[160];
+static u32 cur_pos;
+static u32 stop_pos;
+
+static u64 token_counts[FCODE_COUNT];
+static u64 token_times[FCODE_COUNT];
+
+static void *exec_realloc(void *ptr, size_t size)
+{
+	void *nu_ptr = realloc(ptr, size);
+
+	if (nu_ptr == NULL) {
+		out_str("Out of memory while profiling.\n");
+		exit(-ENOMEM);
+	}
+	return nu_ptr;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  load_cost_model
+ *      Synopsis:       Read the time each token takes from a file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             model_filnam       Name of the file
+ *
+ *      Outputs:
+ *         Returned Value:        FALSE if it could not be read, or a
+ *                                    line of it was not understood
+ *         Printout:
+ *             A message for each line that was not understood
+ *
+ *      Process Explanation:
+ *          Each line holds a token -- its name, or its FCode number in
+ *              hex with a leading  0x  -- and the nanoseconds it takes.
+ *              Two other words may be given in place of a token:
+ *              default , for the time of the tokens not listed, and
+ *              limit , for the number of tokens a run may execute
+ *              before it is stopped.  Blank lines, and lines that
+ *              start with a backslash, are ignored.
+ *          Names are looked up in the dictionary, so that Vendor FCodes
+ *              added with  -f  can be listed too.  That list has to
+ *              have been read before this one is.
+ *
+ **************************************************************************** */
+
+static int find_token_name(const char *name)
+{
+	size_t name_len = strlen(name);
+	int fc;
+
+	for (fc = 0; fc < FCODE_COUNT; fc++) {
+		u8 len;
+		const char *tname = lookup_token((u16) fc, &len);
+
+		if ((len == name_len) && (strncasecmp(tname, name, len) == 0))
+			return fc;
+	}
+	return -1;
+}
+
+bool load_cost_model(char *model_filnam)
+{
+	FILE *model_file;
+	char line_bufr[512];
+	int line_no = 0;
+	bool good = true;
+	int fc;
+
+	model_file = fopen(model_filnam, "r");
+	if (model_file == NULL)
+		return false;
+	if (!costs_loaded) {
+		for (fc = 0; fc < FCODE_COUNT; fc++)
+			token_cost[fc] = NO_INDEX;
+		costs_loaded = true;
+	}
+
+	while (fgets(line_bufr, sizeof(line_bufr), model_file) != NULL) {
+		char name[256];
+		char number[64];
+		char *endp;
+		unsigned long long value;
+		int fields;
+
+		line_no++;
+		fields = sscanf(line_bufr, "%255s %63s", name, number);
+		if ((fields < 1) || (name[0] == '\\'))
+			continue;
+		if (fields < 2) {
+			out_printf("%s, line %d:  no cost given for \"%s\".\n",
+				   model_filnam, line_no, name);
+			good = false;
+			continue;
+		}
+
+		value = strtoull(number, &endp, 0);
+		if ((*endp != 0) || (number[0] == '-')
+		    || (value > 0xffffffffULL)) {
+			out_printf("%s, line %d:  bad number \"%s\".\n",
+				   model_filnam, line_no, number);
+			good = false;
+			continue;
+		}
+
+		if (strcasecmp(name, "default") == 0) {
+			default_cost = (u32) value;
+			continue;
+		}
+		if (strcasecmp(name, "limit") == 0) {
+			token_limit = value;
+			continue;
+		}
+		if ((name[0] == '0') && ((name[1] == 'x') || (name[1] == 'X'))) {
+			long num = strtol(name, &endp, 16);
+			fc = ((*endp == 0) && (num >= 0)
+			      && (num < FCODE_COUNT)) ? (int)num : -1;
+		} else {
+			fc = find_token_name(name);
+		}
+		if (fc < 0) {
+			out_printf("%s, line %d:  unknown token \"%s\".\n",
+				   model_filnam, line_no, name);
+			good = false;
+			continue;
+		}
+		token_cost[fc] = (u32) value;
+	}
+
+	fclose(model_file);
+	return good;
+}
+
+void add_profile_method(char *name)
+{
+	methods = exec_realloc(methods, (method_count + 1) * sizeof(char *));
+	methods[method_count++] = name;
+}
+
+static u32 cost_of(u16 fc)
+{
+	if (costs_loaded && (token_cost[fc] != NO_INDEX))
+		return token_cost[fc];
+	return default_cost;
+}
+
+/* **************************************************************************
+ *
+ *      Collecting the operations.
+ *
+ **************************************************************************** */
+
+static void add_block(s64 pos)
+{
+	exec_block_t *block;
+
+	if (block_count == block_max) {
+		block_max = block_max ? 2 * block_max : 16;
+		blocks = exec_realloc(blocks,
+				      block_max * sizeof(exec_block_t));
+	}
+	block = &blocks[block_count];
+	*block = next_pci;
+	block->first_op = op_count;
+	block->end_op = op_count;
+	block->pos = (u32) pos;
+	collecting_block = block_count++;
+	open_colon = NO_INDEX;
+}
+
+/*  A  b(:)  whose  b(;)  was not found runs to the end of its block  */
+static void end_block(void)
+{
+	if (collecting_block == NO_INDEX)
+		return;
+	blocks[collecting_block].end_op = op_count;
+	if (open_colon != NO_INDEX)
+		ops[open_colon].arg = op_count;
+	open_colon = NO_INDEX;
+	collecting_block = NO_INDEX;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  exec_insn
+ *      Synopsis:       A sink that makes an operation of each token,
+ *                          and keeps track of the blocks.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn               The record
+ *             sink_data          Not used
+ *
+ *      Process Explanation:
+ *          The operation of a branch keeps, for now, the position it
+ *              goes to; it is turned into the number of an operation
+ *              once all the blocks have been collected.
+ *
+ **************************************************************************** */
+
+static void exec_insn(const fc_insn_t * insn, void *sink_data)
+{
+	s64 origin = get_stream_origin();
+	exec_op_t *op;
+
+	switch (insn->kind) {
+	case INSN_IMAGE_START:
+		next_pci.pci_data = insn->opnd.image.pci_data;
+		next_pci.vendor = insn->opnd.image.vendor;
+		next_pci.device = insn->opnd.image.device;
+		next_pci.revision = insn->opnd.image.revision;
+		next_pci.class_code = insn->opnd.image.class_code;
+		return;
+	case INSN_IMAGE_END:
+		memset(&next_pci, 0, sizeof(next_pci));
+		return;
+	case INSN_HEADER:
+		if (insn->flags & INSN_MIDBLOCK)
+			return;
+		end_block();
+		add_block(origin + insn->offset);
+		return;
+	case INSN_BAD_START:
+		end_block();
+		add_block(origin + insn->offset);
+		return;
+	case INSN_BLOCK_END:
+	case INSN_EOF:
+		end_block();
+		return;
+	case INSN_TOKEN:
+		break;
+	default:
+		return;
+	}
+
+	if (collecting_block == NO_INDEX)
+		add_block(origin + insn->offset);
+	if (op_count == op_max) {
+		op_max = op_max ? 2 * op_max : 0x1000;
+		ops = exec_realloc(ops, op_max * sizeof(exec_op_t));
+	}
+	op = &ops[op_count];
+	memset(op, 0, sizeof(exec_op_t));
+	op->pos = (u32) (origin + insn->offset);
+	op->fcode = insn->fcode;
+	op->opnd_kind = insn->opnd_kind;
+	op->flags = insn->flags;
+
+	switch (insn->opnd_kind) {
+	case OPND_LITERAL:
+		op->arg = insn->opnd.literal;
+		break;
+	case OPND_BRANCH:
+		op->arg = (insn->flags & INSN_BAD_DEST) ? NO_INDEX
+		    : (u32) (origin + insn->opnd.branch.dest);
+		break;
+	case OPND_STRING:
+		op->arg = (u32) (insn->opnd.string.ptr - indata);
+		op->arg2 = insn->opnd.string.len;
+		break;
+	case OPND_NEW_TOKEN:
+	case OPND_NAMED_TOKEN:
+		op->arg2 = insn->opnd.new_token.token & (FCODE_COUNT - 1);
+		if (insn->opnd_kind == OPND_NAMED_TOKEN) {
+			op->arg = (u32) (insn->opnd.new_token.ptr - indata);
+			op->arg2 |= (u32) insn->opnd.new_token.len << 16;
+		}
+		break;
+	case OPND_TOKEN:
+		op->arg = insn->opnd.token.token & (FCODE_COUNT - 1);
+		break;
+	default:
+		break;
+	}
+
+	if ((insn->fcode >= FC_B_COLON) && (insn->fcode <= FC_B_CODE))
+		op->arg2 = NO_INDEX;
+	if (insn->fcode == FC_B_COLON) {
+		if (open_colon != NO_INDEX)
+			ops[open_colon].arg = op_count;
+		op->arg = NO_INDEX;
+		open_colon = op_count;
+	} else if ((insn->fcode == FC_B_SEMICOLON) && (open_colon != NO_INDEX)) {
+		ops[open_colon].arg = op_count + 1;
+		open_colon = NO_INDEX;
+	}
+	op_count++;
+}
+
+/*  Turn the position each branch goes to into an operation number.
+ *      A branch past the last token of its block runs off the end
+ *      of the block; one to the middle of a token is bad.
+ */
+static void resolve_branches(void)
+{
+	u32 blk;
+
+	for (blk = 0; blk < block_count; blk++) {
+		u32 first = blocks[blk].first_op;
+		u32 end = blocks[blk].end_op;
+		u32 indx;
+
+		for (indx = first; indx < end; indx++) {
+			exec_op_t *op = &ops[indx];
+			u32 lo = first;
+			u32 hi = end;
+
+			if ((op->opnd_kind != OPND_BRANCH)
+			    || (op->arg == NO_INDEX))
+				continue;
+			while (lo < hi) {
+				u32 mid = lo + (hi - lo) / 2;
+				if (ops[mid].pos < op->arg)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			if ((lo == end) || (ops[lo].pos == op->arg))
+				op->arg = lo;
+			else
+				op->arg = NO_INDEX;
+		}
+	}
+}
+
+/* **************************************************************************
+ *
+ *      The machine:  stopping, the stacks, and memory.
+ *
+ **************************************************************************** */
+
+static void stop_run(const char *fmt, ...)
+    __attribute__ ((format(printf, 1, 2)));
+
+/*  The first reason a run is given to stop is the one it stops for  */
+static void stop_run(const char *fmt, ...)
+{
+	va_list args;
+
+	if (stopped)
+		return;
+	stopped = true;
+	stop_pos = cur_pos;
+	va_start(args, fmt);
+	vsnprintf(stop_reason, sizeof(stop_reason), fmt, args);
+	va_end(args);
+}
+
+static u32 pop(void)
+{
+	if (sp == 0) {
+		stop_run("stack underflow");
+		return 0;
+	}
+	return dstack[--sp];
+}
+
+static void push(u32 value)
+{
+	if (sp == DATA_STACK_SIZE) {
+		stop_run("stack overflow");
+		return;
+	}
+	dstack[sp++] = value;
+	if (sp > max_sp)
+		max_sp = sp;
+}
+
+/*  The item so far down the stack, the top being  0   */
+static u32 *peek(u32 depth)
+{
+	static u32 dummy;
+
+	if (depth >= sp) {
+		stop_run("stack underflow");
+		dummy = 0;
+		return &dummy;
+	}
+	return &dstack[sp - 1 - depth];
+}
+
+/*  Move the item so far down the stack to the top, as  roll  does  */
+static void roll(u32 depth)
+{
+	u32 item;
+
+	if (depth >= sp) {
+		stop_run("stack underflow");
+		return;
+	}
+	item = dstack[sp - 1 - depth];
+	memmove(&dstack[sp - 1 - depth], &dstack[sp - depth],
+		depth * sizeof(u32));
+	dstack[sp - 1] = item;
+}
+
+/*  What a colon definition found on the return stack when it was
+ *      called is not its own to take.
+ */
+static u32 rstack_floor(void)
+{
+	return (frame_count > 0) ? frames[frame_count - 1].rsp : 0;
+}
+
+static u32 rpop(void)
+{
+	if (rsp <= rstack_floor()) {
+		stop_run("return stack underflow");
+		return 0;
+	}
+	return rstack[--rsp];
+}
+
+static void rpush(u32 value)
+{
+	if (rsp == RETURN_STACK_SIZE) {
+		stop_run("return stack overflow");
+		return;
+	}
+	rstack[rsp++] = value;
+	if (rsp > max_rsp)
+		max_rsp = rsp;
+}
+
+static u32 rpeek(u32 depth)
+{
+	if (rsp < rstack_floor() + depth + 1) {
+		stop_run("return stack underflow");
+		return 0;
+	}
+	return rstack[rsp - 1 - depth];
+}
+
+#define FLAG(cond)   ((cond) ? 0xffffffff : 0)
+
+/*  The bytes at an address in the sandbox, or NULL if not all there  */
+static u8 *mem_at(u32 addr, u32 len)
+{
+	if ((addr < MEM_BASE) || (addr - MEM_BASE > MEM_SIZE)
+	    || (len > MEM_SIZE - (addr - MEM_BASE))) {
+		stop_run("address 0x%x is outside of memory", addr);
+		return NULL;
+	}
+	return memory + (addr - MEM_BASE);
+}
+
+/*  Cells and the like are kept little-endian, as on a PC  */
+static u32 fetch(u32 addr, int size)
+{
+	u8 *ptr = mem_at(addr, size);
+	u32 value = 0;
+	int indx;
+
+	if (ptr == NULL)
+		return 0;
+	for (indx = size - 1; indx >= 0; indx--)
+		value = (value << 8) | ptr[indx];
+	return value;
+}
+
+static void store(u32 addr, u32 value, int size)
+{
+	u8 *ptr = mem_at(addr, size);
+	int indx;
+
+	if (ptr == NULL)
+		return;
+	for (indx = 0; indx < size; indx++) {
+		ptr[indx] = (u8) value;
+		value >>= 8;
+	}
+}
+
+/*  Property values are big-endian, as the standard has them  */
+static u32 fetch_be(u32 addr)
+{
+	u8 *ptr = mem_at(addr, 4);
+
+	if (ptr == NULL)
+		return 0;
+	return ((u32) ptr[0] << 24) | ((u32) ptr[1] << 16)
+	    | ((u32) ptr[2] << 8) | ptr[3];
+}
+
+static void store_be(u32 addr, u32 value)
+{
+	u8 *ptr = mem_at(addr, 4);
+
+	if (ptr == NULL)
+		return;
+	ptr[0] = (u8) (value >> 24);
+	ptr[1] = (u8) (value >> 16);
+	ptr[2] = (u8) (value >> 8);
+	ptr[3] = (u8) value;
+}
+
+/*  Bytes from the heap, which is never given back.  They are not
+ *      aligned, so that values encoded one after another are
+ *      contiguous, and  encode+  need not copy them.
+ */
+static u32 heap_alloc(u32 len)
+{
+	u32 addr = heap_ptr;
+
+	if (len > MEM_SIZE - (heap_ptr - MEM_BASE)) {
+		stop_run("out of memory, allocating 0x%x bytes", len);
+		return 0;
+	}
+	heap_ptr += len;
+	return addr;
+}
+
+/*  Copy bytes within the sandbox to a new place in its heap  */
+static u32 heap_copy(u32 src, u32 len)
+{
+	u32 addr;
+	u8 *from = mem_at(src, len);
+	u8 *to;
+
+	if (from == NULL)
+		return 0;
+	addr = heap_alloc(len);
+	to = stopped ? NULL : mem_at(addr, len);
+	if (to == NULL)
+		return 0;
+	memmove(to, from, len);
+	return addr;
+}
+
+/*  An encoded integer:  ( -- addr 4 )  */
+static void encode_int(u32 value)
+{
+	u32 addr = heap_alloc(4);
+
+	if (stopped)
+		return;
+	store_be(addr, value);
+	push(addr);
+	push(4);
+}
+
+static void dict_append(u32 value, int size)
+{
+	if ((u32) size > MEM_BASE + HEAP_START - here_ptr) {
+		stop_run("dictionary full");
+		return;
+	}
+	store(here_ptr, value, size);
+	here_ptr += size;
+}
+
+static void console_out(const char *str, size_t len)
+{
+	if (console_len + len > CONSOLE_MAX) {
+		len = CONSOLE_MAX - console_len;
+		console_full = true;
+	}
+	if (len == 0)
+		return;
+	console = exec_realloc(console, console_len + len);
+	memcpy(console + console_len, str, len);
+	console_len += len;
+}
+
+static u32 number_base(void)
+{
+	u32 base = fetch(MEM_BASE + BASE_VAR, 4);
+
+	if ((base < 2) || (base > 36))
+		base = 10;
+	return base;
+}
+
+static char to_digit(u32 digit)
+{
+	return (char)((digit < 10) ? '0' + digit : 'a' + digit - 10);
+}
+
+/*  As  .  and  u.  print it, or, given a width,  .r  and  u.r   */
+static void print_number(u32 value, bool is_signed, u32 width, bool space)
+{
+	char bufr[48];
+	char *ptr = bufr + sizeof(bufr);
+	u32 base = number_base();
+	bool negative = is_signed && ((s32) value < 0);
+	u32 mag = negative ? (0 - value) : value;
+	u32 len;
+
+	do {
+		*--ptr = to_digit(mag % base);
+		mag /= base;
+	} while (mag != 0);
+	if (negative)
+		*--ptr = '-';
+	len = (u32) (bufr + sizeof(bufr) - ptr);
+	while ((len < width) && (len < sizeof(bufr))) {
+		*--ptr = ' ';
+		len++;
+	}
+	console_out(ptr, len);
+	if (space)
+		console_out(" ", 1);
+}
+
+static void hold(u32 chr)
+{
+	if (hold_ptr <= HOLD_START) {
+		stop_run("pictured numeric output too long");
+		return;
+	}
+	memory[--hold_ptr] = (u8) chr;
+}
+
+static u32 hold_digit(u32 value)
+{
+	u32 base = number_base();
+
+	hold(to_digit(value % base));
+	return value / base;
+}
+
+/*  $number :  ( str len -- true | n false )  */
+static void parse_number(void)
+{
+	u32 len = pop();
+	u32 str = pop();
+	u8 *ptr = mem_at(str, len);
+	u32 base = number_base();
+	u32 value = 0;
+	bool negative = false;
+	u32 indx = 0;
+
+	if (ptr == NULL)
+		return;
+	if ((len > 1) && (ptr[0] == '-')) {
+		negative = true;
+		indx = 1;
+	}
+	if (len == 0) {
+		push(FLAG(true));
+		return;
+	}
+	for (; indx < len; indx++) {
+		int chr = tolower(ptr[indx]);
+		u32 digit = isdigit(chr) ? (u32) (chr - '0')
+		    : isalpha(chr) ? (u32) (chr - 'a' + 10) : base;
+		if (digit >= base) {
+			push(FLAG(true));
+			return;
+		}
+		value = value * base + digit;
+	}
+	push(negative ? 0 - value : value);
+	push(0);
+}
+
+/*  Floored, as the standard has it;  ( n1 n2 -- rem quot )  */
+static void divide(void)
+{
+	s64 divisor = (s32) pop();
+	s64 dividend = (s32) pop();
+	s64 quot, rem;
+
+	if (divisor == 0) {
+		stop_run("division by zero");
+		return;
+	}
+	quot = dividend / divisor;
+	rem = dividend % divisor;
+	if ((rem != 0) && ((rem < 0) != (divisor < 0))) {
+		quot--;
+		rem += divisor;
+	}
+	push((u32) rem);
+	push((u32) quot);
+}
+
+/*  ( u1 u2 -- urem uquot )  */
+static void u_divide(u64 dividend, u32 divisor)
+{
+	if (divisor == 0) {
+		stop_run("division by zero");
+		return;
+	}
+	push((u32) (dividend % divisor));
+	push((u32) (dividend / divisor));
+}
+
+/* **************************************************************************
+ *
+ *      The device tree.  A handle -- phandle or ihandle, for they are
+ *          not told apart -- is the number of the node, plus one.
+ *
+ **************************************************************************** */
+
+static u32 new_node(u32 parent)
+{
+	exec_node_t *node;
+	u32 *link;
+
+	if (node_count == MAX_NODES) {
+		stop_run("too many device nodes");
+		return parent;
+	}
+	if (node_count == node_max) {
+		node_max = node_max ? 2 * node_max : 16;
+		nodes = exec_realloc(nodes, node_max * sizeof(exec_node_t));
+	}
+	node = &nodes[node_count];
+	memset(node, 0, sizeof(exec_node_t));
+	node->parent = parent;
+	node->first_child = NO_INDEX;
+	node->next_peer = NO_INDEX;
+	node->block = run_block;
+	if (parent != NO_INDEX) {
+		link = &nodes[parent].first_child;
+		while (*link != NO_INDEX)
+			link = &nodes[*link].next_peer;
+		*link = node_count;
+	}
+	return node_count++;
+}
+
+static u32 node_of(u32 handle)
+{
+	if ((handle == 0) || (handle > node_count)) {
+		stop_run("0x%x is not a handle", handle);
+		return NO_INDEX;
+	}
+	return handle - 1;
+}
+
+static u32 handle_of(u32 node)
+{
+	return (node == NO_INDEX) ? 0 : node + 1;
+}
+
+static exec_prop_t *find_prop(u32 node, const u8 * name, u32 len)
+{
+	u32 indx;
+
+	for (indx = 0; indx < nodes[node].prop_count; indx++) {
+		exec_prop_t *prop = &nodes[node].props[indx];
+		if ((strlen(prop->name) == len)
+		    && (memcmp(prop->name, name, len) == 0))
+			return prop;
+	}
+	return NULL;
+}
+
+/*  Give the current node a property, in place of one of that name.
+ *      The value is copied, as a system would copy it.
+ */
+static void set_prop(const u8 * name, u32 name_len, u32 addr, u32 len)
+{
+	exec_node_t *node = &nodes[cur_node];
+	exec_prop_t *prop = find_prop(cur_node, name, name_len);
+	u32 value = heap_copy(addr, len);
+
+	if (stopped)
+		return;
+	if (prop == NULL) {
+		if (node->prop_count == MAX_PROPS) {
+			stop_run("too many properties");
+			return;
+		}
+		if (node->prop_count == node->prop_max) {
+			node->prop_max = node->prop_max
+			    ? 2 * node->prop_max : 8;
+			node->props = exec_realloc(node->props,
+						   node->prop_max *
+						   sizeof(exec_prop_t));
+		}
+		prop = &node->props[node->prop_count++];
+		prop->name = exec_realloc(NULL, name_len + 1);
+		memcpy(prop->name, name, name_len);
+		prop->name[name_len] = 0;
+	}
+	prop->addr = value;
+	prop->len = len;
+}
+
+/*  A string, encoded:  ( str len -- addr len+1 )  */
+static void encode_string(void)
+{
+	u32 len = pop();
+	u32 str = pop();
+	u32 addr;
+
+	if (mem_at(str, len) == NULL)
+		return;
+	addr = heap_copy(str, len);
+	store(heap_alloc(1), 0, 1);
+	if (stopped)
+		return;
+	push(addr);
+	push(len + 1);
+}
+
+/*  A property, named by the word that sets it:  ( str len -- )  */
+static void set_string_prop(const char *name)
+{
+	u32 len, addr;
+
+	encode_string();
+	len = pop();
+	addr = pop();
+	if (!stopped)
+		set_prop((const u8 *)name, strlen(name), addr, len);
+}
+
+static void property(void)
+{
+	u32 name_len = pop();
+	u32 name = pop();
+	u32 len = pop();
+	u32 addr = pop();
+	u8 *name_ptr = mem_at(name, name_len);
+
+	if ((name_ptr == NULL) || (mem_at(addr, len) == NULL))
+		return;
+	set_prop(name_ptr, name_len, addr, len);
+}
+
+/*  ( name len -- addr len false | true ), looked for in a node and,
+ *      if inherited, in the nodes above it.
+ */
+static void get_prop(u32 node, bool inherited)
+{
+	u32 len = pop();
+	u32 name = pop();
+	u8 *name_ptr = mem_at(name, len);
+
+	if (name_ptr == NULL)
+		return;
+	while (node != NO_INDEX) {
+		exec_prop_t *prop = find_prop(node, name_ptr, len);
+		if (prop != NULL) {
+			push(prop->addr);
+			push(prop->len);
+			push(0);
+			return;
+		}
+		node = inherited ? nodes[node].parent : NO_INDEX;
+	}
+	push(FLAG(true));
+}
+
+static void delete_prop(void)
+{
+	u32 len = pop();
+	u32 name = pop();
+	u8 *name_ptr = mem_at(name, len);
+	exec_node_t *node = &nodes[cur_node];
+	exec_prop_t *prop;
+
+	if (name_ptr == NULL)
+		return;
+	prop = find_prop(cur_node, name_ptr, len);
+	if (prop == NULL)
+		return;
+	free(prop->name);
+	*prop = node->props[--node->prop_count];
+}
+
+/*  encode+ :  ( addr1 len1 addr2 len2 -- addr3 len1+len2 )  */
+static void encode_plus(void)
+{
+	u32 len2 = pop();
+	u32 addr2 = pop();
+	u32 len1 = pop();
+	u32 addr1 = pop();
+	u32 addr;
+
+	if ((mem_at(addr1, len1) == NULL) || (mem_at(addr2, len2) == NULL))
+		return;
+	if (addr1 + len1 == addr2) {
+		addr = addr1;
+	} else {
+		addr = heap_copy(addr1, len1);
+		heap_copy(addr2, len2);
+	}
+	push(addr);
+	push(len1 + len2);
+}
+
+/*  decode-int  and  decode-phys :  ( addr len -- addr' len' n ... )  */
+static void decode_cells(int count)
+{
+	u32 len = pop();
+	u32 addr = pop();
+	u32 cells[3];
+	int indx;
+
+	if ((u32) (4 * count) > len) {
+		stop_run("decoding %d bytes from a value of %u", 4 * count,
+			 len);
+		return;
+	}
+	for (indx = 0; indx < count; indx++)
+		cells[indx] = fetch_be(addr + 4 * indx);
+	push(addr + 4 * count);
+	push(len - 4 * count);
+	/*  phys.hi  comes first in the value, and last on the stack  */
+	for (indx = count - 1; indx >= 0; indx--)
+		push(cells[indx]);
+}
+
+/*  decode-string :  ( addr len -- addr' len' str slen )  */
+static void decode_string(void)
+{
+	u32 len = pop();
+	u32 addr = pop();
+	u8 *ptr = mem_at(addr, len);
+	u32 slen = 0;
+	u32 used;
+
+	if (ptr == NULL)
+		return;
+	while ((slen < len) && (ptr[slen] != 0))
+		slen++;
+	used = (slen < len) ? slen + 1 : slen;
+	push(addr + used);
+	push(len - used);
+	push(addr);
+	push(slen);
+}
+
+/*  left-parse-string :  ( str len char -- rem rlen first flen )  */
+static void left_parse_string(void)
+{
+	u32 chr = pop();
+	u32 len = pop();
+	u32 str = pop();
+	u8 *ptr = mem_at(str, len);
+	u32 indx = 0;
+
+	if (ptr == NULL)
+		return;
+	while ((indx < len) && (ptr[indx] != (u8) chr))
+		indx++;
+	if (indx < len) {
+		push(str + indx + 1);
+		push(len - indx - 1);
+	} else {
+		push(str + len);
+		push(0);
+	}
+	push(str);
+	push(indx);
+}
+
+/*  The methods of the parent bus that a PCI driver calls  */
+static void call_parent(void)
+{
+	u32 len = pop();
+	u32 name = pop();
+	u8 *ptr = mem_at(name, len);
+	char method[32];
+	u32 reg;
+	u32 value;
+
+	if (ptr == NULL)
+		return;
+	if (len >= sizeof(method))
+		len = sizeof(method) - 1;
+	memcpy(method, ptr, len);
+	method[len] = 0;
+
+	if (strcmp(method, "config-b@") == 0) {
+		push(config_space[pop() & 0xff]);
+	} else if (strcmp(method, "config-w@") == 0) {
+		reg = pop() & 0xfe;
+		push(config_space[reg] | (config_space[reg + 1] << 8));
+	} else if (strcmp(method, "config-l@") == 0) {
+		reg = pop() & 0xfc;
+		push(config_space[reg] | (config_space[reg + 1] << 8)
+		     | (config_space[reg + 2] << 16)
+		     | ((u32) config_space[reg + 3] << 24));
+	} else if (strcmp(method, "config-b!") == 0) {
+		reg = pop() & 0xff;
+		config_space[reg] = (u8) pop();
+	} else if (strcmp(method, "config-w!") == 0) {
+		reg = pop() & 0xfe;
+		value = pop();
+		config_space[reg] = (u8) value;
+		config_space[reg + 1] = (u8) (value >> 8);
+	} else if (strcmp(method, "config-l!") == 0) {
+		reg = pop() & 0xfc;
+		value = pop();
+		config_space[reg] = (u8) value;
+		config_space[reg + 1] = (u8) (value >> 8);
+		config_space[reg + 2] = (u8) (value >> 16);
+		config_space[reg + 3] = (u8) (value >> 24);
+	} else if (strcmp(method, "map-in") == 0) {
+		/*  ( phys.lo phys.mid phys.hi size -- virt )  */
+		value = pop();
+		pop();
+		pop();
+		pop();
+		push(heap_alloc(value));
+	} else if ((strcmp(method, "map-out") == 0)
+		   || (strcmp(method, "dma-free") == 0)) {
+		pop();
+		pop();
+	} else if (strcmp(method, "dma-alloc") == 0) {
+		push(heap_alloc(pop()));
+	} else if (strcmp(method, "dma-map-in") == 0) {
+		/*  ( virt size cacheable? -- devaddr )  */
+		pop();
+		pop();
+	} else if ((strcmp(method, "dma-map-out") == 0)
+		   || (strcmp(method, "dma-sync") == 0)) {
+		pop();
+		pop();
+		pop();
+	} else {
+		stop_run("$call-parent \"%s\" is not simulated", method);
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Running definitions.
+ *
+ **************************************************************************** */
+
+/*  Count a token, and charge its time  */
+static void charge(u16 fc, u64 cost, bool primitive)
+{
+	tokens_run++;
+	now += cost;
+	defs[cur_def].tokens++;
+	defs[cur_def].self_time += cost;
+	if (primitive) {
+		token_counts[fc]++;
+		token_times[fc] += cost;
+	}
+}
+
+/*  ms :  the time waited is the time of the token that waited  */
+static void wait_ms(u32 msecs)
+{
+	u64 wait = msecs * NS_PER_MS;
+
+	now += wait;
+	defs[cur_def].self_time += wait;
+	token_times[FC_MS] += wait;
+}
+
+static void jump(u32 target)
+{
+	if (target == NO_INDEX)
+		stop_run("branch to outside of its block");
+	else
+		ip = target;
+}
+
+static void enter_frame(u32 def, bool is_catch)
+{
+	exec_frame_t *frame;
+
+	if (frame_count == MAX_FRAMES) {
+		stop_run("calls nested too deep");
+		return;
+	}
+	frame = &frames[frame_count++];
+	if (frame_count > max_frames)
+		max_frames = frame_count;
+	frame->def = def;
+	frame->return_op = ip;
+	frame->rsp = rsp;
+	frame->sp = sp;
+	frame->is_catch = is_catch;
+	frame->entry_time = now;
+	defs[def].active++;
+	ip = defs[def].body;
+	cur_def = def;
+}
+
+/*  Return from the innermost call.  Time spent in a definition is
+ *      added to its total once, when its outermost call returns.
+ */
+static void leave_frame(void)
+{
+	exec_frame_t *frame = &frames[--frame_count];
+	exec_def_t *def = &defs[frame->def];
+
+	if (--def->active == 0)
+		def->total_time += now - frame->entry_time;
+	ip = frame->return_op;
+	rsp = frame->rsp;
+	cur_def = (frame_count > 0) ? frames[frame_count - 1].def : block_def;
+	if (frame->is_catch)
+		push(0);
+}
+
+static void run_xt(u32 xt, bool is_catch);
+
+/*  Run a definition.  One that is not a colon definition is done
+ *      with at once, and, if run by  catch , throws nothing.
+ */
+static void invoke(u32 def_num, bool is_catch)
+{
+	exec_def_t *def = &defs[def_num];
+
+	def->calls++;
+	switch (def->kind) {
+	case DEF_COLON:
+		enter_frame(def_num, is_catch);
+		return;
+	case DEF_FIELD:
+		*peek(0) += def->value;
+		break;
+	case DEF_DEFER:
+		if (def->value == NO_INDEX)
+			stop_run("deferred word not set");
+		else
+			run_xt(def->value, false);
+		break;
+	default:
+		push(def->value);
+		break;
+	}
+	if (is_catch)
+		push(0);
+}
+
+/*  throw :  back to the innermost  catch , if there is one  */
+static void throw_code(u32 code)
+{
+	u32 depth;
+	u32 saved_sp;
+
+	if (code == 0)
+		return;
+	for (depth = frame_count; depth > 0; depth--) {
+		if (frames[depth - 1].is_catch)
+			break;
+	}
+	if (depth == 0) {
+		stop_run("throw %d, not caught", (int)code);
+		return;
+	}
+	while (frame_count > depth)
+		leave_frame();
+	saved_sp = frames[depth - 1].sp;
+	frames[depth - 1].is_catch = false;
+	leave_frame();
+	sp = saved_sp;
+	push(code);
+}
+
+/*  Tokens that only mean something where they are in the FCode  */
+static bool in_place_only(u16 fc)
+{
+	return (fc == FC_END0) || (fc == FC_END1) || (fc == FC_EXIT)
+	    || (fc == FC_B_LEAVE) || (fc == FC_B_MARK)
+	    || (fc == FC_B_RESOLVE) || (fc == FC_B_CASE)
+	    || (fc == FC_B_ENDCASE) || (fc == FC_B_SEMICOLON)
+	    || ((fc >= FC_B_COLON) && (fc <= FC_B_CODE));
+}
+
+static void primitive(u16 fc);
+
+/*  Run an execution token, as  execute  and  catch  do.  An execution
+ *      token is the FCode number of the word.
+ */
+static void run_xt(u32 xt, bool is_catch)
+{
+	if (xt >= FCODE_COUNT) {
+		stop_run("0x%x is not an execution token", xt);
+		return;
+	}
+	if (xt_nesting == MAX_XT_NESTING) {
+		stop_run("execution tokens nested too deep");
+		return;
+	}
+	xt_nesting++;
+	if (defined_as[xt] != NO_INDEX) {
+		invoke(defined_as[xt], is_catch);
+	} else if ((xt >= FIRST_USER_FCODE)
+		   || (token_descs[xt].opnd_kind != OPND_NONE)
+		   || in_place_only((u16) xt)) {
+		stop_run("0x%03x is not an execution token", xt);
+	} else {
+		charge((u16) xt, cost_of((u16) xt), true);
+		primitive((u16) xt);
+		if (is_catch)
+			push(0);
+	}
+	xt_nesting--;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  primitive
+ *      Synopsis:       Run a word of the system's own:  one that the
+ *                          image did not define, and that has no
+ *                          operand in the FCode.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             fc                 Its FCode number
+ *
+ **************************************************************************** */
+
+static void primitive(u16 fc)
+{
+	u32 a, b, c, d;
+	u64 wide;
+	u8 *ptr, *ptr2;
+	const char *name;
+	u8 len, unused_len;
+
+	switch (fc) {
+	case 0x019:		/*  i                        */
+		push(rpeek(0));
+		break;
+	case 0x01a:		/*  j                        */
+		push(rpeek(3));
+		break;
+	case 0x01d:		/*  execute                  */
+		run_xt(pop(), false);
+		break;
+	case 0x01e:		/*  +                        */
+		b = pop();
+		*peek(0) += b;
+		break;
+	case 0x01f:		/*  -                        */
+		b = pop();
+		*peek(0) -= b;
+		break;
+	case 0x020:		/*  *                        */
+		b = pop();
+		*peek(0) *= b;
+		break;
+	case 0x021:		/*  /                        */
+		divide();
+		a = pop();
+		pop();
+		push(a);
+		break;
+	case 0x022:		/*  mod                      */
+		divide();
+		pop();
+		break;
+	case 0x023:		/*  and                      */
+		b = pop();
+		*peek(0) &= b;
+		break;
+	case 0x024:		/*  or                       */
+		b = pop();
+		*peek(0) |= b;
+		break;
+	case 0x025:		/*  xor                      */
+		b = pop();
+		*peek(0) ^= b;
+		break;
+	case 0x026:		/*  invert                   */
+		*peek(0) = ~*peek(0);
+		break;
+	case 0x027:		/*  lshift                   */
+		b = pop();
+		a = *peek(0);
+		*peek(0) = (b < 32) ? a << b : 0;
+		break;
+	case 0x028:		/*  rshift                   */
+		b = pop();
+		a = *peek(0);
+		*peek(0) = (b < 32) ? a >> b : 0;
+		break;
+	case 0x029:		/*  >>a                      */
+		b = pop();
+		a = *peek(0);
+		*peek(0) = (u32) ((s32) a >> ((b < 32) ? b : 31));
+		break;
+	case 0x02a:		/*  /mod                     */
+		divide();
+		break;
+	case 0x02b:		/*  u/mod                    */
+		b = pop();
+		a = pop();
+		u_divide(a, b);
+		break;
+	case 0x02c:		/*  negate                   */
+		*peek(0) = 0 - *peek(0);
+		break;
+	case 0x02d:		/*  abs                      */
+		a = *peek(0);
+		*peek(0) = ((s32) a < 0) ? 0 - a : a;
+		break;
+	case 0x02e:		/*  min                      */
+		b = pop();
+		a = *peek(0);
+		*peek(0) = ((s32) a < (s32) b) ? a : b;
+		break;
+	case 0x02f:		/*  max                      */
+		b = pop();
+		a = *peek(0);
+		*peek(0) = ((s32) a > (s32) b) ? a : b;
+		break;
+	case 0x030:		/*  >r                       */
+		rpush(pop());
+		break;
+	case 0x031:		/*  r>                       */
+		push(rpop());
+		break;
+	case 0x032:		/*  r@                       */
+		push(rpeek(0));
+		break;
+	case 0x034:		/*  0=                       */
+		*peek(0) = FLAG(*peek(0) == 0);
+		break;
+	case 0x035:		/*  0<>                      */
+		*peek(0) = FLAG(*peek(0) != 0);
+		break;
+	case 0x036:		/*  0<                       */
+		*peek(0) = FLAG((s32) * peek(0) < 0);
+		break;
+	case 0x037:		/*  0<=                      */
+		*peek(0) = FLAG((s32) * peek(0) <= 0);
+		break;
+	case 0x038:		/*  0>                       */
+		*peek(0) = FLAG((s32) * peek(0) > 0);
+		break;
+	case 0x039:		/*  0>=                      */
+		*peek(0) = FLAG((s32) * peek(0) >= 0);
+		break;
+	case 0x03a:		/*  <                        */
+	case 0x03b:		/*  >                        */
+	case 0x03c:		/*  =                        */
+	case 0x03d:		/*  <>                       */
+	case 0x03e:		/*  u>                       */
+	case 0x03f:		/*  u<=                      */
+	case 0x040:		/*  u<                       */
+	case 0x041:		/*  u>=                      */
+	case 0x042:		/*  >=                       */
+	case 0x043:		/*  <=                       */
+		b = pop();
+		a = pop();
+		switch (fc) {
+		case 0x03a:
+			c = (s32) a < (s32) b;
+			break;
+		case 0x03b:
+			c = (s32) a > (s32) b;
+			break;
+		case 0x03c:
+			c = a == b;
+			break;
+		case 0x03d:
+			c = a != b;
+			break;
+		case 0x03e:
+			c = a > b;
+			break;
+		case 0x03f:
+			c = a <= b;
+			break;
+		case 0x040:
+			c = a < b;
+			break;
+		case 0x041:
+			c = a >= b;
+			break;
+		case 0x042:
+			c = (s32) a >= (s32) b;
+			break;
+		default:
+			c = (s32) a <= (s32) b;
+			break;
+		}
+		push(FLAG(c));
+		break;
+	case 0x044:		/*  between                  */
+		c = pop();
+		b = pop();
+		a = pop();
+		push(FLAG(((s32) b <= (s32) a) && ((s32) a <= (s32) c)));
+		break;
+	case 0x045:		/*  within                   */
+		c = pop();
+		b = pop();
+		a = pop();
+		push(FLAG((a - b) < (c - b)));
+		break;
+	case 0x046:		/*  drop                     */
+		pop();
+		break;
+	case 0x047:		/*  dup                      */
+		push(*peek(0));
+		break;
+	case 0x048:		/*  over                     */
+		push(*peek(1));
+		break;
+	case 0x049:		/*  swap                     */
+		roll(1);
+		break;
+	case 0x04a:		/*  rot                      */
+		roll(2);
+		break;
+	case 0x04b:		/*  -rot                     */
+		roll(2);
+		roll(2);
+		break;
+	case 0x04c:		/*  tuck                     */
+		b = pop();
+		a = pop();
+		push(b);
+		push(a);
+		push(b);
+		break;
+	case 0x04d:		/*  nip                      */
+		b = pop();
+		*peek(0) = b;
+		break;
+	case 0x04e:		/*  pick                     */
+		a = pop();
+		push(*peek(a));
+		break;
+	case 0x04f:		/*  roll                     */
+		roll(pop());
+		break;
+	case 0x050:		/*  ?dup                     */
+		if (*peek(0) != 0)
+			push(*peek(0));
+		break;
+	case 0x051:		/*  depth                    */
+		push(sp);
+		break;
+	case 0x052:		/*  2drop                    */
+		pop();
+		pop();
+		break;
+	case 0x053:		/*  2dup                     */
+		a = *peek(1);
+		b = *peek(0);
+		push(a);
+		push(b);
+		break;
+	case 0x054:		/*  2over                    */
+		a = *peek(3);
+		b = *peek(2);
+		push(a);
+		push(b);
+		break;
+	case 0x055:		/*  2swap                    */
+		roll(3);
+		roll(3);
+		break;
+	case 0x056:		/*  2rot                     */
+		roll(5);
+		roll(5);
+		break;
+	case 0x057:		/*  2/                       */
+		*peek(0) = (u32) ((s32) * peek(0) >> 1);
+		break;
+	case 0x058:		/*  u2/                      */
+		*peek(0) >>= 1;
+		break;
+	case 0x059:		/*  2*                       */
+		*peek(0) <<= 1;
+		break;
+	case 0x05a:		/*  /c                       */
+		push(1);
+		break;
+	case 0x05b:		/*  /w                       */
+		push(2);
+		break;
+	case 0x05c:		/*  /l                       */
+	case 0x05d:		/*  /n                       */
+		push(4);
+		break;
+	case 0x05e:		/*  ca+                      */
+	case 0x05f:		/*  wa+                      */
+	case 0x060:		/*  la+                      */
+	case 0x061:		/*  na+                      */
+		b = pop();
+		*peek(0) += b << ((fc == 0x05e) ? 0 : (fc == 0x05f) ? 1 : 2);
+		break;
+	case 0x062:		/*  char+                    */
+		*peek(0) += 1;
+		break;
+	case 0x063:		/*  wa1+                     */
+		*peek(0) += 2;
+		break;
+	case 0x064:		/*  la1+                     */
+	case 0x065:		/*  cell+                    */
+		*peek(0) += 4;
+		break;
+	case 0x066:		/*  chars                    */
+		peek(0);
+		break;
+	case 0x067:		/*  /w*                      */
+		*peek(0) <<= 1;
+		break;
+	case 0x068:		/*  /l*                      */
+	case 0x069:		/*  cells                    */
+		*peek(0) <<= 2;
+		break;
+	case 0x06a:		/*  on                       */
+		store(pop(), 0xffffffff, 4);
+		break;
+	case 0x06b:		/*  off                      */
+		store(pop(), 0, 4);
+		break;
+	case 0x06c:		/*  +!                       */
+		a = pop();
+		b = pop();
+		store(a, fetch(a, 4) + b, 4);
+		break;
+	case 0x06d:		/*  @                        */
+	case 0x06e:		/*  l@                       */
+		push(fetch(pop(), 4));
+		break;
+	case 0x06f:		/*  w@                       */
+		push(fetch(pop(), 2));
+		break;
+	case 0x070:		/*  <w@                      */
+		push((u32) (s16) fetch(pop(), 2));
+		break;
+	case 0x071:		/*  c@                       */
+		push(fetch(pop(), 1));
+		break;
+	case 0x072:		/*  !                        */
+	case 0x073:		/*  l!                       */
+	case 0x074:		/*  w!                       */
+	case 0x075:		/*  c!                       */
+		a = pop();
+		b = pop();
+		store(a, b, (fc <= 0x073) ? 4 : (fc == 0x074) ? 2 : 1);
+		break;
+	case 0x076:		/*  2@                       */
+		a = pop();
+		push(fetch(a + 4, 4));
+		push(fetch(a, 4));
+		break;
+	case 0x077:		/*  2!                       */
+		a = pop();
+		b = pop();
+		c = pop();
+		store(a, b, 4);
+		store(a + 4, c, 4);
+		break;
+	case 0x078:		/*  move                     */
+		c = pop();
+		b = pop();
+		a = pop();
+		ptr = mem_at(a, c);
+		ptr2 = mem_at(b, c);
+		if ((ptr != NULL) && (ptr2 != NULL))
+			memmove(ptr2, ptr, c);
+		break;
+	case 0x079:		/*  fill                     */
+		c = pop();
+		b = pop();
+		a = pop();
+		ptr = mem_at(a, b);
+		if (ptr != NULL)
+			memset(ptr, (u8) c, b);
+		break;
+	case 0x07a:		/*  comp                     */
+		c = pop();
+		b = pop();
+		a = pop();
+		ptr = mem_at(a, c);
+		ptr2 = mem_at(b, c);
+		if ((ptr != NULL) && (ptr2 != NULL)) {
+			int diff = memcmp(ptr, ptr2, c);
+			push((diff < 0) ? 0xffffffff : (diff > 0) ? 1 : 0);
+		}
+		break;
+	case 0x07b:		/*  noop                     */
+	case FC_INSTANCE:
+	case FC_OFFSET16:
+		break;
+	case 0x07c:		/*  lwsplit                  */
+		a = pop();
+		push(a & 0xffff);
+		push(a >> 16);
+		break;
+	case 0x07d:		/*  wljoin                   */
+		b = pop();
+		a = pop();
+		push((a & 0xffff) | (b << 16));
+		break;
+	case 0x07e:		/*  lbsplit                  */
+		a = pop();
+		push(a & 0xff);
+		push((a >> 8) & 0xff);
+		push((a >> 16) & 0xff);
+		push(a >> 24);
+		break;
+	case 0x07f:		/*  bljoin                   */
+		d = pop();
+		c = pop();
+		b = pop();
+		a = pop();
+		push((a & 0xff) | ((b & 0xff) << 8) | ((c & 0xff) << 16)
+		     | (d << 24));
+		break;
+	case 0x080:		/*  wbflip                   */
+		a = *peek(0);
+		*peek(0) = ((a & 0xff) << 8) | ((a >> 8) & 0xff);
+		break;
+	case 0x081:		/*  upc                      */
+		*peek(0) = (u32) toupper((u8) * peek(0));
+		break;
+	case 0x082:		/*  lcc                      */
+		*peek(0) = (u32) tolower((u8) * peek(0));
+		break;
+	case 0x083:		/*  pack                     */
+		c = pop();
+		b = pop() & 0xff;
+		a = pop();
+		ptr = mem_at(a, b);
+		ptr2 = mem_at(c, b + 1);
+		if ((ptr != NULL) && (ptr2 != NULL)) {
+			memmove(ptr2 + 1, ptr, b);
+			ptr2[0] = (u8) b;
+			push(c);
+		}
+		break;
+	case 0x084:		/*  count                    */
+		a = pop();
+		push(a + 1);
+		push(fetch(a, 1));
+		break;
+	case 0x087:		/*  fcode-revision           */
+		push(0x00030000);
+		break;
+	case 0x088:		/*  span                     */
+		push(MEM_BASE + SPAN_VAR);
+		break;
+	case 0x089:		/*  unloop                   */
+		rpeek(2);
+		if (!stopped)
+			rsp -= 3;
+		break;
+	case 0x08b:		/*  alloc-mem                */
+		push(heap_alloc(pop()));
+		break;
+	case 0x08c:		/*  free-mem                 */
+		pop();
+		pop();
+		break;
+	case 0x08d:		/*  key?                     */
+		push(0);
+		break;
+	case 0x08f:		/*  emit                     */
+		a = pop();
+		if (!stopped) {
+			char chr = (char)a;
+			console_out(&chr, 1);
+		}
+		break;
+	case 0x090:		/*  type                     */
+		b = pop();
+		a = pop();
+		ptr = mem_at(a, b);
+		if (ptr != NULL)
+			console_out((const char *)ptr, b);
+		break;
+	case 0x091:		/*  (cr                      */
+		store(MEM_BASE + OUT_VAR, 0, 4);
+		break;
+	case 0x092:		/*  cr                       */
+		console_out("\n", 1);
+		store(MEM_BASE + OUT_VAR, 0, 4);
+		store(MEM_BASE + LINE_VAR, fetch(MEM_BASE + LINE_VAR, 4) + 1,
+		      4);
+		break;
+	case 0x093:		/*  #out                     */
+		push(MEM_BASE + OUT_VAR);
+		break;
+	case 0x094:		/*  #line                    */
+		push(MEM_BASE + LINE_VAR);
+		break;
+	case 0x095:		/*  hold                     */
+		hold(pop());
+		break;
+	case 0x096:		/*  <#                       */
+		hold_ptr = HOLD_END;
+		break;
+	case 0x097:		/*  u#>                      */
+	case 0x0c9:		/*  #>                       */
+		pop();
+		push(MEM_BASE + hold_ptr);
+		push(HOLD_END - hold_ptr);
+		break;
+	case 0x098:		/*  sign                     */
+		if ((s32) pop() < 0)
+			hold('-');
+		break;
+	case 0x099:		/*  u#                       */
+	case 0x0c7:		/*  #                        */
+		a = pop();
+		push(hold_digit(a));
+		break;
+	case 0x09a:		/*  u#s                      */
+	case 0x0c8:		/*  #s                       */
+		a = pop();
+		do {
+			a = hold_digit(a);
+		} while ((a != 0) && !stopped);
+		push(0);
+		break;
+	case 0x09b:		/*  u.                       */
+		a = pop();
+		if (!stopped)
+			print_number(a, false, 0, true);
+		break;
+	case 0x09c:		/*  u.r                      */
+	case 0x09e:		/*  .r                       */
+		b = pop();
+		a = pop();
+		if (!stopped)
+			print_number(a, fc == 0x09e, b, false);
+		break;
+	case 0x09d:		/*  .                        */
+		a = pop();
+		if (!stopped)
+			print_number(a, true, 0, true);
+		break;
+	case 0x09f:		/*  .s                       */
+		for (a = 0; a < sp; a++)
+			print_number(dstack[a], true, 0, true);
+		break;
+	case 0x0a0:		/*  base                     */
+		push(MEM_BASE + BASE_VAR);
+		break;
+	case 0x0a2:		/*  $number                  */
+		parse_number();
+		break;
+	case 0x0a3:		/*  digit                    */
+		b = pop();
+		a = pop();
+		c = isdigit(tolower((u8) a)) ? (a & 0xff) - '0'
+		    : isalpha(tolower((u8) a)) ? (u32) (tolower((u8) a) -
+							'a' + 10) : b;
+		if ((a < 0x100) && (c < b)) {
+			push(c);
+			push(FLAG(true));
+		} else {
+			push(a);
+			push(0);
+		}
+		break;
+	case 0x0a4:		/*  -1                       */
+		push(0xffffffff);
+		break;
+	case 0x0a5:		/*  0                        */
+	case 0x0a6:		/*  1                        */
+	case 0x0a7:		/*  2                        */
+	case 0x0a8:		/*  3                        */
+		push(fc - 0x0a5);
+		break;
+	case 0x0a9:		/*  bl                       */
+		push(' ');
+		break;
+	case 0x0aa:		/*  bs                       */
+		push(8);
+		break;
+	case 0x0ab:		/*  bell                     */
+		push(7);
+		break;
+	case 0x0ac:		/*  bounds                   */
+		b = pop();
+		a = pop();
+		push(a + b);
+		push(a);
+		break;
+	case 0x0ad:		/*  here                     */
+		push(here_ptr);
+		break;
+	case 0x0ae:		/*  aligned                  */
+		*peek(0) = (*peek(0) + 3) & ~3;
+		break;
+	case 0x0af:		/*  wbsplit                  */
+		a = pop();
+		push(a & 0xff);
+		push((a >> 8) & 0xff);
+		break;
+	case 0x0b0:		/*  bwjoin                   */
+		b = pop();
+		a = pop();
+		push((a & 0xff) | ((b & 0xff) << 8));
+		break;
+	case 0x0d0:		/*  c,                       */
+		dict_append(pop(), 1);
+		break;
+	case 0x0d1:		/*  w,                       */
+		dict_append(pop(), 2);
+		break;
+	case 0x0d2:		/*  l,                       */
+	case 0x0d3:		/*  ,                        */
+		dict_append(pop(), 4);
+		break;
+	case 0x0d4:		/*  um*                      */
+		b = pop();
+		a = pop();
+		wide = (u64) a *b;
+		push((u32) wide);
+		push((u32) (wide >> 32));
+		break;
+	case 0x0d5:		/*  um/mod                   */
+		c = pop();
+		b = pop();
+		a = pop();
+		u_divide(((u64) b << 32) | a, c);
+		break;
+	case 0x0d8:		/*  d+                       */
+	case 0x0d9:		/*  d-                       */
+		d = pop();
+		c = pop();
+		b = pop();
+		a = pop();
+		wide = ((u64) b << 32) | a;
+		if (fc == 0x0d8)
+			wide += ((u64) d << 32) | c;
+		else
+			wide -= ((u64) d << 32) | c;
+		push((u32) wide);
+		push((u32) (wide >> 32));
+		break;
+	case 0x0dc:		/*  state                    */
+		push(MEM_BASE + STATE_VAR);
+		break;
+	case 0x0fc:		/*  ferror                   */
+		stop_run("ferror");
+		break;
+	case 0x102:		/*  my-address               */
+		push(0);
+		push(0);
+		break;
+	case 0x103:		/*  my-space                 */
+		push(0);
+		break;
+	case 0x110:		/*  property                 */
+		property();
+		break;
+	case 0x111:		/*  encode-int               */
+		encode_int(pop());
+		break;
+	case 0x112:		/*  encode+                  */
+		encode_plus();
+		break;
+	case 0x113:		/*  encode-phys              */
+		c = pop();
+		b = pop();
+		a = pop();
+		encode_int(c);
+		encode_int(b);
+		encode_plus();
+		encode_int(a);
+		encode_plus();
+		break;
+	case 0x114:		/*  encode-string            */
+		encode_string();
+		break;
+	case 0x115:		/*  encode-bytes             */
+		b = pop();
+		a = pop();
+		a = heap_copy(a, b);
+		push(a);
+		push(b);
+		break;
+	case 0x116:		/*  reg                      */
+		d = pop();
+		c = pop();
+		b = pop();
+		a = pop();
+		encode_int(c);
+		encode_int(b);
+		encode_plus();
+		encode_int(a);
+		encode_plus();
+		encode_int(d);
+		encode_plus();
+		b = pop();
+		a = pop();
+		if (!stopped)
+			set_prop((const u8 *)"reg", 3, a, b);
+		break;
+	case 0x119:		/*  model                    */
+		set_string_prop("model");
+		break;
+	case 0x11a:		/*  device-type              */
+		set_string_prop("device_type");
+		break;
+	case 0x11c:		/*  is-install               */
+	case 0x11d:		/*  is-remove                */
+	case 0x11e:		/*  is-selftest              */
+	case 0x121:		/*  display-status           */
+		pop();
+		break;
+	case 0x11f:		/*  new-device               */
+		cur_node = new_node(cur_node);
+		my_self = handle_of(cur_node);
+		break;
+	case 0x120:		/*  diagnostic-mode?         */
+		push(0);
+		break;
+	case 0x124:		/*  mask                     */
+		push(MEM_BASE + MASK_VAR);
+		break;
+	case 0x125:		/*  get-msecs                */
+		push((u32) (now / NS_PER_MS));
+		break;
+	case FC_MS:
+		wait_ms(pop());
+		break;
+	case 0x127:		/*  finish-device            */
+		if (nodes[cur_node].parent != 0)
+			cur_node = nodes[cur_node].parent;
+		my_self = handle_of(cur_node);
+		break;
+	case 0x128:		/*  decode-phys              */
+		decode_cells(3);
+		break;
+	case 0x201:		/*  device-name              */
+		set_string_prop("name");
+		break;
+	case 0x202:		/*  my-args                  */
+		push(0);
+		push(0);
+		break;
+	case 0x203:		/*  my-self                  */
+		push(my_self);
+		break;
+	case 0x209:		/*  $call-parent             */
+		call_parent();
+		break;
+	case 0x20a:		/*  my-parent                */
+		push(handle_of(nodes[cur_node].parent));
+		break;
+	case 0x20b:		/*  ihandle>phandle          */
+		node_of(*peek(0));
+		break;
+	case 0x20d:		/*  my-unit                  */
+		push(0);
+		push(0);
+		push(0);
+		break;
+	case 0x216:		/*  abort                    */
+		throw_code(0xffffffff);
+		break;
+	case 0x217:		/*  catch                    */
+		run_xt(pop(), true);
+		break;
+	case 0x218:		/*  throw                    */
+		throw_code(pop());
+		break;
+	case 0x21a:		/*  get-my-property          */
+		get_prop(cur_node, false);
+		break;
+	case 0x21b:		/*  decode-int               */
+		decode_cells(1);
+		break;
+	case 0x21c:		/*  decode-string            */
+		decode_string();
+		break;
+	case 0x21d:		/*  get-inherited-property   */
+		get_prop(cur_node, true);
+		break;
+	case 0x21e:		/*  delete-property          */
+		delete_prop();
+		break;
+	case 0x21f:		/*  get-package-property     */
+		a = node_of(pop());
+		if (a != NO_INDEX)
+			get_prop(a, false);
+		break;
+	case 0x220:		/*  cpeek                    */
+	case 0x221:		/*  wpeek                    */
+	case 0x222:		/*  lpeek                    */
+		push(fetch(pop(), 1 << (fc - 0x220)));
+		push(FLAG(true));
+		break;
+	case 0x223:		/*  cpoke                    */
+	case 0x224:		/*  wpoke                    */
+	case 0x225:		/*  lpoke                    */
+		a = pop();
+		b = pop();
+		store(a, b, 1 << (fc - 0x223));
+		push(FLAG(true));
+		break;
+	case 0x226:		/*  lwflip                   */
+		a = *peek(0);
+		*peek(0) = (a << 16) | (a >> 16);
+		break;
+	case 0x227:		/*  lbflip                   */
+		a = *peek(0);
+		*peek(0) = (a << 24) | ((a & 0xff00) << 8)
+		    | ((a >> 8) & 0xff00) | (a >> 24);
+		break;
+	case 0x230:		/*  rb@                      */
+		push(fetch(pop(), 1));
+		break;
+	case 0x232:		/*  rw@                      */
+		push(fetch(pop(), 2));
+		break;
+	case 0x234:		/*  rl@                      */
+		push(fetch(pop(), 4));
+		break;
+	case 0x231:		/*  rb!                      */
+	case 0x233:		/*  rw!                      */
+	case 0x235:		/*  rl!                      */
+		a = pop();
+		b = pop();
+		store(a, b, 1 << ((fc - 0x231) / 2));
+		break;
+	case 0x23b:		/*  child                    */
+		a = node_of(pop());
+		if (a != NO_INDEX)
+			push(handle_of(nodes[a].first_child));
+		break;
+	case 0x23c:		/*  peer                     */
+		a = pop();
+		if (a == 0) {
+			push(handle_of(0));
+			break;
+		}
+		a = node_of(a);
+		if (a != NO_INDEX)
+			push(handle_of(nodes[a].next_peer));
+		break;
+	case 0x23f:		/*  set-args                 */
+		pop();
+		pop();
+		pop();
+		pop();
+		break;
+	case 0x240:		/*  left-parse-string        */
+		left_parse_string();
+		break;
+	default:
+		name = lookup_token(fc, &len);
+		/*  The name of a token not in the dictionary is  ferror   */
+		if ((fc >= FIRST_USER_FCODE)
+		    || ((name == lookup_token(0xffff, &unused_len))
+			&& (fc != 0x0fc)))
+			stop_run("token 0x%03x is not defined", fc);
+		else
+			stop_run("\"%.*s\" is not simulated", (int)len, name);
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  define
+ *      Synopsis:       Make the definition that a defining word makes,
+ *                          of the FCode number assigned before it.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             op                 The defining word
+ *
+ *      Process Explanation:
+ *          A defining word that is run again -- in a loop, or in a
+ *              definition run more than once -- makes its definition
+ *              over again, in the same place, so that the list of
+ *              definitions does not grow past the number of tokens.
+ *
+ **************************************************************************** */
+
+static void define(exec_op_t * op)
+{
+	exec_def_t *def;
+	u32 num = op->arg2;
+	u32 size;
+
+	if (pending_fcode == NO_INDEX) {
+		stop_run("defining word without a token to define");
+		return;
+	}
+	if (num == NO_INDEX) {
+		if (def_count == def_max) {
+			def_max = def_max ? 2 * def_max : 64;
+			defs = exec_realloc(defs,
+					    def_max * sizeof(exec_def_t));
+		}
+		num = def_count++;
+		op->arg2 = num;
+		memset(&defs[num], 0, sizeof(exec_def_t));
+	}
+	def = &defs[num];
+	def->kind = (u8) op->fcode;
+	def->fcode = (u16) pending_fcode;
+	def->name = pending_name;
+	def->name_len = pending_name_len;
+	def->block = run_block;
+	if (defined_as[pending_fcode] == NO_INDEX)
+		defined_fcodes[defined_count++] = (u16) pending_fcode;
+	defined_as[pending_fcode] = num;
+	pending_fcode = NO_INDEX;
+
+	switch (op->fcode) {
+	case FC_B_COLON:
+		def->body = ip;
+		jump(op->arg);
+		break;
+	case DEF_VALUE:
+	case DEF_CONSTANT:
+		def->value = pop();
+		break;
+	case DEF_VARIABLE:
+		def->value = here_ptr;
+		dict_append(0, 4);
+		break;
+	case DEF_CREATE:
+		def->value = here_ptr;
+		break;
+	case DEF_DEFER:
+		def->value = NO_INDEX;
+		break;
+	case DEF_BUFFER:
+		size = pop();
+		def->value = heap_alloc(size);
+		break;
+	case DEF_FIELD:
+		size = pop();
+		def->value = pop();
+		push(def->value + size);
+		break;
+	default:
+		stop_run("\"b(code)\" is not simulated");
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  step
+ *      Synopsis:       Run one operation:  a token with its operand.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             op                 The operation
+ *
+ *      Process Explanation:
+ *          The tokens that change the flow of control, and those that
+ *              make definitions, are handled here.  A token that the
+ *              image defined runs its definition; any other is run by
+ *              primitive() .
+ *
+ **************************************************************************** */
+
+static void step(exec_op_t * op)
+{
+	u16 fc = op->fcode;
+	u32 a, b;
+
+	cur_pos = op->pos;
+	if (op->flags & INSN_PARTIAL) {
+		stop_run("input ends within the token");
+		return;
+	}
+	if (op->opnd_kind == OPND_NONE) {
+		if (defined_as[fc] != NO_INDEX) {
+			charge(fc, cost_of(fc), false);
+			invoke(defined_as[fc], false);
+			return;
+		}
+		if ((op->flags & INSN_INVALID) || (fc >= FIRST_USER_FCODE)) {
+			stop_run("token 0x%03x is not defined", fc);
+			return;
+		}
+	}
+	charge(fc, cost_of(fc), true);
+
+	switch (fc) {
+	case FC_END0:
+	case FC_END1:
+		stop_run((fc == FC_END0) ? "end0" : "end1");
+		break;
+	case FC_B_LIT:
+	case FC_B_TICK:
+		push(op->arg);
+		break;
+	case FC_B_QUOTE:
+		a = MEM_BASE + PAD_START + pad_next * PAD_SIZE;
+		pad_next = (pad_next + 1) % PAD_COUNT;
+		memcpy(memory + (a - MEM_BASE), indata + op->arg, op->arg2);
+		push(a);
+		push(op->arg2);
+		break;
+	case FC_B_TO:
+		a = defined_as[op->arg];
+		if ((a == NO_INDEX) && (op->arg == 0x203)) {
+			my_self = pop();
+			break;
+		}
+		if ((a == NO_INDEX) || ((defs[a].kind != DEF_VALUE)
+					&& (defs[a].kind != DEF_DEFER))) {
+			stop_run("b(to) of 0x%03x, which is not a value",
+				 op->arg);
+			break;
+		}
+		defs[a].value = pop();
+		break;
+	case FC_BBRANCH:
+	case FC_B_ENDOF:
+		jump(op->arg);
+		break;
+	case FC_B_QBRANCH:
+		if (pop() == 0)
+			jump(op->arg);
+		break;
+	case FC_B_DO:
+	case FC_B_QDO:
+		b = pop();
+		a = pop();
+		if (stopped)
+			break;
+		if ((fc == FC_B_QDO) && (a == b)) {
+			jump(op->arg);
+			break;
+		}
+		rpush(op->arg);
+		rpush(a);
+		rpush(b);
+		break;
+	case FC_B_LOOP:
+	case FC_B_PLUS_LOOP:
+		/*  The loop ends when the index crosses from  limit-1
+		 *      to  limit , either way.
+		 */
+		b = (fc == FC_B_LOOP) ? 1 : pop();
+		rpeek(2);
+		if (stopped)
+			break;
+		a = rstack[rsp - 1] - rstack[rsp - 2];
+		if (((s32) (a ^ (a + b)) < 0) && ((s32) (a ^ b) < 0)) {
+			rsp -= 3;
+		} else {
+			rstack[rsp - 1] += b;
+			jump(op->arg);
+		}
+		break;
+	case FC_B_LEAVE:
+		a = rpeek(2);
+		if (stopped)
+			break;
+		rsp -= 3;
+		jump(a);
+		break;
+	case FC_B_CASE:
+	case FC_B_MARK:
+	case FC_B_RESOLVE:
+		break;
+	case FC_B_OF:
+		a = pop();
+		if (*peek(0) == a)
+			pop();
+		else
+			jump(op->arg);
+		break;
+	case FC_B_ENDCASE:
+		pop();
+		break;
+	case FC_NEW_TOKEN:
+	case FC_NAMED_TOKEN:
+	case FC_EXTERNAL_TOKEN:
+		pending_fcode = op->arg2 & (FCODE_COUNT - 1);
+		pending_name = (op->opnd_kind == OPND_NAMED_TOKEN)
+		    ? indata + op->arg : NULL;
+		pending_name_len = (u8) (op->arg2 >> 16);
+		break;
+	case FC_B_SEMICOLON:
+	case FC_EXIT:
+		if (frame_count == 0) {
+			stop_run((fc == FC_EXIT) ? "exit outside of a definition"
+				 : "b(;) outside of a definition");
+			break;
+		}
+		leave_frame();
+		if (method_run && (frame_count == 0))
+			stop_run("returned");
+		break;
+	default:
+		if ((fc >= FC_B_COLON) && (fc <= FC_B_CODE))
+			define(op);
+		else if (op->opnd_kind != OPND_NONE)
+			primitive(fc);
+		else
+			primitive(fc);
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Runs, and what they did.
+ *
+ **************************************************************************** */
+
+static void begin_run(u32 blk)
+{
+	sp = rsp = frame_count = 0;
+	max_sp = max_rsp = max_frames = 0;
+	tokens_run = 0;
+	xt_nesting = 0;
+	stopped = false;
+	pending_fcode = NO_INDEX;
+	cur_pos = blocks[blk].pos;
+	cur_def = block_def;
+}
+
+/*  Run until something stops it:  as the FCode would, or otherwise  */
+static void run_ops(u32 end_op)
+{
+	while (!stopped) {
+		if (ip >= end_op) {
+			stop_run((frame_count > 0)
+				 ? "definition runs past the end of its block"
+				 : "ran past the end of the block");
+			break;
+		}
+		if (tokens_run >= token_limit) {
+			stop_run("limit of %llu tokens reached",
+				 (unsigned long long)token_limit);
+			break;
+		}
+		step(&ops[ip++]);
+	}
+}
+
+/*  Close the calls left open, and print a line about the run  */
+static void end_run(u32 blk, const char *label, u64 start_time)
+{
+	while (frame_count > 0)
+		leave_frame();
+	all_tokens_run += tokens_run;
+	out_printf("%8u  %-12s  %10llu  %12llu  %5u  %6u  %5u  %s at 0x%06x\n",
+		   blk + 1, label, (unsigned long long)tokens_run,
+		   (unsigned long long)(now - start_time), max_sp, max_rsp,
+		   max_frames, stop_reason, stop_pos);
+}
+
+/*  The definition a method of that name stands for in the block  */
+static u32 find_method(const char *name)
+{
+	size_t name_len = strlen(name);
+	u32 found = NO_INDEX;
+	u32 indx;
+
+	for (indx = 0; indx < defined_count; indx++) {
+		u32 num = defined_as[defined_fcodes[indx]];
+		exec_def_t *def = &defs[num];
+
+		if ((def->name != NULL) && (def->name_len == name_len)
+		    && (strncasecmp((const char *)def->name, name,
+				    name_len) == 0)
+		    && ((found == NO_INDEX) || (num > found)))
+			found = num;
+	}
+	return found;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  profile_block
+ *      Synopsis:       Probe a device with an FCode block, and then
+ *                          call the methods asked for.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             blk                The number of the block
+ *
+ *      Process Explanation:
+ *          The device gets a node of its own under the root, and the
+ *              configuration space of its PCI image.  A definition
+ *              stands for the block's own code, and is charged with
+ *              what that does.
+ *          A method is looked up by name among the definitions the
+ *              probe left in place, and is run with empty stacks.
+ *
+ **************************************************************************** */
+
+static void profile_block(u32 blk)
+{
+	exec_block_t *block = &blocks[blk];
+	u64 start_time = now;
+	int indx;
+
+	run_block = blk;
+	while (defined_count > 0)
+		defined_as[defined_fcodes[--defined_count]] = NO_INDEX;
+
+	if (def_count == def_max) {
+		def_max = def_max ? 2 * def_max : 64;
+		defs = exec_realloc(defs, def_max * sizeof(exec_def_t));
+	}
+	block_def = def_count++;
+	memset(&defs[block_def], 0, sizeof(exec_def_t));
+	defs[block_def].kind = DEF_BLOCK;
+	defs[block_def].block = blk;
+	defs[block_def].calls = 1;
+
+	memset(config_space, 0, sizeof(config_space));
+	if (block->pci_data) {
+		config_space[0] = (u8) block->vendor;
+		config_space[1] = (u8) (block->vendor >> 8);
+		config_space[2] = (u8) block->device;
+		config_space[3] = (u8) (block->device >> 8);
+		config_space[8] = (u8) block->revision;
+		config_space[9] = (u8) block->class_code;
+		config_space[10] = (u8) (block->class_code >> 8);
+		config_space[11] = (u8) (block->class_code >> 16);
+	}
+	store(MEM_BASE + BASE_VAR, 16, 4);
+	store(MEM_BASE + STATE_VAR, 0, 4);
+	hold_ptr = HOLD_END;
+
+	begin_run(blk);
+	cur_node = new_node(0);
+	my_self = handle_of(cur_node);
+	ip = block->first_op;
+	run_ops(block->end_op);
+	end_run(blk, "probe", start_time);
+	defs[block_def].total_time = now - start_time;
+
+	for (indx = 0; indx < method_count; indx++) {
+		u32 method = find_method(methods[indx]);
+
+		if (method == NO_INDEX) {
+			out_printf("%8u  %-12s  not defined\n", blk + 1,
+				   methods[indx]);
+			continue;
+		}
+		start_time = now;
+		begin_run(blk);
+		method_run = true;
+		ip = block->end_op;
+		invoke(method, false);
+		if (frame_count == 0)
+			stop_run("returned");
+		run_ops(block->end_op);
+		end_run(blk, methods[indx], start_time);
+		method_run = false;
+	}
+}
+
+/*  A name, with anything that would not print shown in hex  */
+static void out_name(const u8 * name, u32 len)
+{
+	u32 indx;
+
+	for (indx = 0; indx < len; indx++) {
+		if ((name[indx] < 0x20) || (name[indx] >= 0x7f))
+			out_printf("\\x%02x", name[indx]);
+		else
+			out_char(name[indx]);
+	}
+}
+
+static int compare_defs(const void *one, const void *two)
+{
+	const exec_def_t *def1 = &defs[*(const u32 *)one];
+	const exec_def_t *def2 = &defs[*(const u32 *)two];
+
+	if (def1->total_time != def2->total_time)
+		return (def1->total_time < def2->total_time) ? 1 : -1;
+	if (def1->self_time != def2->self_time)
+		return (def1->self_time < def2->self_time) ? 1 : -1;
+	return (*(const u32 *)one < *(const u32 *)two) ? -1 : 1;
+}
+
+static int compare_tokens(const void *one, const void *two)
+{
+	u16 fc1 = *(const u16 *)one;
+	u16 fc2 = *(const u16 *)two;
+
+	if (token_times[fc1] != token_times[fc2])
+		return (token_times[fc1] < token_times[fc2]) ? 1 : -1;
+	if (token_counts[fc1] != token_counts[fc2])
+		return (token_counts[fc1] < token_counts[fc2]) ? 1 : -1;
+	return (fc1 < fc2) ? -1 : 1;
+}
+
+static void print_defs(void)
+{
+	u32 *order = exec_realloc(NULL, (def_count + 1) * sizeof(u32));
+	u32 count = 0;
+	u32 indx;
+
+	for (indx = 0; indx < def_count; indx++) {
+		if (defs[indx].calls > 0)
+			order[count++] = indx;
+	}
+	qsort(order, count, sizeof(u32), compare_defs);
+
+	out_str("\\\n\\  Definitions run, most time first\n");
+	out_str("\\   Block  FCode  Kind           Calls      Tokens  "
+		"     Self ns      Total ns  Name\n");
+	for (indx = 0; indx < count; indx++) {
+		exec_def_t *def = &defs[order[indx]];
+		static const char *const kinds[] = {
+			":", "value", "variable", "constant",
+			"create", "defer", "buffer:", "field"
+		};
+
+		if (def->kind == DEF_BLOCK) {
+			out_printf("%8u  %5s  %-8s  %10llu  %10llu  %12llu  "
+				   "%12llu  (FCode block %u)\n",
+				   def->block + 1, "-", "-",
+				   (unsigned long long)def->calls,
+				   (unsigned long long)def->tokens,
+				   (unsigned long long)def->self_time,
+				   (unsigned long long)def->total_time,
+				   def->block + 1);
+			continue;
+		}
+		out_printf("%8u  0x%03x  %-8s  %10llu  %10llu  %12llu  "
+			   "%12llu  ", def->block + 1, def->fcode,
+			   kinds[def->kind - DEF_COLON],
+			   (unsigned long long)def->calls,
+			   (unsigned long long)def->tokens,
+			   (unsigned long long)def->self_time,
+			   (unsigned long long)def->total_time);
+		if (def->name == NULL)
+			out_str(unnamed);
+		else
+			out_name(def->name, def->name_len);
+		out_char('\n');
+	}
+	free(order);
+}
+
+static void print_tokens(void)
+{
+	u16 used[FCODE_COUNT];
+	u32 count = 0;
+	u32 indx;
+
+	for (indx = 0; indx < FCODE_COUNT; indx++) {
+		if (token_counts[indx] > 0)
+			used[count++] = (u16) indx;
+	}
+	qsort(used, count, sizeof(u16), compare_tokens);
+
+	out_str("\\\n\\  Other tokens run, most time first\n");
+	out_str("\\      Count       Time ns  FCode  Name\n");
+	for (indx = 0; indx < count; indx++) {
+		u8 len;
+		const char *name = lookup_token(used[indx], &len);
+
+		out_printf("%12llu  %12llu  0x%03x  ",
+			   (unsigned long long)token_counts[used[indx]],
+			   (unsigned long long)token_times[used[indx]],
+			   used[indx]);
+		out_name((const u8 *)name, len);
+		out_char('\n');
+	}
+}
+
+/*  A value that is a list of strings is shown as such; any other,
+ *      as cells in hex, and as bytes at the end if it is not a
+ *      whole number of cells.
+ */
+static void print_value(exec_prop_t * prop)
+{
+	u8 *ptr = memory + (prop->addr - MEM_BASE);
+	u32 len = (prop->len < PROP_SHOWN) ? prop->len : PROP_SHOWN;
+	bool is_text = (prop->len > 0) && (prop->len <= PROP_SHOWN)
+	    && (ptr[0] != 0) && (ptr[prop->len - 1] == 0);
+	u32 indx;
+
+	for (indx = 0; is_text && (indx < prop->len); indx++) {
+		if ((ptr[indx] == 0) && (indx + 1 < prop->len)
+		    && (ptr[indx + 1] == 0))
+			is_text = false;
+		if ((ptr[indx] != 0)
+		    && ((ptr[indx] < 0x20) || (ptr[indx] >= 0x7f)))
+			is_text = false;
+	}
+
+	if (prop->len == 0) {
+		out_str("(empty)");
+	} else if (is_text) {
+		for (indx = 0; indx < prop->len - 1; indx++) {
+			if ((indx == 0) || (ptr[indx - 1] == 0))
+				out_str((indx == 0) ? "\"" : " \"");
+			if (ptr[indx] == 0)
+				out_char('"');
+			else
+				out_char(ptr[indx]);
+		}
+		out_char('"');
+	} else {
+		for (indx = 0; indx + 4 <= len; indx += 4)
+			out_printf("%s%02x%02x%02x%02x", indx ? " " : "",
+				   ptr[indx], ptr[indx + 1], ptr[indx + 2],
+				   ptr[indx + 3]);
+		for (; indx < len; indx++)
+			out_printf(" %02x", ptr[indx]);
+		if (len < prop->len)
+			out_str(" ...");
+	}
+	out_char('\n');
+}
+
+static void print_node(u32 node, int depth)
+{
+	exec_node_t *this = &nodes[node];
+	exec_prop_t *name = find_prop(node, (const u8 *)"name", 4);
+	u32 indx;
+	u32 child;
+
+	if (node == 0)
+		out_str("/\n");
+	else {
+		out_printf("%*s", 2 * depth, "");
+		if ((name != NULL) && (name->len > 0))
+			out_name(memory + (name->addr - MEM_BASE),
+				 strnlen((const char *)memory +
+					 (name->addr - MEM_BASE), name->len));
+		else
+			out_str("(no name)");
+		out_printf("  (FCode block %u)\n", this->block + 1);
+	}
+	for (indx = 0; indx < this->prop_count; indx++) {
+		out_printf("%*s%-20s  ", 2 * depth + 4, "",
+			   this->props[indx].name);
+		print_value(&this->props[indx]);
+	}
+	for (child = this->first_child; child != NO_INDEX;
+	     child = nodes[child].next_peer)
+		print_node(child, depth + 1);
+}
+
+static void print_console(void)
+{
+	size_t start = 0;
+	size_t indx;
+
+	if (console_len == 0)
+		return;
+	out_str("\\\n\\  Console output\n");
+	for (indx = 0; indx <= console_len; indx++) {
+		if ((indx < console_len) && (console[indx] != '\n'))
+			continue;
+		if ((indx < console_len) || (indx > start)) {
+			out_str("    ");
+			out_name((const u8 *)console + start, indx - start);
+			out_char('\n');
+		}
+		start = indx + 1;
+	}
+	if (console_full)
+		out_str("\\  (and more, not kept)\n");
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  profile_stream
+ *      Synopsis:       Run each FCode block of the input file, and
+ *                          report what it cost.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *
+ *      Outputs:
+ *         Printout:
+ *             A line for each run:  how many tokens it executed, in
+ *                 how much time, how deep the stacks and the calls
+ *                 went, and how it ended.  Then, the definitions that
+ *                 were run, the other tokens, the device tree and
+ *                 what the FCode printed on the console.
+ *
+ **************************************************************************** */
+
+void profile_stream(char *in_filnam)
+{
+	insn_sink_t prev_sink;
+	void *prev_sink_data;
+	u32 called = 0;
+	u32 defined = 0;
+	u32 indx;
+
+	/*  The positions are kept in 32 bits  */
+	if (stream_max > 0xffffffffLL) {
+		out_printf("File \"%s\" is too large to profile.\n",
+			   in_filnam);
+		return;
+	}
+
+	op_count = block_count = def_count = node_count = 0;
+	for (indx = 0; indx < FCODE_COUNT; indx++)
+		defined_as[indx] = NO_INDEX;
+	defined_count = 0;
+	collecting_block = open_colon = NO_INDEX;
+	memset(&next_pci, 0, sizeof(next_pci));
+	prev_sink = get_insn_sink(&prev_sink_data);
+	set_insn_sink(exec_insn, NULL);
+	init_decoder();
+	detokenize();
+	set_insn_sink(prev_sink, prev_sink_data);
+	end_block();
+	resolve_branches();
+
+	memory = calloc(MEM_SIZE, 1);
+	if (memory == NULL) {
+		out_str("Out of memory while profiling.\n");
+		exit(-ENOMEM);
+	}
+	here_ptr = MEM_BASE + DICT_START;
+	heap_ptr = MEM_BASE + HEAP_START;
+	pad_next = 0;
+	now = 0;
+	all_tokens_run = 0;
+	console_len = 0;
+	console_full = false;
+	memset(token_counts, 0, sizeof(token_counts));
+	memset(token_times, 0, sizeof(token_times));
+	run_block = NO_INDEX;
+	new_node(NO_INDEX);
+
+	out_printf("\\  Profile of %s\n", in_filnam);
+	out_printf("\\  %u ns a token, unless the cost model says otherwise;  "
+		   "at most %llu tokens a run\n\\\n", default_cost,
+		   (unsigned long long)token_limit);
+	out_str("\\   Block  Run               Tokens       Time ns  "
+		"Stack  Return  Calls  Ended\n");
+	for (indx = 0; indx < block_count; indx++)
+		profile_block(indx);
+
+	print_defs();
+	print_tokens();
+	out_str("\\\n\\  Device tree\n");
+	print_node(0, 0);
+	print_console();
+
+	for (indx = 0; indx < def_count; indx++) {
+		if (defs[indx].kind == DEF_BLOCK)
+			continue;
+		defined++;
+		if (defs[indx].calls > 0)
+			called++;
+	}
+	out_printf("\\\n\\  %llu tokens run in %llu ns;  %u of %u "
+		   "definitions called.\n",
+		   (unsigned long long)all_tokens_run,
+		   (unsigned long long)now, called, defined);
+
+	for (indx = 0; indx < node_count; indx++) {
+		u32 prop;
+		for (prop = 0; prop < nodes[indx].prop_count; prop++)
+			free(nodes[indx].props[prop].name);
+		free(nodes[indx].props);
+	}
+	free(nodes);
+	free(ops);
+	free(blocks);
+	free(defs);
+	free(memory);
+	free(console);
+	nodes = NULL;
+	ops = NULL;
+	blocks = NULL;
+	defs = NULL;
+	memory = NULL;
+	console = NULL;
+	node_count = node_max = 0;
+	op_count = op_max = 0;
+	block_count = block_max = 0;
+	def_count = def_max = 0;
+	console_len = 0;
+}
@@ -0,0 +1,1107 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcindex.c - a sidecar index, for detokenizing one definition, or one
+ *                  range of bytes, of a large image without all the rest.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Support for the  --index ,  --word  and  --range  options.
+ *
+ *      The decoder cannot simply start in the middle of an image:  the
+ *          names of the tokens the image defines are entered into the
+ *          dictionary as they are read, and the tokens themselves are
+ *          of different lengths, so neither the names nor even where a
+ *          token begins is known without reading everything before it.
+ *
+ *      So, as a file is detokenized, a sink that stands in front of the
+ *          listing notes down, in a sidecar file next to it, where each
+ *          FCode block is, where each token is defined and by what name,
+ *          and, at every definition and every so often in between, a
+ *          checkpoint:  the position of a token and the state of the
+ *          decoder just before it.  The dictionary at a checkpoint is
+ *          the one made by the definitions before it, which are all in
+ *          the index.
+ *
+ *      To detokenize a span, the state at the last checkpoint before it
+ *          is put back, and the decoder is started from there; whatever
+ *          comes before the span is decoded without being shown.  The
+ *          records for the span are the same ones the whole file would
+ *          have given.
+ *
+ *      The index records the length, the sum of the bytes and the time
+ *          of modification of the file it was made from, whether  end0
+ *          stopped the blocks, and a fingerprint of the table of how
+ *          the decoder treats each FCode number, in which the Vendor
+ *          FCodes have a part.  If any of those do not match, the index
+ *          is made over again.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "fcsum.h"
+
+#include "detok.h"
+#include "stream.h"
+#include "outsink.h"
+#include "fcinsn.h"
+#include "workers.h"
+#include "jsonout.h"
+#include "fcindex.h"
+
+/* **************************************************************************
+ *
+ *      Layout of a sidecar index.  Numbers are stored big-endian, as
+ *          in FCode; positions are byte offsets from the start of the
+ *          file.
+ *
+ *           Offset  Length
+ *              0       8      IDX_MAGIC
+ *              8       2      IDX_VERSION
+ *             10       2      Flags:  IDX_DECODE_ALL
+ *             12       4      Fingerprint of the  token_descs  table
+ *             16       8      Length of the file
+ *             24       8      Sum of its bytes
+ *             32       8      Its time of modification
+ *             40       4      Number of blocks
+ *             44       4      Number of checkpoints
+ *             48       4      Number of definitions
+ *             52       4      Check-value of all the rest of the index
+ *             56              The blocks, 36 bytes each:
+ *                                 Position of the header
+ *                                 Origin of the stream positions
+ *                                 End:  where its decoding stopped, or
+ *                                     if it was cut short by the end of
+ *                                     the file, where its header says
+ *                                 Number of definitions before it
+ *                                 last_defined_token  at its start
+ *                                 Flags:  IDX_OFFS16
+ *                                 A byte of padding
+ *                                 Its number, as the JSON output
+ *                                     counts blocks
+ *                             The checkpoints, 24 bytes each:
+ *                                 Position of the token
+ *                                 Index of its block
+ *                                 Number of definitions before it
+ *                                 last_defined_token  just before it
+ *                                 Flags:  IDX_OFFS16 , IDX_END_FOUND
+ *                                 A byte of padding
+ *                                 Number of the block the JSON output
+ *                                     has it in, counting the headers
+ *                                     met within a block
+ *                             The definitions, 24 bytes each:
+ *                                 Position of the defining token
+ *                                 Position of the name; zero if none
+ *                                 Index of the checkpoint at it
+ *                                 Token number defined
+ *                                 Length of the name
+ *                                 One if it has a name, else zero
+ *
+ *      The index is not where the names are kept:  they are read from
+ *          the file, as the dictionary reads them anyway.
+ *
+ **************************************************************************** */
+
+#define IDX_MAGIC            "\0DTKidx\n"
+#define IDX_MAGIC_LEN        8
+#define IDX_VERSION          1
+#define IDX_HEADER_LEN       56
+#define IDX_CHECK_OFFSET     52
+#define IDX_BLOCK_LEN        36
+#define IDX_CHECKPOINT_LEN   24
+#define IDX_DEF_LEN          24
+
+#define IDX_DECODE_ALL       0x0001
+
+#define IDX_OFFS16           0x01
+#define IDX_END_FOUND        0x02
+
+/*  Bytes of FCode between checkpoints, at most, give or take a token  */
+#define IDX_CHECKPOINT_GAP   0x400
+
+/*  Extension of the sidecar file's name  */
+#define IDX_EXTENSION        ".dtx"
+
+typedef struct {
+	s64 pos;
+	s64 origin;
+	s64 end;
+	u32 defs_before;
+	u16 last_def;
+	u8 flags;
+	u32 number;
+} idx_block_t;
+
+typedef struct {
+	s64 pos;
+	u32 block;
+	u32 defs_before;
+	u16 last_def;
+	u8 flags;
+	u32 number;
+} idx_checkpoint_t;
+
+typedef struct {
+	s64 pos;
+	s64 name_pos;
+	u32 checkpoint;
+	u16 token;
+	u8 name_len;
+	bool named;
+} idx_def_t;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     blocks, checkpoints, defs     The index being made or used
+ *     block_count, etc.             How many of each it holds
+ *     block_max, etc.               How many there is room for
+ *     next_sink, next_sink_data     Where the records go after the
+ *                                       index, or the span filter, has
+ *                                       seen them
+ *     json_block                    Number of the current block, as
+ *                                       the JSON output counts them
+ *     span_from                     Position at which the part of a
+ *                                       span to be shown begins
+ *     span_showing                  Whether it has been reached
+ *
+ **************************************************************************** */
+
+static idx_block_t *blocks = NULL;
+static idx_checkpoint_t *checkpoints = NULL;
+static idx_def_t *defs = NULL;
+static u32 block_count = 0;
+static u32 checkpoint_count = 0;
+static u32 def_count = 0;
+static u32 block_max = 0;
+static u32 checkpoint_max = 0;
+static u32 def_max = 0;
+static int json_block = -1;
+
+static insn_sink_t next_sink;
+static void *next_sink_data;
+
+static s64 span_from;
+static bool span_showing;
+
+/*  Numbers in the index  */
+static u16 get_be16(const u8 * ptr)
+{
+	return (u16) ((ptr[0] << 8) | ptr[1]);
+}
+
+static u32 get_be32(const u8 * ptr)
+{
+	return ((u32) get_be16(ptr) << 16) | get_be16(ptr + 2);
+}
+
+static s64 get_be64(const u8 * ptr)
+{
+	return (s64) (((u64) get_be32(ptr) << 32) | get_be32(ptr + 4));
+}
+
+static void put_be16(u8 * ptr, u16 val)
+{
+	ptr[0] = val >> 8;
+	ptr[1] = val & 0xff;
+}
+
+static void put_be32(u8 * ptr, u32 val)
+{
+	put_be16(ptr, val >> 16);
+	put_be16(ptr + 2, val & 0xffff);
+}
+
+static void put_be64(u8 * ptr, s64 val)
+{
+	put_be32(ptr, (u32) ((u64) val >> 32));
+	put_be32(ptr + 4, (u32) val);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  room_for
+ *      Synopsis:       Make sure one of the index's lists has room for
+ *                          one more entry; it grows by doubling.
+ *
+ **************************************************************************** */
+
+static void *room_for(void *list, u32 count, u32 * max, size_t entry_len)
+{
+	if (count == *max) {
+		void *nu_list;
+		*max = *max ? 2 * *max : 256;
+		nu_list = realloc(list, (size_t) * max * entry_len);
+		if (!nu_list) {
+			out_str("Out of memory while indexing.\n");
+			exit(-ENOMEM);
+		}
+		list = nu_list;
+	}
+	return list;
+}
+
+static void clear_index(void)
+{
+	free(blocks);
+	free(checkpoints);
+	free(defs);
+	blocks = NULL;
+	checkpoints = NULL;
+	defs = NULL;
+	block_count = checkpoint_count = def_count = 0;
+	block_max = checkpoint_max = def_max = 0;
+	json_block = -1;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  fnv_hash
+ *      Synopsis:       Carry a 32-bit FNV-1a hash on over some bytes.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             hash               The hash so far; FNV_START to begin
+ *             ptr                The bytes
+ *             len                How many
+ *
+ *      Outputs:
+ *         Returned Value:        The hash taken on over them
+ *
+ **************************************************************************** */
+
+#define FNV_START  2166136261u
+
+static u32 fnv_hash(u32 hash, const u8 * ptr, size_t len)
+{
+	size_t indx;
+
+	for (indx = 0; indx < len; indx++) {
+		hash ^= ptr[indx];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  descs_fingerprint
+ *      Synopsis:       Boil the table of how the decoder treats each
+ *                          FCode number down to 32 bits.
+ *
+ **************************************************************************** */
+
+static u32 descs_fingerprint(void)
+{
+	return fnv_hash(FNV_START, (const u8 *)token_descs,
+			sizeof(token_descs));
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  index_check_value
+ *      Synopsis:       Hash an index, all but the field that holds
+ *                          the hash itself.
+ *
+ **************************************************************************** */
+
+static u32 index_check_value(const u8 * header, const u8 * body,
+			     size_t body_len)
+{
+	return fnv_hash(fnv_hash(FNV_START, header, IDX_CHECK_OFFSET), body, body_len);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  index_insn
+ *      Synopsis:       A sink that notes down, for the index, what it
+ *                          needs from each record, then passes the
+ *                          record along.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn               The record
+ *             unused             The sink's data; none needed here
+ *         Global Variables:
+ *             offs16, end_found, last_defined_token
+ *                                The state of the decoder.  A token's
+ *                                    record goes out before anything it
+ *                                    does to these, and its definition
+ *                                    is entered into the dictionary
+ *                                    only afterwards, so they are as
+ *                                    they were just before it.
+ *
+ *      Outputs:
+ *         Local Static Variables:
+ *             blocks             One more for each header, or for each
+ *                                    place where one should have been;
+ *                                    its end set when the block ends
+ *             checkpoints        One more at each definition, and at
+ *                                    the next token once there have been
+ *                                    IDX_CHECKPOINT_GAP  bytes without
+ *             defs               One more at each definition
+ *
+ *      Process Explanation:
+ *          The records give stream positions; the origin of those, in
+ *              the file, is asked of the stream as each one comes by.
+ *          No checkpoint is put at an  end0 :  started from there, the
+ *              decoder would not know that it had not yet seen it.  Nor
+ *              at a token cut short by the end of the file.
+ *
+ **************************************************************************** */
+
+static void index_insn(const fc_insn_t * insn, void *unused)
+{
+	s64 origin = get_stream_origin();
+	s64 pos = origin + insn->offset;
+	idx_block_t *block;
+	idx_checkpoint_t *cp;
+	bool defines;
+
+	switch (insn->kind) {
+	case INSN_HEADER:
+	case INSN_BAD_START:
+		json_block++;
+		if (insn->flags & INSN_MIDBLOCK)
+			break;
+		blocks = room_for(blocks, block_count, &block_max,
+				  sizeof(idx_block_t));
+		block = &blocks[block_count++];
+		block->pos = pos;
+		block->origin = origin;
+		block->end = pos + insn->opnd.header.len;
+		if ((insn->kind == INSN_HEADER)
+		    && (insn->opnd.header.fields < 3))
+			block->end = pos;
+		block->defs_before = def_count;
+		block->last_def = last_defined_token;
+		/*  A block with no proper header keeps the offsets it had  */
+		block->flags = offs16 ? IDX_OFFS16 : 0;
+		block->number = json_block;
+		break;
+	case INSN_TOKEN:
+		if ((block_count == 0) || (insn->flags & INSN_PARTIAL))
+			break;
+		if (token_descs[insn->fcode].flags & DESC_ENDER)
+			break;
+		defines = (insn->opnd_kind == OPND_NEW_TOKEN)
+		    || (insn->opnd_kind == OPND_NAMED_TOKEN);
+		if (checkpoint_count > 0) {
+			idx_checkpoint_t *last = &checkpoints[checkpoint_count - 1];
+			/*  The checkpoints must stay in order, to be searched  */
+			if (pos <= last->pos)
+				break;
+			if (!defines && (last->block == block_count - 1)
+			    && (pos < last->pos + IDX_CHECKPOINT_GAP))
+				break;
+		}
+
+		checkpoints = room_for(checkpoints, checkpoint_count,
+				       &checkpoint_max,
+				       sizeof(idx_checkpoint_t));
+		cp = &checkpoints[checkpoint_count++];
+		cp->pos = pos;
+		cp->block = block_count - 1;
+		cp->defs_before = def_count;
+		cp->last_def = last_defined_token;
+		cp->flags = (offs16 ? IDX_OFFS16 : 0)
+		    | (end_found ? IDX_END_FOUND : 0);
+		cp->number = json_block;
+
+		if (defines) {
+			idx_def_t *def;
+
+			defs = room_for(defs, def_count, &def_max,
+					sizeof(idx_def_t));
+			def = &defs[def_count++];
+			def->pos = pos;
+			def->checkpoint = checkpoint_count - 1;
+			def->token = insn->opnd.new_token.token;
+			def->named = (insn->opnd_kind == OPND_NAMED_TOKEN);
+			def->name_pos = 0;
+			def->name_len = 0;
+			if (def->named) {
+				/*  An embedded null ends the name  */
+				def->name_pos = insn->opnd.new_token.ptr - indata;
+				def->name_len =
+				    strnlen((const char *)insn->opnd.new_token.ptr,
+					    insn->opnd.new_token.len);
+			}
+		}
+		break;
+	case INSN_BLOCK_END:
+		/*  A block can stop well short of the length it was given  */
+		if (block_count > 0)
+			blocks[block_count - 1].end = pos;
+		break;
+	default:
+		break;
+	}
+
+	(*next_sink) (insn, next_sink_data);
+}
+
+/*  A sink that lets everything go by:  for an index made quietly  */
+static void discard_insn(const fc_insn_t * insn, void *unused)
+{
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  index_name
+ *      Synopsis:       Name of the sidecar index for an input file
+ *
+ *      Memory Allocated
+ *          The name
+ *      When Freed?
+ *          By the caller
+ *
+ **************************************************************************** */
+
+static char *index_name(char *in_filnam)
+{
+	char *idx_filnam = malloc(strlen(in_filnam) + strlen(IDX_EXTENSION) + 1);
+	if (!idx_filnam) {
+		out_str("Out of memory while naming index.\n");
+		exit(-ENOMEM);
+	}
+	sprintf(idx_filnam, "%s%s", in_filnam, IDX_EXTENSION);
+	return idx_filnam;
+}
+
+/*  Time of modification of the input file, as the index records it  */
+static s64 input_mtime(char *in_filnam)
+{
+	struct stat finfo;
+
+	if (stat(in_filnam, &finfo) != 0)
+		return 0;
+	return (s64) finfo.st_mtime;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  write_index
+ *      Synopsis:       Write the index that has been made, for the
+ *                          current input file, to its sidecar file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *
+ *      Outputs:
+ *         File Written:
+ *             The index, in the layout described near the top of this file
+ *         Printout:
+ *             A remark if it could not be written.
+ *
+ **************************************************************************** */
+
+static void write_index(char *in_filnam)
+{
+	char *idx_filnam = index_name(in_filnam);
+	size_t idx_len = IDX_HEADER_LEN + block_count * IDX_BLOCK_LEN
+	    + checkpoint_count * IDX_CHECKPOINT_LEN + def_count * IDX_DEF_LEN;
+	u8 *idx;
+	u8 *ptr;
+	FILE *idx_file;
+	bool written;
+	u32 indx;
+
+	idx = calloc(1, idx_len);
+	if (!idx) {
+		out_str("Out of memory while writing index.\n");
+		exit(-ENOMEM);
+	}
+
+	memcpy(idx, IDX_MAGIC, IDX_MAGIC_LEN);
+	put_be16(idx + 8, IDX_VERSION);
+	put_be16(idx + 10, decode_all ? IDX_DECODE_ALL : 0);
+	put_be32(idx + 12, descs_fingerprint());
+	put_be64(idx + 16, stream_max);
+	put_be64(idx + 24, (s64) fcode_byte_sum(indata, stream_max));
+	put_be64(idx + 32, input_mtime(in_filnam));
+	put_be32(idx + 40, block_count);
+	put_be32(idx + 44, checkpoint_count);
+	put_be32(idx + 48, def_count);
+
+	ptr = idx + IDX_HEADER_LEN;
+	for (indx = 0; indx < block_count; indx++, ptr += IDX_BLOCK_LEN) {
+		put_be64(ptr, blocks[indx].pos);
+		put_be64(ptr + 8, blocks[indx].origin);
+		put_be64(ptr + 16, blocks[indx].end);
+		put_be32(ptr + 24, blocks[indx].defs_before);
+		put_be16(ptr + 28, blocks[indx].last_def);
+		ptr[30] = blocks[indx].flags;
+		put_be32(ptr + 32, blocks[indx].number);
+	}
+	for (indx = 0; indx < checkpoint_count;
+	     indx++, ptr += IDX_CHECKPOINT_LEN) {
+		put_be64(ptr, checkpoints[indx].pos);
+		put_be32(ptr + 8, checkpoints[indx].block);
+		put_be32(ptr + 12, checkpoints[indx].defs_before);
+		put_be16(ptr + 16, checkpoints[indx].last_def);
+		ptr[18] = checkpoints[indx].flags;
+		put_be32(ptr + 20, checkpoints[indx].number);
+	}
+	for (indx = 0; indx < def_count; indx++, ptr += IDX_DEF_LEN) {
+		put_be64(ptr, defs[indx].pos);
+		put_be64(ptr + 8, defs[indx].name_pos);
+		put_be32(ptr + 16, defs[indx].checkpoint);
+		put_be16(ptr + 20, defs[indx].token);
+		ptr[22] = defs[indx].name_len;
+		ptr[23] = defs[indx].named ? 1 : 0;
+	}
+	put_be32(idx + IDX_CHECK_OFFSET, index_check_value(idx, idx + IDX_HEADER_LEN,
+					     idx_len - IDX_HEADER_LEN));
+
+	idx_file = fopen(idx_filnam, "wb");
+	written = (idx_file != NULL);
+	if (written) {
+		written = (fwrite(idx, 1, idx_len, idx_file) == idx_len);
+		if (fclose(idx_file) != 0)
+			written = false;
+	}
+	if (!written) {
+		char *strbfr = malloc(strlen(idx_filnam) + 32);
+		sprintf(strbfr, "Could not write index:  %s", idx_filnam);
+		printremark(strbfr);
+		free(strbfr);
+	}
+
+	free(idx);
+	free(idx_filnam);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_index
+ *      Synopsis:       Read the sidecar index of the current input file,
+ *                          if it has one that is up to date.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *         Global Variables:
+ *             indata, stream_max The input file, already opened
+ *
+ *      Outputs:
+ *         Returned Value:        TRUE if the index was read
+ *         Local Static Variables:
+ *             blocks, checkpoints, defs     The index
+ *
+ *      Error Detection:
+ *          An index that is not there, or that is for another version
+ *              of the file, or of detok, is not read.  Nor is one whose
+ *              check-value is wrong, which catches a damaged index, or
+ *              one that does not hang together:  every position in it
+ *              must lie within the file, and every count and cross-
+ *              reference within the index, so that nothing it says can
+ *              take the decoder outside the input-data, however it was
+ *              made.
+ *
+ **************************************************************************** */
+
+static bool index_header_ok(u8 * header, char *in_filnam)
+{
+	if (memcmp(header, IDX_MAGIC, IDX_MAGIC_LEN) != 0)
+		return false;
+	if (get_be16(header + 8) != IDX_VERSION)
+		return false;
+	if (get_be16(header + 10) != (decode_all ? IDX_DECODE_ALL : 0))
+		return false;
+	if (get_be32(header + 12) != descs_fingerprint())
+		return false;
+	if (get_be64(header + 16) != stream_max)
+		return false;
+	if (get_be64(header + 32) != input_mtime(in_filnam))
+		return false;
+	/*  Last, as it is the only one that takes any time  */
+	return (get_be64(header + 24) ==
+		(s64) fcode_byte_sum(indata, stream_max));
+}
+
+static bool parse_index(u8 * ptr)
+{
+	u32 indx;
+
+	blocks = calloc(block_count + 1, sizeof(idx_block_t));
+	checkpoints = calloc(checkpoint_count + 1, sizeof(idx_checkpoint_t));
+	defs = calloc(def_count + 1, sizeof(idx_def_t));
+	if (!blocks || !checkpoints || !defs) {
+		out_str("Out of memory while reading index.\n");
+		exit(-ENOMEM);
+	}
+	block_max = block_count;
+	checkpoint_max = checkpoint_count;
+	def_max = def_count;
+
+	for (indx = 0; indx < block_count; indx++, ptr += IDX_BLOCK_LEN) {
+		idx_block_t *block = &blocks[indx];
+		block->pos = get_be64(ptr);
+		block->origin = get_be64(ptr + 8);
+		block->end = get_be64(ptr + 16);
+		block->defs_before = get_be32(ptr + 24);
+		block->last_def = get_be16(ptr + 28);
+		block->flags = ptr[30];
+		block->number = get_be32(ptr + 32);
+		if ((block->origin < 0) || (block->pos < block->origin)
+		    || (block->pos > stream_max) || (block->end < block->pos)
+		    || (block->defs_before > def_count)
+		    || (block->number > stream_max))
+			return false;
+	}
+	for (indx = 0; indx < checkpoint_count;
+	     indx++, ptr += IDX_CHECKPOINT_LEN) {
+		idx_checkpoint_t *cp = &checkpoints[indx];
+		cp->pos = get_be64(ptr);
+		cp->block = get_be32(ptr + 8);
+		cp->defs_before = get_be32(ptr + 12);
+		cp->last_def = get_be16(ptr + 16);
+		cp->flags = ptr[18];
+		cp->number = get_be32(ptr + 20);
+		if ((cp->block >= block_count)
+		    || (cp->pos < blocks[cp->block].pos)
+		    || (cp->pos >= stream_max)
+		    || (cp->defs_before > def_count)
+		    || (cp->number > stream_max)
+		    || ((indx > 0) && (cp->pos <= checkpoints[indx - 1].pos)))
+			return false;
+	}
+	for (indx = 0; indx < def_count; indx++, ptr += IDX_DEF_LEN) {
+		idx_def_t *def = &defs[indx];
+		def->pos = get_be64(ptr);
+		def->name_pos = get_be64(ptr + 8);
+		def->checkpoint = get_be32(ptr + 16);
+		def->token = get_be16(ptr + 20);
+		def->name_len = ptr[22];
+		def->named = (ptr[23] != 0);
+		if ((def->checkpoint >= checkpoint_count)
+		    || (checkpoints[def->checkpoint].pos != def->pos)
+		    || (checkpoints[def->checkpoint].defs_before != indx)
+		    || (def->name_pos < 0)
+		    || (def->name_pos + def->name_len > stream_max))
+			return false;
+	}
+	return true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_index
+ *      Synopsis:       Read the sidecar index of the current input file,
+ *                          if it has one that is up to date.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *         Global Variables:
+ *             indata, stream_max The input file, already opened
+ *
+ *      Outputs:
+ *         Returned Value:        TRUE if the index was read
+ *         Local Static Variables:
+ *             blocks, checkpoints, defs     The index
+ *
+ *      Error Detection:
+ *          An index that is not there, or that was made from another
+ *              version of the file, or under other options, is not used.
+ *              Nor is one that is damaged, or does not hang together.
+ *
+ **************************************************************************** */
+
+static bool read_index(char *in_filnam)
+{
+	char *idx_filnam = index_name(in_filnam);
+	FILE *idx_file;
+	u8 header[IDX_HEADER_LEN];
+	u8 *body = NULL;
+	size_t body_len = 0;
+	bool retval;
+
+	clear_index();
+	idx_file = fopen(idx_filnam, "rb");
+	free(idx_filnam);
+	if (idx_file == NULL)
+		return false;
+
+	retval = (fread(header, 1, IDX_HEADER_LEN, idx_file) == IDX_HEADER_LEN)
+	    && index_header_ok(header, in_filnam);
+	if (retval) {
+		block_count = get_be32(header + 40);
+		checkpoint_count = get_be32(header + 44);
+		def_count = get_be32(header + 48);
+		body_len = (size_t) block_count * IDX_BLOCK_LEN
+		    + (size_t) checkpoint_count * IDX_CHECKPOINT_LEN
+		    + (size_t) def_count * IDX_DEF_LEN;
+		/*  Every entry needs at least one byte of the file  */
+		retval = (block_count <= stream_max)
+		    && (checkpoint_count <= stream_max)
+		    && (def_count <= stream_max);
+	}
+	if (retval) {
+		/*  One more byte, to be sure the index ends where it should  */
+		body = malloc(body_len + 1);
+		if (!body) {
+			out_str("Out of memory while reading index.\n");
+			exit(-ENOMEM);
+		}
+		retval = (fread(body, 1, body_len + 1, idx_file) == body_len)
+		    && (get_be32(header + IDX_CHECK_OFFSET) ==
+			index_check_value(header, body, body_len))
+		    && parse_index(body);
+		free(body);
+	}
+	fclose(idx_file);
+
+	if (!retval)
+		clear_index();
+	return retval;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  build_index
+ *      Synopsis:       Detokenize the current input file, noting down
+ *                          the index as it goes, and write the index.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *             quiet              TRUE if nothing else is to be printed
+ *
+ *      Outputs:
+ *         Printout:
+ *             The listing, unless  quiet
+ *         File Written:
+ *             The index
+ *
+ *         Local Static Variables:
+ *             blocks, checkpoints, defs     The index
+ *
+ *      Process Explanation:
+ *          The dictionary is left with the names the file defined; the
+ *              caller resets it.
+ *
+ **************************************************************************** */
+
+static void build_index(char *in_filnam, bool quiet)
+{
+	void *prev_sink_data;
+	insn_sink_t prev_sink = get_insn_sink(&prev_sink_data);
+
+	clear_index();
+	next_sink = quiet ? discard_insn : prev_sink;
+	next_sink_data = quiet ? NULL : prev_sink_data;
+	set_insn_sink(index_insn, NULL);
+	init_decoder();
+	detokenize();
+	set_insn_sink(prev_sink, prev_sink_data);
+	write_index(in_filnam);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  span_insn
+ *      Synopsis:       A sink that passes records along only once the
+ *                          part of a span that is to be shown is reached.
+ *
+ *      Process Explanation:
+ *          That is at the first token, or header, at or after  span_from .
+ *              Whatever was decoded before it, remarks and all, is only
+ *              there to bring the decoder up to that point; but the
+ *              headers go into the count of blocks that the JSON output
+ *              is to carry on from.
+ *
+ **************************************************************************** */
+
+static void span_insn(const fc_insn_t * insn, void *unused)
+{
+	if (!span_showing) {
+		if ((insn->kind == INSN_HEADER) || (insn->kind == INSN_BAD_START))
+			json_block++;
+		if ((insn->kind != INSN_TOKEN) && (insn->kind != INSN_HEADER))
+			return;
+		if (get_stream_origin() + insn->offset < span_from)
+			return;
+		span_showing = true;
+		/*  Bring the JSON output's count of blocks up to here  */
+		json_set_block(insn->kind == INSN_HEADER ? json_block - 1
+			       : json_block);
+	}
+	(*next_sink) (insn, next_sink_data);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  decode_span
+ *      Synopsis:       Detokenize the part of one FCode block from one
+ *                          position to another, by way of the index.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             block_num          Index of the block
+ *             from               Where the part to be shown begins
+ *             to                 No token is started at or past here
+ *         Local Static Variables:
+ *             blocks, checkpoints, defs     The index
+ *
+ *      Outputs:
+ *         Printout:
+ *             The listing of the span
+ *
+ *      Process Explanation:
+ *          Start from the last checkpoint in the block at or before
+ *              from , with the dictionary made up of the definitions
+ *              before it; if there is none, start from the block's
+ *              header, with the dictionary as at the start of the block.
+ *          The names the dictionary is given are slices of the input
+ *              file, as they were the first time.
+ *
+ **************************************************************************** */
+
+static void decode_span(u32 block_num, s64 from, s64 to)
+{
+	idx_block_t *block = &blocks[block_num];
+	idx_checkpoint_t *cp = NULL;
+	u32 defs_before;
+	u32 low = 0;
+	u32 high = checkpoint_count;
+	u32 indx;
+
+	/*  The last checkpoint at or before  from   */
+	while (low < high) {
+		u32 mid = low + (high - low) / 2;
+		if (checkpoints[mid].pos <= from)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if ((low > 0) && (checkpoints[low - 1].block == block_num))
+		cp = &checkpoints[low - 1];
+
+	reset_dictionary();
+	defs_before = cp ? cp->defs_before : block->defs_before;
+	check_tok_seq = false;
+	for (indx = 0; indx < defs_before; indx++) {
+		if (defs[indx].named)
+			add_token(defs[indx].token,
+				  (const char *)indata + defs[indx].name_pos,
+				  defs[indx].name_len);
+		else
+			add_token(defs[indx].token, unnamed, strlen(unnamed));
+	}
+	check_tok_seq = true;
+
+	init_decoder();
+	set_stream_origin(block->origin);
+	span_from = from;
+	span_showing = false;
+	next_sink = get_insn_sink(&next_sink_data);
+	set_insn_sink(span_insn, NULL);
+
+	if (cp != NULL) {
+		last_defined_token = cp->last_def;
+		offs16 = (cp->flags & IDX_OFFS16) != 0;
+		end_found = (cp->flags & IDX_END_FOUND) != 0;
+		json_block = cp->number;
+		detokenize_span(-1, cp->pos - block->origin,
+				block->end - block->origin, to - block->origin);
+	} else {
+		last_defined_token = block->last_def;
+		offs16 = (block->flags & IDX_OFFS16) != 0;
+		json_block = (int)block->number - 1;
+		detokenize_span(block->pos - block->origin, 0,
+				block->end - block->origin, to - block->origin);
+	}
+
+	set_insn_sink(next_sink, next_sink_data);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  open_index
+ *      Synopsis:       Read the current input file's index, or if it
+ *                          has none that is up to date, make one.
+ *
+ **************************************************************************** */
+
+static bool open_index(char *in_filnam)
+{
+	if (read_index(in_filnam))
+		return true;
+
+	/*  Even if it could not be written, the one just made will do  */
+	build_index(in_filnam, true);
+	return (block_count > 0);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  index_and_detokenize
+ *      Synopsis:       Detokenize the current input file, and write its
+ *                          sidecar index.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *
+ **************************************************************************** */
+
+void index_and_detokenize(char *in_filnam)
+{
+	build_index(in_filnam, false);
+	clear_index();
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  detokenize_word
+ *      Synopsis:       Detokenize only the definitions of the given name
+ *                          in the current input file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *             word               The name; case does not matter
+ *
+ *      Outputs:
+ *         Printout:
+ *             For each definition of the name, a remark saying where it
+ *                 is and the listing from the token that defines it up
+ *                 to the next definition, or the end of its block.
+ *         Global Variables:
+ *             job_failed         Set if there is no such definition
+ *
+ *      Process Explanation:
+ *          The index is made first, if need be.
+ *
+ **************************************************************************** */
+
+void detokenize_word(char *in_filnam, char *word)
+{
+	size_t word_len = strlen(word);
+	char temp_bufr[160];
+	int found = 0;
+	u32 indx;
+
+	if (!open_index(in_filnam))
+		return;
+
+	for (indx = 0; indx < def_count; indx++) {
+		idx_def_t *def = &defs[indx];
+		u32 block_num = checkpoints[def->checkpoint].block;
+		s64 to = blocks[block_num].end;
+
+		if (!def->named || (def->name_len != word_len)
+		    || (strncasecmp((const char *)indata + def->name_pos,
+				    word, word_len) != 0))
+			continue;
+
+		if ((indx + 1 < def_count)
+		    && (checkpoints[defs[indx + 1].checkpoint].block
+			== block_num))
+			to = defs[indx + 1].pos;
+		snprintf(temp_bufr, sizeof(temp_bufr),
+			 "Definition of %.*s, token 0x%03x, at 0x%llx in "
+			 "the FCode block at 0x%llx", (int) word_len,
+			 indata + def->name_pos, def->token,
+			 (unsigned long long) def->pos,
+			 (unsigned long long) blocks[block_num].pos);
+		printremark(temp_bufr);
+		decode_span(block_num, def->pos, to);
+		found++;
+	}
+
+	if (found == 0) {
+		snprintf(temp_bufr, sizeof(temp_bufr),
+			 "%s:  no definition of %s", in_filnam, word);
+		printremark(temp_bufr);
+		job_failed = true;
+	}
+	clear_index();
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  detokenize_range
+ *      Synopsis:       Detokenize only the tokens between two positions
+ *                          in the current input file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *             from               Byte offset, from the start of the
+ *                                    file, at which to begin
+ *             to                 Byte offset at which to stop:  the
+ *                                    last token shown starts before it
+ *
+ *      Outputs:
+ *         Printout:
+ *             For each FCode block the range reaches into, a remark
+ *                 saying which, and from where in the file the offsets
+ *                 in the listing count, and the listing of its tokens
+ *                 that start
+ *                 within the range.  If the range takes in a header, the
+ *                 header too.
+ *
+ *      Process Explanation:
+ *          A position in the middle of a token is taken to mean the
+ *              token that follows it.
+ *
+ **************************************************************************** */
+
+void detokenize_range(char *in_filnam, s64 from, s64 to)
+{
+	char temp_bufr[120];
+	u32 indx;
+
+	if (!open_index(in_filnam))
+		return;
+
+	for (indx = 0; indx < block_count; indx++) {
+		idx_block_t *block = &blocks[indx];
+
+		if ((block->pos >= to) || (block->end <= from))
+			continue;
+		snprintf(temp_bufr, sizeof(temp_bufr),
+			 "FCode block at 0x%llx, offsets counted from 0x%llx:  "
+			 "from 0x%llx to 0x%llx",
+			 (unsigned long long) block->pos,
+			 (unsigned long long) block->origin,
+			 (unsigned long long) (from > block->pos ? from
+					       : block->pos),
+			 (unsigned long long) (to < block->end ? to
+					       : block->end));
+		printremark(temp_bufr);
+		decode_span(indx, from, to);
+	}
+	clear_index();
+}
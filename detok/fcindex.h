@@ -0,0 +1,38 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcindex.h - the sidecar index, for detokenizing part of an image.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+#ifndef _UTILS_DETOK_FCINDEX_H
+#define _UTILS_DETOK_FCINDEX_H
+
+#include "types.h"
+
+/*  Prototypes for functions exported from  fcindex.c     */
+
+void index_and_detokenize(char *in_filnam);
+void detokenize_word(char *in_filnam, char *word);
+void detokenize_range(char *in_filnam, s64 from, s64 to);
+
+#endif				/*  _UTILS_DETOK_FCINDEX_H    */
@@ -0,0 +1,285 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcinsn.c - hand the decoded-instruction records to whoever wants them.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      The decoder hands each record it makes to  emit_insn() , which
+ *          passes it along to the current sink.  Unless told otherwise,
+ *          that is the text listing.
+ *
+ *      Also here is the means for a program that links with the
+ *          decoder to have the records of a whole input image gathered
+ *          into a list:  decode_insns() .  The list grows by doubling,
+ *          so there is no allocation per token.  The names and remarks
+ *          the records point to are copied, one after the other, into
+ *          blocks of text that the list keeps; a block is never moved,
+ *          so the records can point to the copies right away.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "detok.h"
+#include "stream.h"
+#include "outsink.h"
+#include "listing.h"
+#include "fcinsn.h"
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     insn_sink              Where records go
+ *     insn_sink_data         Passed along with each one
+ *
+ **************************************************************************** */
+
+static insn_sink_t insn_sink = print_insn;
+static void *insn_sink_data = NULL;
+
+/* **************************************************************************
+ *
+ *      Function name:  set_insn_sink
+ *      Synopsis:       Send the records to the given routine, or back
+ *                          to the text listing if it is NULL.
+ *
+ **************************************************************************** */
+
+void set_insn_sink(insn_sink_t sink, void *sink_data)
+{
+	if (sink == NULL) {
+		sink = print_insn;
+		sink_data = NULL;
+	}
+	insn_sink = sink;
+	insn_sink_data = sink_data;
+}
+
+/*  The current sink, so that another can pass records along to it  */
+insn_sink_t get_insn_sink(void **sink_data)
+{
+	*sink_data = insn_sink_data;
+	return insn_sink;
+}
+
+void emit_insn(const fc_insn_t * insn)
+{
+	(*insn_sink) (insn, insn_sink_data);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  emit_remark
+ *      Synopsis:       Make a record of a remark, and send it along.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             text               The remark.  It may run to more than
+ *                                    one line.
+ *
+ *      Process Explanation:
+ *          The record points to the caller's text; a sink that wants to
+ *              keep it has to take a copy.
+ *
+ **************************************************************************** */
+
+void emit_remark(const char *text)
+{
+	fc_insn_t remark;
+
+	memset(&remark, 0, sizeof(remark));
+	remark.kind = INSN_REMARK;
+	remark.name = text;
+	emit_insn(&remark);
+}
+
+#define INSN_TEXT_BLOCK   0x10000
+
+/* **************************************************************************
+ *
+ *      Function name:  keep_text
+ *      Synopsis:       Keep a copy of a name or remark with a list.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             list               The list
+ *             text               The name or remark; NULL is let be
+ *             text_len           Its length
+ *
+ *      Outputs:
+ *         Returned Value:        Pointer to the copy, null-terminated
+ *         Memory Allocated
+ *             A new block of text, when the last one is full.  A text
+ *                 too long for a block gets one of its own.
+ *         When Freed?
+ *             By  free_insns()
+ *
+ **************************************************************************** */
+
+static const char *keep_text(insn_list_t * list, const char *text,
+			     size_t text_len)
+{
+	insn_text_t *block = list->text;
+	char *retval;
+
+	if (text == NULL)
+		return NULL;
+
+	if ((block == NULL) || (block->len + text_len + 1 > block->size)) {
+		size_t size = INSN_TEXT_BLOCK;
+		if (text_len + 1 > size)
+			size = text_len + 1;
+		block = malloc(sizeof(insn_text_t) + size);
+		if (!block) {
+			out_str("Out of memory while gathering instructions.\n");
+			exit(-ENOMEM);
+		}
+		block->next = list->text;
+		block->len = 0;
+		block->size = size;
+		list->text = block;
+	}
+
+	retval = &block->data[block->len];
+	memcpy(retval, text, text_len);
+	retval[text_len] = 0;
+	block->len += text_len + 1;
+	return retval;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  collect_insn
+ *      Synopsis:       A sink that adds each record to a list.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn               The record
+ *             list_data          The list, an  insn_list_t
+ *
+ *      Outputs:
+ *         Memory Allocated
+ *             The list grows as needed.
+ *         When Freed?
+ *             By  free_insns()
+ *
+ *      Process Explanation:
+ *          A name in the dictionary might be a slice of an image that
+ *              is gone by the time the list is looked at; a remark is
+ *              in the caller's buffer.  Either way, the list keeps a
+ *              copy of its own.
+ *
+ **************************************************************************** */
+
+void collect_insn(const fc_insn_t * insn, void *list_data)
+{
+	insn_list_t *list = list_data;
+	fc_insn_t *this_insn;
+
+	if (list->count == list->max) {
+		fc_insn_t *nu_insns;
+		list->max = list->max ? 2 * list->max : 1024;
+		nu_insns = realloc(list->insns, list->max * sizeof(fc_insn_t));
+		if (!nu_insns) {
+			out_str("Out of memory while gathering instructions.\n");
+			exit(-ENOMEM);
+		}
+		list->insns = nu_insns;
+	}
+	this_insn = &list->insns[list->count++];
+	*this_insn = *insn;
+
+	if (insn->kind == INSN_REMARK) {
+		this_insn->name = keep_text(list, insn->name, strlen(insn->name));
+		return;
+	}
+
+	this_insn->name = keep_text(list, insn->name, insn->name_len);
+	if ((insn->kind == INSN_TOKEN) && (insn->opnd_kind == OPND_TOKEN))
+		this_insn->opnd.token.name =
+		    keep_text(list, insn->opnd.token.name,
+			      insn->opnd.token.name_len);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  decode_insns
+ *      Synopsis:       Decode an image held in memory into a list of
+ *                          records, without printing anything.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             data               The image
+ *             len                Its length
+ *             list               Where to put the records
+ *
+ *      Outputs:
+ *         Returned Value:        Zero, or -1 if there was nothing to decode
+ *         Supplied Pointers:
+ *             *list              Filled in; release it with  free_insns()
+ *
+ *      Process Explanation:
+ *          The dictionary must have been set up -- by  init_dictionary() ,
+ *              and by  add_fcodes_from_list()  and  freeze_dictionary()
+ *              for vendor FCodes -- before this is called.  The names of
+ *              tokens the image defines are left in it until the caller
+ *              calls  reset_dictionary() .
+ *          String operands point into the caller's data, which is not
+ *              copied and must be kept as long as the list is.
+ *          This decodes the image the same way as a run of detok does;
+ *              the records are the same ones the text listing would
+ *              have been made from.
+ *
+ **************************************************************************** */
+
+int decode_insns(u8 * data, s64 len, insn_list_t * list)
+{
+	memset(list, 0, sizeof(insn_list_t));
+	if (data == NULL || len <= 0)
+		return -1;
+
+	use_stream_data(data, len);
+	set_insn_sink(collect_insn, list);
+	init_decoder();
+	detokenize();
+	set_insn_sink(NULL, NULL);
+	close_stream();
+
+	return 0;
+}
+
+void free_insns(insn_list_t * list)
+{
+	while (list->text != NULL) {
+		insn_text_t *next = list->text->next;
+		free(list->text);
+		list->text = next;
+	}
+	free(list->insns);
+	memset(list, 0, sizeof(insn_list_t));
+}
@@ -0,0 +1,175 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcinsn.h - the decoded-instruction records the decoder produces.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+#ifndef _UTILS_DETOK_FCINSN_H
+#define _UTILS_DETOK_FCINSN_H
+
+#include <stddef.h>
+#include "types.h"
+
+/* **************************************************************************
+ *
+ *      The decoder does not print anything itself.  For each token it
+ *          reads -- and for each FCode-block header, block ending, PCI
+ *          image boundary, remark and so on -- it fills in one record
+ *          and hands it to the current sink.  The text listing is one
+ *          such sink, and the default; a program that wants the
+ *          decoded instructions themselves can collect them in a list.
+ *
+ *      Names and strings are not copied as the records are made:  a
+ *          string operand points into the input-data, and so does the
+ *          resolved name of a token the image defined.  A resolved name
+ *          is given by pointer and length, and is not null-terminated.
+ *          A list of records keeps copies of the names and remarks it
+ *          holds; those copies are null-terminated.  The input-data, it
+ *          leaves to the caller.
+ *
+ **************************************************************************** */
+
+/*  What a record is about  */
+typedef enum insn_kind {
+	INSN_TOKEN,		/*  An FCode token, with its operand       */
+	INSN_HEADER,		/*  The header of an FCode block           */
+	INSN_BAD_START,		/*  Where a header should have been        */
+	INSN_BLOCK_END,		/*  End of an FCode block                  */
+	INSN_IMAGE_START,	/*  A PCI header and Data Structure        */
+	INSN_IMAGE_END,		/*  End of a PCI image, at its filler      */
+	INSN_RESTART,		/*  Offsets and line numbers start over    */
+	INSN_REMARK,		/*  Message about what was found           */
+	INSN_EOF		/*  End of the input, and how it came      */
+} insn_kind_t;
+
+/*  What operand follows an  INSN_TOKEN  in the FCode  */
+typedef enum opnd_kind {
+	OPND_NONE,
+	OPND_LITERAL,		/*  b(lit)                                 */
+	OPND_BRANCH,		/*  Branches, and  do , of , loop  etc.    */
+	OPND_STRING,		/*  b(")                                   */
+	OPND_NEW_TOKEN,		/*  new-token                              */
+	OPND_NAMED_TOKEN,	/*  named-token  and  external-token       */
+	OPND_TOKEN,		/*  b(')  and  b(to)                       */
+	OPND_QUAD		/*  Double-length literal                  */
+} opnd_kind_t;
+
+/*  Flags  */
+#define INSN_INVALID    0x01	/*  Token # past the last one defined;
+				 *      the stream was backed up a byte   */
+#define INSN_PARTIAL    0x02	/*  Input ended before operand was read   */
+#define INSN_MIDBLOCK   0x04	/*  Header found inside an FCode block    */
+#define INSN_BAD_DEST   0x08	/*  Branch destination out of bounds      */
+#define INSN_OPND_BAD   0x10	/*  Token operand was itself invalid      */
+#define INSN_ENDER      0x20	/*  Block-end:  end0 was seen             */
+#define INSN_PREMATURE  0x40	/*  EOF:  in the middle of a token        */
+#define INSN_OFFS16     0x80	/*  16-bit branch offsets in effect       */
+
+typedef struct fc_insn {
+	s64 offset;		/*  Stream position, as shown in listing  */
+	u16 fcode;		/*  The token, when there is one          */
+	u8 kind;		/*  An  insn_kind_t                       */
+	u8 opnd_kind;		/*  An  opnd_kind_t                       */
+	u8 flags;
+	const char *name;	/*  Resolved name, or remark text         */
+	u8 name_len;		/*  Length of the resolved name           */
+	union {
+		u32 literal;
+		struct {
+			s16 offs;
+			s64 dest;
+		} branch;
+		struct {
+			const u8 *ptr;	/*  Into the input-data  */
+			u8 len;
+		} string;
+		struct {
+			u16 token;	/*  Token number assigned     */
+			u8 len;		/*  Length of the name;       */
+			const u8 *ptr;	/*      named tokens only     */
+		} new_token;
+		struct {
+			u16 token;
+			u8 name_len;
+			const char *name;	/*  Its resolved name  */
+		} token;
+		u16 quad[4];
+		struct {		/*  Also  INSN_BAD_START :  len  */
+			u8 format;	/*      is the bytes remaining    */
+			u8 fields;	/*  How many were read:  3 if all  */
+			u16 checksum;	/*  As stored                      */
+			u16 calc_checksum;	/*  As calculated          */
+			u16 sun_checksum;	/*  Likewise, Sun-style    */
+			s64 len;
+		} header;
+		struct {
+			s64 consumed;	/*  Bytes detokenized        */
+			s64 len;	/*  Bytes in the block       */
+		} block_end;
+		struct {
+			s64 data_pos;	/*  From the start of data   */
+			int header_len;
+			/*  From the PCI Data Structure, if  pci_data  */
+			bool pci_data;
+			bool last_image;
+			u8 code_type;
+			u16 vendor;
+			u16 device;
+			u16 revision;
+			u32 class_code;
+			s64 image_len;	/*  In bytes, as stated      */
+		} image;
+	} opnd;
+} fc_insn_t;
+
+/*  A routine that takes each record as it is made  */
+typedef void (*insn_sink_t) (const fc_insn_t * insn, void *sink_data);
+
+/*  A block of the text kept by a list.  Blocks never move.  */
+typedef struct insn_text {
+	struct insn_text *next;
+	size_t len;
+	size_t size;
+	char data[];
+} insn_text_t;
+
+/*  The records of a whole input file, gathered by  decode_insns()   */
+typedef struct insn_list {
+	fc_insn_t *insns;
+	size_t count;
+	size_t max;
+	insn_text_t *text;	/*  Names and remarks are kept here  */
+} insn_list_t;
+
+/*  Prototypes for functions exported from  fcinsn.c     */
+
+void set_insn_sink(insn_sink_t sink, void *sink_data);
+insn_sink_t get_insn_sink(void **sink_data);
+void emit_insn(const fc_insn_t * insn);
+void emit_remark(const char *text);
+
+void collect_insn(const fc_insn_t * insn, void *list_data);
+int decode_insns(u8 * data, s64 len, insn_list_t * list);
+void free_insns(insn_list_t * list);
+
+#endif				/*  _UTILS_DETOK_FCINSN_H    */
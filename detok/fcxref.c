@@ -0,0 +1,705 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  fcxref.c - cross-reference and call graph of the definitions in
+ *                 an FCode image, gathered as it is decoded.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Support for the  --xref  and  --dot  options.
+ *
+ *      The file is decoded once, by the same decoder as the listing,
+ *          into a sink that keeps no tokens, only what they refer to.
+ *          Each definition is a node of the graph, and so is each
+ *          FCode block, standing for the code in it that is outside
+ *          of any definition:  the code that runs when the block is
+ *          loaded.
+ *
+ *      A definition starts at the token that assigns its FCode number.
+ *          If the defining word that follows is  b(:) , it runs up to
+ *          the  b(;)  that ends the colon definition; otherwise, it
+ *          ends with the defining word itself, and what follows it is
+ *          the block's again.  A token that uses a word the image has
+ *          defined -- or names one, after  b(')  or  b(to)  -- is a
+ *          reference, from the definition it is in to the one that
+ *          FCode number was last given to.  Any other token is only
+ *          counted, by its FCode number.
+ *
+ *      The references are kept as pairs, one after another, and sorted
+ *          once the file is done.  What is reached is found from there:
+ *          from each FCode block, and from each definition made with
+ *          external-token , which the system can find by its name
+ *          after the image has been loaded.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "detok.h"
+#include "stream.h"
+#include "outsink.h"
+#include "fcinsn.h"
+#include "fcxref.h"
+
+/*  Tokens that give a definition its shape  */
+#define FC_NEW_TOKEN       0x0b5
+#define FC_NAMED_TOKEN     0x0b6
+#define FC_COLON           0x0b7	/*  b(:)                          */
+#define FC_LAST_DEFINER    0x0bf	/*  b(code) ;  b(value)  and the
+					 *      rest come in between      */
+#define FC_SEMICOLON       0x0c2	/*  b(;)                          */
+#define FC_EXTERNAL_TOKEN  0x0ca
+
+#define FCODE_COUNT        0x1000
+#define NO_NODE            0xffffffff
+
+typedef struct {
+	const char *name;	/*  Into the input-data, or  unnamed       */
+	u32 pos;		/*  Where it starts in the file            */
+	u32 len;		/*  Bytes of FCode in it                   */
+	u32 block;		/*  Number of the FCode block it is in     */
+	u32 uses;		/*  References to it                       */
+	u16 fcode;		/*  The number assigned to it              */
+	u8 name_len;
+	u8 header;		/*  The token that assigned its number;
+				 *      zero for an FCode block           */
+	u8 kind;		/*  Its defining word, once it is seen     */
+	bool reached;
+} xref_node_t;
+
+typedef struct {
+	u32 from;
+	u32 to;
+	u32 count;		/*  Once they are sorted and merged        */
+} xref_edge_t;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     nodes                   The definitions and FCode blocks so far
+ *     edges                   The references so far
+ *     ref_count               How many there were, before they were
+ *                                 merged
+ *     defined_as              Node each FCode number was last given to,
+ *                                 or  NO_NODE
+ *     open_node               The definition the tokens now belong to,
+ *                                 or  NO_NODE  if they are the block's
+ *     block_node              The FCode block they are in
+ *     token_uses              How many times each other token is used
+ *     token_names             Its name, as the dictionary has it
+ *
+ **************************************************************************** */
+
+static xref_node_t *nodes = NULL;
+static u32 node_count = 0;
+static u32 node_max = 0;
+static xref_edge_t *edges = NULL;
+static size_t edge_count = 0;
+static size_t edge_max = 0;
+static size_t ref_count = 0;
+static u32 block_count = 0;
+
+static u32 defined_as[FCODE_COUNT];
+static u32 open_node;
+static u32 block_node;
+static u32 token_uses[FCODE_COUNT];
+static const char *token_names[FCODE_COUNT];
+static u8 token_name_lens[FCODE_COUNT];
+
+/*  Out of memory:  there is no going on  */
+static void out_of_memory(void)
+{
+	out_str("Out of memory while cross-referencing.\n");
+	exit(-ENOMEM);
+}
+
+static void *xref_realloc(void *ptr, size_t size)
+{
+	void *nu_ptr = realloc(ptr, size);
+	if (!nu_ptr)
+		out_of_memory();
+	return nu_ptr;
+}
+
+static u32 add_node(u8 header, s64 pos)
+{
+	xref_node_t *node;
+
+	if (node_count == node_max) {
+		node_max = node_max ? 2 * node_max : 256;
+		nodes = xref_realloc(nodes, node_max * sizeof(xref_node_t));
+	}
+	node = &nodes[node_count];
+	memset(node, 0, sizeof(xref_node_t));
+	node->header = header;
+	node->block = block_count;
+	node->pos = (u32) pos;
+	return node_count++;
+}
+
+static void add_edge(u32 from, u32 to)
+{
+	if (edge_count == edge_max) {
+		edge_max = edge_max ? 2 * edge_max : 0x1000;
+		edges = xref_realloc(edges, edge_max * sizeof(xref_edge_t));
+	}
+	edges[edge_count].from = from;
+	edges[edge_count].to = to;
+	edges[edge_count].count = 1;
+	edge_count++;
+}
+
+/*  The definition open, if any, ends here  */
+static void close_node(s64 end_pos)
+{
+	if (open_node != NO_NODE) {
+		nodes[open_node].len = (u32) (end_pos - nodes[open_node].pos);
+		open_node = NO_NODE;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  use_token
+ *      Synopsis:       Count a use of a token by the definition or FCode
+ *                          block it appears in.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             from               The node it appears in
+ *             fcode              Its FCode number
+ *             name               Its name, and
+ *             name_len               the length of it, for the count
+ *
+ **************************************************************************** */
+
+static void use_token(u32 from, u16 fcode, const char *name, u8 name_len)
+{
+	fcode &= FCODE_COUNT - 1;
+	if (defined_as[fcode] != NO_NODE) {
+		add_edge(from, defined_as[fcode]);
+		return;
+	}
+	if (token_uses[fcode]++ == 0) {
+		token_names[fcode] = name;
+		token_name_lens[fcode] = name_len;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  xref_insn
+ *      Synopsis:       A sink that follows the definitions and the
+ *                          references in them.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn               The record
+ *             sink_data          Not used
+ *
+ *      Process Explanation:
+ *          A header found within a block does not start a new one, any
+ *              more than it does for the decoder.
+ *          An invalid token refers to nothing, and is not counted; nor
+ *              is the operand of one whose input ran out.  A number is
+ *              given to a definition whenever the decoder gives it to
+ *              one, so that the references go where the listing would
+ *              show them going.
+ *
+ **************************************************************************** */
+
+static void xref_insn(const fc_insn_t * insn, void *sink_data)
+{
+	s64 pos = get_stream_origin() + insn->offset;
+	u32 from;
+
+	switch (insn->kind) {
+	case INSN_HEADER:
+		if (insn->flags & INSN_MIDBLOCK)
+			break;
+		/*  Fall through  */
+	case INSN_BAD_START:
+		close_node(pos);
+		block_count++;
+		block_node = add_node(0, pos);
+		break;
+	case INSN_BLOCK_END:
+		close_node(pos);
+		if (block_node != NO_NODE)
+			nodes[block_node].len =
+			    (u32) (pos - nodes[block_node].pos);
+		break;
+	case INSN_EOF:
+		close_node(pos);
+		break;
+	case INSN_TOKEN:
+		if (insn->flags & INSN_INVALID)
+			break;
+		if (block_node == NO_NODE) {
+			block_count++;
+			block_node = add_node(0, pos);
+		}
+
+		if ((insn->opnd_kind == OPND_NEW_TOKEN)
+		    || (insn->opnd_kind == OPND_NAMED_TOKEN)) {
+			u16 fcode = insn->opnd.new_token.token;
+			xref_node_t *node;
+
+			close_node(pos);
+			open_node = add_node((u8) insn->fcode, pos);
+			node = &nodes[open_node];
+			node->fcode = fcode;
+			if (insn->opnd_kind == OPND_NAMED_TOKEN) {
+				node->name = (const char *)
+				    insn->opnd.new_token.ptr;
+				node->name_len = strnlen(node->name,
+							 insn->opnd.
+							 new_token.len);
+			} else {
+				node->name = unnamed;
+				node->name_len = strlen(unnamed);
+			}
+			defined_as[fcode & (FCODE_COUNT - 1)] = open_node;
+		}
+
+		from = (open_node != NO_NODE) ? open_node : block_node;
+		use_token(from, insn->fcode, insn->name, insn->name_len);
+		if ((insn->opnd_kind == OPND_TOKEN)
+		    && !(insn->flags & (INSN_PARTIAL | INSN_OPND_BAD))) {
+			u16 fcode = insn->opnd.token.token & (FCODE_COUNT - 1);
+			if (defined_as[fcode] != NO_NODE)
+				add_edge(from, defined_as[fcode]);
+		}
+
+		if (open_node == NO_NODE)
+			break;
+		if (nodes[open_node].kind == 0) {
+			if ((insn->fcode >= FC_COLON)
+			    && (insn->fcode <= FC_LAST_DEFINER)) {
+				nodes[open_node].kind = (u8) insn->fcode;
+				if (insn->fcode != FC_COLON)
+					close_node(pos + 1);
+			}
+		} else if (insn->fcode == FC_SEMICOLON) {
+			close_node(pos + 1);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  merge_edges
+ *      Synopsis:       Sort the references, and merge those from the
+ *                          same node to the same node into one.
+ *
+ *      Outputs:
+ *         Returned Value:        Where the references from each node
+ *                                    begin among them;  one more entry
+ *                                    than there are nodes
+ *         Memory Allocated
+ *             For the list returned
+ *         When Freed?
+ *             By the caller
+ *
+ **************************************************************************** */
+
+static int compare_edges(const void *left, const void *right)
+{
+	const xref_edge_t *l_edge = left;
+	const xref_edge_t *r_edge = right;
+
+	if (l_edge->from != r_edge->from)
+		return l_edge->from < r_edge->from ? -1 : 1;
+	if (l_edge->to != r_edge->to)
+		return l_edge->to < r_edge->to ? -1 : 1;
+	return 0;
+}
+
+static size_t *merge_edges(void)
+{
+	size_t *starts;
+	size_t indx;
+	size_t kept = 0;
+	u32 node;
+
+	ref_count = edge_count;
+	if (edge_count > 0)
+		qsort(edges, edge_count, sizeof(xref_edge_t), compare_edges);
+	for (indx = 0; indx < edge_count; indx++) {
+		if ((kept > 0) && (edges[kept - 1].from == edges[indx].from)
+		    && (edges[kept - 1].to == edges[indx].to)) {
+			edges[kept - 1].count++;
+		} else {
+			edges[kept++] = edges[indx];
+		}
+		nodes[edges[indx].to].uses++;
+	}
+	edge_count = kept;
+
+	starts = xref_realloc(NULL, (node_count + 1) * sizeof(size_t));
+	indx = 0;
+	for (node = 0; node <= node_count; node++) {
+		while ((indx < edge_count) && (edges[indx].from < node))
+			indx++;
+		starts[node] = indx;
+	}
+	return starts;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  mark_reached
+ *      Synopsis:       Mark each node that can be reached from an FCode
+ *                          block, or from an external definition.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             starts             From  merge_edges()
+ *
+ **************************************************************************** */
+
+static void mark_reached(const size_t * starts)
+{
+	u32 *queue;
+	u32 head = 0;
+	u32 tail = 0;
+	u32 node;
+
+	queue = xref_realloc(NULL, (node_count + 1) * sizeof(u32));
+	for (node = 0; node < node_count; node++) {
+		if ((nodes[node].header == 0)
+		    || (nodes[node].header == (u8) FC_EXTERNAL_TOKEN)) {
+			nodes[node].reached = true;
+			queue[tail++] = node;
+		}
+	}
+	while (head < tail) {
+		size_t indx;
+
+		node = queue[head++];
+		for (indx = starts[node]; indx < starts[node + 1]; indx++) {
+			u32 to = edges[indx].to;
+			if (!nodes[to].reached) {
+				nodes[to].reached = true;
+				queue[tail++] = to;
+			}
+		}
+	}
+	free(queue);
+}
+
+static const char *header_name(u8 header)
+{
+	switch (header) {
+	case 0:
+		return "-";
+	case (u8) FC_NEW_TOKEN:
+		return "headerless";
+	case (u8) FC_NAMED_TOKEN:
+		return "named";
+	default:
+		return "external";
+	}
+}
+
+/*  The defining word, without the  b( )  around it  */
+static const char *kind_name(u8 kind)
+{
+	static const char *const kinds[] = {
+		":", "value", "variable", "constant",
+		"create", "defer", "buffer:", "field", "code"
+	};
+
+	if (kind == 0)
+		return "-";
+	return kinds[kind - (u8) FC_COLON];
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  print_list
+ *      Synopsis:       Print the cross-reference as tables:  the nodes,
+ *                          the references from each, the other tokens
+ *                          used, and the definitions not reached.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *             starts             From  merge_edges()
+ *
+ *      Process Explanation:
+ *          Every line that is not a remark starts with a number, and
+ *              the references from a node are on one line, so the
+ *              output can be read back in without much trouble.
+ *
+ **************************************************************************** */
+
+/*  On one line:  a control character is written as  \xNN   */
+static void out_list_name(const char *name, size_t len)
+{
+	size_t indx;
+
+	for (indx = 0; indx < len; indx++) {
+		u8 c = (u8) name[indx];
+
+		if ((c < ' ') || (c == 0x7f))
+			out_printf("\\x%02x", c);
+		else
+			out_char(c);
+	}
+	out_char('\n');
+}
+
+static int compare_uses(const void *left, const void *right)
+{
+	u16 l_fcode = *(const u16 *)left;
+	u16 r_fcode = *(const u16 *)right;
+
+	if (token_uses[l_fcode] != token_uses[r_fcode])
+		return token_uses[l_fcode] > token_uses[r_fcode] ? -1 : 1;
+	return l_fcode < r_fcode ? -1 : (l_fcode > r_fcode);
+}
+
+static void print_list(char *in_filnam, const size_t * starts)
+{
+	u16 used[FCODE_COUNT];
+	u32 used_count = 0;
+	u32 not_reached = 0;
+	s64 unused_bytes = 0;
+	u32 node;
+	size_t indx;
+
+	out_printf("\\  Cross-reference of %s\n\\\n", in_filnam);
+	out_str("\\    Node  FCode  Header      Kind      "
+		"Offset     Bytes   Uses  Name\n");
+	for (node = 0; node < node_count; node++) {
+		xref_node_t *this = &nodes[node];
+
+		if (this->header == 0) {
+			out_printf("%8u  %5s  %-10s  %-8s  0x%06x  %6u  "
+				   "%5s  (FCode block %u)\n", node, "-", "-",
+				   "-", this->pos, this->len, "-", this->block);
+			continue;
+		}
+		out_printf("%8u  0x%03x  %-10s  %-8s  0x%06x  %6u  %5u  ",
+			   node, this->fcode, header_name(this->header),
+			   kind_name(this->kind), this->pos, this->len,
+			   this->uses);
+		out_list_name(this->name, this->name_len);
+	}
+
+	out_str("\\\n\\  References from each node to those it uses;  "
+		"*N  if more than once\n");
+	for (node = 0; node < node_count; node++) {
+		if (starts[node] == starts[node + 1])
+			continue;
+		out_printf("%8u:", node);
+		for (indx = starts[node]; indx < starts[node + 1]; indx++) {
+			if (edges[indx].count > 1)
+				out_printf(" %u*%u", edges[indx].to,
+					   edges[indx].count);
+			else
+				out_printf(" %u", edges[indx].to);
+		}
+		out_char('\n');
+	}
+
+	for (indx = 0; indx < FCODE_COUNT; indx++) {
+		if (token_uses[indx] > 0)
+			used[used_count++] = (u16) indx;
+	}
+	qsort(used, used_count, sizeof(u16), compare_uses);
+	out_str("\\\n\\  Other tokens used, most first\n");
+	for (indx = 0; indx < used_count; indx++) {
+		out_printf("%8u  0x%03x  ", token_uses[used[indx]],
+			   used[indx]);
+		out_list_name(token_names[used[indx]],
+			      token_name_lens[used[indx]]);
+	}
+
+	out_str("\\\n\\  Definitions not reached from any FCode block "
+		"or external definition\n");
+	for (node = 0; node < node_count; node++) {
+		xref_node_t *this = &nodes[node];
+
+		if (this->reached)
+			continue;
+		not_reached++;
+		unused_bytes += this->len;
+		out_printf("%8u  0x%03x  %6u  ", node, this->fcode,
+			   this->len);
+		out_list_name(this->name, this->name_len);
+	}
+
+	out_printf("\\\n\\  %u definitions in %u FCode block%s, "
+		   "%lu references;  %u not reached, of %lld bytes.\n",
+		   node_count - block_count, block_count,
+		   (block_count == 1) ? "" : "s",
+		   (unsigned long)ref_count, not_reached,
+		   (long long)unused_bytes);
+}
+
+/*  Within the double-quotes of a name in the graph  */
+static void out_dot_string(const char *str, size_t len)
+{
+	size_t indx;
+
+	for (indx = 0; indx < len; indx++) {
+		u8 c = (u8) str[indx];
+
+		if ((c == '"') || (c == '\\'))
+			out_printf("\\%c", c);
+		else if ((c < ' ') || (c > '~'))
+			out_printf("\\\\x%02x", c);
+		else
+			out_char(c);
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  print_dot
+ *      Synopsis:       Print the call graph in the language of
+ *                          Graphviz'  dot  program.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file
+ *             starts             From  merge_edges()
+ *
+ *      Process Explanation:
+ *          FCode blocks are boxes; definitions without a name are
+ *              labeled with their FCode numbers; those not reached are
+ *              drawn dashed.  A reference made more than once is
+ *              labeled with how many times.
+ *
+ **************************************************************************** */
+
+static void print_dot(char *in_filnam, const size_t * starts)
+{
+	u32 node;
+	size_t indx;
+
+	out_str("digraph \"");
+	out_dot_string(in_filnam, strlen(in_filnam));
+	out_str("\" {\n");
+	for (node = 0; node < node_count; node++) {
+		xref_node_t *this = &nodes[node];
+
+		out_printf("\tn%u [label=\"", node);
+		if (this->header == 0)
+			out_printf("FCode block %u\", shape=box", this->block);
+		else if (this->header == (u8) FC_NEW_TOKEN)
+			out_printf("0x%03x\"", this->fcode);
+		else {
+			out_dot_string(this->name, this->name_len);
+			out_char('"');
+		}
+		if (!this->reached)
+			out_str(", style=dashed");
+		out_str("];\n");
+	}
+	for (node = 0; node < node_count; node++) {
+		for (indx = starts[node]; indx < starts[node + 1]; indx++) {
+			out_printf("\tn%u -> n%u", node, edges[indx].to);
+			if (edges[indx].count > 1)
+				out_printf(" [label=\"%u\"]", edges[indx].count);
+			out_str(";\n");
+		}
+	}
+	out_str("}\n");
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  xref_stream
+ *      Synopsis:       Decode the input stream, and print the cross-
+ *                          reference of what is defined in it.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             in_filnam          Name of the input file, for the title
+ *             format             XREF_LIST  or  XREF_DOT
+ *
+ *      Outputs:
+ *         Printout:
+ *             The cross-reference, in place of the listing
+ *
+ *      Process Explanation:
+ *          The stream has been opened by the caller, who will also
+ *              reset the dictionary and close the stream afterwards.
+ *          All that is kept is let go of before returning, since the
+ *              next file, if any, starts over.
+ *
+ **************************************************************************** */
+
+void xref_stream(char *in_filnam, int format)
+{
+	insn_sink_t prev_sink;
+	void *prev_sink_data;
+	size_t *starts;
+	u32 indx;
+
+	/*  The positions are kept in 32 bits  */
+	if (stream_max > 0xffffffffLL) {
+		out_printf("File \"%s\" is too large to cross-reference.\n",
+			   in_filnam);
+		return;
+	}
+
+	for (indx = 0; indx < FCODE_COUNT; indx++)
+		defined_as[indx] = NO_NODE;
+	memset(token_uses, 0, sizeof(token_uses));
+	open_node = NO_NODE;
+	block_node = NO_NODE;
+	block_count = 0;
+
+	prev_sink = get_insn_sink(&prev_sink_data);
+	set_insn_sink(xref_insn, NULL);
+	init_decoder();
+	detokenize();
+	set_insn_sink(prev_sink, prev_sink_data);
+	close_node(stream_max);
+
+	starts = merge_edges();
+	mark_reached(starts);
+	if (format == XREF_DOT)
+		print_dot(in_filnam, starts);
+	else
+		print_list(in_filnam, starts);
+
+	free(starts);
+	free(nodes);
+	free(edges);
+	nodes = NULL;
+	edges = NULL;
+	node_count = node_max = 0;
+	edge_count = edge_max = 0;
+}
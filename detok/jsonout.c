@@ -0,0 +1,469 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  jsonout.c - print the decoded instructions as JSON, a record to a line.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      The sink for the  --json  option:  each record from the decoder
+ *          is printed as a JSON object on a line of its own (the form
+ *          known as NDJSON, or JSON Lines), for a program to read.
+ *          Every line stands by itself; nothing is held back until the
+ *          end, so the output of a large image streams out in as little
+ *          memory as the listing does.
+ *
+ *      Everything goes through the buffered writer in  outsink.c .  The
+ *          numbers are decimal, as JSON has it; names, strings and
+ *          remarks are escaped, and a byte that is not printable ASCII
+ *          is written as  \u00XX , so the output is always valid UTF-8.
+ *
+ *      The depth of nesting of each token is tracked here by the same
+ *          rules the listing uses for its indentation; the FCode blocks
+ *          of a file are numbered from zero.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcihdr.h"
+
+#include "detok.h"
+#include "outsink.h"
+#include "fcinsn.h"
+#include "jsonout.h"
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     depth                  Nesting depth of the next token
+ *     block_id               Number of the current FCode block, or -1
+ *                                 before the first one
+ *
+ **************************************************************************** */
+
+static int depth;
+static int block_id = -1;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* **************************************************************************
+ *
+ *      Function name:  out_json_string
+ *      Synopsis:       Print a string, quoted and escaped for JSON.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             str               The string; it need not be null-terminated
+ *             len               Its length
+ *
+ *      Process Explanation:
+ *          Runs of characters that need no escape are handed to the
+ *              writer in one piece.
+ *
+ **************************************************************************** */
+
+static void out_json_string(const char *str, size_t len)
+{
+	size_t run_start = 0;
+	size_t indx;
+
+	out_char('"');
+	for (indx = 0; indx < len; indx++) {
+		u8 c = (u8) str[indx];
+		char esc[6] = "\\u00";
+
+		if ((c >= ' ') && (c < 0x7f) && (c != '"') && (c != '\\'))
+			continue;
+
+		out_chars(&str[run_start], indx - run_start);
+		run_start = indx + 1;
+		switch (c) {
+		case '"':
+			out_str("\\\"");
+			break;
+		case '\\':
+			out_str("\\\\");
+			break;
+		case '\n':
+			out_str("\\n");
+			break;
+		case '\t':
+			out_str("\\t");
+			break;
+		default:
+			esc[4] = hex_digits[c >> 4];
+			esc[5] = hex_digits[c & 0xf];
+			out_chars(esc, 6);
+			break;
+		}
+	}
+	out_chars(&str[run_start], len - run_start);
+	out_char('"');
+}
+
+/*  Start a record, or add a field to one  */
+static void begin_record(const char *type)
+{
+	out_str("{\"type\":\"");
+	out_str(type);
+	out_char('"');
+}
+
+static void out_key(const char *key)
+{
+	out_str(",\"");
+	out_str(key);
+	out_str("\":");
+}
+
+static void out_num_field(const char *key, s64 val)
+{
+	out_key(key);
+	out_dec(val);
+}
+
+static void out_bool_field(const char *key, bool val)
+{
+	out_key(key);
+	out_str(val ? "true" : "false");
+}
+
+static void out_string_field(const char *key, const char *str, size_t len)
+{
+	out_key(key);
+	out_json_string(str, len);
+}
+
+static void end_record(void)
+{
+	out_str("}\n");
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_operand
+ *      Synopsis:       Print the operand of a token, as an object.
+ *
+ **************************************************************************** */
+
+static void json_operand(const fc_insn_t * insn)
+{
+	out_key("operand");
+	switch (insn->opnd_kind) {
+	case OPND_LITERAL:
+		out_str("{\"kind\":\"literal\"");
+		out_num_field("value", insn->opnd.literal);
+		break;
+	case OPND_BRANCH:
+		out_str("{\"kind\":\"branch\"");
+		out_num_field("offset", insn->opnd.branch.offs);
+		out_num_field("dest", insn->opnd.branch.dest);
+		if (insn->flags & INSN_BAD_DEST)
+			out_bool_field("bad_dest", true);
+		break;
+	case OPND_STRING:
+		out_str("{\"kind\":\"string\"");
+		out_string_field("value", (const char *)insn->opnd.string.ptr,
+				 insn->opnd.string.len);
+		break;
+	case OPND_NEW_TOKEN:
+		out_str("{\"kind\":\"new_token\"");
+		out_num_field("token", insn->opnd.new_token.token);
+		break;
+	case OPND_NAMED_TOKEN:
+		out_str("{\"kind\":\"named_token\"");
+		out_num_field("token", insn->opnd.new_token.token);
+		/*  An embedded null ends the name, as in the listing  */
+		out_string_field("name", (const char *)insn->opnd.new_token.ptr,
+				 strnlen((const char *)insn->opnd.new_token.ptr,
+					 insn->opnd.new_token.len));
+		break;
+	case OPND_TOKEN:
+		out_str("{\"kind\":\"token\"");
+		out_num_field("token", insn->opnd.token.token);
+		if (insn->flags & INSN_OPND_BAD)
+			out_bool_field("invalid", true);
+		else
+			out_string_field("name", insn->opnd.token.name,
+					 insn->opnd.token.name_len);
+		break;
+	case OPND_QUAD:
+		out_str("{\"kind\":\"quad\",\"value\":[");
+		out_dec(insn->opnd.quad[0]);
+		out_char(',');
+		out_dec(insn->opnd.quad[1]);
+		out_char(',');
+		out_dec(insn->opnd.quad[2]);
+		out_char(',');
+		out_dec(insn->opnd.quad[3]);
+		out_char(']');
+		break;
+	default:
+		out_str("{\"kind\":\"none\"");
+		break;
+	}
+	out_char('}');
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_token
+ *      Synopsis:       Print the record for a token, and keep track of
+ *                          the depth of nesting.
+ *
+ *      Process Explanation:
+ *          A token whose operand could not be read is marked  partial
+ *              and has no operand.  An invalid token # has no name.
+ *
+ **************************************************************************** */
+
+static void json_token(const fc_insn_t * insn)
+{
+	u8 desc_flags = token_descs[insn->fcode].flags;
+
+	if (desc_flags & DESC_OUTDENT)
+		depth--;
+	if (depth < 0)
+		depth = 0;
+
+	begin_record("token");
+	out_num_field("offset", insn->offset);
+	out_num_field("block", block_id);
+	out_num_field("depth", depth);
+	out_num_field("fcode", insn->fcode);
+	if (insn->flags & INSN_INVALID) {
+		out_bool_field("invalid", true);
+		end_record();
+		return;
+	}
+	out_string_field("name", insn->name, insn->name_len);
+	if (insn->flags & INSN_PARTIAL)
+		out_bool_field("partial", true);
+	else if (insn->opnd_kind != OPND_NONE)
+		json_operand(insn);
+	end_record();
+
+	if (desc_flags & DESC_INDENT)
+		depth++;
+	if (desc_flags & DESC_BR_INDENT) {
+		if (insn->opnd.branch.offs >= 0)
+			depth++;
+		else
+			depth--;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_header
+ *      Synopsis:       Print the record for an FCode-block header, with
+ *                          the result of checking its checksum.
+ *
+ *      Process Explanation:
+ *          Only the fields the decoder could read are shown; if the
+ *              input ended partway through the header, it is marked
+ *              partial .
+ *
+ **************************************************************************** */
+
+static void json_header(const fc_insn_t * insn)
+{
+	const u16 stored = insn->opnd.header.checksum;
+
+	block_id++;
+	if (!(insn->flags & INSN_MIDBLOCK))
+		depth = 0;
+
+	begin_record("header");
+	out_num_field("offset", insn->offset);
+	out_num_field("block", block_id);
+	out_num_field("fcode", insn->fcode);
+	out_string_field("name", insn->name, insn->name_len);
+	out_num_field("offset_bits", (insn->flags & INSN_OFFS16) ? 16 : 8);
+	if (insn->flags & INSN_MIDBLOCK)
+		out_bool_field("midblock", true);
+	if (insn->opnd.header.fields >= 1)
+		out_num_field("format", insn->opnd.header.format);
+	if (insn->opnd.header.fields >= 2) {
+		out_num_field("checksum", stored);
+		out_num_field("calc_checksum", insn->opnd.header.calc_checksum);
+		out_bool_field("checksum_ok",
+			       (stored == insn->opnd.header.calc_checksum)
+			       || (stored == insn->opnd.header.sun_checksum));
+		if ((stored != insn->opnd.header.calc_checksum)
+		    && (stored == insn->opnd.header.sun_checksum))
+			out_bool_field("sun_style", true);
+	}
+	if (insn->opnd.header.fields >= 3)
+		out_num_field("length", insn->opnd.header.len);
+	else
+		out_bool_field("partial", true);
+	end_record();
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_image_start
+ *      Synopsis:       Print the record for the PCI header and Data
+ *                          Structure at the start of an image.
+ *
+ **************************************************************************** */
+
+static void json_image_start(const fc_insn_t * insn)
+{
+	begin_record("pci_image");
+	out_num_field("offset", insn->opnd.image.data_pos);
+	out_num_field("header_len", insn->opnd.image.header_len);
+	if (insn->opnd.image.pci_data) {
+		const char *name;
+
+		out_num_field("vendor", insn->opnd.image.vendor);
+		out_num_field("device", insn->opnd.image.device);
+		out_num_field("class_code", insn->opnd.image.class_code);
+		name = pci_device_class_name(insn->opnd.image.class_code);
+		out_string_field("class_name", name, strlen(name));
+		out_num_field("revision", insn->opnd.image.revision);
+		out_num_field("code_type", insn->opnd.image.code_type);
+		name = pci_code_type_name(insn->opnd.image.code_type);
+		out_string_field("code_type_name", name, strlen(name));
+		out_num_field("image_len", insn->opnd.image.image_len);
+		out_bool_field("last_image", insn->opnd.image.last_image);
+	}
+	end_record();
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_insn
+ *      Synopsis:       Print one record from the decoder as a line of JSON.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn                The record
+ *             unused              The sink's data; none needed here
+ *
+ *      Process Explanation:
+ *          Line numbers are a matter of the listing; the record that
+ *              starts them over is let go by.  A remark loses the new-
+ *              lines at its end.
+ *
+ **************************************************************************** */
+
+void json_insn(const fc_insn_t * insn, void *unused)
+{
+	size_t len;
+
+	switch (insn->kind) {
+	case INSN_TOKEN:
+		json_token(insn);
+		break;
+	case INSN_HEADER:
+		json_header(insn);
+		break;
+	case INSN_BAD_START:
+		block_id++;
+		depth = 0;
+		begin_record("bad_start");
+		out_num_field("offset", insn->offset);
+		out_num_field("block", block_id);
+		out_num_field("remaining", insn->opnd.header.len);
+		end_record();
+		break;
+	case INSN_BLOCK_END:
+		begin_record("block_end");
+		out_num_field("offset", insn->offset);
+		out_num_field("block", block_id);
+		out_bool_field("ender", (insn->flags & INSN_ENDER) != 0);
+		out_num_field("consumed", insn->opnd.block_end.consumed);
+		out_num_field("length", insn->opnd.block_end.len);
+		end_record();
+		break;
+	case INSN_IMAGE_START:
+		json_image_start(insn);
+		break;
+	case INSN_IMAGE_END:
+		begin_record("pci_image_end");
+		out_num_field("offset", insn->opnd.image.data_pos);
+		end_record();
+		break;
+	case INSN_REMARK:
+		len = strlen(insn->name);
+		while ((len > 0) && (insn->name[len - 1] == '\n'))
+			len--;
+		begin_record("remark");
+		out_string_field("text", insn->name, len);
+		end_record();
+		break;
+	case INSN_EOF:
+		begin_record("eof");
+		out_num_field("offset", insn->offset);
+		out_bool_field("ender", (insn->flags & INSN_ENDER) != 0);
+		out_bool_field("premature", (insn->flags & INSN_PREMATURE) != 0);
+		end_record();
+		break;
+	case INSN_RESTART:
+	default:
+		break;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_set_block
+ *      Synopsis:       Take up the count of FCode blocks partway through
+ *                          a file, for output that does not start at
+ *                          its beginning.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             id                 Number of the block the next token is
+ *                                    in; one less, if the next record
+ *                                    is to be the header of a block.
+ *
+ **************************************************************************** */
+
+void json_set_block(int id)
+{
+	block_id = id;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  json_begin_file
+ *      Synopsis:       Print the record that starts the output for an
+ *                          input file, and start the count of its
+ *                          FCode blocks over.
+ *
+ **************************************************************************** */
+
+void json_begin_file(const char *name)
+{
+	depth = 0;
+	block_id = -1;
+	begin_record("file");
+	out_string_field("name", name, strlen(name));
+	end_record();
+}
@@ -0,0 +1,570 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  listing.c - print the decoded instructions as a text listing.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *         Modifications made in 2005 by IBM Corporation
+ *      (C) Copyright 2005 IBM Corporation.  All Rights Reserved.
+ *      Modifications Author:  David L. Paktor    dlpaktor@us.ibm.com
+ **************************************************************************** */
+
+/* **************************************************************************
+ *
+ *      This is the sink to which the decoder sends its records unless
+ *          told otherwise:  the listing that detok prints.  What it
+ *          prints is what the decoder used to print as it went along;
+ *          the line numbers and the indentation, which are of no
+ *          concern to the decoder, are kept track of here.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "detok.h"
+#include "outsink.h"
+#include "fcinsn.h"
+#include "listing.h"
+
+/* **************************************************************************
+ *
+ *          Global Variables Exported
+ *     verbose                Print FCode numbers of named tokens too
+ *     show_linenumbers       Start each line with a line number...
+ *     show_offsets           ... or rather, with its byte offset
+ *
+ **************************************************************************** */
+
+bool verbose = false;
+bool show_linenumbers = false;
+bool show_offsets = false;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     indent                 Current level of indentation
+ *     linenum                Number of the next line, when shown
+ *
+ **************************************************************************** */
+
+static int indent;
+static unsigned int linenum;
+
+/* **************************************************************************
+ *
+ *      Still to be done:
+ *          Handling of indent-level is not correct.  Branches should
+ *              balance with their resolvers; constructs like do..loop
+ *              case/of/endof/endcase are a few major examples.
+ *          This will be tricky; the rules need to be carefully thought
+ *              out, and the implementation might be more complex than
+ *              at first meets the eye...
+ *
+ **************************************************************************** */
+
+static void decode_indent(void)
+{
+	if (indent < 0) {
+#ifdef DEBUG_INDENT
+		out_str("detok: error in indentation code.\n");
+#endif
+		indent = 0;
+	}
+	out_indent(indent);
+}
+
+static void decode_lines(s64 streampos)
+{
+	if (show_linenumbers) {
+		out_dec_padded(show_offsets ? streampos : linenum++, 6);
+		out_str(": ");
+	}
+}
+
+/*  Print forth string ( [len] char[0] ... char[len] ) */
+static void pretty_print_string(const u8 * strptr, u8 len)
+{
+	int indx;
+	bool in_parens = false;	/*  Are we already inside parentheses?  */
+
+	out_str(len >= 10 ? "( len=0x" : "( len=");
+	out_hex(len, 0);
+	if (len >= 10) {
+		out_str(" [");
+		out_dec(len);
+		out_str(" bytes]");
+	}
+	out_str(" )\n");
+	if (show_linenumbers)
+		out_str("        ");
+	decode_indent();
+	out_str("\" ");
+
+	for (indx = 0; indx < len; indx++) {
+		u8 c = *strptr++;
+		if (isprint(c)) {
+			if (in_parens) {
+				out_str(" )");
+				in_parens = false;
+			}
+			out_char(c);
+			/*  Quote-mark must escape itself  */
+			if (c == '"')
+				out_char(c);
+		} else {
+			if (!in_parens) {
+				out_str("\"(");
+				in_parens = true;
+			}
+			out_char(' ');
+			out_hex(c, 2);
+		}
+	}
+	if (in_parens)
+		out_str(" )");
+	out_char('"');
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_token_name
+ *      Synopsis:       Print the name of a token along with any
+ *                          interesting related information...
+ *
+ *      Inputs:
+ *         Parameters:
+ *             token                  The token #
+ *             tname                  Its name, as resolved by the decoder
+ *             tname_len              The length of the name
+ *             is_invalid             TRUE if the decoder found the token #
+ *                                        to be larger than the last one
+ *                                        defined
+ *         Global/Static Constants:
+ *             unnamed                Namefield of headerless token
+ *
+ *      Outputs:
+ *         Printout:
+ *             Print the function name (if known) and the FCode number,
+ *                  if interesting.
+ *             The fcode number is interesting if either
+ *                 a) the token has no name
+ *                           or
+ *                 b) verbose mode is in effect.
+ *             If the token is named, show its FCode number in
+ *                 the syntax of a FORTH Comment, otherwise, its
+ *                 FCode number -- in [brackets] -- acts as its name.
+ *
+ *      Error Detection:
+ *          An invalid token # is probably an artifact of an error that
+ *              was allowed in the tokenization; the decoder has skipped
+ *              only its first byte.  Print a message saying so.
+ *
+ **************************************************************************** */
+
+static void output_token_name(u16 token, const char *tname, u8 tname_len,
+			      bool is_invalid)
+{
+	if (is_invalid) {
+		char temp_buf[80];
+		int buf_pos;
+		u8 top_byte = token >> 8;
+		out_printf("Invalid token:  [0x%03x]\n", token);
+		sprintf(temp_buf, "Backing up over first byte, which is ");
+		buf_pos = strlen(temp_buf);
+		if (top_byte < 10) {
+			sprintf(&temp_buf[buf_pos], " %02x", top_byte);
+		} else {
+			sprintf(&temp_buf[buf_pos], "0x%02x ( =dec %d)",
+				top_byte, top_byte);
+		}
+		print_remark_text(temp_buf);
+		return;
+	}
+
+	out_chars(tname, tname_len);
+	out_char(' ');
+
+	/* The fcode number is interesting
+	 *  if either
+	 *  a) the token has no name
+	 *            or
+	 *  b) detok is in verbose mode.
+	 */
+	if ((tname_len == strlen(unnamed))
+	    && (memcmp(tname, unnamed, tname_len) == 0)) {
+		out_str("[0x");
+		out_hex(token, 3);
+		out_str("] ");
+	} else {
+		if (verbose) {
+			/*  If the token is named,
+			 *  show its fcode number in
+			 *  the syntax of a FORTH Comment
+			 */
+			out_str("( 0x");
+			out_hex(token, 3);
+			out_str(" ) ");
+		}
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_token
+ *      Synopsis:       Print the start of the line for a token:
+ *                          line number, indentation and name.
+ *
+ **************************************************************************** */
+
+static void output_token(const fc_insn_t * insn)
+{
+	decode_lines(insn->offset);
+	decode_indent();
+	output_token_name(insn->fcode, insn->name, insn->name_len,
+			  (insn->flags & INSN_INVALID) != 0);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_offset
+ *      Synopsis:       Display an FCode-offset associated with a branch
+ *                          or suchlike function.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn                    The record for the branch
+ *         Global/Static Variables:
+ *             show_offsets            Whether to show offsets in full detail
+ *
+ *      Outputs:
+ *         Printout:
+ *             The offset and destination, if display of offsets was specified
+ *                 or if the destination is invalid
+ *
+ *      Error Detection:
+ *          The decoder has checked the destination.  If it was invalid,
+ *              print a remark saying so; unless the offset was zero, the
+ *              decoder has gone back to the location of the offset, to
+ *              process it in the manner of normal tokens.
+ *
+ **************************************************************************** */
+
+static void output_offset(const fc_insn_t * insn)
+{
+	s16 offs = insn->opnd.branch.offs;
+	bool invalid_dest = (insn->flags & INSN_BAD_DEST) != 0;
+
+	/*  Show the offset in hex and again as a signed decimal number.   */
+	if (insn->flags & INSN_OFFS16) {
+		out_str("0x");
+		out_hex((u16) (offs & 0xffff), 4);
+	} else {
+		out_str("0x");
+		out_hex((u8) (offs & 0x00ff), 2);
+	}
+	out_str(" (");
+	if ((offs < 0) || (offs > 9)) {
+		out_str(" =dec ");
+		out_dec(offs);
+	}
+	/*  If we're showing source-byte offsets, show targets of offsets  */
+	if (show_offsets || invalid_dest) {
+		out_str("  dest = ");
+		out_dec(insn->opnd.branch.dest);
+		out_char(' ');
+	}
+	out_str(")\n");
+
+	if (invalid_dest) {
+		if (offs == 0) {
+			print_remark_text("Error:  Unresolved offset.");
+		} else {
+			print_remark_text
+			    ("Error:  Invalid offset.  Ignoring...");
+		}
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_header
+ *      Synopsis:       Display an FCode block Header
+ *
+ *      Process Explanation:
+ *          Each field of the header gets a line of its own, with the
+ *              offset at which the field lies.  If the input ended
+ *              partway through the header, stop after the start of the
+ *              line for the field that could not be read.
+ *
+ **************************************************************************** */
+
+static void output_header(const fc_insn_t * insn)
+{
+	if (!(insn->flags & INSN_MIDBLOCK))
+		indent = 0;
+
+	output_token(insn);
+	out_printf("  ( %d-bit offsets)\n",
+		   (insn->flags & INSN_OFFS16) ? 16 : 8);
+
+	decode_lines(insn->offset + 1);
+	if (insn->opnd.header.fields < 1)
+		return;
+	out_printf("  format:    0x%02x\n", insn->opnd.header.format);
+
+	decode_lines(insn->offset + 2);
+	if (insn->opnd.header.fields < 2)
+		return;
+	if (insn->opnd.header.checksum == insn->opnd.header.calc_checksum) {
+		out_printf("  checksum:  0x%04x (Ok)\n",
+			   insn->opnd.header.checksum);
+	} else if (insn->opnd.header.checksum ==
+		   insn->opnd.header.sun_checksum) {
+		out_printf("  checksum:  0x%04x (Ok, Sun-style)\n",
+			   insn->opnd.header.checksum);
+	} else {
+		out_printf("  checksum should be:  0x%04x, but is 0x%04x\n",
+			   insn->opnd.header.calc_checksum,
+			   insn->opnd.header.checksum);
+	}
+
+	decode_lines(insn->offset + 4);
+	if (insn->opnd.header.fields < 3)
+		return;
+	out_printf("  len:       0x%04llx ( %lld bytes)\n",
+		   (long long) insn->opnd.header.len,
+		   (long long) insn->opnd.header.len);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_token_line
+ *      Synopsis:       Display the full line for a token:  its name,
+ *                          its operand, and the change in indentation
+ *                          that goes with it.
+ *
+ *      Revision History:
+ *          Some tuning of adjustment of indent, particularly wrt branches...
+ *          The change in indentation comes from the token's entry in
+ *              the  token_descs  table.
+ *
+ **************************************************************************** */
+
+static void output_token_line(const fc_insn_t * insn)
+{
+	u8 desc_flags = token_descs[insn->fcode].flags;
+
+	if (desc_flags & DESC_OUTDENT)
+		indent--;
+
+	output_token(insn);
+	if (insn->flags & INSN_PARTIAL)
+		return;
+
+	switch (insn->opnd_kind) {
+	case OPND_LITERAL:
+		out_str("0x");
+		out_hex(insn->opnd.literal, 0);
+		out_char('\n');
+		break;
+	case OPND_BRANCH:
+		output_offset(insn);
+		break;
+	case OPND_STRING:
+		pretty_print_string(insn->opnd.string.ptr,
+				    insn->opnd.string.len);
+		out_char('\n');
+		break;
+	case OPND_NAMED_TOKEN:
+		/*  An embedded null ends the name  */
+		out_chars((const char *)insn->opnd.new_token.ptr,
+			  strnlen((const char *)insn->opnd.new_token.ptr,
+				  insn->opnd.new_token.len));
+		out_char(' ');
+		/*  Fall through  */
+	case OPND_NEW_TOKEN:
+		out_str("0x");
+		out_hex(insn->opnd.new_token.token, 3);
+		out_char('\n');
+		break;
+	case OPND_TOKEN:
+		output_token_name(insn->opnd.token.token,
+				  insn->opnd.token.name,
+				  insn->opnd.token.name_len,
+				  (insn->flags & INSN_OPND_BAD) != 0);
+		out_char('\n');
+		break;
+	case OPND_QUAD:
+		out_printf("0x%04x.%04x.%04x.%04x\n",
+			   insn->opnd.quad[0], insn->opnd.quad[1],
+			   insn->opnd.quad[2], insn->opnd.quad[3]);
+		break;
+	case OPND_NONE:
+	default:
+		out_char('\n');
+		break;
+	}
+
+	if (desc_flags & DESC_INDENT)
+		indent++;
+	if (desc_flags & DESC_BR_INDENT) {
+		if (insn->opnd.branch.offs >= 0)
+			indent++;
+		else
+			indent--;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_block_end
+ *      Synopsis:       Print the summary message at the end of an
+ *                          FCode block.
+ *
+ **************************************************************************** */
+
+static void output_block_end(const fc_insn_t * insn)
+{
+	char temp_bufr[80];
+
+	if (!(insn->flags & INSN_ENDER)) {
+		print_remark_text("FCode-ender not found");
+	}
+	if (insn->opnd.block_end.consumed == insn->opnd.block_end.len) {
+		sprintf(temp_bufr,
+			"Detokenization finished normally after %lld bytes.",
+			(long long) insn->opnd.block_end.len);
+	} else {
+		sprintf(temp_bufr,
+			"Detokenization finished prematurely after %lld of %lld bytes.",
+			(long long) insn->opnd.block_end.consumed,
+			(long long) insn->opnd.block_end.len);
+	}
+	print_remark_text(temp_bufr);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_bad_start
+ *      Synopsis:       Print the message for an FCode block that does
+ *                          not start with a valid FCode Start Byte,
+ *                          on a line of its own.
+ *
+ **************************************************************************** */
+
+static void output_bad_start(const fc_insn_t * insn)
+{
+	char temp_bufr[128] =
+	    "Invalid FCode Start Byte.  Ignoring FCode header.";
+
+	indent = 0;
+	out_char('\n');
+	if (show_linenumbers) {
+		sprintf(&(temp_bufr[strlen(temp_bufr)]),
+			"  Remaining len = 0x%04llx ( %lld bytes)",
+			(long long) insn->opnd.header.len,
+			(long long) insn->opnd.header.len);
+	}
+	print_remark_text(temp_bufr);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_eof
+ *      Synopsis:       Print the cause of the end-of-file.
+ *
+ *      Outputs:
+ *         Printout:
+ *             "End-of-file" message, along with a descriptor, if applicable:
+ *                 Premature, Unexpected.
+ *          A "Premature" end-of-file is one in the middle of a token.
+ *          If the normal end of FCode wasn't seen, it is an "Unexpected"
+ *               end-of-file.
+ *
+ **************************************************************************** */
+
+static void output_eof(const fc_insn_t * insn)
+{
+	char yoo = 'U';
+	char eee = 'E';
+	if (insn->flags & INSN_PREMATURE) {
+		out_str("Premature ");
+		yoo = 'u';
+		eee = 'e';
+	}
+	if (!(insn->flags & INSN_ENDER)) {
+		out_char(yoo);
+		out_str("nexpected ");
+		eee = 'e';
+	}
+	out_char(eee);
+	out_str("nd of file.\n");
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  print_insn
+ *      Synopsis:       Print the listing for one record from the decoder.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             insn                The record
+ *             unused              The sink's data; none needed here
+ *
+ **************************************************************************** */
+
+void print_insn(const fc_insn_t * insn, void *unused)
+{
+	switch (insn->kind) {
+	case INSN_TOKEN:
+		output_token_line(insn);
+		break;
+	case INSN_HEADER:
+		output_header(insn);
+		break;
+	case INSN_BAD_START:
+		output_bad_start(insn);
+		break;
+	case INSN_BLOCK_END:
+		output_block_end(insn);
+		break;
+	case INSN_RESTART:
+		linenum = 1;
+		break;
+	case INSN_REMARK:
+		print_remark_text(insn->name);
+		break;
+	case INSN_EOF:
+		output_eof(insn);
+		break;
+	case INSN_IMAGE_START:
+	case INSN_IMAGE_END:
+	default:
+		/*  Shown by way of the remarks that go with them  */
+		break;
+	}
+}
@@ -0,0 +1,347 @@
+/*
+ *                     OpenBIOS - free your system! 
+ *                        ( FCode detokenizer )
+ *                          
+ *  outsink.c - buffered output for the detokenizer.
+ *  
+ *  This program is part of a free implementation of the IEEE 1275-1994 
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      All of the detokenizer's text output goes through here.
+ *
+ *      It is gathered into a large buffer and handed to  write(2)  a
+ *          buffer-full at a time, or, for a caller that wants the text
+ *          itself, gathered into a buffer that grows to hold all of it.
+ *
+ *      The numeric formats the detokenizer uses on every token -- hex
+ *          with a minimum number of digits, and decimal, possibly padded
+ *          to a width -- are done here by hand rather than by  printf ;
+ *          anything else can still go through  out_printf() .
+ *
+ *      Whatever is still in the buffer when the program exits is
+ *          written out then.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "outsink.h"
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     out_buf                Buffer into which output is gathered
+ *     out_size               Its size
+ *     out_len                Number of bytes in it
+ *     out_fd                 File descriptor to which it is written,
+ *                                or -1 when gathering into memory
+ *     indent_str             Enough indentation for a dozen levels
+ *
+ **************************************************************************** */
+
+#define OUT_BUF_SIZE    0x10000
+#define INDENT_WIDTH    4
+
+static char out_fd_buf[OUT_BUF_SIZE];
+static char *out_buf = out_fd_buf;
+static size_t out_size = OUT_BUF_SIZE;
+static size_t out_len = 0;
+static int out_fd = STDOUT_FILENO;
+static bool flush_at_exit = false;
+
+static const char indent_str[] =
+	"                                                ";
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* **************************************************************************
+ *
+ *      Function name:  write_all
+ *      Synopsis:       Write the given bytes to the output file,
+ *                          however many calls that takes.
+ *
+ *      Error Detection:
+ *          A write that fails for any reason other than interruption
+ *              ends the attempt; the rest of the bytes are discarded,
+ *              as  stdio  would have done.
+ *
+ **************************************************************************** */
+
+static void write_all(const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t written = write(out_fd, data, len);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		data += written;
+		len -= written;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  flush_output
+ *      Synopsis:       Write out whatever has been gathered, when
+ *                          writing to a file.
+ *
+ **************************************************************************** */
+
+void flush_output(void)
+{
+	if (out_fd >= 0) {
+		write_all(out_buf, out_len);
+		out_len = 0;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  make_room
+ *      Synopsis:       Make room in the buffer for the given number of
+ *                          bytes, by flushing it or by enlarging it.
+ *
+ *      Outputs:
+ *         Returned Value:     TRUE if the bytes will fit.  FALSE means
+ *                                 they are too many for the buffer and
+ *                                 should be written directly.
+ *
+ **************************************************************************** */
+
+static bool make_room(size_t len)
+{
+	if (out_fd >= 0) {
+		flush_output();
+		return (len <= out_size);
+	}
+
+	while (out_len + len + 1 > out_size) {
+		char *nu_buf;
+		out_size *= 2;
+		nu_buf = realloc(out_buf, out_size);
+		if (!nu_buf) {
+			printf("Out of memory while gathering output.\n");
+			exit(-ENOMEM);
+		}
+		out_buf = nu_buf;
+	}
+	return (true);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_to_fd
+ *      Synopsis:       Send the output to the given file descriptor
+ *
+ *      Outputs:
+ *         Returned Value:     The file descriptor the output had been
+ *                                 going to, so that the caller can
+ *                                 send it back there when done.
+ *
+ **************************************************************************** */
+
+int output_to_fd(int fd)
+{
+	int prev_fd = out_fd;
+
+	flush_output();
+	if (out_buf != out_fd_buf) {
+		free(out_buf);
+		out_buf = out_fd_buf;
+		out_size = OUT_BUF_SIZE;
+	}
+	out_len = 0;
+	out_fd = fd;
+	if (!flush_at_exit) {
+		atexit(flush_output);
+		flush_at_exit = true;
+	}
+	return (prev_fd);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_to_memory
+ *      Synopsis:       Gather the output into memory, starting afresh,
+ *                          until the caller collects it with
+ *                          output_memory()
+ *
+ **************************************************************************** */
+
+void output_to_memory(void)
+{
+	flush_output();
+	if (out_buf == out_fd_buf) {
+		out_buf = malloc(OUT_BUF_SIZE);
+		if (!out_buf) {
+			printf("Out of memory while gathering output.\n");
+			exit(-ENOMEM);
+		}
+	}
+	out_size = OUT_BUF_SIZE;
+	out_len = 0;
+	out_fd = -1;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  output_memory
+ *      Synopsis:       Return the output gathered in memory so far.
+ *
+ *      Outputs:
+ *         Returned Value:     Pointer to the text, null-terminated, or
+ *                                 NULL if output is going to a file.
+ *                                 It remains valid until more output
+ *                                 is produced.
+ *         Supplied Pointers:
+ *             *len            Length of the text, if  len  is not NULL
+ *
+ **************************************************************************** */
+
+char *output_memory(size_t *len)
+{
+	if (out_fd >= 0)
+		return (NULL);
+
+	out_buf[out_len] = 0;
+	if (len)
+		*len = out_len;
+	return (out_buf);
+}
+
+/* **************************************************************************
+ *
+ *      The output routines proper.
+ *
+ **************************************************************************** */
+
+void out_chars(const char *str, size_t len)
+{
+	if (out_len + len >= out_size) {
+		if (!make_room(len)) {
+			write_all(str, len);
+			return;
+		}
+	}
+	memcpy(&out_buf[out_len], str, len);
+	out_len += len;
+}
+
+void out_str(const char *str)
+{
+	out_chars(str, strlen(str));
+}
+
+void out_char(char c)
+{
+	if (out_len + 1 >= out_size)
+		make_room(1);
+	out_buf[out_len++] = c;
+}
+
+/*  Hex, lower-case, zero-filled to at least  min_digits  (as "%0*x")  */
+void out_hex(u32 val, int min_digits)
+{
+	char digits[8];
+	int indx = 8;
+
+	do {
+		digits[--indx] = hex_digits[val & 0xf];
+		val >>= 4;
+	} while (val != 0);
+	while ((8 - indx) < min_digits && indx > 0)
+		digits[--indx] = '0';
+
+	out_chars(&digits[indx], 8 - indx);
+}
+
+/*  Decimal, blank-filled on the left to  width  (as "%*lld")  */
+void out_dec_padded(s64 val, int width)
+{
+	char digits[24];
+	int indx = sizeof(digits);
+	u64 mag = (val < 0) ? -(u64) val : (u64) val;
+
+	do {
+		digits[--indx] = '0' + (mag % 10);
+		mag /= 10;
+	} while (mag != 0);
+	if (val < 0)
+		digits[--indx] = '-';
+	while (((int)sizeof(digits) - indx) < width && indx > 0)
+		digits[--indx] = ' ';
+
+	out_chars(&digits[indx], sizeof(digits) - indx);
+}
+
+void out_dec(s64 val)
+{
+	out_dec_padded(val, 0);
+}
+
+void out_indent(int level)
+{
+	const int per_str = (sizeof(indent_str) - 1) / INDENT_WIDTH;
+
+	while (level > per_str) {
+		out_chars(indent_str, per_str * INDENT_WIDTH);
+		level -= per_str;
+	}
+	if (level > 0)
+		out_chars(indent_str, level * INDENT_WIDTH);
+}
+
+/*  Anything not covered by the above  */
+void out_printf(const char *fmt, ...)
+{
+	char small_bufr[256];
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(small_bufr, sizeof(small_bufr), fmt, args);
+	va_end(args);
+	if (len < 0)
+		return;
+
+	if (len < (int)sizeof(small_bufr)) {
+		out_chars(small_bufr, len);
+	} else {
+		char *big_bufr = malloc(len + 1);
+		if (!big_bufr) {
+			printf("Out of memory while formatting output.\n");
+			exit(-ENOMEM);
+		}
+		va_start(args, fmt);
+		vsnprintf(big_bufr, len + 1, fmt, args);
+		va_end(args);
+		out_chars(big_bufr, len);
+		free(big_bufr);
+	}
+}
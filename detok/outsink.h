@@ -0,0 +1,50 @@
+/*
+ *                     OpenBIOS - free your system! 
+ *                        ( FCode detokenizer )
+ *                          
+ *  outsink.h - prototypes for the detokenizer's output sink.
+ *  
+ *  This program is part of a free implementation of the IEEE 1275-1994 
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+#ifndef _UTILS_DETOK_OUTSINK_H
+#define _UTILS_DETOK_OUTSINK_H
+
+#include <stddef.h>
+#include "types.h"
+
+/*  Prototypes for functions exported from  outsink.c     */
+
+int output_to_fd(int fd);
+void output_to_memory(void);
+char *output_memory(size_t *len);
+void flush_output(void);
+
+void out_chars(const char *str, size_t len);
+void out_str(const char *str);
+void out_char(char c);
+void out_hex(u32 val, int min_digits);
+void out_dec(s64 val);
+void out_dec_padded(s64 val, int width);
+void out_indent(int level);
+void out_printf(const char *fmt, ...)
+	__attribute__ ((format (printf, 1, 2)));
+
+#endif				/*  _UTILS_DETOK_OUTSINK_H    */
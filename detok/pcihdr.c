@@ -77,6 +77,7 @@
 #include <stdio.h>
 
 #include "detok.h"
+#include "stream.h"
 
 
 /* **************************************************************************
@@ -350,6 +351,9 @@ static void announce_pci_data_struct(pci_data_t * pci_data_ptr)
  *      
  *      Process Explanation:
  *          Use the various support routines defined below.
+ *          A header or Data Structure that would run past the end of
+ *              the input-data ( max ) is not examined; it is treated
+ *              as not being there.
  *      
  *      
  *      Revision History:
@@ -373,8 +377,13 @@ int handle_pci_header(u8 * data_ptr)
 	/*  int retval;  *//*  Not needed until we handle error cases...  */
 
 	data_struc_len = 0;
+	/*  Only a valid Data Structure tells where the image ends  */
+	pci_image_end = NULL;
 
-	hdrlen = is_pci_header((rom_header_t *) data_ptr);
+	/*  Neither structure may run past the end of the input  */
+	hdrlen = 0;
+	if (data_ptr + sizeof(rom_header_t) <= max)
+		hdrlen = is_pci_header((rom_header_t *) data_ptr);
 	/*  retval = hdrlen;  *//*  Not needed yet...  */
 	if (hdrlen < 0) {
 		/*  Handle error case...  */
@@ -384,7 +393,8 @@ int handle_pci_header(u8 * data_ptr)
 		/* if hdrlen == 0 then we don't need to check a Data Structure  */
 		if (hdrlen > 0) {
 			announce_pci_hdr((rom_header_t *) data_ptr);
-			data_struc_len = is_pci_data_struct((pci_data_t *) & data_ptr[hdrlen]);
+			if (&data_ptr[hdrlen] + sizeof(pci_data_t) <= max)
+				data_struc_len = is_pci_data_struct((pci_data_t *) & data_ptr[hdrlen]);
 			/*
 			 *  A Data Structure Length of Zero would be an error
 			 *  that could be detected by  is_pci_data_struct()
@@ -405,6 +415,125 @@ int handle_pci_header(u8 * data_ptr)
 }
 
 
+/* **************************************************************************
+ *
+ *      Function name:  probe_pci_image
+ *      Synopsis:       Quietly check whether a PCI image, with both a
+ *                          PCI header and a PCI Data Structure, begins
+ *                          at the given point; describe it if so.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             data_ptr          Pointer to the point to examine
+ *             limit             Just after the end of the data available
+ *             probe             Pointer to the description to fill in
+ *
+ *      Outputs:
+ *         Returned Value:       TRUE if a PCI image was found
+ *         Supplied Pointers:
+ *             *probe            Offset to the code, length of the image
+ *                                   (limited to the data available), its
+ *                                   Code Type and Last-Image flag
+ *
+ *      Process Explanation:
+ *          The same tests as  handle_pci_header()  makes, but without
+ *              printing anything and without disturbing the state of
+ *              the image currently being detokenized.
+ *          An image with an Image Length of zero, or with its code
+ *              outside the image, is not taken as genuine.
+ *
+ **************************************************************************** */
+
+bool probe_pci_image(u8 * data_ptr, u8 * limit, pci_probe_t * probe)
+{
+	int hdrlen;
+	int data_struc_len;
+	pci_data_t *pci_data_ptr;
+	s64 image_len;
+
+	if (data_ptr + sizeof(rom_header_t) > limit)
+		return false;
+	hdrlen = is_pci_header((rom_header_t *) data_ptr);
+	if (hdrlen <= 0)
+		return false;
+
+	pci_data_ptr = (pci_data_t *) & data_ptr[hdrlen];
+	if ((u8 *) pci_data_ptr + sizeof(pci_data_t) > limit)
+		return false;
+	data_struc_len = is_pci_data_struct(pci_data_ptr);
+	if (data_struc_len <= 0)
+		return false;
+
+	image_len = (s64) LITTLE_ENDIAN_WORD_FETCH(pci_data_ptr->ilen) * 512;
+	if ((image_len == 0) || (hdrlen + data_struc_len >= image_len))
+		return false;
+	if (image_len > limit - data_ptr)
+		image_len = limit - data_ptr;
+
+	probe->code_offset = hdrlen + data_struc_len;
+	probe->image_len = image_len;
+	probe->code_type = pci_data_ptr->code_type;
+	probe->last_image = (pci_data_ptr->last_image_flag & 0x80) != 0;
+	return true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  describe_pci_image
+ *      Synopsis:       Fill in, in the record for the start of a PCI
+ *                          image, the fields of its Data Structure.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             data_ptr          Pointer to the start of the PCI header
+ *             image_insn        The record, with its other fields set
+ *         Global/Static Variables:
+ *             max               Just after the end of the input-data
+ *
+ *      Outputs:
+ *         Supplied Pointers:
+ *             *image_insn       Its  opnd.image  fields from the Data
+ *                                   Structure, and  pci_data  set,
+ *                                   if there is a valid one.
+ *
+ *      Process Explanation:
+ *          The same tests as  handle_pci_header()  makes, which has
+ *              already printed the same details as remarks.
+ *
+ **************************************************************************** */
+
+void describe_pci_image(u8 * data_ptr, fc_insn_t * image_insn)
+{
+	int hdrlen;
+	pci_data_t *pci_data_ptr;
+
+	if (data_ptr + sizeof(rom_header_t) > max)
+		return;
+	hdrlen = is_pci_header((rom_header_t *) data_ptr);
+	if (hdrlen <= 0)
+		return;
+	pci_data_ptr = (pci_data_t *) & data_ptr[hdrlen];
+	if ((u8 *) pci_data_ptr + sizeof(pci_data_t) > max)
+		return;
+	if (is_pci_data_struct(pci_data_ptr) <= 0)
+		return;
+
+	image_insn->opnd.image.pci_data = true;
+	image_insn->opnd.image.vendor =
+	    LITTLE_ENDIAN_WORD_FETCH(pci_data_ptr->vendor);
+	image_insn->opnd.image.device =
+	    LITTLE_ENDIAN_WORD_FETCH(pci_data_ptr->device);
+	image_insn->opnd.image.class_code =
+	    CLASS_CODE_FETCH(pci_data_ptr->class_code);
+	image_insn->opnd.image.revision =
+	    LITTLE_ENDIAN_WORD_FETCH(pci_data_ptr->irevision);
+	image_insn->opnd.image.code_type = pci_data_ptr->code_type;
+	image_insn->opnd.image.image_len =
+	    (s64) LITTLE_ENDIAN_WORD_FETCH(pci_data_ptr->ilen) * 512;
+	image_insn->opnd.image.last_image =
+	    (pci_data_ptr->last_image_flag & 0x80) != 0;
+}
+
 /* **************************************************************************
  *
  *      Function name:  handle_pci_filler
@@ -444,13 +573,11 @@ void handle_pci_filler(u8 * filler_ptr)
 	int filler_len;
 	char temp_buf[80];
 	bool all_zero = true;
-	u8 filler_byte = *filler_ptr;
 
 	filler_len = pci_image_end - filler_ptr;
 
-	for (scan_ptr = filler_ptr;
-	     scan_ptr < pci_image_end; filler_byte = *(++scan_ptr)) {
-		if (filler_byte != 0) {
+	for (scan_ptr = filler_ptr; scan_ptr < pci_image_end; scan_ptr++) {
+		if (*scan_ptr != 0) {
 			all_zero = false;
 			break;
 		}
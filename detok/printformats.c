@@ -45,11 +45,30 @@
 #include <string.h>
 
 #include "detok.h"
+#include "outsink.h"
+#include "fcinsn.h"
 
 
 /* **************************************************************************
  *
  *      Function name:  printremark ( string )
+ *      Synopsis:       Make a "Remark" of the given string.
+ *
+ *      Process Explanation:
+ *          The remark goes along, as a record, to whatever is taking the
+ *              decoder's records.  Normally that is the listing, which
+ *              prints it by way of  print_remark_text() .
+ *
+ **************************************************************************** */
+
+void printremark(char *str)
+{
+	emit_remark(str);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  print_remark_text ( string )
  *      Synopsis:       Print the given string as a series of "Remark" lines,
  *                      (i.e., preceded by backslash-space)
  *      
@@ -84,22 +103,12 @@
  *
  **************************************************************************** */
 
-void printremark(char *str)
+void print_remark_text(const char *str)
 {
-	char *strtmp;		/*  Temporary pointer to current substring    */
+	const char *strtmp;	/*  Temporary pointer to current substring    */
 	int substrlen;		/*  Length of current substring               */
-	char *substrend;	/*  Pointer to end of current substring       */
-	char *strend;		/*  Pointer to end of given string            */
-
-	char *strbfr;		/*  Temporary substring buffer                */
-
-	/*  Guarantee that the malloc will be big enough.  */
-	strbfr = (char *) malloc(strlen((char *) str) + 1);
-	if (!strbfr) {
-		printf("No memory.\n");
-		exit(-1);
-	}
-
+	const char *substrend;	/*  Pointer to end of current substring       */
+	const char *strend;	/*  Pointer to end of given string            */
 
 	strtmp = str;
 	strend = &str[strlen(str)];
@@ -112,26 +121,20 @@ void printremark(char *str)
 	 *      The  strend  pointer provides a convenient means to
 	 *      test for when we've reached the end.
 	 *
+	 *      Each substring goes to the output directly from where
+	 *      it sits in the given string, so no copy is needed.
+	 *
 	 ******************************************************************** */
 
 	while (strtmp < strend) {
 		substrend = strchr(strtmp, '\n');
 		substrlen = (substrend ? (substrend - strtmp) : strlen(strtmp));
 
-		strncpy(strbfr, strtmp, substrlen);
-		/* **********************************************************
-		 * 
-		 *  strncpy() does not append a terminating null character,
-		 *  so we have to.
-		 *
-		 ************************************************************ */
-		strbfr[substrlen] = (char) 0;
-
-		printf("\\  %s\n", strbfr);
+		out_str("\\  ");
+		out_chars(strtmp, substrlen);
+		out_char('\n');
 
 		strtmp = &strtmp[substrlen + (substrend ? 1 : 0)];
 
 	}
-
-	free(strbfr);
 }
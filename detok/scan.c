@@ -0,0 +1,618 @@
+/*
+ *                     OpenBIOS - free your system! 
+ *                        ( FCode detokenizer )
+ *                          
+ *  scan.c - find FCode and PCI images embedded in a larger file.
+ *  
+ *  This program is part of a free implementation of the IEEE 1275-1994 
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Support for the  --scan  option, which takes the input file to be
+ *          a dump -- of a flash part, say -- with FCode somewhere in it,
+ *          rather than an image that starts with a PCI header or an
+ *          FCode header.
+ *
+ *      The whole file is searched for PCI images (a PCI header with a
+ *          valid PCI Data Structure) and for FCode blocks (an FCode-block
+ *          Starter followed by a header whose length fits in the file and
+ *          whose checksum is right).  A list of what was found is printed,
+ *          and then each one that holds FCode is detokenized as though it
+ *          had been a file by itself.  They are detokenized side by side,
+ *          as many at once as the  -j  switch allows.
+ *
+ *      A candidate that lies inside the extent of one already found is
+ *          taken to be part of it and passed over.
+ *
+ *      Also here is the support for detokenizing the images of a multi-
+ *          image ROM side by side, when the  -j  switch allows more than
+ *          one at a time.  The extent of each image is known beforehand
+ *          from the Image Length in its PCI Data Structure, and the last
+ *          one is marked as such, so the file can be divided up without
+ *          having to detokenize it first.
+ *
+ *      A dump of any size holds a great many bytes that look like FCode
+ *          Starters followed by a length that fits, so a stand-alone
+ *          FCode block must also have the format byte ( 0x08 ) in its
+ *          header, and its checksum is found from running sums kept for
+ *          every  SUM_BLOCK  bytes of the file, instead of by adding up
+ *          the whole block afresh for each candidate.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "detok.h"
+#include "stream.h"
+#include "fcsum.h"
+#include "outsink.h"
+#include "workers.h"
+#include "scan.h"
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     hits              List of images found
+ *     hit_count         Number of entries in it
+ *     hit_max           Number of entries allocated
+ *
+ **************************************************************************** */
+
+typedef enum scan_kind {
+	PCI_IMAGE_HIT,
+	FCODE_BLOCK_HIT
+} scan_kind_t;
+
+typedef struct scan_hit {
+	s64 offset;		/*  From start of file                   */
+	s64 len;		/*  Extent of the image                  */
+	scan_kind_t kind;
+	u8 code_type;		/*  PCI images only                      */
+	bool has_fcode;		/*  TRUE if there is FCode to decode     */
+	bool cksum_ok;		/*  Of the FCode block, if there is one  */
+	u8 starter;		/*  FCode-block Starter, likewise        */
+} scan_hit_t;
+
+static scan_hit_t *hits = NULL;
+static int hit_count = 0;
+static int hit_max = 0;
+
+#define PCI_CODE_TYPE_FCODE   1
+#define FCODE_FORMAT          0x08
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     block_sums        Sum of all the bytes of the
+ *                           input-data before the start of each block
+ *                           of  SUM_BLOCK  bytes; one more entry at the
+ *                           end covers the whole of the data.
+ *
+ **************************************************************************** */
+
+#define SUM_BLOCK   0x1000
+
+static u64 *block_sums = NULL;
+
+/* **************************************************************************
+ *
+ *      Function name:  make_block_sums
+ *      Synopsis:       Fill in the running sums for the input-data.
+ *
+ **************************************************************************** */
+
+static void make_block_sums(void)
+{
+	s64 block_count = (stream_max + SUM_BLOCK - 1) / SUM_BLOCK;
+	s64 indx;
+	u64 running = 0;
+
+	block_sums = malloc((block_count + 1) * sizeof(u64));
+	if (!block_sums) {
+		out_str("Out of memory while scanning.\n");
+		exit(-ENOMEM);
+	}
+
+	for (indx = 0; indx < block_count; indx++) {
+		s64 left = stream_max - indx * SUM_BLOCK;
+		block_sums[indx] = running;
+		running += fcode_byte_sum(indata + indx * SUM_BLOCK,
+					  left < SUM_BLOCK ? left : SUM_BLOCK);
+	}
+	block_sums[block_count] = running;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  range_sum
+ *      Synopsis:       Sum of the given range of the input-data, from
+ *                          the running sums plus the odd bytes at
+ *                          either end.
+ *
+ **************************************************************************** */
+
+static u64 range_sum(u8 * start, u32 len)
+{
+	s64 first = start - indata;
+	s64 last = first + len;
+	s64 first_block = (first + SUM_BLOCK - 1) / SUM_BLOCK;
+	s64 last_block = last / SUM_BLOCK;
+
+	if (first_block >= last_block)
+		return fcode_byte_sum(start, len);
+
+	return (block_sums[last_block] - block_sums[first_block]
+		+ fcode_byte_sum(start, first_block * SUM_BLOCK - first)
+		+ fcode_byte_sum(indata + last_block * SUM_BLOCK,
+				 last - last_block * SUM_BLOCK));
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  checksum_ok
+ *      Synopsis:       Whether the checksum in an FCode header matches
+ *                          the block after it, in either style.
+ *
+ **************************************************************************** */
+
+static bool checksum_ok(u16 stored_cksum, u8 * body, u32 len)
+{
+	u64 sum = range_sum(body, len);
+
+	return ((stored_cksum == fold_fcode_checksum(sum, false))
+		|| (stored_cksum == fold_fcode_checksum(sum, true)));
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  add_hit
+ *      Synopsis:       Add an entry to the list of images found.
+ *
+ **************************************************************************** */
+
+static scan_hit_t *add_hit(void)
+{
+	if (hit_count == hit_max) {
+		scan_hit_t *nu_hits;
+		hit_max = hit_max ? hit_max * 2 : 64;
+		nu_hits = realloc(hits, hit_max * sizeof(scan_hit_t));
+		if (!nu_hits) {
+			out_str("Out of memory while scanning.\n");
+			exit(-ENOMEM);
+		}
+		hits = nu_hits;
+	}
+	memset(&hits[hit_count], 0, sizeof(scan_hit_t));
+	return (&hits[hit_count++]);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  word_has_candidate
+ *      Synopsis:       Tell whether any of the eight bytes in the given
+ *                          word could begin a PCI image or an FCode block.
+ *
+ *      Process Explanation:
+ *          Those are the bytes  0x55  (the first byte of the PCI header's
+ *              signature),  0xf0  through  0xf3  (start0  through  start4)
+ *              and  0xfd  (version1).
+ *          The well-known test for a zero byte in a word,
+ *                  (x - 0x0101...) & ~x & 0x8080...
+ *              is non-zero exactly when some byte of  x  is zero; it
+ *              is applied to the word exclusive-or'ed with each value
+ *              sought.  Masking off the two low bits of every byte first
+ *              catches all four of  0xf0  through  0xf3  in one test.
+ *          The great majority of words in a dump contain none of these
+ *              bytes and are passed over eight bytes at a time.
+ *
+ **************************************************************************** */
+
+#define BYTES_OF(b)     ((u64)(b) * 0x0101010101010101ULL)
+#define HAS_ZERO_BYTE(x)  (((x) - BYTES_OF(0x01)) & ~(x) & BYTES_OF(0x80))
+
+static bool word_has_candidate(u64 word)
+{
+	u64 starts = (word & BYTES_OF(0xfc)) ^ BYTES_OF(0xf0);
+	u64 version1 = word ^ BYTES_OF(0xfd);
+	u64 pci_sig = word ^ BYTES_OF(0x55);
+
+	return ((HAS_ZERO_BYTE(starts) | HAS_ZERO_BYTE(version1)
+		 | HAS_ZERO_BYTE(pci_sig)) != 0);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  try_candidate
+ *      Synopsis:       See whether an image begins at the given point,
+ *                          and add it to the list if so.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             cand_ptr           The point to examine
+ *
+ *      Outputs:
+ *         Returned Value:        Pointer to just after the image found,
+ *                                    or NULL if none was.
+ *
+ **************************************************************************** */
+
+static u8 *try_candidate(u8 * cand_ptr)
+{
+	scan_hit_t *hit;
+	u32 blk_len;
+	u16 stored_cksum;
+
+	if (*cand_ptr == 0x55) {
+		pci_probe_t probe;
+		if (!probe_pci_image(cand_ptr, max, &probe))
+			return NULL;
+		hit = add_hit();
+		hit->offset = cand_ptr - indata;
+		hit->len = probe.image_len;
+		hit->kind = PCI_IMAGE_HIT;
+		hit->code_type = probe.code_type;
+		if (probe.code_type == PCI_CODE_TYPE_FCODE) {
+			u8 *fc_ptr = cand_ptr + probe.code_offset;
+			hit->has_fcode = true;
+			if (probe_fcode_header(fc_ptr, &blk_len, &stored_cksum)) {
+				hit->starter = *fc_ptr;
+				hit->cksum_ok = checksum_ok(stored_cksum,
+							    fc_ptr + 8, blk_len - 8);
+			}
+		}
+		return (cand_ptr + probe.image_len);
+	}
+
+	if ((max - cand_ptr < 2) || (cand_ptr[1] != FCODE_FORMAT))
+		return NULL;
+	if (!probe_fcode_header(cand_ptr, &blk_len, &stored_cksum))
+		return NULL;
+	if (!checksum_ok(stored_cksum, cand_ptr + 8, blk_len - 8))
+		return NULL;
+	hit = add_hit();
+	hit->offset = cand_ptr - indata;
+	hit->len = blk_len;
+	hit->kind = FCODE_BLOCK_HIT;
+	hit->has_fcode = true;
+	hit->cksum_ok = true;
+	hit->starter = *cand_ptr;
+	return (cand_ptr + blk_len);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  find_images
+ *      Synopsis:       Search the whole of the input-data for images.
+ *
+ *      Outputs:
+ *         Local Static Variables:
+ *             hits               Filled in, in order of offset
+ *             hit_count          Number of images found
+ *
+ **************************************************************************** */
+
+static void find_images(void)
+{
+	u8 *scan_ptr = indata;
+	u8 *covered = indata;	/*  End of the last image found  */
+
+	hit_count = 0;
+	make_block_sums();
+
+	while (scan_ptr < max) {
+		u8 *found_end;
+		int indx;
+		int word_len = 8;
+
+		if (max - scan_ptr >= 8) {
+			u64 word;
+			memcpy(&word, scan_ptr, 8);
+			if (!word_has_candidate(word)) {
+				scan_ptr += 8;
+				continue;
+			}
+		} else {
+			word_len = max - scan_ptr;
+		}
+
+		for (indx = 0; indx < word_len; indx++) {
+			u8 *cand_ptr = scan_ptr + indx;
+			if (cand_ptr < covered)
+				continue;
+			found_end = try_candidate(cand_ptr);
+			if (found_end != NULL)
+				covered = found_end;
+		}
+		scan_ptr += word_len;
+		if (scan_ptr < covered)
+			scan_ptr = covered;
+	}
+
+	free(block_sums);
+	block_sums = NULL;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  starter_name
+ *      Synopsis:       Name of the given FCode-block Starter
+ *
+ **************************************************************************** */
+
+const char *starter_name(u8 starter)
+{
+	switch (starter) {
+	case 0x0fd:
+		return "version1";
+	case 0x0f0:
+		return "start0";
+	case 0x0f1:
+		return "start1";
+	case 0x0f2:
+		return "start2";
+	case 0x0f3:
+		return "start4";
+	}
+	return "no FCode header";
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  report_images
+ *      Synopsis:       Print, as remarks, the list of images found.
+ *
+ **************************************************************************** */
+
+static void report_images(void)
+{
+	char temp_bufr[160];
+	int indx;
+
+	for (indx = 0; indx < hit_count; indx++) {
+		scan_hit_t *hit = &hits[indx];
+		int pos;
+
+		pos = sprintf(temp_bufr, "%s at 0x%08llx (%lld):  0x%llx bytes",
+			      hit->kind == PCI_IMAGE_HIT ?
+			      "PCI image" : "FCode block",
+			      (long long) hit->offset, (long long) hit->offset,
+			      (long long) hit->len);
+		if (hit->kind == PCI_IMAGE_HIT) {
+			pos += sprintf(&temp_bufr[pos], ", code type 0x%02x",
+				       hit->code_type);
+		}
+		if (hit->has_fcode) {
+			if (hit->starter == 0) {
+				sprintf(&temp_bufr[pos], ", no FCode header");
+			} else {
+				sprintf(&temp_bufr[pos], ", %s, checksum %s",
+					starter_name(hit->starter),
+					hit->cksum_ok ? "Ok" : "bad");
+			}
+		} else {
+			sprintf(&temp_bufr[pos], ", not FCode");
+		}
+		printremark(temp_bufr);
+	}
+
+	sprintf(temp_bufr, "%d image%s found.\n", hit_count,
+		hit_count == 1 ? "" : "s");
+	printremark(temp_bufr);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  decode_hit
+ *      Synopsis:       Detokenize one of the images found.  This is the
+ *                          job that is handed to the workers.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             job_num           Index into the list of FCode images
+ *             job_data          The list:  an array of indices of  hits 
+ *
+ *      Process Explanation:
+ *          The input-stream is confined to the image, and the decoder
+ *              and dictionary are put back to their starting state
+ *              afterwards, so that each image comes out the same no
+ *              matter whether the images are done one after the other
+ *              or side by side.
+ *
+ **************************************************************************** */
+
+static void decode_hit(int job_num, void *job_data)
+{
+	int *fcode_hits = job_data;
+	scan_hit_t *hit = &hits[fcode_hits[job_num]];
+	char temp_bufr[80];
+
+	sprintf(temp_bufr, "Detokenizing %s at 0x%08llx\n",
+		hit->kind == PCI_IMAGE_HIT ? "PCI image" : "FCode block",
+		(long long) hit->offset);
+	printremark(temp_bufr);
+
+	set_stream_window(hit->offset, hit->len);
+	init_decoder();
+	detokenize();
+	if (!json_output)
+		out_char('\n');
+
+	reset_dictionary();
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  scan_stream
+ *      Synopsis:       Find the images in the input file, list them,
+ *                          and detokenize the ones that hold FCode.
+ *
+ **************************************************************************** */
+
+void scan_stream(void)
+{
+	char temp_bufr[80];
+	int *fcode_hits;
+	int fcode_count = 0;
+	int indx;
+
+	sprintf(temp_bufr, "Scanning %lld bytes for embedded images.",
+		(long long) stream_max);
+	printremark(temp_bufr);
+
+	find_images();
+	report_images();
+
+	fcode_hits = malloc((hit_count + 1) * sizeof(int));
+	if (!fcode_hits) {
+		out_str("Out of memory while scanning.\n");
+		exit(-ENOMEM);
+	}
+	for (indx = 0; indx < hit_count; indx++) {
+		if (hits[indx].has_fcode)
+			fcode_hits[fcode_count++] = indx;
+	}
+
+	run_jobs(fcode_count, decode_hit, fcode_hits);
+
+	free(fcode_hits);
+	free(hits);
+	hits = NULL;
+	hit_max = 0;
+	hit_count = 0;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  decode_image
+ *      Synopsis:       Detokenize one image of a multi-image ROM.  This is
+ *                          the job that is handed to the workers.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             job_num           Index into the list of images
+ *             job_data          The list:  an array of extents, each a
+ *                                   pair of offset and length
+ *
+ **************************************************************************** */
+
+static void decode_image(int job_num, void *job_data)
+{
+	s64 *extent = (s64 *) job_data + 2 * job_num;
+
+	set_stream_window(extent[0], extent[1]);
+	init_decoder();
+	detokenize();
+
+	reset_dictionary();
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  detokenize_images
+ *      Synopsis:       Detokenize the input file, doing its PCI images
+ *                          side by side.
+ *
+ *      Inputs:
+ *         Global Variables:
+ *             indata            Start of the input-data
+ *             stream_max        Its length
+ *
+ *      Outputs:
+ *         Printout:
+ *             The same as from  detokenize()  for the whole file, as long
+ *                 as each image keeps to its own extent and does not use
+ *                 FCodes named only in an image before it.
+ *
+ *      Process Explanation:
+ *          Walk the chain of PCI images from the start of the file:  each
+ *              begins where the one before it ended, until one that is
+ *              marked as the last, or until what is left is not a PCI
+ *              image.  Whatever follows the one marked as the last goes
+ *              with it, and what is left that is not an image is one
+ *              more piece.
+ *          Each piece is then detokenized as though it were a file by
+ *              itself, and their output is put together in order.
+ *          Unlike in  detokenize() , an image does not see the FCodes
+ *              named in the images before it, a block that runs past the
+ *              end of its image stops there, and the byte-offsets of an
+ *              image always count from its own start, even when the image
+ *              before it finished prematurely.  None of these should
+ *              happen in a well-formed ROM.
+ *
+ **************************************************************************** */
+
+void detokenize_images(void)
+{
+	s64 *extents;
+	int extent_max = 16;
+	int extent_count = 0;
+	u8 *image_ptr = indata;
+	u8 *data_end = indata + stream_max;
+
+	extents = malloc(2 * extent_max * sizeof(s64));
+	if (!extents) {
+		out_str("Out of memory while dividing up images.\n");
+		exit(-ENOMEM);
+	}
+
+	while (image_ptr < data_end) {
+		pci_probe_t probe;
+		bool is_image = probe_pci_image(image_ptr, data_end, &probe);
+		s64 *extent;
+
+		if (extent_count == extent_max) {
+			s64 *nu_extents;
+			extent_max *= 2;
+			nu_extents = realloc(extents, 2 * extent_max * sizeof(s64));
+			if (!nu_extents) {
+				out_str("Out of memory while dividing up images.\n");
+				exit(-ENOMEM);
+			}
+			extents = nu_extents;
+		}
+		extent = extents + 2 * extent_count;
+		extent_count++;
+
+		extent[0] = image_ptr - indata;
+		extent[1] = data_end - image_ptr;
+		if (!is_image)
+			break;
+
+		extent[1] = probe.image_len;
+
+		image_ptr += probe.image_len;
+		if (probe.last_image) {
+			/*  Whatever follows the last image goes with it,
+			 *      as it would have been read on from there.
+			 */
+			if (image_ptr < data_end)
+				extent[1] = data_end - (indata + extent[0]);
+			break;
+		}
+	}
+
+	run_jobs(extent_count, decode_image, extents);
+
+	free(extents);
+}
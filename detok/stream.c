@@ -33,12 +33,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <setjmp.h>
 
 #include "stream.h"
 #include "detok.h"
 #include "pcihdr.h"
+#include "fcsum.h"
+#include "outsink.h"
+#include "fcinsn.h"
 
 extern jmp_buf eof_exception;
 
@@ -56,7 +65,7 @@ extern jmp_buf eof_exception;
  **************************************************************************** */
 
 u16 fcode;
-unsigned int stream_max;
+s64 stream_max;
 u8 *pc;
 u8 *max;
 
@@ -65,47 +74,269 @@ u8 *max;
  *      Local/Static Variables:
  *        Name            Pointer to:
  *      indata          Start of input-data image taken from input file.
- *                          This memory was "malloc"ed; keep it around
- *                          for when we "free" that memory.
+ *                          Keep it around for when we release that memory.
  *      fc_start        Start of the FCode.  This might not be the same
  *                          as the start of the input file data, especially
  *                          if the input file data starts with a PCI header.
  *      pci_image_found     TRUE iff a valid PCI header was found
+ *      indata_mapped   TRUE if  indata  was mapped rather than "malloc"ed
+ *      indata_size     Size of the memory at  indata 
+ *      indata_len      Length of the input-data image itself
+ *      indata_borrowed TRUE if  indata  belongs to the caller of
+ *                          use_stream_data()  and is not ours to release
  *
  **************************************************************************** */
 u8 *indata;
 static u8 *fc_start;
 static bool pci_image_found = false;
+static bool indata_mapped = false;
+static size_t indata_size = 0;
+static s64 indata_len = 0;
+static bool indata_borrowed = false;
 
+#define STREAM_CHUNK   0x10000
 
-int init_stream(char *name)
+/* **************************************************************************
+ *
+ *      Function name:  map_stream
+ *      Synopsis:       Map the given open file, which is of known size,
+ *                          into memory as the input-data image.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             fd                    File descriptor, open for reading
+ *             size                  Size of the file
+ *
+ *      Outputs:
+ *         Returned Value:           Zero for success; -1 if the file
+ *                                       could not be mapped.
+ *         Local Static Variables:
+ *             indata                Start of the mapping
+ *             indata_mapped         TRUE
+ *             indata_size           Length of the mapping
+ *
+ *      Process Explanation:
+ *          The mapping is read-only:  nothing writes into the input-
+ *              data, so no page of it ever needs to be copied.
+ *          The pages of the file are brought in as they are reached and
+ *              can be dropped again by the system whenever it likes, so
+ *              the memory we use does not grow with the size of the file.
+ *
+ **************************************************************************** */
+
+static int map_stream(int fd, off_t size)
 {
-	FILE *infile;
-	struct stat finfo;
+	void *addr;
 
-	if (stat(name, &finfo))
+	if ((size <= 0) || ((u64) size > SIZE_MAX))
 		return -1;
 
-	indata = malloc(finfo.st_size);
-	if (!indata)
+	addr = mmap(NULL, (size_t) size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED)
 		return -1;
+#ifdef MADV_SEQUENTIAL
+	madvise(addr, (size_t) size, MADV_SEQUENTIAL);
+#endif
 
-	infile = fopen(name, "r");
-	if (!infile)
-		return -1;
+	indata = addr;
+	indata_mapped = true;
+	indata_size = (size_t) size;
+	return 0;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_stream
+ *      Synopsis:       Read the given open file, to its end, into memory
+ *                          as the input-data image.  For when it cannot be
+ *                          mapped:  a pipe, say, or a device.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             fd                    File descriptor, open for reading
+ *
+ *      Outputs:
+ *         Returned Value:           Number of bytes read, or -1 if the file
+ *                                       could not be read or was empty.
+ *         Local Static Variables:
+ *             indata                Start of the "malloc"ed buffer
+ *             indata_mapped         FALSE
+ *             indata_size           Size of the buffer
+ *
+ **************************************************************************** */
+
+static s64 read_stream(int fd)
+{
+	u8 *bufr = NULL;
+	size_t bufr_size = 0;
+	size_t bufr_len = 0;
+
+	while (1) {
+		ssize_t got;
+		if (bufr_len == bufr_size) {
+			u8 *nu_bufr;
+			bufr_size = bufr_size ? bufr_size * 2 : STREAM_CHUNK;
+			nu_bufr = realloc(bufr, bufr_size);
+			if (!nu_bufr)
+				break;
+			bufr = nu_bufr;
+		}
+		got = read(fd, bufr + bufr_len, bufr_size - bufr_len);
+		if (got < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (got == 0) {
+			if (bufr_len == 0)
+				break;
+			indata = bufr;
+			indata_mapped = false;
+			indata_size = bufr_size;
+			return (s64) bufr_len;
+		}
+		bufr_len += got;
+	}
+	free(bufr);
+	return -1;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  spool_stream
+ *      Synopsis:       Copy the given open file, to its end, into an
+ *                          anonymous temporary file and map that.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             fd                    File descriptor, open for reading
+ *
+ *      Outputs:
+ *         Returned Value:           Number of bytes in the image, or -1
+ *                                       if there was nothing to read or
+ *                                       the temporary file failed us.
+ *         Local Static Variables:   As for  map_stream() 
+ *
+ *      Process Explanation:
+ *          This is how we take data from a pipe or from Standard Input,
+ *              which cannot be mapped directly, and still keep our memory
+ *              use flat, however much of it there is.
+ *          The temporary file is unlinked from the start; the mapping
+ *              keeps it alive until we let go of that.
+ *
+ **************************************************************************** */
 
-	if (fread(indata, finfo.st_size, 1, infile) != 1) {
-		free(indata);
+static s64 spool_stream(int fd)
+{
+	FILE *spool;
+	int spool_fd;
+	s64 spooled = 0;
+	s64 retval = -1;
+	u8 *bufr;
+
+	spool = tmpfile();
+	bufr = malloc(STREAM_CHUNK);
+	if (spool && bufr) {
+		spool_fd = fileno(spool);
+		while (1) {
+			ssize_t got = read(fd, bufr, STREAM_CHUNK);
+			ssize_t put = 0;
+			if (got < 0) {
+				if (errno == EINTR)
+					continue;
+				spooled = -1;
+				break;
+			}
+			if (got == 0)
+				break;
+			while (put < got) {
+				ssize_t wrote = write(spool_fd, bufr + put, got - put);
+				if (wrote < 0) {
+					if (errno == EINTR)
+						continue;
+					break;
+				}
+				put += wrote;
+			}
+			if (put < got) {
+				spooled = -1;
+				break;
+			}
+			spooled += got;
+		}
+		if ((spooled > 0) && (map_stream(spool_fd, spooled) == 0))
+			retval = spooled;
+	}
+	free(bufr);
+	if (spool)
+		fclose(spool);
+	return retval;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  init_stream
+ *      Synopsis:       Bring the named file into memory as the
+ *                          input-data image.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             name                  Name of the file.  A name of  -  means
+ *                                       Standard Input.
+ *
+ *      Outputs:
+ *         Returned Value:           Zero for success; -1 if the file
+ *                                       could not be opened or read,
+ *                                       or was empty.
+ *         Global Variables:
+ *             pc                    Start of the input-data image
+ *             max                   Just after its end
+ *             stream_max            Its length
+ *         Local Static Variables:
+ *             indata_len            Its length, likewise
+ *
+ *      Process Explanation:
+ *          An ordinary file is mapped.  Anything else -- Standard Input,
+ *              a pipe, a device -- is spooled to a temporary file that
+ *              is mapped in its turn.  If the mapping fails for any
+ *              reason, the file is read into memory the old way.
+ *          Data from a pipe that could not be spooled cannot be read
+ *              a second time, so there is no fall-back for those.
+ *
+ **************************************************************************** */
+
+int init_stream(char *name)
+{
+	int infd;
+	struct stat finfo;
+	s64 size = -1;
+	bool is_stdin = (strcmp(name, "-") == 0);
+
+	infd = is_stdin ? STDIN_FILENO : open(name, O_RDONLY);
+	if (infd < 0)
 		return -1;
+
+	if (fstat(infd, &finfo) == 0) {
+		if (S_ISREG(finfo.st_mode)) {
+			size = finfo.st_size;
+			if (map_stream(infd, finfo.st_size) != 0)
+				size = (size > 0) ? read_stream(infd) : -1;
+		} else if (!S_ISDIR(finfo.st_mode)) {
+			size = spool_stream(infd);
+		}
 	}
 
-	fclose(infile);
+	if (!is_stdin)
+		close(infd);
+	if (size <= 0)
+		return -1;
 
 	pc = indata;
 	fc_start = indata;
-	max = pc + finfo.st_size;
+	max = pc + size;
 
-	stream_max = finfo.st_size;
+	stream_max = size;
+	indata_len = size;
 
 	return 0;
 }
@@ -121,22 +352,63 @@ int init_stream(char *name)
 void init_fcode_block(void)
 {
 	fc_start = pc;
-	linenum = 1;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  use_stream_data
+ *      Synopsis:       Take an image that the caller already has in
+ *                          memory as the input-data, in place of a file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             data                  The image
+ *             len                   Its length
+ *
+ *      Outputs:
+ *         Global Variables:
+ *             indata, pc, max, stream_max    As  init_stream()  sets them
+ *         Local Static Variables:
+ *             indata_borrowed       TRUE;  close_stream()  will leave the
+ *                                       image alone.
+ *
+ **************************************************************************** */
+
+void use_stream_data(u8 * data, s64 len)
+{
+	indata = data;
+	indata_borrowed = true;
+	pc = indata;
+	fc_start = indata;
+	max = pc + len;
+
+	stream_max = len;
+	indata_len = len;
 }
 
 
 void close_stream(void)
 {
-	free(indata);
+	if (!indata_borrowed) {
+		if (indata_mapped)
+			munmap(indata, indata_size);
+		else
+			free(indata);
+	}
+	indata = NULL;
+	indata_borrowed = false;
+	indata_mapped = false;
+	indata_size = 0;
+	indata_len = 0;
 	stream_max = 0;
 }
 
-int get_streampos(void)
+s64 get_streampos(void)
 {
-	return (int) (pc - fc_start);
+	return (s64) (pc - fc_start);
 }
 
-void set_streampos(int pos)
+void set_streampos(s64 pos)
 {
 	pc = fc_start + pos;
 }
@@ -145,44 +417,31 @@ void set_streampos(int pos)
 /* **************************************************************************
  *
  *      Function name:  throw_eof
- *      Synopsis:       Analyze and print the cause of the end-of-file
- *                      and throw an exception.
+ *      Synopsis:       Throw an end-of-file exception, saying what
+ *                      kind of end-of-file it is.
  *
  *      Inputs:
  *         Parameters:
  *             premature              TRUE iff end-of-file was out-of-sync 
  *         Global/Static Variables:        
- *                  end_found         Indicates if normal end of fcode was read.
  *                  eof_exception     Long-Jump environment to which to jump.
  *
  *      Outputs:                      Does a Long-Jump
  *         Returned Value:            NONE
- *         Printout:
- *             "End-of-file" message, along with a descriptor, if applicable:
- *                 Premature, Unexpected.
+ *
+ *      Process Explanation:
  *          The calling routine notifies us if the number of bytes requested
  *              overflowed the input buffer, by passing us a TRUE for the
- *              input parameter.  That is a "Premature" end-of-file.
- *          If  end_found  is FALSE, it means the normal end of FCode
- *               wasn't seen.  That is an "Unexpected" end-of-file.
+ *              input parameter.  That is a "Premature" end-of-file, and
+ *              the value we jump with says so.
+ *          The end-of-file message is printed, from the record that the
+ *              catcher of the exception makes, by the listing.
  *
  **************************************************************************** */
 
 static void throw_eof(bool premature)
 {
-	char yoo = 'U';
-	char eee = 'E';
-	if (premature) {
-		printf("Premature ");
-		yoo = 'u';
-		eee = 'e';
-	}
-	if (!end_found) {
-		printf("%cnexpected ", yoo);
-		eee = 'e';
-	}
-	printf("%cnd of file.\n", eee);
-	longjmp(eof_exception, -1);
+	longjmp(eof_exception, premature ? EOF_PREMATURE : EOF_AT_END);
 }
 
 /* **************************************************************************
@@ -219,6 +478,10 @@ static void throw_eof(bool premature)
  *              there's no call to our EOF-handling routine needed at all.
  *          Only if the requested number of bytes puts us past MAX have we 
  *              over-run our input stream with a "premature" condition.
+ *          That last test is made against the room left before MAX rather
+ *              than by advancing PC first, so that a huge request -- say,
+ *              the length field of a corrupted FCode header -- cannot
+ *              wrap the pointer around and slip past it.
  *
  *      Extraneous Remarks:
  *          This is another one where it was easier to write the code
@@ -226,13 +489,13 @@ static void throw_eof(bool premature)
  *
  **************************************************************************** */
 
-static u8 *get_bytes(int nbytes)
+static u8 *get_bytes(s64 nbytes)
 {
 	u8 *retval = pc;
 	if (pc == max) {
 		throw_eof(false);
 	}
-	if (pc + nbytes > max) {
+	if (nbytes > max - pc) {
 		throw_eof(true);
 	}
 	pc += nbytes;
@@ -367,59 +630,8 @@ u8 *get_string(u8 * len)
 
 /* **************************************************************************
  *
- *      Function name:  get_name
- *      Synopsis:       Retrieve a copy of the next string in the input-stream
- *                      when it is expected to be a new function-name.
- *
- *      Inputs:
- *         Parameters:
- *             *len                       Pointer to where the length will go
- *         Global/Static Variables:
- *             pc                        "Where we are" in the file-stream
- *
- *      Outputs:
- *         Returned Value: 
- *             Pointer to allocated memory containing a copy of the string
- *         Supplied Pointers:
- *             *len                      Length of the name
- *         Memory Allocated
- *             Memory for the copy of the string is allocated by  strdup()
- *         When Freed?
- *             Never.  Retained for duration of the program.
- *
- *      Process Explanation:
- *          Get the FORTH-style string.
- *          At this point, PC points to the byte that follows the string;
- *              we are going to save that byte and replace it with a zero,
- *              thus creating a C-style string.
- *          We will pass that C-style string as an argument to  strdup() ,
- *              which will give us our return value.
- *          Then, of course, we restore the byte we so rudely zeroed, and
- *              proceed merrily on our way.
- *
- **************************************************************************** */
-
-char *get_name(u8 * len)
-{
-	char *str_start;
-	char *retval;
-	u8 sav_byt;
-
-	str_start = (char *)get_string(len);
-
-	sav_byt = *pc;
-	*pc = 0;
-
-	retval = strdup(str_start);
-	*pc = sav_byt;
-
-	return retval;
-}
-
-/* **************************************************************************
- *
- *      Function name:  calc_checksum
- *      Synopsis:       Calculate the checksum.
+ *      Function name:  calc_body_sum
+ *      Synopsis:       Sum the bytes the checksum is formed from.
  *                          Leave the input position unchanged.
  *
  *      Inputs:
@@ -428,7 +640,10 @@ char *get_name(u8 * len)
  *             pc      Pointer to "where we are" in the file-stream
  *
  *      Outputs:
- *         Returned Value:        Calculated checksum.
+ *         Returned Value:        Sum of the bytes of the FCode block
+ *                                    after its header, unfolded; the
+ *                                    caller folds it into a checksum
+ *                                    with  fold_fcode_checksum() 
  *         Global/Static Variables:  
  *             pc     Reset to value upon entry
  *
@@ -444,22 +659,20 @@ char *get_name(u8 * len)
  *
  **************************************************************************** */
 
-u16 calc_checksum(void)
+u64 calc_body_sum(void)
 {
-	u16 retval = 0;
+	u64 retval = 0;
 	u8 *cksmptr;
 	u8 *save_pc;
 	u32 fc_blk_len;
-	int indx;
 
 	save_pc = pc;
 
 	fc_blk_len = get_num32();	/* Read len */
-	cksmptr = get_bytes(fc_blk_len - 8);	/*  Make sure we have all our data  */
+	cksmptr = get_bytes((s64) fc_blk_len - 8);	/*  Make sure we have all our data  */
 
-	for (indx = 8; indx < fc_blk_len; indx++) {
-		retval += *cksmptr++;
-	}
+	if (fc_blk_len > 8)
+		retval = fcode_byte_sum(cksmptr, fc_blk_len - 8);
 
 	pc = save_pc;
 	return retval;
@@ -487,6 +700,9 @@ u16 calc_checksum(void)
  *                  fc_start               Likewise.
  *                  pci_image_found        Set or cleared as appropriate.
  *                  last_defined_token     Re-initialized
+ *              Record:
+ *                  The start of the PCI image, with the fields of its
+ *                      Data Structure, if one was found
  *      
  *      Process Explanation:
  *          Call handle_pci_header to get the size of the PCI header,
@@ -506,6 +722,17 @@ void adjust_for_pci_header(void)
 
 	pci_header_size = handle_pci_header(pc);
 	pci_image_found = pci_header_size > 0 ? true : false;
+	if (pci_image_found) {
+		fc_insn_t image_insn;
+
+		memset(&image_insn, 0, sizeof(image_insn));
+		image_insn.kind = INSN_IMAGE_START;
+		image_insn.offset = get_streampos();
+		image_insn.opnd.image.data_pos = pc - indata;
+		image_insn.opnd.image.header_len = pci_header_size;
+		describe_pci_image(pc, &image_insn);
+		emit_insn(&image_insn);
+	}
 	pc += pci_header_size;
 	fc_start += pci_header_size;
 	last_defined_token = 0;
@@ -527,22 +754,181 @@ void adjust_for_pci_header(void)
  *          Returned Value:                NONE
  *          Global/Static Variables:
  *              pci_image_found            Reset to FALSE
+ *          Record:
+ *              The end of the PCI image
  *
  *      Error Detection:
  *          Confirm that the data-stream has the complete filler,
  *              via a call to get_bytes()
+ *          If the PCI header had no valid Data Structure, the end of
+ *              the image is not known; and if the FCode ran past the
+ *              end of the image, there is no filler.  Skip it either way.
  *
  **************************************************************************** */
 
 void adjust_for_pci_filler(void)
 {
-	if (pci_image_found) {
-		int pci_filler_len;
+	if (pci_image_found && (pci_image_end != NULL)
+	    && (pci_image_end >= pc)) {
+		s64 pci_filler_len;
 		u8 *pci_filler_ptr;
+		fc_insn_t image_insn;
+
+		memset(&image_insn, 0, sizeof(image_insn));
+		image_insn.kind = INSN_IMAGE_END;
+		image_insn.offset = get_streampos();
 
 		pci_filler_len = pci_image_end - pc;
 		pci_filler_ptr = get_bytes(pci_filler_len);
 		handle_pci_filler(pci_filler_ptr);
-		pci_image_found = false;
+
+		image_insn.opnd.image.data_pos = pci_image_end - indata;
+		emit_insn(&image_insn);
 	}
+	pci_image_found = false;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  probe_fcode_header
+ *      Synopsis:       Quietly check whether a plausible FCode header
+ *                          begins at the given point in the input-data.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             hdr_ptr           Pointer to the point to examine
+ *             blk_len           Pointer to where the block length will go
+ *             stored_cksum      Pointer to where the header's checksum goes
+ *         Global Variables:
+ *             max               Just after the end of the input-data
+ *
+ *      Outputs:
+ *         Returned Value:       TRUE if the first byte is an FCode-block
+ *                                   Starter and the length in the header
+ *                                   fits within the input-data.
+ *         Supplied Pointers:
+ *             *blk_len          Length of the block, per its header
+ *             *stored_cksum     Checksum, per its header
+ *
+ *      Process Explanation:
+ *          The length must at least cover the header itself and one
+ *              more byte, for the  end0 .
+ *          Checking the checksum is left to the caller, who can compare
+ *              it with the folded  fcode_byte_sum()  of the block after
+ *              the header (as  calc_body_sum()  does) or with something
+ *              quicker.
+ *
+ **************************************************************************** */
+
+bool probe_fcode_header(u8 * hdr_ptr, u32 * blk_len, u16 * stored_cksum)
+{
+	u32 len;
+
+	if (hdr_ptr + 8 > max)
+		return false;
+
+	switch (hdr_ptr[0]) {
+	case 0x0fd:		/* version1 */
+	case 0x0f0:		/* start0 */
+	case 0x0f1:		/* start1 */
+	case 0x0f2:		/* start2 */
+	case 0x0f3:		/* start4 */
+		break;
+	default:
+		return false;
+	}
+
+	len = BIG_ENDIAN_LONG_FETCH((hdr_ptr + 4));
+	if ((len <= 8) || (len > max - hdr_ptr))
+		return false;
+
+	*blk_len = len;
+	*stored_cksum = BIG_ENDIAN_WORD_FETCH((hdr_ptr + 2));
+	return true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  set_stream_window
+ *      Synopsis:       Confine the input-stream to a part of the
+ *                          input-data, as though that part had been
+ *                          the whole of the input file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             offset            Start of the part, from the start of data
+ *             len               Its length
+ *
+ *      Outputs:
+ *         Global Variables:
+ *             pc                Start of the part
+ *             max               Just after its end
+ *             stream_max        Its length
+ *         Local Static Variables:
+ *             fc_start          Start of the part
+ *             pci_image_found   Cleared
+ *
+ *      Error Detection:
+ *          The part is trimmed to fit within the input-data.
+ *
+ **************************************************************************** */
+
+void set_stream_window(s64 offset, s64 len)
+{
+	if (offset > indata_len)
+		offset = indata_len;
+	if (len > indata_len - offset)
+		len = indata_len - offset;
+
+	pc = indata + offset;
+	fc_start = pc;
+	max = pc + len;
+	stream_max = len;
+	pci_image_found = false;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  get_stream_origin
+ *      Synopsis:       Where, in the input-data, stream position zero
+ *                          currently is:  the start of the FCode of
+ *                          the image being detokenized.
+ *
+ **************************************************************************** */
+
+s64 get_stream_origin(void)
+{
+	return (s64) (fc_start - indata);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  set_stream_origin
+ *      Synopsis:       Open the whole of the input-data again, with
+ *                          stream position zero at the given point.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             origin            Offset, from the start of data, of what
+ *                                   get_stream_origin()  said when the
+ *                                   part to be detokenized was reached
+ *
+ *      Outputs:
+ *         Global Variables:
+ *             pc                At the origin
+ *             max, stream_max   As  init_stream()  set them
+ *         Local Static Variables:
+ *             fc_start          At the origin
+ *
+ **************************************************************************** */
+
+void set_stream_origin(s64 origin)
+{
+	if (origin > indata_len)
+		origin = indata_len;
+
+	fc_start = indata + origin;
+	pc = fc_start;
+	max = indata + indata_len;
+	stream_max = indata_len;
 }
@@ -35,10 +35,17 @@
 
 #include "types.h"
 
+/*  Values with which an end-of-file exception is thrown:  whether
+ *      the input ran out between tokens or in the middle of one.
+ */
+#define EOF_AT_END      1
+#define EOF_PREMATURE   2
+
 /*  Prototypes for functions exported from  stream.c     */
 
 
 int init_stream(char *name);
+void use_stream_data(u8 * data, s64 len);
 void close_stream(void);
 bool more_to_go(void);
 
@@ -46,8 +53,8 @@ void adjust_for_pci_header(void);
 void adjust_for_pci_filler(void);
 void init_fcode_block(void);
 
-int get_streampos(void);
-void set_streampos(int pos);
+s64 get_streampos(void);
+void set_streampos(s64 pos);
 
 u16 next_token(void);
 u8 get_num8(void);
@@ -55,12 +62,15 @@ u16 get_num16(void);
 u32 get_num32(void);
 s16 get_offset(void);
 u8 *get_string(u8 * len);
-char *get_name(u8 * len);
-u16 calc_checksum(void);
+u64 calc_body_sum(void);
+bool probe_fcode_header(u8 * hdr_ptr, u32 * blk_len, u16 * stored_cksum);
+void set_stream_window(s64 offset, s64 len);
+s64 get_stream_origin(void);
+void set_stream_origin(s64 origin);
 
 /*  External declarations for variables defined in   stream.c   */
 
-extern unsigned int stream_max;
+extern s64 stream_max;
 extern u8 *indata;
 extern u8 *pc;
 extern u8 *max;
@@ -0,0 +1,320 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                        ( FCode detokenizer )
+ *
+ *  verify.c - check the FCode blocks of a file without decoding them.
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Support for the  --verify-only  option, which checks that each
+ *          FCode block in the input file has a well-formed header, a
+ *          length that fits, and the right checksum, without decoding
+ *          any of its tokens.  A ROM that holds several PCI images has
+ *          the FCode blocks of each one checked in turn.
+ *
+ *      One line is printed, as a remark, for each block, and one for
+ *          the file as a whole.  Anything wrong sets  job_failed , so
+ *          that detok can leave with a non-zero exit status.
+ *
+ *      Only the headers are looked at, and the sum of each block's
+ *          bytes is taken by  fcode_byte_sum() , so this goes as fast as
+ *          the bytes can be read.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcihdr.h"
+#include "fcsum.h"
+
+#include "detok.h"
+#include "stream.h"
+#include "workers.h"
+#include "scan.h"
+#include "verify.h"
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     blocks_checked     Number of FCode blocks looked at in this file
+ *     blocks_bad         Number of those that were not right
+ *
+ **************************************************************************** */
+
+static int blocks_checked;
+static int blocks_bad;
+
+/* **************************************************************************
+ *
+ *      Function name:  is_fcode_starter
+ *      Synopsis:       Whether the given byte begins an FCode block
+ *
+ **************************************************************************** */
+
+static bool is_fcode_starter(u8 starter)
+{
+	switch (starter) {
+	case 0x0fd:		/* version1 */
+	case 0x0f0:		/* start0 */
+	case 0x0f1:		/* start1 */
+	case 0x0f2:		/* start2 */
+	case 0x0f3:		/* start4 */
+		return true;
+	}
+	return false;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  verify_block
+ *      Synopsis:       Check one FCode block and report on it.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             blk_ptr           Pointer to its Starter byte
+ *             limit             Just after the end of the region it
+ *                                   must fit in
+ *
+ *      Outputs:
+ *         Returned Value:       Length of the block, or zero if its
+ *                                   header did not make sense
+ *         Local Static Variables:
+ *             blocks_checked    Incremented
+ *             blocks_bad        Incremented if anything was wrong
+ *         Printout:
+ *             One remark line about the block
+ *
+ *      Process Explanation:
+ *          The caller has made sure the first byte is a Starter.
+ *          A checksum that is right in either the IEEE-1275 or the
+ *              Sun style is accepted; see  fold_fcode_checksum() .
+ *
+ **************************************************************************** */
+
+static u32 verify_block(u8 * blk_ptr, u8 * limit)
+{
+	char temp_bufr[128];
+	int offset_len;
+	u32 len;
+	u16 stored_cksum;
+	u64 sum;
+	u16 ieee_cksum;
+	u16 sun_cksum;
+
+	blocks_checked++;
+	offset_len = sprintf(temp_bufr, "FCode block at 0x%llx:  %s",
+			     (unsigned long long) (blk_ptr - indata),
+			     starter_name(blk_ptr[0]));
+
+	if (blk_ptr + 8 > limit) {
+		sprintf(&temp_bufr[offset_len], ", header runs past the end");
+		printremark(temp_bufr);
+		blocks_bad++;
+		return 0;
+	}
+
+	len = BIG_ENDIAN_LONG_FETCH((blk_ptr + 4));
+	stored_cksum = BIG_ENDIAN_WORD_FETCH((blk_ptr + 2));
+	offset_len += sprintf(&temp_bufr[offset_len],
+			      ", format 0x%02x, length 0x%x", blk_ptr[1], len);
+
+	if (len <= 8) {
+		sprintf(&temp_bufr[offset_len], ", too short");
+		printremark(temp_bufr);
+		blocks_bad++;
+		return 0;
+	}
+	if (len > limit - blk_ptr) {
+		sprintf(&temp_bufr[offset_len], ", runs past the end by 0x%llx",
+			(unsigned long long) (len - (limit - blk_ptr)));
+		printremark(temp_bufr);
+		blocks_bad++;
+		return 0;
+	}
+
+	sum = fcode_byte_sum(blk_ptr + 8, len - 8);
+	ieee_cksum = fold_fcode_checksum(sum, false);
+	sun_cksum = fold_fcode_checksum(sum, true);
+	if (stored_cksum == ieee_cksum) {
+		sprintf(&temp_bufr[offset_len], ", checksum Ok");
+	} else if (stored_cksum == sun_cksum) {
+		sprintf(&temp_bufr[offset_len], ", checksum Ok (Sun-style)");
+	} else {
+		sprintf(&temp_bufr[offset_len],
+			", checksum bad:  is 0x%04x, should be 0x%04x",
+			stored_cksum, ieee_cksum);
+		blocks_bad++;
+	}
+	printremark(temp_bufr);
+	return len;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  verify_blocks
+ *      Synopsis:       Check the FCode blocks, one after another, in a
+ *                          region of the input-data.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             blk_ptr           Where the first block should begin
+ *             limit             Just after the end of the region
+ *
+ *      Outputs:
+ *         Local Static Variables:
+ *             blocks_checked    Incremented for each block
+ *             blocks_bad        Incremented for each block not right,
+ *                                   and if there is no block at all
+ *
+ *      Process Explanation:
+ *          After a block, another one may follow.  A zero byte there
+ *              is taken to be the start of the filler, and ends the
+ *              region quietly; anything else that is not a Starter ends
+ *              it with a remark, but is not counted as a fault, any
+ *              more than it is when detokenizing.
+ *
+ **************************************************************************** */
+
+static void verify_blocks(u8 * blk_ptr, u8 * limit)
+{
+	char temp_bufr[80];
+	bool first_block = true;
+
+	while (blk_ptr < limit) {
+		u32 len;
+
+		if (!is_fcode_starter(blk_ptr[0])) {
+			if (first_block) {
+				sprintf(temp_bufr, "No FCode header at 0x%llx",
+					(unsigned long long) (blk_ptr - indata));
+				printremark(temp_bufr);
+				blocks_bad++;
+			} else if (blk_ptr[0] != 0) {
+				sprintf(temp_bufr, "No more FCode blocks:  "
+					"found 0x%02x at 0x%llx", blk_ptr[0],
+					(unsigned long long) (blk_ptr - indata));
+				printremark(temp_bufr);
+			}
+			return;
+		}
+
+		len = verify_block(blk_ptr, limit);
+		if (len == 0)
+			return;
+		blk_ptr += len;
+		first_block = false;
+	}
+	if (first_block) {
+		printremark("No FCode block:  nothing after the header");
+		blocks_bad++;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  verify_stream
+ *      Synopsis:       Check the FCode blocks of the input file, without
+ *                          decoding them.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             name              Name of the input file, for the summary
+ *         Global Variables:
+ *             indata            Start of the input-data
+ *             stream_max        Its length
+ *
+ *      Outputs:
+ *         Global Variables:
+ *             job_failed        Set if anything was wrong
+ *         Printout:
+ *             A remark line per FCode block and per PCI image, and a
+ *                 summary for the file.
+ *
+ *      Process Explanation:
+ *          Walk the chain of PCI images the same way as is done by
+ *              detokenize_images() , checking the blocks in the code
+ *              of each image that says it holds FCode.  If the file does
+ *              not start with a PCI image, or once the chain runs out,
+ *              what is left is taken to be FCode blocks by themselves.
+ *
+ **************************************************************************** */
+
+void verify_stream(char *name)
+{
+	char temp_bufr[160];
+	u8 *image_ptr = indata;
+	u8 *data_end = indata + stream_max;
+	bool was_image = false;
+
+	blocks_checked = 0;
+	blocks_bad = 0;
+
+	while (image_ptr < data_end) {
+		pci_probe_t probe;
+		u8 *image_end;
+
+		if (!probe_pci_image(image_ptr, data_end, &probe))
+			break;
+		was_image = true;
+		image_end = image_ptr + probe.image_len;
+
+		sprintf(temp_bufr, "PCI image at 0x%llx, length 0x%llx, "
+			"Code Type %d",
+			(unsigned long long) (image_ptr - indata),
+			(unsigned long long) probe.image_len, probe.code_type);
+		if (probe.code_type == 1) {
+			printremark(temp_bufr);
+			verify_blocks(image_ptr + probe.code_offset, image_end);
+		} else {
+			strcat(temp_bufr, ":  not FCode, passed over");
+			printremark(temp_bufr);
+		}
+
+		image_ptr = image_end;
+		if (probe.last_image)
+			break;
+	}
+
+	/*  Whatever follows the last image is only looked at if it
+	 *      seems to start an FCode block.
+	 */
+	if (!was_image)
+		verify_blocks(image_ptr, data_end);
+	else if ((image_ptr < data_end) && is_fcode_starter(image_ptr[0]))
+		verify_blocks(image_ptr, data_end);
+
+	if (blocks_bad == 0) {
+		snprintf(temp_bufr, sizeof(temp_bufr),
+			 "%s:  %d FCode block%s, all Ok", name,
+			 blocks_checked, blocks_checked == 1 ? "" : "s");
+	} else {
+		snprintf(temp_bufr, sizeof(temp_bufr),
+			 "%s:  %d FCode block%s, %d not right",
+			 name, blocks_checked, blocks_checked == 1 ? "" : "s",
+			 blocks_bad);
+		job_failed = true;
+	}
+	printremark(temp_bufr);
+}
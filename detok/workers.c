@@ -0,0 +1,273 @@
+/*
+ *                     OpenBIOS - free your system! 
+ *                        ( FCode detokenizer )
+ *                          
+ *  workers.c - run detokenizer jobs side by side.
+ *  
+ *  This program is part of a free implementation of the IEEE 1275-1994 
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      A "job" is a piece of detokenization whose output can stand on
+ *          its own:  one image found in a dump, say.  Given a list of
+ *          them, we run up to  max_workers  at a time, each in a
+ *          process of its own, and put their output together again in
+ *          the order of the list, as though they had been run one after
+ *          the other.
+ *
+ *      A separate process, rather than a thread, gives every job its
+ *          own copy of all the detokenizer's state -- the input stream,
+ *          the dictionary and all the rest -- as it stood when the job
+ *          was started, at no more cost than the pages the job actually
+ *          changes.  The built-in dictionary, and any Vendor FCodes that
+ *          were frozen into it, are thereby shared among all the jobs
+ *          without anyone having to take care that they are not changed.
+ *
+ *      Each job's output goes into an anonymous temporary file, which
+ *          is copied to our own output as soon as every job ahead of it
+ *          in the list has been copied.
+ *
+ *      With only one worker, or only one job, the jobs are simply run
+ *          in turn, right here.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "workers.h"
+#include "outsink.h"
+#include "detok.h"
+
+/* **************************************************************************
+ *
+ *          Global Variables Exported
+ *     max_workers            Most jobs to run at one time.  Set by the
+ *                                 -j  command-line switch.
+ *     job_failed             Set by a job that found something wrong,
+ *                                 for the exit status.  A job run by a
+ *                                 worker passes it back in its own.
+ *
+ **************************************************************************** */
+
+int max_workers = 1;
+bool job_failed = false;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     job_state              One entry per job in the current list
+ *
+ **************************************************************************** */
+
+typedef struct job_state {
+	FILE *spool;		/*  Where its output goes              */
+	pid_t pid;		/*  Process running it, while it runs  */
+	bool done;		/*  Finished, output ready to copy     */
+	int status;		/*  As from  waitpid()                 */
+} job_state_t;
+
+static job_state_t *job_state;
+
+/* **************************************************************************
+ *
+ *      Function name:  copy_job_output
+ *      Synopsis:       Copy the output of a finished job to our own
+ *                          output, and report if the job came to grief.
+ *
+ **************************************************************************** */
+
+static void copy_job_output(int job_num)
+{
+	job_state_t *this_job = &job_state[job_num];
+	char bufr[0x10000];
+	int spool_fd = fileno(this_job->spool);
+	ssize_t got;
+
+	if (lseek(spool_fd, 0, SEEK_SET) == 0) {
+		while ((got = read(spool_fd, bufr, sizeof(bufr))) != 0) {
+			if (got < 0) {
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			out_chars(bufr, got);
+		}
+	}
+	fclose(this_job->spool);
+	this_job->spool = NULL;
+
+	if (WIFSIGNALED(this_job->status)) {
+		char temp_bufr[80];
+		sprintf(temp_bufr, "Worker for job %d was killed by signal %d.",
+			job_num, WTERMSIG(this_job->status));
+		printremark(temp_bufr);
+		job_failed = true;
+	} else if (WIFEXITED(this_job->status)
+		   && (WEXITSTATUS(this_job->status) != 0)) {
+		job_failed = true;
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  start_job
+ *      Synopsis:       Start the given job in a process of its own.
+ *
+ *      Outputs:
+ *         Returned Value:     TRUE if the job was started.  FALSE if no
+ *                                 process could be had for it; the
+ *                                 caller should try again later.
+ *
+ *      Process Explanation:
+ *          Our own output buffer must be emptied first, or the new
+ *              process would write out a copy of what was in it.
+ *          The new process leaves by  _exit() , which spares it from
+ *              the exit-time handlers it inherited along with the rest.
+ *              Its exit status tells whether the job failed.
+ *
+ **************************************************************************** */
+
+static bool start_job(int job_num, job_func_t job_func, void *job_data)
+{
+	job_state_t *this_job = &job_state[job_num];
+	pid_t pid;
+
+	this_job->spool = tmpfile();
+	if (this_job->spool == NULL)
+		return false;
+
+	flush_output();
+	pid = fork();
+	if (pid < 0) {
+		fclose(this_job->spool);
+		this_job->spool = NULL;
+		return false;
+	}
+
+	if (pid == 0) {
+		output_to_fd(fileno(this_job->spool));
+		(*job_func) (job_num, job_data);
+		flush_output();
+		_exit(job_failed ? 1 : 0);
+	}
+
+	this_job->pid = pid;
+	return true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  run_jobs
+ *      Synopsis:       Run the given number of jobs, side by side,
+ *                          with their output in order.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             job_count          Number of jobs
+ *             job_func           Routine that does one job, given its
+ *                                    number and the  job_data
+ *             job_data           Passed along to  job_func 
+ *         Global Variables:
+ *             max_workers        Most jobs to run at one time
+ *
+ *      Outputs:
+ *         Printout:
+ *             The jobs' output, in order of job number.
+ *
+ *      Error Detection:
+ *          If no process can be had for a job even when no other job is
+ *              running, the job is run here, after the output of all
+ *              the jobs ahead of it has been copied.
+ *
+ **************************************************************************** */
+
+void run_jobs(int job_count, job_func_t job_func, void *job_data)
+{
+	int next_to_start = 0;
+	int next_to_copy = 0;
+	int running = 0;
+	int job_num;
+
+	if ((max_workers <= 1) || (job_count <= 1)) {
+		for (job_num = 0; job_num < job_count; job_num++) {
+			(*job_func) (job_num, job_data);
+		}
+		return;
+	}
+
+	job_state = calloc(job_count, sizeof(job_state_t));
+	if (job_state == NULL) {
+		out_str("Out of memory while starting jobs.\n");
+		exit(-ENOMEM);
+	}
+
+	while (next_to_copy < job_count) {
+		pid_t pid;
+		int status;
+
+		while ((running < max_workers) && (next_to_start < job_count)) {
+			if (!start_job(next_to_start, job_func, job_data))
+				break;
+			running++;
+			next_to_start++;
+		}
+
+		if (running == 0) {
+			/*  No process to be had.  Do this one here.  */
+			(*job_func) (next_to_start, job_data);
+			job_state[next_to_start].done = true;
+			next_to_start++;
+			next_to_copy++;
+			continue;
+		}
+
+		pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (job_num = next_to_copy; job_num < next_to_start; job_num++) {
+			if (job_state[job_num].pid == pid) {
+				job_state[job_num].done = true;
+				job_state[job_num].status = status;
+				job_state[job_num].pid = 0;
+				running--;
+				break;
+			}
+		}
+
+		while ((next_to_copy < next_to_start)
+		       && job_state[next_to_copy].done) {
+			copy_job_output(next_to_copy);
+			next_to_copy++;
+		}
+	}
+
+	free(job_state);
+	job_state = NULL;
+}
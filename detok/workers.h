@@ -0,0 +1,44 @@
+/*
+ *                     OpenBIOS - free your system! 
+ *                        ( FCode detokenizer )
+ *                          
+ *  workers.h - prototypes for running detokenizer jobs side by side.
+ *  
+ *  This program is part of a free implementation of the IEEE 1275-1994 
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+#ifndef _UTILS_DETOK_WORKERS_H
+#define _UTILS_DETOK_WORKERS_H
+
+#include "types.h"
+
+/*  A job is identified by its number, from zero up  */
+typedef void (*job_func_t) (int job_num, void *job_data);
+
+/*  Prototypes for functions exported from  workers.c     */
+
+void run_jobs(int job_count, job_func_t job_func, void *job_data);
+
+/*  External declarations for variables defined in   workers.c   */
+
+extern int max_workers;
+extern bool job_failed;
+
+#endif				/*  _UTILS_DETOK_WORKERS_H    */
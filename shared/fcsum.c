@@ -0,0 +1,129 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                      ( FCode block checksums )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      The checksum of an FCode block is formed from the sum of the
+ *          bytes of its body -- everything after the eight-byte header.
+ *          IEEE 1275-1994 section 5.2.2.5 takes that sum modulo 0x10000.
+ *          Sun's OpenBoot on some SPARC platforms (the M3000, M4000 and
+ *          M9000, notably) expects the carries out of the low sixteen
+ *          bits to be added back in instead.  Both are formed here from
+ *          the one full-width sum, so either can be had, or checked,
+ *          for the cost of a single pass over the bytes.
+ *
+ *      The pass is the costly part, and an image can be large, so on
+ *          processors that have SSE2 the bytes are summed sixteen at a
+ *          time with the "sum of absolute differences" instruction
+ *          against zero, which adds up each group of eight bytes into
+ *          a 64-bit lane.  Elsewhere, a plain loop does the same job.
+ *
+ **************************************************************************** */
+
+#include "fcsum.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* **************************************************************************
+ *
+ *      Function name:  fcode_byte_sum
+ *      Synopsis:       Sum the given bytes, without folding.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             data                  The bytes
+ *             len                   How many
+ *
+ *      Outputs:
+ *         Returned Value:           Their sum
+ *
+ **************************************************************************** */
+
+u64 fcode_byte_sum(const u8 * data, size_t len)
+{
+	u64 sum = 0;
+
+#if defined(__SSE2__)
+	if (len >= 64) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i acc0 = _mm_setzero_si128();
+		__m128i acc1 = _mm_setzero_si128();
+		u64 lanes[2];
+
+		while (len >= 64) {
+			__m128i v0 = _mm_loadu_si128((const __m128i *)data);
+			__m128i v1 = _mm_loadu_si128((const __m128i *)(data + 16));
+			__m128i v2 = _mm_loadu_si128((const __m128i *)(data + 32));
+			__m128i v3 = _mm_loadu_si128((const __m128i *)(data + 48));
+			acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(v0, zero));
+			acc1 = _mm_add_epi64(acc1, _mm_sad_epu8(v1, zero));
+			acc0 = _mm_add_epi64(acc0, _mm_sad_epu8(v2, zero));
+			acc1 = _mm_add_epi64(acc1, _mm_sad_epu8(v3, zero));
+			data += 64;
+			len -= 64;
+		}
+		_mm_storeu_si128((__m128i *) lanes, _mm_add_epi64(acc0, acc1));
+		sum = lanes[0] + lanes[1];
+	}
+#endif
+
+	while (len >= 4) {
+		sum += data[0] + data[1] + data[2] + data[3];
+		data += 4;
+		len -= 4;
+	}
+	while (len > 0) {
+		sum += *data++;
+		len--;
+	}
+	return sum;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  fold_fcode_checksum
+ *      Synopsis:       Reduce the sum of a block's body to its checksum.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             sum                   From  fcode_byte_sum()
+ *             sun_style             TRUE to fold the carries back in,
+ *                                       as Sun's OpenBoot does; FALSE
+ *                                       for the IEEE 1275 checksum
+ *
+ *      Outputs:
+ *         Returned Value:           The sixteen-bit checksum
+ *
+ **************************************************************************** */
+
+u16 fold_fcode_checksum(u64 sum, bool sun_style)
+{
+	if (sun_style) {
+		while (sum >> 16)
+			sum = (sum & 0xffff) + (sum >> 16);
+	}
+	return (u16) (sum & 0xffff);
+}
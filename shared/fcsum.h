@@ -0,0 +1,45 @@
+#ifndef _FCSUM_H
+#define _FCSUM_H
+/*
+ *                     OpenBIOS - free your system!
+ *                      ( FCode block checksums )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      The checksum in an FCode header, shared by the tokenizer, which
+ *          forms it, and the detokenizer, which checks it.
+ *
+ *      Functions Exported:
+ *          fcode_byte_sum          The plain sum of a run of bytes
+ *          fold_fcode_checksum     Reduce such a sum to the sixteen-bit
+ *                                      checksum, in either style
+ *
+ **************************************************************************** */
+
+#include <stddef.h>
+#include "types.h"
+
+u64 fcode_byte_sum(const u8 * data, size_t len);
+u16 fold_fcode_checksum(u64 sum, bool sun_style);
+
+#endif				/*  _FCSUM_H  */
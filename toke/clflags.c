@@ -106,6 +106,10 @@ bool obso_fcode_warning = true;
 bool trace_conditionals = false;
 bool big_end_pci_image_rev = false;
 bool allow_ret_stk_interp = true;
+bool drop_unused_headerless = false;
+bool dense_fcode_numbers = false;
+bool factor_common_sequences = false;
+bool inline_tiny_headerless = false;
 
 /*  And one to trigger a "help" message  */
 bool clflag_help = false;
@@ -254,6 +258,26 @@ static const cl_flag_t cl_flags_list[] = {
 	"\t\t",
 	    "Allow Return-Stack Operations during Interpretation" } ,
 
+  { "Drop-Unused-Headerless",
+        &drop_unused_headerless,
+	"\t",
+	    "Drop unreferenced headerless definitions from the image" } ,
+
+  { "Inline-Tiny-Headerless",
+        &inline_tiny_headerless,
+	"\t",
+	    "Expand calls to very small headerless definitions in place" } ,
+
+  { "Factor-Common-Sequences",
+        &factor_common_sequences,
+	"\t",
+	    "Factor repeated token sequences into new definitions" } ,
+
+  { "Dense-FCode-Numbers",
+        &dense_fcode_numbers,
+	"\t",
+	    "Reassign the FCode numbers of each image densely" } ,
+
 
   /*  Keep the "help" pseudo-flag last in the list  */
   { "help",
@@ -127,6 +127,10 @@ extern bool big_end_pci_image_rev;
 extern bool force_tokens_case;
 extern bool force_lower_case_tokens;
 extern bool allow_ret_stk_interp;
+extern bool drop_unused_headerless;
+extern bool dense_fcode_numbers;
+extern bool factor_common_sequences;
+extern bool inline_tiny_headerless;
 
 extern bool clflag_help;
 
@@ -167,9 +167,9 @@ bool define_token = true;      /*    TRUE = Normal definition process;
  *      The "FWords" list contains FORTH words that require additional
  *          special action at tokenization-time.  Their numeric values
  *          are derived from the  fword_token  enumeration declaration,
- *          and are used as the control-expression for a SWITCH statement
- *          with a large number of CASE labels in the  handle_internal()
- *          function.
+ *          and are used to select each word's own handler (defined in
+ *          scanner.c), which is bound into its entry when this list is
+ *          initialized.
  *
  *      The "Shared Words" list contains FORTH words that can be executed
  *          similarly both during "Tokenizer Escape" mode (i.e., the scope
@@ -371,10 +371,10 @@ static void obsolete_fc_token( tic_param_t pfield)
 
 /* **************************************************************************
  *
- *      The function for most of the "FWords" list,  handle_internal() ,
- *          is defined externally, but not exported in a  .h  file,
- *          because we want to keep it as private as possible.
- *      We will declare its prototype here.
+ *      The functions for the "FWords" list, one handler per FWord,
+ *          are defined externally, but not exported in a  .h  file,
+ *          because we want to keep them as private as possible.
+ *      We will declare their prototypes here.
  *
  *      Initialization macros for both "Normal Mode"-only and
  *          "Shared" entries are also defined here.
@@ -382,33 +382,126 @@ static void obsolete_fc_token( tic_param_t pfield)
  *   Arguments:
  *       fwt      (fword_token)    Value of the FWord Token (from Enum list)
  *       nam      (string)         Name of the entry as seen in the source
+ *       hdlr     (routine-name)   The FWord's handler
  *
  **************************************************************************** */
 
-void handle_internal( tic_param_t pfield);
+void fw_again( tic_param_t pfield);
+void fw_alias( tic_param_t pfield);
+void fw_allow_multi_line( tic_param_t pfield);
+void fw_asc_num( tic_param_t pfield);
+void fw_ascii( tic_param_t pfield);
+void fw_begin( tic_param_t pfield);
+void fw_brack_tick( tic_param_t pfield);
+void fw_buffer( tic_param_t pfield);
+void fw_case( tic_param_t pfield);
+void fw_cchar( tic_param_t pfield);
+void fw_cdo( tic_param_t pfield);
+void fw_char( tic_param_t pfield);
+void fw_cl_flag( tic_param_t pfield);
+void fw_colon( tic_param_t pfield);
+void fw_condl_ender( tic_param_t pfield);
+void fw_const( tic_param_t pfield);
+void fw_control( tic_param_t pfield);
+void fw_create( tic_param_t pfield);
+void fw_decimal( tic_param_t pfield);
+void fw_decval( tic_param_t pfield);
+void fw_defer( tic_param_t pfield);
+void fw_defined( tic_param_t pfield);
+void fw_dev_scope( tic_param_t pfield);
+void fw_do( tic_param_t pfield);
+void fw_else( tic_param_t pfield);
+void fw_encodefile( tic_param_t pfield);
+void fw_end0( tic_param_t pfield);
+void fw_endcase( tic_param_t pfield);
+void fw_endof( tic_param_t pfield);
+void fw_escapetok( tic_param_t pfield);
+void fw_exit( tic_param_t pfield);
+void fw_external( tic_param_t pfield);
+void fw_f_brack_tick( tic_param_t pfield);
+void fw_fcode_date( tic_param_t pfield);
+void fw_field( tic_param_t pfield);
+void fw_finish_device( tic_param_t pfield);
+void fw_fliteral( tic_param_t pfield);
+void fw_fload( tic_param_t pfield);
+void fw_func_name( tic_param_t pfield);
+void fw_glob_scope( tic_param_t pfield);
+void fw_headerless( tic_param_t pfield);
+void fw_headers( tic_param_t pfield);
+void fw_hex( tic_param_t pfield);
+void fw_hexval( tic_param_t pfield);
+void fw_if( tic_param_t pfield);
+void fw_ifile_name( tic_param_t pfield);
+void fw_iline_num( tic_param_t pfield);
+void fw_instance( tic_param_t pfield);
+void fw_is( tic_param_t pfield);
+void fw_leave( tic_param_t pfield);
+void fw_loop( tic_param_t pfield);
+void fw_loop_i( tic_param_t pfield);
+void fw_loop_j( tic_param_t pfield);
+void fw_new_device( tic_param_t pfield);
+void fw_octal( tic_param_t pfield);
+void fw_octval( tic_param_t pfield);
+void fw_of( tic_param_t pfield);
+void fw_offset16( tic_param_t pfield);
+void fw_other( tic_param_t pfield);
+void fw_overload( tic_param_t pfield);
+void fw_pbstring( tic_param_t pfield);
+void fw_pciend( tic_param_t pfield);
+void fw_pcihdr( tic_param_t pfield);
+void fw_pcirev( tic_param_t pfield);
+void fw_plus_loop( tic_param_t pfield);
+void fw_pop_fcode( tic_param_t pfield);
+void fw_pstring( tic_param_t pfield);
+void fw_push_fcode( tic_param_t pfield);
+void fw_recurse( tic_param_t pfield);
+void fw_recursive( tic_param_t pfield);
+void fw_repeat( tic_param_t pfield);
+void fw_reset_fcode( tic_param_t pfield);
+void fw_resetsymbs( tic_param_t pfield);
+void fw_ret_stk_fetch( tic_param_t pfield);
+void fw_ret_stk_from( tic_param_t pfield);
+void fw_ret_stk_to( tic_param_t pfield);
+void fw_saveimg( tic_param_t pfield);
+void fw_semicolon( tic_param_t pfield);
+void fw_setlast( tic_param_t pfield);
+void fw_show_cl_flags( tic_param_t pfield);
+void fw_sstring( tic_param_t pfield);
+void fw_start0( tic_param_t pfield);
+void fw_start1( tic_param_t pfield);
+void fw_start2( tic_param_t pfield);
+void fw_start4( tic_param_t pfield);
+void fw_string( tic_param_t pfield);
+void fw_then( tic_param_t pfield);
+void fw_tick( tic_param_t pfield);
+void fw_to( tic_param_t pfield);
+void fw_unloop( tic_param_t pfield);
+void fw_until( tic_param_t pfield);
+void fw_value( tic_param_t pfield);
+void fw_variable( tic_param_t pfield);
+void fw_version1( tic_param_t pfield);
+void fw_while( tic_param_t pfield);
 /*  "Skip-a-string when Ignoring" function.  Same args and limited-proto ...  */
 void skip_string( tic_param_t pfield);
 
-#define FWORD_EXEC_FUNC  handle_internal
+#define BUILTIN_FWORD( fwt, nam, hdlr)   \
+     FWORD_TKN_TIC(nam, hdlr, fwt, BI_FWRD_DEFN )
 
-#define BUILTIN_FWORD( fwt, nam)   \
-     FWORD_TKN_TIC(nam, FWORD_EXEC_FUNC, fwt, BI_FWRD_DEFN )
-
-#define SHARED_FWORD( fwt, nam)   \
-     FWORD_TKN_TIC(nam, FWORD_EXEC_FUNC, fwt, COMMON_FWORD )
+#define SHARED_FWORD( fwt, nam, hdlr)   \
+     FWORD_TKN_TIC(nam, hdlr, fwt, COMMON_FWORD )
 
 /*  Variants:  When Ignoring, SKip One Word  */
-#define SHR_FWD_SKOW( fwt, nam)   \
-     DUALFUNC_FWT_TIC(nam, FWORD_EXEC_FUNC, fwt, skip_a_word, COMMON_FWORD )
+#define SHR_FWD_SKOW( fwt, nam, hdlr)   \
+     DUALFUNC_FWT_TIC(nam, hdlr, fwt, skip_a_word, COMMON_FWORD )
 
 /*  Variants:  When Ignoring, SKip one Word in line  */
-#define SH_FW_SK_WIL( fwt, nam)   \
-     DUALFUNC_FWT_TIC(nam, FWORD_EXEC_FUNC, fwt,     \
+#define SH_FW_SK_WIL( fwt, nam, hdlr)   \
+     DUALFUNC_FWT_TIC(nam, hdlr, fwt,     \
          skip_a_word_in_line, COMMON_FWORD )
 
 /*  When Ignoring, SKip Two Words in line  */
-#define SH_FW_SK2WIL( fwt, nam)   \
-     DUALFUNC_FWT_TIC(nam, FWORD_EXEC_FUNC, fwt,     \
+#define SH_FW_SK2WIL( fwt, nam, hdlr)   \
+     DUALFUNC_FWT_TIC(nam, hdlr, fwt,     \
          skip_two_words_in_line, COMMON_FWORD )
 
 /* **************************************************************************
@@ -428,8 +521,8 @@ void skip_string( tic_param_t pfield);
     DUFNC_FWT_PARM(nam, afunc, pval, ifunc, COMMON_FWORD )
 
 /*  A "Shared" entry that uses the same routine for both of its functions  */
-#define SHR_SAMIG_FWRD( fwt, nam)   \
-    DUFNC_FWT_PARM(nam, FWORD_EXEC_FUNC, fwt, FWORD_EXEC_FUNC, COMMON_FWORD )
+#define SHR_SAMIG_FWRD( fwt, nam, hdlr)   \
+    DUFNC_FWT_PARM(nam, hdlr, fwt, hdlr, COMMON_FWORD )
 
 /* **************************************************************************
  *
@@ -439,18 +532,19 @@ void skip_string( tic_param_t pfield);
  *   Arguments:
  *       fwt      (fword_token)    Value of the FWord Token (from Enum list)
  *       nam      (string)         Name of the entry as seen in the source
+ *       hdlr     (routine-name)   The FWord's handler
  *
  **************************************************************************** */
-#define BI_IG_FW_HDLR( fwt, nam)   \
-    DUALFUNC_FWT_TIC(nam, FWORD_EXEC_FUNC, fwt, FWORD_EXEC_FUNC, BI_FWRD_DEFN )
+#define BI_IG_FW_HDLR( fwt, nam, hdlr)   \
+    DUALFUNC_FWT_TIC(nam, hdlr, fwt, hdlr, BI_FWRD_DEFN )
 
 /*  A variant:  A "Built-In FWorD that SKiPs One Word", when Ignoring  */
-#define BI_FWD_SKP_OW( fwt, nam)   \
-     DUALFUNC_FWT_TIC(nam, FWORD_EXEC_FUNC, fwt, skip_a_word, BI_FWRD_DEFN )
+#define BI_FWD_SKP_OW( fwt, nam, hdlr)   \
+     DUALFUNC_FWT_TIC(nam, hdlr, fwt, skip_a_word, BI_FWRD_DEFN )
 
 /*  Another variant:  A "Built-In FWorD String".  skip_string when Ignoring  */
-#define BI_FWD_STRING( fwt, nam)   \
-     DUALFUNC_FWT_TIC(nam, FWORD_EXEC_FUNC, fwt, skip_string, BI_FWRD_DEFN )
+#define BI_FWD_STRING( fwt, nam, hdlr)   \
+     DUALFUNC_FWT_TIC(nam, hdlr, fwt, skip_string, BI_FWRD_DEFN )
 
 /* **************************************************************************
  *
@@ -1499,93 +1593,93 @@ void token_entry_warning( tic_hdr_t *t_entry)
 
 static tic_fwt_hdr_t fwords_list[] = {
 
-	BI_FWD_SKP_OW(COLON,	 	":") ,
-	BUILTIN_FWORD(SEMICOLON, 	";") ,
-	BI_FWD_SKP_OW(TICK, 		"'") ,
-	BUILTIN_FWORD(AGAIN, 		"again") ,
-	BI_FWD_SKP_OW(BRACK_TICK,  	 "[']") ,
-	BI_FWD_SKP_OW(ASCII,		"ascii") ,
-	BUILTIN_FWORD(BEGIN,		"begin") ,
-	BI_FWD_SKP_OW(BUFFER,		"buffer:") ,
-	BUILTIN_FWORD(CASE,		"case") ,
-	BI_FWD_SKP_OW(CONST,		"constant") ,
-	BI_FWD_SKP_OW(CONTROL,		"control") ,
-	BI_FWD_SKP_OW(CREATE,		"create") ,
-
-	BI_FWD_SKP_OW(DEFER,		"defer") ,
-	BUILTIN_FWORD(CDO,		"?do") ,
-	BUILTIN_FWORD(DO,		"do") ,
-	BUILTIN_FWORD(ELSE,		"else") ,
-	BUILTIN_FWORD(ENDCASE,		"endcase") ,
-	BUILTIN_FWORD(ENDOF,		"endof") ,
-	BUILTIN_FWORD(EXTERNAL, 	"external") ,
-	BI_FWD_SKP_OW(FIELD,		"field") ,
-	BUILTIN_FWORD(FINISH_DEVICE,	"finish-device" ) ,
-	BUILTIN_FWORD(HEADERLESS,	"headerless") ,
-	BUILTIN_FWORD(HEADERS,		"headers") ,
-
-	BUILTIN_FWORD(INSTANCE ,	"instance") ,
-
-	BUILTIN_FWORD(IF,		"if") ,
-	BUILTIN_FWORD(UNLOOP,		"unloop") ,
-	BUILTIN_FWORD(LEAVE,		"leave") ,
-	BUILTIN_FWORD(PLUS_LOOP, 	"+loop") ,
-	BUILTIN_FWORD(LOOP,		"loop") ,
-
-	BUILTIN_FWORD(OF,		"of") ,
-	BUILTIN_FWORD(REPEAT,		"repeat") ,
-	BUILTIN_FWORD(THEN,		"then") ,
-	BI_FWD_SKP_OW(TO,		"to") ,
-	BI_FWD_SKP_OW(IS,		"is") , /*  Deprecated synonym to TO  */
-	BUILTIN_FWORD(UNTIL,		"until") ,
-	BI_FWD_SKP_OW(VALUE,		"value") ,
-	BI_FWD_SKP_OW(VARIABLE,		"variable") ,
-	BUILTIN_FWORD(WHILE,		"while") ,
-	BUILTIN_FWORD(OFFSET16,		"offset16") ,
-
-	BI_FWD_STRING(STRING,		"\"") ,     /*  XXXXX  */
-	BI_FWD_STRING(PSTRING,		".\"") ,    /*  XXXXX  */
-	BI_FWD_STRING(PBSTRING,		".(") ,     /*  XXXXX  */
-	BI_FWD_STRING(SSTRING,		"s\"") ,    /*  XXXXX  */
-	BUILTIN_FWORD(IFILE_NAME,	"[input-file-name]"),
-	BUILTIN_FWORD(ILINE_NUM,	"[line-number]"),
-	BUILTIN_FWORD(RECURSE,		"recurse") ,
-	BUILTIN_FWORD(RECURSIVE,	"recursive") ,
-	BUILTIN_FWORD(RET_STK_FETCH,	"r@") ,
-	BUILTIN_FWORD(RET_STK_FROM,	"r>") ,
-	BUILTIN_FWORD(RET_STK_TO,	">r") ,
-	BUILTIN_FWORD(THEN,		"endif" ) ,  /*  Synonym for "then"  */
-	BUILTIN_FWORD(NEW_DEVICE,	"new-device" ) ,
-	BUILTIN_FWORD(LOOP_I,		"i") ,
-	BUILTIN_FWORD(LOOP_J,		"j") ,
+	BI_FWD_SKP_OW(COLON,	 	":", fw_colon) ,
+	BUILTIN_FWORD(SEMICOLON, 	";", fw_semicolon) ,
+	BI_FWD_SKP_OW(TICK, 		"'", fw_tick) ,
+	BUILTIN_FWORD(AGAIN, 		"again", fw_again) ,
+	BI_FWD_SKP_OW(BRACK_TICK,  	 "[']", fw_brack_tick) ,
+	BI_FWD_SKP_OW(ASCII,		"ascii", fw_ascii) ,
+	BUILTIN_FWORD(BEGIN,		"begin", fw_begin) ,
+	BI_FWD_SKP_OW(BUFFER,		"buffer:", fw_buffer) ,
+	BUILTIN_FWORD(CASE,		"case", fw_case) ,
+	BI_FWD_SKP_OW(CONST,		"constant", fw_const) ,
+	BI_FWD_SKP_OW(CONTROL,		"control", fw_control) ,
+	BI_FWD_SKP_OW(CREATE,		"create", fw_create) ,
+
+	BI_FWD_SKP_OW(DEFER,		"defer", fw_defer) ,
+	BUILTIN_FWORD(CDO,		"?do", fw_cdo) ,
+	BUILTIN_FWORD(DO,		"do", fw_do) ,
+	BUILTIN_FWORD(ELSE,		"else", fw_else) ,
+	BUILTIN_FWORD(ENDCASE,		"endcase", fw_endcase) ,
+	BUILTIN_FWORD(ENDOF,		"endof", fw_endof) ,
+	BUILTIN_FWORD(EXTERNAL, 	"external", fw_external) ,
+	BI_FWD_SKP_OW(FIELD,		"field", fw_field) ,
+	BUILTIN_FWORD(FINISH_DEVICE,	"finish-device", fw_finish_device) ,
+	BUILTIN_FWORD(HEADERLESS,	"headerless", fw_headerless) ,
+	BUILTIN_FWORD(HEADERS,		"headers", fw_headers) ,
+
+	BUILTIN_FWORD(INSTANCE ,	"instance", fw_instance) ,
+
+	BUILTIN_FWORD(IF,		"if", fw_if) ,
+	BUILTIN_FWORD(UNLOOP,		"unloop", fw_unloop) ,
+	BUILTIN_FWORD(LEAVE,		"leave", fw_leave) ,
+	BUILTIN_FWORD(PLUS_LOOP, 	"+loop", fw_plus_loop) ,
+	BUILTIN_FWORD(LOOP,		"loop", fw_loop) ,
+
+	BUILTIN_FWORD(OF,		"of", fw_of) ,
+	BUILTIN_FWORD(REPEAT,		"repeat", fw_repeat) ,
+	BUILTIN_FWORD(THEN,		"then", fw_then) ,
+	BI_FWD_SKP_OW(TO,		"to", fw_to) ,
+	BI_FWD_SKP_OW(IS,		"is", fw_is) , /*  Deprecated synonym to TO  */
+	BUILTIN_FWORD(UNTIL,		"until", fw_until) ,
+	BI_FWD_SKP_OW(VALUE,		"value", fw_value) ,
+	BI_FWD_SKP_OW(VARIABLE,		"variable", fw_variable) ,
+	BUILTIN_FWORD(WHILE,		"while", fw_while) ,
+	BUILTIN_FWORD(OFFSET16,		"offset16", fw_offset16) ,
+
+	BI_FWD_STRING(STRING,		"\"", fw_string) ,     /*  XXXXX  */
+	BI_FWD_STRING(PSTRING,		".\"", fw_pstring) ,    /*  XXXXX  */
+	BI_FWD_STRING(PBSTRING,		".(", fw_pbstring) ,     /*  XXXXX  */
+	BI_FWD_STRING(SSTRING,		"s\"", fw_sstring) ,    /*  XXXXX  */
+	BUILTIN_FWORD(IFILE_NAME,	"[input-file-name]", fw_ifile_name),
+	BUILTIN_FWORD(ILINE_NUM,	"[line-number]", fw_iline_num),
+	BUILTIN_FWORD(RECURSE,		"recurse", fw_recurse) ,
+	BUILTIN_FWORD(RECURSIVE,	"recursive", fw_recursive) ,
+	BUILTIN_FWORD(RET_STK_FETCH,	"r@", fw_ret_stk_fetch) ,
+	BUILTIN_FWORD(RET_STK_FROM,	"r>", fw_ret_stk_from) ,
+	BUILTIN_FWORD(RET_STK_TO,	">r", fw_ret_stk_to) ,
+	BUILTIN_FWORD(THEN,		"endif", fw_then) ,  /*  Synonym for "then"  */
+	BUILTIN_FWORD(NEW_DEVICE,	"new-device", fw_new_device) ,
+	BUILTIN_FWORD(LOOP_I,		"i", fw_loop_i) ,
+	BUILTIN_FWORD(LOOP_J,		"j", fw_loop_j) ,
 	/* version1 is also an fcode word, but it 
 	 * needs to trigger some tokenizer internals */
-	BUILTIN_FWORD(VERSION1,		"version1") ,
-	BUILTIN_FWORD(START0,		"start0") ,
-	BUILTIN_FWORD(START1,		"start1") ,
-	BUILTIN_FWORD(START2,		"start2") ,
-	BUILTIN_FWORD(START4,		"start4") ,
-	BUILTIN_FWORD(END0,		"end0") ,
-	BUILTIN_FWORD(END1,		"end1") ,
-	BUILTIN_FWORD(FCODE_V1,		"fcode-version1") ,
-	BUILTIN_FWORD(FCODE_V2,		"fcode-version2") ,
-	BUILTIN_FWORD(FCODE_V3,		"fcode-version3") ,
-	BUILTIN_FWORD(FCODE_END,	"fcode-end") ,
+	BUILTIN_FWORD(VERSION1,		"version1", fw_version1) ,
+	BUILTIN_FWORD(START0,		"start0", fw_start0) ,
+	BUILTIN_FWORD(START1,		"start1", fw_start1) ,
+	BUILTIN_FWORD(START2,		"start2", fw_start2) ,
+	BUILTIN_FWORD(START4,		"start4", fw_start4) ,
+	BUILTIN_FWORD(END0,		"end0", fw_end0) ,
+	BUILTIN_FWORD(END1,		"end1", fw_end0) ,
+	BUILTIN_FWORD(FCODE_V1,		"fcode-version1", fw_version1) ,
+	BUILTIN_FWORD(FCODE_V2,		"fcode-version2", fw_start1) ,
+	BUILTIN_FWORD(FCODE_V3,		"fcode-version3", fw_start1) ,
+	BUILTIN_FWORD(FCODE_END,	"fcode-end", fw_end0) ,
 
         /*  Support for IBM-style Locals  */
-	BI_FWD_STRING(CURLY_BRACE,	"{") ,
-	BI_FWD_STRING(DASH_ARROW,	"->") ,
-	BUILTIN_FWORD(EXIT,		"exit") ,
+	BI_FWD_STRING(CURLY_BRACE,	"{", fw_other) ,
+	BI_FWD_STRING(DASH_ARROW,	"->", fw_other) ,
+	BUILTIN_FWORD(EXIT,		"exit", fw_exit) ,
 
 
-	BUILTIN_FWORD(CHAR,		"char") ,
-	BUILTIN_FWORD(CCHAR,		"[char]") ,
-	BI_FWD_STRING(ABORTTXT,		"abort\"") ,
+	BUILTIN_FWORD(CHAR,		"char", fw_char) ,
+	BUILTIN_FWORD(CCHAR,		"[char]", fw_cchar) ,
+	BI_FWD_STRING(ABORTTXT,		"abort\"", fw_other) ,
 
-	BUILTIN_FWORD(ENCODEFILE,	"encode-file") ,
+	BUILTIN_FWORD(ENCODEFILE,	"encode-file", fw_encodefile) ,
 
-	BI_IG_FW_HDLR(ESCAPETOK,	"tokenizer[") ,
-	BI_IG_FW_HDLR(ESCAPETOK,	"f[") ,       /*  An IBM-ish synonym  */
+	BI_IG_FW_HDLR(ESCAPETOK,	"tokenizer[", fw_escapetok) ,
+	BI_IG_FW_HDLR(ESCAPETOK,	"f[", fw_escapetok) ,       /*  An IBM-ish synonym  */
 };
 
 static const int number_of_builtin_fwords =
@@ -1600,38 +1694,38 @@ static const int number_of_builtin_fwords =
  **************************************************************************** */
 
 static tic_fwt_hdr_t shared_words_list[] = {
-	SHARED_FWORD(FLOAD,		"fload") ,
+	SHARED_FWORD(FLOAD,		"fload", fw_fload) ,
 	/*  As does the "Allow Multi-Line" directive   */
-	SHR_SAMIG_FWRD(ALLOW_MULTI_LINE, "multi-line") ,
+	SHR_SAMIG_FWRD(ALLOW_MULTI_LINE, "multi-line", fw_allow_multi_line) ,
 
-	SHR_FWD_SKOW( F_BRACK_TICK,	 "f[']") ,
+	SHR_FWD_SKOW( F_BRACK_TICK,	 "f[']", fw_f_brack_tick) ,
 
-	SH_FW_SK2WIL(ALIAS, 		"alias") ,
-	SHARED_FWORD(DECIMAL,		"decimal") ,
-	SHARED_FWORD(HEX,		"hex") ,
-	SHARED_FWORD(OCTAL,		"octal") ,
-	SH_FW_SK_WIL(HEXVAL,		"h#") ,
-	SH_FW_SK_WIL(DECVAL,		"d#") ,
-	SH_FW_SK_WIL(OCTVAL,		"o#") ,
+	SH_FW_SK2WIL(ALIAS, 		"alias", fw_alias) ,
+	SHARED_FWORD(DECIMAL,		"decimal", fw_decimal) ,
+	SHARED_FWORD(HEX,		"hex", fw_hex) ,
+	SHARED_FWORD(OCTAL,		"octal", fw_octal) ,
+	SH_FW_SK_WIL(HEXVAL,		"h#", fw_hexval) ,
+	SH_FW_SK_WIL(DECVAL,		"d#", fw_decval) ,
+	SH_FW_SK_WIL(OCTVAL,		"o#", fw_octval) ,
 
-	SH_FW_SK_WIL(ASC_NUM,		"a#") ,
-	SH_FW_SK_WIL(ASC_LEFT_NUM,	"al#") ,
+	SH_FW_SK_WIL(ASC_NUM,		"a#", fw_asc_num) ,
+	SH_FW_SK_WIL(ASC_LEFT_NUM,	"al#", fw_asc_num) ,
 
 	/* IBM-style extension.  Might be generalizable...  */
-	SHARED_FWORD(FLITERAL, 	"fliteral") ,
+	SHARED_FWORD(FLITERAL, 	"fliteral", fw_fliteral) ,
 
 	/*  Directives to extract the value of a Command-Line symbol */
-	SH_FW_SK_WIL(DEFINED,		"[defined]") ,
-	SH_FW_SK_WIL(DEFINED,		"#defined") ,
-	SH_FW_SK_WIL(DEFINED,		"[#defined]") ,
+	SH_FW_SK_WIL(DEFINED,		"[defined]", fw_defined) ,
+	SH_FW_SK_WIL(DEFINED,		"#defined", fw_defined) ,
+	SH_FW_SK_WIL(DEFINED,		"[#defined]", fw_defined) ,
 
 	/*  Present the current date or time, either as an  */
 	/*  in-line string or as a user-generated message.  */
-	SHARED_FWORD(FCODE_DATE,	"[fcode-date]") ,
-	SHARED_FWORD(FCODE_TIME,	"[fcode-time]") ,
+	SHARED_FWORD(FCODE_DATE,	"[fcode-date]", fw_fcode_date) ,
+	SHARED_FWORD(FCODE_TIME,	"[fcode-time]", fw_fcode_date) ,
 
 	/*  Current definition under construction, similarly  */
-	SHARED_FWORD(FUNC_NAME,	"[function-name]"),
+	SHARED_FWORD(FUNC_NAME,	"[function-name]", fw_func_name),
 
 	/*  Synonymous forms of the #ELSE and #THEN operators,
 	 *      associated with Conditional-Compilation,
@@ -1640,67 +1734,80 @@ static tic_fwt_hdr_t shared_words_list[] = {
 	 */
 
 	/*  #ELSE  operators */
-	SHARED_FWORD(CONDL_ELSE,	"#else") ,
-	SHARED_FWORD(CONDL_ELSE,	"[else]") ,
-	SHARED_FWORD(CONDL_ELSE,	"[#else]") ,
+	SHARED_FWORD(CONDL_ELSE,	"#else", fw_condl_ender) ,
+	SHARED_FWORD(CONDL_ELSE,	"[else]", fw_condl_ender) ,
+	SHARED_FWORD(CONDL_ELSE,	"[#else]", fw_condl_ender) ,
 
 	/*  #THEN  operators */
-	SHARED_FWORD(CONDL_ENDER,	"#then") ,
-	SHARED_FWORD(CONDL_ENDER,	"[then]") ,
-	SHARED_FWORD(CONDL_ENDER,	"[#then]") ,
+	SHARED_FWORD(CONDL_ENDER,	"#then", fw_condl_ender) ,
+	SHARED_FWORD(CONDL_ENDER,	"[then]", fw_condl_ender) ,
+	SHARED_FWORD(CONDL_ENDER,	"[#then]", fw_condl_ender) ,
 	/*   #ENDIF variants for users who favor C-style notation   */
-	SHARED_FWORD(CONDL_ENDER,	"#endif") ,
-	SHARED_FWORD(CONDL_ENDER,	"[endif]") ,
-	SHARED_FWORD(CONDL_ENDER,	"[#endif]") ,
+	SHARED_FWORD(CONDL_ENDER,	"#endif", fw_condl_ender) ,
+	SHARED_FWORD(CONDL_ENDER,	"[endif]", fw_condl_ender) ,
+	SHARED_FWORD(CONDL_ENDER,	"[#endif]", fw_condl_ender) ,
 
 
-	SHARED_FWORD(OVERLOAD,  "overload" ) ,
+	SHARED_FWORD(OVERLOAD,  "overload", fw_overload) ,
 
-	SHARED_FWORD(GLOB_SCOPE , "global-definitions" ) ,
-	SHARED_FWORD(DEV_SCOPE , "device-definitions" ) ,
+	SHARED_FWORD(GLOB_SCOPE , "global-definitions", fw_glob_scope) ,
+	SHARED_FWORD(DEV_SCOPE , "device-definitions", fw_dev_scope) ,
 
 	/*  Directives to change a command-line flag value from source   */
-	SH_FW_SK_WIL(CL_FLAG,	"[FLAG]") ,
-	SH_FW_SK_WIL(CL_FLAG,	"#FLAG") ,
-	SH_FW_SK_WIL(CL_FLAG,	"[#FLAG]") ,
+	SH_FW_SK_WIL(CL_FLAG,	"[FLAG]", fw_cl_flag) ,
+	SH_FW_SK_WIL(CL_FLAG,	"#FLAG", fw_cl_flag) ,
+	SH_FW_SK_WIL(CL_FLAG,	"[#FLAG]", fw_cl_flag) ,
 
 	/*  Directives to force display of a command-line flags' values   */
-	SHARED_FWORD(SHOW_CL_FLAGS,	"[FLAGS]") ,
-	SHARED_FWORD(SHOW_CL_FLAGS,	"#FLAGS") ,
-	SHARED_FWORD(SHOW_CL_FLAGS,	"[#FLAGS]") ,
-	SHARED_FWORD(SHOW_CL_FLAGS,	"SHOW-FLAGS") ,
+	SHARED_FWORD(SHOW_CL_FLAGS,	"[FLAGS]", fw_show_cl_flags) ,
+	SHARED_FWORD(SHOW_CL_FLAGS,	"#FLAGS", fw_show_cl_flags) ,
+	SHARED_FWORD(SHOW_CL_FLAGS,	"[#FLAGS]", fw_show_cl_flags) ,
+	SHARED_FWORD(SHOW_CL_FLAGS,	"SHOW-FLAGS", fw_show_cl_flags) ,
 
 	/*  Directives to save and retrieve the FCode Assignment number  */
-	SHARED_FWORD(PUSH_FCODE,	"FCODE-PUSH") ,
-	SHARED_FWORD(POP_FCODE, 	"FCODE-POP") ,
+	SHARED_FWORD(PUSH_FCODE,	"FCODE-PUSH", fw_push_fcode) ,
+	SHARED_FWORD(POP_FCODE, 	"FCODE-POP", fw_pop_fcode) ,
 
 	/*  Directive to reset the FCode Assignment number and
 	 *      re-initialize FCode Range overlap checking.
 	 */
-	SHARED_FWORD(RESET_FCODE,	"FCODE-RESET") ,
+	SHARED_FWORD(RESET_FCODE,	"FCODE-RESET", fw_reset_fcode) ,
 
 	/* pci header generation is done differently 
 	 * across the available tokenizers. We try to
 	 * be compatible to all of them
 	 */
-	SHARED_FWORD(PCIHDR,	  "pci-header") ,
-	SHARED_FWORD(PCIEND,	  "pci-end") ,           /* SUN syntax */
-	SHARED_FWORD(PCIEND,	  "pci-header-end") ,    /* Firmworks syntax */
-	SHARED_FWORD(PCIREV,	  "pci-revision") ,      /* SUN syntax */
-	SHARED_FWORD(PCIREV,	  "pci-code-revision") , /* SUN syntax */
-	SHARED_FWORD(PCIREV,	  "set-rev-level") ,     /* Firmworks syntax */
-	SHARED_FWORD(NOTLAST,	  "not-last-image") ,
-	SHARED_FWORD(NOTLAST,	  "not-last-img") ,      /* Shorthand form  */
-	SHARED_FWORD(ISLAST,	  "last-image") ,
-	SHARED_FWORD(ISLAST,	  "last-img") ,          /* Shorthand form  */
-	SHARED_FWORD(SETLAST,	  "set-last-image") ,
-	SHARED_FWORD(SETLAST,	  "set-last-img") ,      /* Shorthand form  */
-
-	SH_FW_SK_WIL(SAVEIMG,	  "save-image") ,
-	SH_FW_SK_WIL(SAVEIMG,	  "save-img") ,          /* Shorthand form  */
-
-	SHARED_FWORD(RESETSYMBS,  "reset-symbols") ,
+	SHARED_FWORD(PCIHDR,	  "pci-header", fw_pcihdr) ,
+	SHARED_FWORD(PCIEND,	  "pci-end", fw_pciend) ,           /* SUN syntax */
+	SHARED_FWORD(PCIEND,	  "pci-header-end", fw_pciend) ,    /* Firmworks syntax */
+	SHARED_FWORD(PCIREV,	  "pci-revision", fw_pcirev) ,      /* SUN syntax */
+	SHARED_FWORD(PCIREV,	  "pci-code-revision", fw_pcirev) , /* SUN syntax */
+	SHARED_FWORD(PCIREV,	  "set-rev-level", fw_pcirev) ,     /* Firmworks syntax */
+	SHARED_FWORD(NOTLAST,	  "not-last-image", fw_setlast) ,
+	SHARED_FWORD(NOTLAST,	  "not-last-img", fw_setlast) ,      /* Shorthand form  */
+	SHARED_FWORD(ISLAST,	  "last-image", fw_setlast) ,
+	SHARED_FWORD(ISLAST,	  "last-img", fw_setlast) ,          /* Shorthand form  */
+	SHARED_FWORD(SETLAST,	  "set-last-image", fw_setlast) ,
+	SHARED_FWORD(SETLAST,	  "set-last-img", fw_setlast) ,      /* Shorthand form  */
+
+	SH_FW_SK_WIL(SAVEIMG,	  "save-image", fw_saveimg) ,
+	SH_FW_SK_WIL(SAVEIMG,	  "save-img", fw_saveimg) ,          /* Shorthand form  */
+
+	SHARED_FWORD(RESETSYMBS,  "reset-symbols", fw_resetsymbs) ,
+};
+
+static const int number_of_shared_words =
+	sizeof(shared_words_list)/sizeof(tic_hdr_t);
+
+/* **************************************************************************
+ *
+ *      The "Shared Words" whose param field is a literal value rather
+ *          than an FWord Token are kept in a list of their own, which
+ *          is linked right after the other "Shared Words".
+ *
+ **************************************************************************** */
 
+static tic_fwt_hdr_t shared_ig_hdlrs_list[] = {
 	/*  User-Macro definers    */
 	SHARED_IG_HDLR("[MACRO]", add_user_macro,  0 ,  skip_user_macro) ,
 
@@ -1715,8 +1822,77 @@ static tic_fwt_hdr_t shared_words_list[] = {
 	SHARED_IG_HDLR("#MESSAGE\"", user_message, '"' , skip_user_message) ,
 };
 
-static const int number_of_shared_words =
-	sizeof(shared_words_list)/sizeof(tic_hdr_t);
+static const int number_of_shared_ig_hdlrs =
+	sizeof(shared_ig_hdlrs_list)/sizeof(tic_hdr_t);
+
+/* **************************************************************************
+ *
+ *      The handler of each FWord Token, as given in the "FWords" and
+ *          "Shared Words" lists, indexed by the Token.  It is filled in
+ *          from the lists themselves when they are initialized, and is
+ *          used to recognize an entry -- or an alias to one -- whose
+ *          FUNCT is the handler of its FWord.
+ *
+ **************************************************************************** */
+
+static void (*fword_functs[FCODE_END+1])( tic_param_t);
+
+/* **************************************************************************
+ *
+ *      Function name:  note_fword_functs
+ *      Synopsis:       Record the handler of each FWord Token in a list
+ *
+ *      Inputs:
+ *         Parameters:
+ *             tic_vocab_tbl       Pointer to the initial TIC_HDR vocab array
+ *             max_indx            Number of entries in the array
+ *
+ *      Outputs:
+ *         Returned Value:         NONE
+ *         Local Static Variables:
+ *             fword_functs        Entries for the list's Tokens filled in
+ *
+ **************************************************************************** */
+
+static void note_fword_functs( tic_hdr_t *tic_vocab_tbl, int max_indx)
+{
+    int indx;
+    for ( indx = 0 ; indx < max_indx ; indx++ )
+    {
+	fwtoken tok = tic_vocab_tbl[indx].pfield.fw_token;
+	fword_functs[tok] = tic_vocab_tbl[indx].funct;
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  is_fword_funct
+ *      Synopsis:       Indicate whether the given entry's FUNCT is the
+ *                          handler of its FWord.  (Formerly, this was a
+ *                          comparison with  handle_internal ...)
+ *
+ *      Inputs:
+ *         Parameters:
+ *             t_entry              Pointer to the  tic_hdr_t  -type entry
+ *         Local Static Variables:
+ *             fword_functs         The handler of each FWord Token
+ *
+ *      Outputs:
+ *         Returned Value:          TRUE if the entry's FUNCT is the handler
+ *                                      for the FWord Token in its param
+ *
+ **************************************************************************** */
+
+bool is_fword_funct( tic_hdr_t *t_entry)
+{
+    bool retval = false;
+    unsigned long tok = (unsigned long)t_entry->pfield.fw_token;
+    if ( tok <= FCODE_END )
+    {
+	retval = ( t_entry->funct == fword_functs[tok] );
+    }
+    return ( retval );
+}
 
 /* **************************************************************************
  *
@@ -1779,11 +1955,6 @@ tic_hdr_t *lookup_shared_word( char *tname)
  *             tname                     The name to look for
  *         Local Static Variables:
  *             global_voc_dict_ptr       "Tail" of Global Vocabulary
- *         Macro Definitions:
- *             FWORD_EXEC_FUNC           The "Active" function of the
- *                                           sub-class of "Shared Word"s
- *                                           that is the object of this
- *                                           routine's search
  *
  *      Outputs:
  *         Returned Value:                Pointer to the data-structure, or
@@ -1791,7 +1962,7 @@ tic_hdr_t *lookup_shared_word( char *tname)
  *
  *      Process Explanation:
  *          The "Shared F-Exec Words" are the subset of "Shared Words" that
- *              have the  FWORD_EXEC_FUNC  as their "Active" function.
+ *              have the handler of their FWord as their "Active" function.
  *
  *      Extraneous Remarks:
  *          This is the only routine that requires a check of two fields;
@@ -1808,7 +1979,7 @@ tic_hdr_t *lookup_shared_f_exec_word( char *tname)
     found = lookup_shared_word( tname );
     if ( found != NULL )
     {
-	if ( found->funct == FWORD_EXEC_FUNC )
+	if ( is_fword_funct( found) )
 	{
 	    retval = found ;
 	}
@@ -1837,6 +2008,8 @@ tic_hdr_t *lookup_shared_f_exec_word( char *tname)
  *             number_of_builtin_fwords        Number of "FWord" entries
  *             shared_words_list               Base of the "Shared Words" list
  *             number_of_shared_words          Number of "Shared Words" entries
+ *             shared_ig_hdlrs_list            "Shared Words" with literal params
+ *             number_of_shared_ig_hdlrs       Number of those entries
  *
  *      Outputs:
  *         Returned Value:                      NONE
@@ -1846,12 +2019,14 @@ tic_hdr_t *lookup_shared_f_exec_word( char *tname)
  *             fc_tokens_list_ender             End of "FC-Tokens" search
  *             shared_fwords_ender              End of Shared Words" search
  *             global_voc_reset_ptr             Reset-point for Global Vocab
+ *             fword_functs                     Handler of each FWord Token
  *
  *      Process Explanation:
  *          The first linked will be the last searched.
  *              Link the "FC-Tokens" first, and mark their limits
- *              Link the "FWords" next,
- *              Mark the end-limit of the "Shared Words", and link them
+ *              Link the "FWords" next, noting the handler of each Token
+ *              Mark the end-limit of the "Shared Words", and link them,
+ *                  likewise; then those with literal params
  *              The "Conditionals", defined in another file, are also "Shared";
  *                  link them next.
  *              Then link the Built-In Macros, also defined in another file.
@@ -1878,15 +2053,20 @@ void init_dictionary( void )
     fc_tokens_list_start = global_voc_dict_ptr;
 
     /*  Link the "FWords" next */
+    note_fword_functs( (tic_hdr_t *)fwords_list, number_of_builtin_fwords);
    init_tic_vocab( (tic_hdr_t *)fwords_list,
                         number_of_builtin_fwords,
                             &global_voc_dict_ptr ) ;
 
     /*  Mark the end-limit of the "Shared Words", and link them. */
     shared_fwords_ender = global_voc_dict_ptr;
+    note_fword_functs( (tic_hdr_t *)shared_words_list, number_of_shared_words);
     init_tic_vocab( (tic_hdr_t *)shared_words_list,
                 	number_of_shared_words,
                             &global_voc_dict_ptr ) ;
+    init_tic_vocab( (tic_hdr_t *)shared_ig_hdlrs_list,
+                	number_of_shared_ig_hdlrs,
+                            &global_voc_dict_ptr ) ;
 
     /*  Link the "Conditionals" to the Global Vocabulary.  */
     init_conditionals_vocab( &global_voc_dict_ptr ) ;
@@ -35,8 +35,8 @@
 
 /* **************************************************************************
  *
- *      Numeric values for FWord-type vocabulary entries.  Used by the
- *          big "switch" statement in handle_internal(); a subset are 
+ *      Numeric values for FWord-type vocabulary entries.  Used to select
+ *          the handler for each FWord in scanner.c; a subset are 
  *          also used as "definer-type" values associated with various
  *          types of definitions.
  *
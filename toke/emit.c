@@ -49,6 +49,7 @@
 #include <unistd.h>
 
 #include "pcihdr.h"
+#include "fcsum.h"
 
 #include "toke.h"
 #include "vocabfuncts.h"
@@ -59,6 +60,8 @@
 #include "errhandler.h"
 #include "stream.h"
 #include "nextfcode.h"
+#include "fcimage.h"
+#include "sizemap.h"
 
 /* **************************************************************************
  *
@@ -182,6 +185,48 @@ static void emit_byte(u8 data)
 	opc++;
 }
 
+/* **************************************************************************
+ *
+ *      Function name:  emit_block
+ *      Synopsis:       Place a block of bytes into the Output Buffer
+ *                          with as few copies as possible.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             data               Pointer to the bytes to place
+ *             cnt                Number of bytes
+ *
+ *      Outputs:
+ *         Returned Value:        NONE
+ *         Global Variables:
+ *             opc                Advanced by  cnt
+ *
+ *      Process Explanation:
+ *          Copy as much as fits, expand the buffer, and repeat.  The
+ *              buffer is expanded at the same Output Position it would
+ *              have been by a series of calls to  emit_byte() , so the
+ *              Advisory for the expansion is unchanged.
+ *
+ **************************************************************************** */
+
+void emit_block(u8 *data, unsigned int cnt)
+{
+	while ( cnt > 0 )
+	{
+	    unsigned int room;
+	    if ( opc == olen)
+	    {
+		increase_output_buffer();
+	    }
+	    room = olen - opc;
+	    if ( room > cnt )  room = cnt;
+	    memcpy( ostart+opc, data, room);
+	    opc  += room;
+	    data += room;
+	    cnt  -= room;
+	}
+}
+
 void emit_fcode(u16 tok)
 {
 	if ((tok>>8))
@@ -212,6 +257,7 @@ static void emit_num32(u32 num)
 void user_emit_byte(u8 data)
 {
 	emit_byte( data);
+	note_raw_emission();
 	fcode_written = true;
 }
 
@@ -231,7 +277,6 @@ void emit_literal(u32 num)
 
 void emit_string(u8 *string, signed int cnt)
 {
-	signed int i=0;
 	signed int cnt_cpy = cnt;
 	
 	if ( cnt_cpy > STRING_LEN_MAX )
@@ -241,8 +286,25 @@ void emit_string(u8 *string, signed int cnt)
 	    cnt_cpy = STRING_LEN_MAX ;
 	}
 	emit_byte(cnt_cpy);
-	for (i=0; i<cnt_cpy; i++)
-		emit_byte(string[i]);
+	emit_block(string, cnt_cpy);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  emit_string_literal
+ *      Synopsis:       Place a string literal, i.e., a  b(")  followed
+ *                          by the counted string, into the Output Buffer,
+ *                          and count its bytes for the Size-Map.
+ *
+ **************************************************************************** */
+
+void emit_string_literal(u8 *string, signed int cnt)
+{
+	unsigned int lit_start = opc;
+
+	emit_token("b(\")");
+	emit_string(string, cnt);
+	note_string_literal( opc - lit_start);
 }
 
 void emit_fcodehdr(const char *starter_name)
@@ -267,6 +329,7 @@ void emit_fcodehdr(const char *starter_name)
 	EMIT_STRUCT(fcode_header_t);
 
 	fcode_body_ob_off = opc;
+	start_size_map( fcode_start_ob_off, fcode_body_ob_off);
 
 	/* Format = 8 means we comply with IEEE 1275-1994 */
 	fcode_hdr->format = 0x08;
@@ -285,6 +348,9 @@ void emit_fcodehdr(const char *starter_name)
  *          Print a WARNING message if the end-of-file was encountered
  *              without an end0 or an fcode-end
  *
+ *          Show the Size-Map of the image, if one was requested, with
+ *              the sizes as they were before any Whole-Image passes.
+ *
  *          Print an informative message to standard-output giving the
  *              checksum.  Call  list_fcode_ranges()  to print the
  *              value of the last FCode-token that was assigned or
@@ -317,31 +383,47 @@ void finish_fcodehdr(void)
 	/*  Calculate and place checksum and length, if haven't already  */
 	if ( fcode_start_ob_off != -1 )
 	{
-	    u32 checksum;
+	    u16 checksum;
 	    int length;
+	    u8 *fcode_body;
+	    u8 *ob_end;
+	    fcode_header_t *fcode_hdr;
+	    unsigned int tokenized_end = opc;
 
-	    u8 *fcode_body = ostart+fcode_body_ob_off;
-	    u8 *ob_end = ostart+opc;
-	    fcode_header_t *fcode_hdr =
-	         (fcode_header_t *)(ostart+fcode_hdr_ob_off);
+	    /*  Apply the Whole-Image passes, if any, to the body  */
+	    if ( image_passes_wanted() )
+	    {
+		u8 *nu_body;
+		unsigned int nu_len;
+		if ( run_image_passes( ostart+fcode_body_ob_off,
+			 fcode_body_ob_off, opc - fcode_body_ob_off,
+			     &nu_body, &nu_len) )
+		{
+		    unsigned int indx;
+		    opc = fcode_body_ob_off;
+		    for ( indx = 0 ; indx < nu_len ; indx++ )
+		    {
+			emit_byte( nu_body[indx]);
+		    }
+		}
+	    }
+	    finish_size_map( tokenized_end, opc);
+
+	    fcode_body = ostart+fcode_body_ob_off;
+	    ob_end = ostart+opc;
+	    fcode_hdr = (fcode_header_t *)(ostart+fcode_hdr_ob_off);
 	
 	    length = opc - fcode_start_ob_off;
 
-	    for ( checksum = 0;
-	              fcode_body < ob_end ;
-		          checksum += *(fcode_body++) ) ;
-
-	    if (sun_style_checksum) {
-		/* SUN OPB on the SPARC (Enterprise) platforms (especially):
-                 * M3000, M4000, M9000 expects a checksum algorithm that is
-                 * not compliant with IEEE 1275-1994 section 5.2.2.5.
-		 */
-		checksum = (checksum & 0xffff) + (checksum >> 16);
-		checksum = (checksum & 0xffff) + (checksum >> 16);
-	    }
+	    /* SUN OPB on the SPARC (Enterprise) platforms (especially):
+	     * M3000, M4000, M9000 expects a checksum algorithm that is
+	     * not compliant with IEEE 1275-1994 section 5.2.2.5.
+	     */
+	    checksum = fold_fcode_checksum(
+			   fcode_byte_sum(fcode_body, ob_end - fcode_body),
+			       sun_style_checksum);
 
-	    BIG_ENDIAN_WORD_STORE(fcode_hdr->checksum, 
-		    (u16)(checksum & 0xffff));
+	    BIG_ENDIAN_WORD_STORE(fcode_hdr->checksum, checksum);
 	    BIG_ENDIAN_LONG_STORE(fcode_hdr->length , length);
 
 	if (verbose)
@@ -84,6 +84,8 @@ typedef struct {
  *       This is a generous allotment for the buffer into which
  *           input strings are gathered.  Overflow calculations are
  *           also based on it.  It may be changed safely.
+ *       It is only the starting size for quoted strings, though:
+ *           get_string()  enlarges the buffer as needed.
  *       We like to keep it a nice power-of-two to make the memory-
  *           allocation routine run efficiently and happily (Okay, so
  *           that's anthropormism:  It's efficient and *we*'re happy.
@@ -109,11 +111,13 @@ extern unsigned int pci_hdr_end_ob_off;
  *
  **************************************************************************** */
 
+void  emit_block(u8 *data, unsigned int cnt);
 void  emit_fcode(u16 tok);
 void  user_emit_byte(u8 data);
 
 void  emit_offset(s16 offs);
 void  emit_string(u8 *string, signed int cnt);
+void  emit_string_literal(u8 *string, signed int cnt);
 void  emit_fcodehdr(const char *starter_name);
 void  finish_fcodehdr(void);
 void  emit_pcihdr(void);
@@ -0,0 +1,2786 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                         ( FCode tokenizer )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Whole-Image passes over the buffered FCode of a finished image.
+ *
+ *      The Output Buffer holds the entire Binary Output until the file
+ *          is closed, so by the time an image is finished (end0 or
+ *          fcode-end, or end-of-file) its body -- everything between
+ *          the FCode Header and the end-token -- is available to be
+ *          examined as a whole.  The routines in this module read the
+ *          body back into a list of tokens ("items") and definitions,
+ *          apply whichever of the optional passes are enabled, and
+ *          write out a replacement body.  The calling routine replaces
+ *          the body in the Output Buffer before the FCode Header's
+ *          length and checksum are calculated.
+ *
+ *      The passes rely on the body being FCode as this Tokenizer writes
+ *          it.  If the user has placed arbitrary bytes into the output
+ *          (via  emit-byte  in Tokenizer-Escape mode) or the body does
+ *          not parse cleanly, the image is left exactly as it was.
+ *
+ **************************************************************************** */
+
+/* **************************************************************************
+ *
+ *      Functions Exported:
+ *          start_image_notes      Clear the notes collected for an image
+ *                                     at the start of a new image.
+ *          note_definition        Record the name and placement of a new
+ *                                     definition as it is being created.
+ *          note_pinned_fcode      Record that an FCode number has been
+ *                                     exposed as a number (e.g., by F['] )
+ *          note_raw_emission      Record that raw bytes have been written.
+ *          image_passes_wanted    Indicate whether any pass is enabled.
+ *          run_image_passes       Apply the enabled passes to an image body.
+ *
+ **************************************************************************** */
+
+/* **************************************************************************
+ *
+ *      Passes supported:
+ *
+ *      Drop-Unused-Headerless
+ *          Build the reference-graph of the definitions in the image and
+ *              drop every headerless definition that cannot be reached
+ *              from the image's top-level (interpretation-state) code or
+ *              from a headered or external definition.  A definition
+ *              whose token is the object of  b(')  (i.e., of  '  or  ['] )
+ *              or whose number was exposed by  F[']  is kept regardless.
+ *          The stack-effect of a dropped data-definition is preserved:
+ *              b(constant)  b(value)  and  b(buffer:)  are replaced by a
+ *              drop  and  b(field)  by a  +  ; a  b(create)  is never
+ *              dropped because the code that follows it may be building
+ *              its data-space.  An  instance  prefix goes with its
+ *              definition.
+ *          The FCode numbers of the definitions that remain are then
+ *              compacted, to close the holes the dropped definitions
+ *              left.  Each run of consecutively-assigned numbers keeps
+ *              its starting number; if the same number was assigned to
+ *              more than one definition in the image (an intentionally
+ *              "recycled" Range) the numbers are left as they were.
+ *
+ *      Inline-Tiny-Headerless
+ *          Expand calls to very small headerless colon-definitions in
+ *              place, i.e., write a copy of the body of the definition
+ *              instead of the call.  A definition qualifies if its body,
+ *              with its own inline expansions, is no larger than a
+ *              threshold, and contains no branches and no Return-Stack or
+ *              loop-frame tokens.  Only calls from within the bodies of
+ *              colon-definitions are expanded.  A definition that is left
+ *              with no references is dropped.
+ *
+ *      Factor-Common-Sequences
+ *          Find sequences of tokens repeated within the bodies of
+ *              colon-definitions and replace each occurrence with a call
+ *              to a new headerless definition of the sequence.
+ *          The FCode numbers of the definitions are then reassigned in
+ *              order of placement, as for Dense-FCode-Numbers but without
+ *              closing the holes, so that each new definition is numbered
+ *              in sequence with the definitions around it.
+ *
+ *      Dense-FCode-Numbers
+ *          Reassign the FCode numbers of the definitions in the image
+ *              densely, starting from the first number the image was
+ *              given, so that the firmware's token table for the image
+ *              is no larger than it needs to be and an image that carries
+ *              on the numbering of an earlier one does not reuse its
+ *              numbers.  Every new-token, named-token and external-token,
+ *              and every reference to the tokens they define, is rewritten.
+ *          A number set explicitly by the User (with  next-fcode  or
+ *              fcode-pop ) is a hard constraint:  the definition that
+ *              follows keeps it, and dense assignment continues from it.
+ *              The definitions before it may be given more numbers than
+ *              their Range had only if that does not carry the Range into
+ *              another.  The ends of the Ranges, as recorded for the final
+ *              tally and the Overlap test, are moved to match the new
+ *              numbers.
+ *              A definition whose number was exposed by  F[']  also keeps
+ *              its number, and no other definition is given that number.
+ *          If an explicitly-set number would now displace a definition
+ *              that is still referenced, the image is left as it was.
+ *          This pass supersedes the compaction done after dropping unused
+ *              definitions.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "toke.h"
+#include "fcimage.h"
+#include "clflags.h"
+#include "errhandler.h"
+#include "nextfcode.h"
+#include "stream.h"
+#include "vocabfuncts.h"
+
+/* **************************************************************************
+ *
+ *          Global Variables Exported
+ *              factor_min_savings     Least number of bytes that factoring
+ *                                         out a common sequence must save
+ *              inline_max_bytes       Largest body of a definition that
+ *                                         will be expanded in place
+ *
+ **************************************************************************** */
+
+int factor_min_savings = FACTOR_MIN_SAVINGS_DEFAULT;
+int inline_max_bytes = INLINE_MAX_BYTES_DEFAULT;
+
+/* **************************************************************************
+ *
+ *          Global Variables Imported
+ *              verbose            Print the pass reports
+ *              iname              Current input file name, for the notes
+ *              lineno             Current line number, for the notes
+ *              nextfcode          FCode-token Assignment Counter
+ *
+ **************************************************************************** */
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          fc_role_t             What an FCode token signifies to the
+ *                                    passes:  the form of its operand
+ *                                    and its part in a definition.
+ *
+ **************************************************************************** */
+
+typedef enum fc_role {
+	ROLE_PLAIN = 0 ,     /*  No operand, no special significance      */
+	ROLE_LITERAL ,       /*  b(lit)  Four-byte operand                */
+	ROLE_TICK ,          /*  b(')    FCode-token operand              */
+	ROLE_TO ,            /*  b(to)   FCode-token operand              */
+	ROLE_STRING ,        /*  b(")    Counted-string operand           */
+	ROLE_BRANCH ,        /*  FCode-offset operand                     */
+	ROLE_NEW_TOKEN ,     /*  new-token  FCode-token operand           */
+	ROLE_NAMED_TOKEN ,   /*  named- or external- -token:  string and
+			      *      FCode-token operands                 */
+	ROLE_OFFSET16 ,      /*  Switch to 16-bit offsets                 */
+	ROLE_COLON ,         /*  b(:)                                     */
+	ROLE_SEMICOLON ,     /*  b(;)                                     */
+	ROLE_DEFINER ,       /*  Definers of data words                   */
+	ROLE_INSTANCE ,      /*  instance                                 */
+	ROLE_RSTACK ,        /*  Uses the Return Stack or the loop frame  */
+	ROLE_CASE ,          /*  b(case)  b(endcase)                      */
+	ROLE_ENDER           /*  end0  end1                               */
+} fc_role_t;
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          fc_special_t          The FCode tokens that are significant
+ *                                    to the passes, by name.
+ *
+ *   Fields:
+ *       name                 Name of the token, as in the Tokens Table
+ *       role                 What the token signifies
+ *       stand_in             For data-definers, the token that preserves
+ *                                the stack-effect of a dropped definition:
+ *                                An empty string if none is needed, or
+ *                                NULL if the definition must be kept.
+ *
+ *      The FCode numbers are taken from the Tokens Table by name, so
+ *          that the names remain the single source of the numbers.
+ *
+ **************************************************************************** */
+
+typedef struct fc_special {
+	char        *name;
+	fc_role_t    role;
+	char        *stand_in;
+} fc_special_t;
+
+static const fc_special_t fc_specials[] = {
+	{ "b(lit)" ,		ROLE_LITERAL ,		NULL } ,
+	{ "b(')" ,		ROLE_TICK ,		NULL } ,
+	{ "b(to)" ,		ROLE_TO ,		NULL } ,
+	{ "b(\")" ,		ROLE_STRING ,		NULL } ,
+	{ "bbranch" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b?branch" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b(loop)" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b(+loop)" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b(do)" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b(?do)" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b(of)" ,		ROLE_BRANCH ,		NULL } ,
+	{ "b(endof)" ,		ROLE_BRANCH ,		NULL } ,
+	{ "new-token" ,		ROLE_NEW_TOKEN ,	NULL } ,
+	{ "named-token" ,	ROLE_NAMED_TOKEN ,	NULL } ,
+	{ "external-token" ,	ROLE_NAMED_TOKEN ,	NULL } ,
+	{ "offset16" ,		ROLE_OFFSET16 ,		NULL } ,
+	{ "b(:)" ,		ROLE_COLON ,		""   } ,
+	{ "b(;)" ,		ROLE_SEMICOLON ,	NULL } ,
+	{ "b(value)" ,		ROLE_DEFINER ,		"drop" } ,
+	{ "b(constant)" ,	ROLE_DEFINER ,		"drop" } ,
+	{ "b(buffer:)" ,	ROLE_DEFINER ,		"drop" } ,
+	{ "b(field)" ,		ROLE_DEFINER ,		"+" } ,
+	{ "b(variable)" ,	ROLE_DEFINER ,		""   } ,
+	{ "b(defer)" ,		ROLE_DEFINER ,		""   } ,
+	{ "b(create)" ,		ROLE_DEFINER ,		NULL } ,
+	{ "instance" ,		ROLE_INSTANCE ,		NULL } ,
+	{ ">r" ,		ROLE_RSTACK ,		NULL } ,
+	{ "r>" ,		ROLE_RSTACK ,		NULL } ,
+	{ "r@" ,		ROLE_RSTACK ,		NULL } ,
+	{ "i" ,			ROLE_RSTACK ,		NULL } ,
+	{ "j" ,			ROLE_RSTACK ,		NULL } ,
+	{ "b(leave)" ,		ROLE_RSTACK ,		NULL } ,
+	{ "unloop" ,		ROLE_RSTACK ,		NULL } ,
+	{ "exit" ,		ROLE_RSTACK ,		NULL } ,
+	{ "b(case)" ,		ROLE_CASE ,		NULL } ,
+	{ "b(endcase)" ,	ROLE_CASE ,		NULL } ,
+	{ "end0" ,		ROLE_ENDER ,		NULL } ,
+	{ "end1" ,		ROLE_ENDER ,		NULL } ,
+};
+
+static const int number_of_specials =
+	sizeof(fc_specials)/sizeof(fc_special_t);
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          fc_item_t             One FCode token, with its operand,
+ *                                    as read back from the image body.
+ *
+ *   Fields:
+ *       ob_off               Offset of the token within the image body
+ *       length               Length of the token plus its operand
+ *       fcode                The FCode token
+ *       opnd_tok             FCode-token operand, if any
+ *       offset               Value of the FCode-offset operand, if any
+ *       offs_len             Size of the FCode-offset operand (1 or 2)
+ *       target               Index of the item that a branch targets
+ *       ref_defn             Index of the definition that the token (or
+ *                                its token operand) refers to; -1 if none
+ *       in_defn              Index of the definition of which the item
+ *                                is a part; -1 if at top-level.
+ *       replaced_by          Index of the factored definition that is
+ *                                called in place of a sequence starting
+ *                                with this item; -1 if none
+ *       consumed             TRUE if the item is part of a sequence that
+ *                                has been factored out
+ *       inlined              Index of the definition whose body is written
+ *                                in place of this call; -1 if none
+ *
+ **************************************************************************** */
+
+typedef struct fc_item {
+	unsigned int   ob_off;
+	unsigned int   length;
+	u16            fcode;
+	u16            opnd_tok;
+	s16            offset;
+	u8             offs_len;
+	int            target;
+	int            ref_defn;
+	int            in_defn;
+	int            replaced_by;
+	bool           consumed;
+	int            inlined;
+} fc_item_t;
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          fc_defn_t             One definition, as read back from the
+ *                                    image body.
+ *
+ *   Fields:
+ *       first_item           First item; the  instance  prefix, if any
+ *       tokn_item            The new-token, named-token or external-token
+ *       last_item            The definer, or the  b(;)  of a colon-def'n
+ *       fcode                FCode number assigned when tokenized
+ *       nu_fcode             FCode number after the passes
+ *       definer              The definer's FCode token
+ *       headerless           TRUE if created by  new-token
+ *       root                 TRUE if the definition must be kept
+ *                                regardless of references to it
+ *       reached              TRUE if reached by the reference-graph
+ *       dropped              TRUE if the definition has been dropped
+ *       anchored             TRUE if its number was set explicitly
+ *       synthetic            TRUE if made by factoring a common sequence;
+ *                                its first, token and last items are
+ *                                then all the item before which it is
+ *                                to be written
+ *       src_item             For a factored definition, the first item
+ *                                of the occurrence its body is copied from
+ *       src_count            The number of items in its body
+ *       inline_bytes         Size of its body, as written in place of a
+ *                                call; -1 if it is not to be so written
+ *       name                 Name from the notes, or NULL if unknown
+ *
+ **************************************************************************** */
+
+typedef struct fc_defn {
+	int            first_item;
+	int            tokn_item;
+	int            last_item;
+	u16            fcode;
+	u16            nu_fcode;
+	u16            definer;
+	bool           headerless;
+	bool           root;
+	bool           reached;
+	bool           dropped;
+	bool           anchored;
+	bool           synthetic;
+	int            src_item;
+	int            src_count;
+	int            inline_bytes;
+	char          *name;
+} fc_defn_t;
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          defn_note_t           What the Tokenizer knew about a definition
+ *                                    when it was created.
+ *
+ *   Fields:
+ *       ob_off               Position in the Output Buffer of its token
+ *       fcode                FCode number assigned
+ *       name                 Copy of its name
+ *       ifile                Copy of the input file name
+ *       line_no              Line number in the input file
+ *       anchored             TRUE if the number was set explicitly
+ *
+ **************************************************************************** */
+
+typedef struct defn_note {
+	unsigned int   ob_off;
+	u16            fcode;
+	char          *name;
+	char          *ifile;
+	unsigned int   line_no;
+	bool           anchored;
+} defn_note_t;
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          fc_range_move_t       The end of a Range of FCode numbers that
+ *                                    is to be moved once the image
+ *                                    has been rewritten.
+ *
+ *   Fields:
+ *       old_next             The number that followed its last assignment
+ *       nu_next              The number that follows it after renumbering
+ *
+ **************************************************************************** */
+
+typedef struct fc_range_move {
+	u16            old_next;
+	u16            nu_next;
+} fc_range_move_t;
+
+/* **************************************************************************
+ *
+ *          Internal Static Variables
+ *     special_of              For each FCode token, the index of its entry
+ *                                 in  fc_specials , or -1
+ *     specials_ready          TRUE once  special_of  has been filled in
+ *     drop_fcode              The  drop  token, for convenience
+ *
+ *     start_offs16            State of 16-bit offsets at start of image
+ *     image_first_fcode       The FCode-token Assignment Counter at the
+ *                                 start of the image; the first number
+ *                                 the image would be given
+ *     raw_emission            TRUE if raw bytes were written in the image
+ *     pinned_fcodes           Bit-map of FCode numbers exposed as numbers
+ *     defn_notes              Notes about definitions made in the image
+ *     num_notes               Number of notes in use
+ *     notes_size              Number of notes allocated
+ *
+ *     items                   The items read back from the image body
+ *     num_items               Number of items in use
+ *     items_size              Number of items allocated
+ *     defns                   The definitions read back from the body
+ *     num_defns               Number of definitions in use
+ *     defns_size              Number of definitions allocated
+ *     body_trailer            Offset in the body after the end-token
+ *     compacted_next          The next FCode number, if the numbers of
+ *                                 the image have already been compacted
+ *                                 and it was retracted; otherwise zero
+ *     planned_next            What the FCode-token Assignment Counter is
+ *                                 to become if the image is rewritten.
+ *                                 The Counter itself is not touched until
+ *                                 the replacement body has been written.
+ *     counter_follows         TRUE if the Counter continued from the last
+ *                                 number assigned in the image when the
+ *                                 image was finished
+ *     range_moves             Ends of earlier Ranges to be moved if
+ *                                 the image is rewritten
+ *     num_range_moves         Number of them in use
+ *
+ *     nu_body_buf             The replacement body under construction
+ *     nu_body_len             Its length so far
+ *     nu_body_size            Its allocated size
+ *
+ **************************************************************************** */
+
+static signed char special_of[FCODE_LIMIT+1];
+static bool specials_ready = false;
+static u16 drop_fcode;
+
+static bool start_offs16 = true;
+static u16 image_first_fcode = FCODE_START;
+static bool raw_emission = false;
+static u8 pinned_fcodes[(FCODE_LIMIT+1)/8];
+static defn_note_t *defn_notes = NULL;
+static int num_notes = 0;
+static int notes_size = 0;
+
+static fc_item_t *items = NULL;
+static int num_items = 0;
+static int items_size = 0;
+static fc_defn_t *defns = NULL;
+static int num_defns = 0;
+static int defns_size = 0;
+static unsigned int body_trailer;
+static u16 compacted_next = 0;
+static u16 planned_next = 0;
+static bool counter_follows = false;
+static fc_range_move_t *range_moves = NULL;
+static int num_range_moves = 0;
+
+static u8 *nu_body_buf = NULL;
+static unsigned int nu_body_len = 0;
+static unsigned int nu_body_size = 0;
+
+
+/* **************************************************************************
+ *
+ *      Function name:  fcode_by_name
+ *      Synopsis:       Return the FCode number of the named token
+ *                          from the Built-in Tokens Table.
+ *
+ *      Error Detection:
+ *          The name is hard-coded; if it's not found, that's FATAL.
+ *
+ **************************************************************************** */
+
+static u16 fcode_by_name( char *fc_name)
+{
+    tic_hdr_t *found = lookup_token( fc_name);
+    if ( found == NULL )
+    {
+	tokenization_error( FATAL, "Did not recognize FCode name %s", fc_name);
+    }
+    return ( (u16)found->pfield.deflt_elem );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  init_specials
+ *      Synopsis:       Fill in the  special_of  table, once.
+ *
+ **************************************************************************** */
+
+static void init_specials( void)
+{
+    if ( ! specials_ready )
+    {
+	int indx;
+	memset( special_of, -1, sizeof(special_of));
+	for ( indx = 0 ; indx < number_of_specials ; indx++ )
+	{
+	    special_of[fcode_by_name( fc_specials[indx].name)] = indx;
+	}
+	drop_fcode = fcode_by_name( "drop");
+	specials_ready = true;
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  role_of
+ *      Synopsis:       Return the role of the given FCode token.
+ *
+ **************************************************************************** */
+
+static fc_role_t role_of( u16 fcode)
+{
+    fc_role_t retval = ROLE_PLAIN;
+    if ( ( fcode <= FCODE_LIMIT ) && ( special_of[fcode] >= 0 ) )
+    {
+	retval = fc_specials[(int)special_of[fcode]].role;
+    }
+    return ( retval );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  start_image_notes
+ *      Synopsis:       Discard the notes collected for the previous image
+ *                          and record the state of the FCode-offset size
+ *                          at the start of a new one.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             is_offs16              TRUE if the image starts with 16-bit
+ *                                        FCode-offsets
+ *         Global Variables:
+ *             nextfcode              FCode-token Assignment Counter
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             start_offs16           Set from the parameter
+ *             image_first_fcode      Set from the Counter
+ *             raw_emission           Cleared
+ *             pinned_fcodes          Cleared
+ *             defn_notes             Emptied
+ *         Memory Freed
+ *             Copies of names and file names in the notes.
+ *
+ *      Process Explanation:
+ *          Called by the FCode-Starter, after the FCode Header was written
+ *              and the FCode Range for the image was started.
+ *
+ **************************************************************************** */
+
+void start_image_notes( bool is_offs16)
+{
+    int indx;
+    for ( indx = 0 ; indx < num_notes ; indx++ )
+    {
+	free( defn_notes[indx].name);
+	free( defn_notes[indx].ifile);
+    }
+    num_notes = 0;
+    memset( pinned_fcodes, 0, sizeof(pinned_fcodes));
+    raw_emission = false;
+    start_offs16 = is_offs16;
+    image_first_fcode = nextfcode;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_definition
+ *      Synopsis:       Record the name and placement of a new definition.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             ob_off                 Position in the Output Buffer at which
+ *                                        the new-token (or named-token
+ *                                        or external-token) will be written
+ *             fcode                  FCode number being assigned
+ *             name                   Name of the definition
+ *             hdr                    Its headered-ness
+ *         Global Variables:
+ *             iname                  Current input file name
+ *             lineno                 Current line number
+ *             Whether the number was set explicitly, from  nextfcode.c
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             defn_notes             New entry added
+ *         Memory Allocated
+ *             Copies of the name and of the input file name
+ *         When Freed?
+ *             By  start_image_notes() , at the start of the next image.
+ *
+ *      Extraneous Remarks:
+ *          The notes serve to put names to the definitions in the reports
+ *              and to identify the explicitly-set numbers; otherwise, the
+ *              passes do not rely on them.  The headered-ness is taken
+ *              from the image itself.
+ *
+ **************************************************************************** */
+
+void note_definition( unsigned int ob_off, u16 fcode,
+                          char *name, headeredness hdr)
+{
+    if ( num_notes == notes_size )
+    {
+	notes_size = notes_size ? notes_size * 2 : 64;
+	defn_notes = realloc( defn_notes, notes_size * sizeof(defn_note_t));
+	if ( defn_notes == NULL )
+	{
+	    tokenization_error( FATAL, "Out of memory noting definitions");
+	}
+    }
+    defn_notes[num_notes].ob_off  = ob_off;
+    defn_notes[num_notes].fcode   = fcode;
+    defn_notes[num_notes].name    = strdup( name);
+    defn_notes[num_notes].ifile   = strdup( iname != NULL ? iname : "");
+    defn_notes[num_notes].line_no = lineno;
+    defn_notes[num_notes].anchored = next_fcode_is_anchored();
+    num_notes++;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_pinned_fcode
+ *      Synopsis:       Record that the given FCode number has been exposed
+ *                          as a number, (e.g., as a literal by  F['] ), and
+ *                          therefore must not be changed or dropped.
+ *
+ **************************************************************************** */
+
+void note_pinned_fcode( u16 fcode)
+{
+    if ( fcode <= FCODE_LIMIT )
+    {
+	pinned_fcodes[fcode >> 3] |= ( 1 << (fcode & 7) );
+    }
+}
+
+static bool is_pinned( u16 fcode)
+{
+    return ( (pinned_fcodes[fcode >> 3] & ( 1 << (fcode & 7) )) != 0 );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_raw_emission
+ *      Synopsis:       Record that bytes whose meaning is unknown to us
+ *                          were written into the current image.
+ *
+ **************************************************************************** */
+
+void note_raw_emission( void)
+{
+    raw_emission = true;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  image_passes_wanted
+ *      Synopsis:       Indicate whether any of the Whole-Image passes
+ *                          is enabled.
+ *
+ **************************************************************************** */
+
+bool image_passes_wanted( void)
+{
+    return ( drop_unused_headerless || inline_tiny_headerless
+		 || factor_common_sequences || dense_fcode_numbers );
+}
+
+/* **************************************************************************
+ *
+ *      Support routines for growing the lists.
+ *
+ **************************************************************************** */
+
+static fc_item_t *new_item( void)
+{
+    fc_item_t *retval;
+    if ( num_items == items_size )
+    {
+	items_size = items_size ? items_size * 2 : 1024;
+	items = realloc( items, items_size * sizeof(fc_item_t));
+	if ( items == NULL )
+	{
+	    tokenization_error( FATAL, "Out of memory reading FCode image");
+	}
+    }
+    retval = &items[num_items++];
+    memset( retval, 0, sizeof(fc_item_t));
+    retval->target      = -1;
+    retval->ref_defn    = -1;
+    retval->in_defn     = -1;
+    retval->replaced_by = -1;
+    retval->inlined     = -1;
+    return ( retval );
+}
+
+static fc_defn_t *new_defn( void)
+{
+    fc_defn_t *retval;
+    if ( num_defns == defns_size )
+    {
+	defns_size = defns_size ? defns_size * 2 : 256;
+	defns = realloc( defns, defns_size * sizeof(fc_defn_t));
+	if ( defns == NULL )
+	{
+	    tokenization_error( FATAL, "Out of memory reading FCode image");
+	}
+    }
+    retval = &defns[num_defns++];
+    memset( retval, 0, sizeof(fc_defn_t));
+    retval->inline_bytes = -1;
+    return ( retval );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  get_fcode_at
+ *      Synopsis:       Read an FCode token from the image body.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             body                   The image body
+ *             len                    Its length
+ *             pos                    Pointer to the read position
+ *             fcode                  Pointer to where to put the token
+ *
+ *      Outputs:
+ *         Returned Value:            FALSE if the body ended prematurely
+ *         Supplied Pointers:
+ *             *pos                   Advanced past the token
+ *             *fcode                 The token
+ *
+ *      Process Explanation:
+ *          A first byte of 0x01 through 0x0f introduces a two-byte token.
+ *
+ **************************************************************************** */
+
+static bool get_fcode_at( u8 *body, unsigned int len,
+                              unsigned int *pos, u16 *fcode)
+{
+    bool retval = false;
+    if ( *pos < len )
+    {
+	u16 tok = body[(*pos)++];
+	if ( ( tok >= 0x01 ) && ( tok <= 0x0f ) )
+	{
+	    if ( *pos < len )
+	    {
+		tok = ( tok << 8 ) | body[(*pos)++];
+		retval = true;
+	    }
+	}else{
+	    retval = true;
+	}
+	*fcode = tok;
+    }
+    return ( retval );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  find_item_at
+ *      Synopsis:       Return the index of the item that starts at the
+ *                          given offset in the body, the number of items
+ *                          if the offset is the end of the last item,
+ *                          or -1 if no item starts there.
+ *
+ **************************************************************************** */
+
+static int find_item_at( unsigned int ob_off)
+{
+    int lo = 0;
+    int hi = num_items - 1;
+
+    if ( ( num_items > 0 ) &&
+	 ( ob_off == items[hi].ob_off + items[hi].length ) )
+    {
+	return ( num_items );
+    }
+    while ( lo <= hi )
+    {
+	int mid = ( lo + hi ) / 2;
+	if ( items[mid].ob_off == ob_off )  return ( mid );
+	if ( items[mid].ob_off < ob_off )
+	{
+	    lo = mid + 1;
+	}else{
+	    hi = mid - 1;
+	}
+    }
+    return ( -1 );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  read_image_body
+ *      Synopsis:       Read the image body back into the lists of items
+ *                          and of definitions, and resolve references.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             body                   The image body
+ *             len                    Its length
+ *         Local Static Variables:
+ *             start_offs16           State of FCode-offset size at start
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if the body was read successfully
+ *         Local Static Variables:
+ *             items                  Filled in
+ *             defns                  Filled in
+ *             body_trailer           Offset after the end-token
+ *
+ *      Error Detection:
+ *          Return FALSE if an operand runs past the end of the body, if
+ *              a new-token is not followed by a definer, if a colon-def'n
+ *              is not terminated, or if a branch does not land on a token.
+ *
+ *      Process Explanation:
+ *          A reference to a user-defined token resolves to the most recent
+ *              definition of that token preceding the reference, just as
+ *              it would when the FCode is evaluated.
+ *          An  instance  immediately preceding a new definition is treated
+ *              as part of that definition.  A definition separated from
+ *              its  instance  by other code must be kept, lest the
+ *              instance  attach itself to the next definition.
+ *
+ **************************************************************************** */
+
+static bool read_image_body( u8 *body, unsigned int len)
+{
+    static int latest_defn[FCODE_LIMIT+1];
+    unsigned int pos = 0;
+    bool offs16_now = start_offs16;
+    int curr_defn = -1;           /*  Colon-def'n being read, or -1  */
+    int pend_instance = -1;       /*  Item of a preceding  instance  */
+    bool instance_open = false;   /*  An  instance  awaits its definer  */
+    bool ended = false;
+    int indx;
+
+    num_items = 0;
+    num_defns = 0;
+    for ( indx = 0 ; indx <= FCODE_LIMIT ; indx++ )
+    {
+	latest_defn[indx] = -1;
+    }
+
+    while ( ( pos < len ) && ( ! ended ) )
+    {
+	fc_item_t *item = new_item();
+	fc_role_t role;
+	int this_item = num_items - 1;
+
+	item->ob_off = pos;
+	item->in_defn = curr_defn;
+	if ( ! get_fcode_at( body, len, &pos, &item->fcode) )  return ( false );
+	role = role_of( item->fcode);
+
+	if ( item->fcode >= FCODE_START )
+	{
+	    item->ref_defn = latest_defn[item->fcode];
+	}
+
+	switch ( role )
+	{
+	    case ROLE_LITERAL:
+		pos += 4;
+		break;
+
+	    case ROLE_STRING:
+		if ( pos >= len )  return ( false );
+		pos += 1 + body[pos];
+		break;
+
+	    case ROLE_TICK:
+	    case ROLE_TO:
+		if ( ! get_fcode_at( body, len, &pos, &item->opnd_tok) )
+		{
+		    return ( false );
+		}
+		if ( item->opnd_tok >= FCODE_START )
+		{
+		    item->ref_defn = latest_defn[item->opnd_tok];
+		    if ( ( role == ROLE_TICK ) && ( item->ref_defn >= 0 ) )
+		    {
+			defns[item->ref_defn].root = true;
+		    }
+		}
+		break;
+
+	    case ROLE_BRANCH:
+		if ( offs16_now )
+		{
+		    if ( pos + 2 > len )  return ( false );
+		    item->offset = (s16)( (body[pos] << 8) | body[pos+1] );
+		    item->offs_len = 2;
+		}else{
+		    if ( pos + 1 > len )  return ( false );
+		    item->offset = (s8)body[pos];
+		    item->offs_len = 1;
+		}
+		/*  Temporarily keep the target's body offset here  */
+		item->target = (int)pos + item->offset;
+		pos += item->offs_len;
+		break;
+
+	    case ROLE_OFFSET16:
+		offs16_now = true;
+		break;
+
+	    case ROLE_INSTANCE:
+		if ( curr_defn == -1 )
+		{
+		    pend_instance = this_item;
+		    instance_open = true;
+		    item->length = pos - item->ob_off;
+		    continue;
+		}
+		break;
+
+	    case ROLE_NAMED_TOKEN:
+		if ( pos >= len )  return ( false );
+		pos += 1 + body[pos];
+		/*  Fall through  */
+	    case ROLE_NEW_TOKEN:
+		{
+		    fc_defn_t *defn;
+		    u16 definer;
+		    unsigned int def_pos;
+		    fc_role_t def_role;
+
+		    if ( curr_defn != -1 )  return ( false );
+		    if ( ! get_fcode_at( body, len, &pos, &item->opnd_tok) )
+		    {
+			return ( false );
+		    }
+		    /*  Look ahead to the definer  */
+		    def_pos = pos;
+		    if ( ! get_fcode_at( body, len, &def_pos, &definer) )
+		    {
+			return ( false );
+		    }
+		    def_role = role_of( definer);
+		    if ( ( def_role != ROLE_COLON ) &&
+		         ( def_role != ROLE_DEFINER ) )
+		    {
+			return ( false );
+		    }
+
+		    defn = new_defn();
+		    defn->first_item = this_item;
+		    if ( pend_instance != -1 )
+		    {
+			defn->first_item = pend_instance;
+			items[pend_instance].in_defn = num_defns - 1;
+		    }else{
+			/*  Separated from its  instance  by other code  */
+			if ( instance_open )  defn->root = true;
+		    }
+		    instance_open = false;
+		    defn->tokn_item  = this_item;
+		    defn->fcode      = item->opnd_tok;
+		    defn->nu_fcode   = item->opnd_tok;
+		    defn->definer    = definer;
+		    defn->headerless = ( role == ROLE_NEW_TOKEN );
+		    defn->root       = ! defn->headerless;
+		    if ( is_pinned( defn->fcode) )  defn->root = true;
+
+		    item->in_defn = num_defns - 1;
+		    if ( item->opnd_tok <= FCODE_LIMIT )
+		    {
+			latest_defn[item->opnd_tok] = num_defns - 1;
+		    }
+
+		    /*  The definer is an item of its own  */
+		    item->length = pos - item->ob_off;
+		    item = new_item();
+		    item->ob_off  = pos;
+		    item->fcode   = definer;
+		    item->in_defn = num_defns - 1;
+		    pos = def_pos;
+		    this_item = num_items - 1;
+
+		    if ( def_role == ROLE_COLON )
+		    {
+			curr_defn = num_defns - 1;
+		    }else{
+			defn->last_item = this_item;
+		    }
+		}
+		break;
+
+	    case ROLE_SEMICOLON:
+		if ( curr_defn == -1 )  return ( false );
+		defns[curr_defn].last_item = this_item;
+		curr_defn = -1;
+		break;
+
+	    case ROLE_ENDER:
+		ended = true;
+		break;
+
+	    default:
+		break;
+	}
+	pend_instance = -1;
+
+	if ( pos > len )  return ( false );
+	item->length = pos - item->ob_off;
+    }
+
+    if ( ( curr_defn != -1 ) || ( pend_instance != -1 ) )  return ( false );
+    body_trailer = pos;
+
+    /*  Now that all items are known, convert branch targets to items  */
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	if ( items[indx].offs_len != 0 )
+	{
+	    int targ = find_item_at( (unsigned int)items[indx].target);
+	    if ( ( items[indx].target < 0 ) || ( targ < 0 ) )  return ( false );
+	    items[indx].target = targ;
+	}
+    }
+
+    /*  Give the definitions their names, from the notes  */
+    {
+	int note = 0;
+	for ( indx = 0 ; indx < num_defns ; indx++ )
+	{
+	    unsigned int tok_off = items[defns[indx].tokn_item].ob_off;
+	    while ( ( note < num_notes ) && ( defn_notes[note].ob_off < tok_off ) )
+	    {
+		note++;
+	    }
+	    if ( ( note < num_notes ) && ( defn_notes[note].ob_off == tok_off ) )
+	    {
+		defns[indx].name = defn_notes[note].name;
+		defns[indx].anchored = defn_notes[note].anchored;
+	    }
+	}
+    }
+
+    return ( true );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  stand_in_for
+ *      Synopsis:       Return the  fc_specials  entry's  stand_in  string
+ *                          for the given definer.
+ *
+ **************************************************************************** */
+
+static char *stand_in_for( u16 definer)
+{
+    return ( fc_specials[(int)special_of[definer]].stand_in );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  reach_definitions
+ *      Synopsis:       Walk the reference-graph from its roots and mark
+ *                          every definition that can be reached.
+ *
+ *      Process Explanation:
+ *          The roots are:  every reference made from top-level code, and
+ *              every definition marked as a root when it was read.
+ *          A work-list of definitions whose own references have not yet
+ *              been followed keeps the walk linear in the size of the body.
+ *
+ **************************************************************************** */
+
+static void reach_definitions( void)
+{
+    int *work = safe_malloc( (num_defns + 1) * sizeof(int),
+			     "walking reference-graph");
+    int work_depth = 0;
+    int indx;
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	defns[indx].reached = defns[indx].root;
+	if ( defns[indx].reached )  work[work_depth++] = indx;
+    }
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	int refd = items[indx].ref_defn;
+	if ( ( items[indx].in_defn == -1 ) && ( refd >= 0 ) &&
+	     ( ! defns[refd].reached ) )
+	{
+	    defns[refd].reached = true;
+	    work[work_depth++] = refd;
+	}
+    }
+
+    while ( work_depth > 0 )
+    {
+	fc_defn_t *defn = &defns[work[--work_depth]];
+	for ( indx = defn->first_item ; indx <= defn->last_item ; indx++ )
+	{
+	    int refd = items[indx].ref_defn;
+	    if ( ( refd >= 0 ) && ( ! defns[refd].reached ) )
+	    {
+		defns[refd].reached = true;
+		work[work_depth++] = refd;
+	    }
+	}
+    }
+    free( work);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  plan_next_fcode
+ *      Synopsis:       Plan the retraction of the FCode-token Assignment
+ *                          Counter after the numbers at the end of the
+ *                          image have been compacted, in the manner of
+ *                          compact_next_fcode() , without touching it.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_next               The number that would have followed
+ *                                        the last one assigned in the image
+ *             nu_next                The number that follows the last one
+ *                                        assigned after compaction
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             planned_next           May be retracted to  nu_next
+ *
+ **************************************************************************** */
+
+static void plan_next_fcode( u16 old_next, u16 nu_next)
+{
+    if ( ( planned_next == old_next ) && ( nu_next < old_next ) )
+    {
+	planned_next = nu_next;
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  commit_next_fcode
+ *      Synopsis:       Bring the FCode-token Assignment Counter to the
+ *                          planned number, once the replacement body has
+ *                          been written.
+ *
+ *      Inputs:
+ *         Parameters:                NONE
+ *         Global Variables:
+ *             nextfcode              FCode-token Assignment Counter
+ *         Local Static Variables:
+ *             planned_next           The number it is to become
+ *             range_moves            Ends of earlier Ranges to move
+ *             num_range_moves        Number of them
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Global Variables:
+ *             nextfcode              Retracted or advanced to  planned_next
+ *
+ *      Process Explanation:
+ *          Numbers given to factored definitions may carry the Counter
+ *              beyond where the Tokenizer left it; each of them is then
+ *              assigned through  nextfcode.c  as any other would be, so
+ *              the Ranges and the Overlap test take account of them.
+ *          Ranges of the image that were closed by an explicitly-set
+ *              number have their ends moved to match the renumbering.
+ *
+ **************************************************************************** */
+
+static void commit_next_fcode( void)
+{
+    int indx;
+    for ( indx = 0 ; indx < num_range_moves ; indx++ )
+    {
+	move_fcode_range_end( range_moves[indx].old_next,
+				  range_moves[indx].nu_next);
+    }
+    if ( planned_next < nextfcode )
+    {
+	compact_next_fcode( nextfcode, planned_next);
+    }else{
+	while ( nextfcode < planned_next )
+	{
+	    assigning_fcode();
+	    bump_fcode();
+	}
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  compact_fcodes
+ *      Synopsis:       Assign new FCode numbers to the definitions that
+ *                          remain, closing the holes left by the dropped
+ *                          ones.  Report whether any number changed.
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if any number was changed
+ *         Local Static Variables:
+ *             defns[].nu_fcode       Set for every remaining definition
+ *
+ *      Process Explanation:
+ *          A "run" is a sequence of definitions whose numbers were assigned
+ *              consecutively.  Each run keeps its starting number, so
+ *              the effect of an explicit  next-fcode  is preserved, and
+ *              a definition whose number is pinned keeps it.
+ *          If any number was assigned to more than one definition in the
+ *              image, the programmer has intentionally recycled a Range;
+ *              moving numbers could then collide with a later assignment,
+ *              so we leave all numbers alone.
+ *          If the last run continues into the FCode-token Assignment
+ *              Counter, plan to inform  nextfcode.c  of the new next number
+ *              once the image has been rewritten.  If another pass already
+ *              compacted the numbers, the Counter continues from where
+ *              that compaction left it.
+ *
+ **************************************************************************** */
+
+static bool compact_fcodes( void)
+{
+    static u8 seen[(FCODE_LIMIT+1)/8];
+    bool retval = false;
+    u16 prev_fcode = 0;
+    u16 next_nu = 0;
+    int indx;
+
+    memset( seen, 0, sizeof(seen));
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	u16 fc = defns[indx].fcode;
+	if ( (fc > FCODE_LIMIT) || ( seen[fc >> 3] & (1 << (fc & 7)) ) )
+	{
+	    return ( false );
+	}
+	seen[fc >> 3] |= ( 1 << (fc & 7) );
+    }
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	fc_defn_t *defn = &defns[indx];
+	if ( ( indx == 0 ) || ( defn->fcode != prev_fcode + 1 ) ||
+	     is_pinned( defn->fcode) )
+	{
+	    next_nu = defn->fcode;
+	}
+	prev_fcode = defn->fcode;
+	if ( ! defn->dropped )
+	{
+	    defn->nu_fcode = next_nu++;
+	    if ( defn->nu_fcode != defn->fcode )  retval = true;
+	}
+    }
+
+    if ( num_defns > 0 )
+    {
+	u16 old_next = compacted_next ? compacted_next : prev_fcode + 1;
+	plan_next_fcode( old_next, next_nu);
+	compacted_next = ( planned_next == next_nu ) ? next_nu : 0;
+    }
+    return ( retval );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  drop_unused_defns
+ *      Synopsis:       The "Drop-Unused-Headerless" pass.
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if the image needs rewriting
+ *         Local Static Variables:
+ *             defns[].dropped        Set for each definition dropped
+ *         Printout (if verbose):
+ *             The definitions dropped, and a summary.
+ *
+ **************************************************************************** */
+
+static bool drop_unused_defns( void)
+{
+    bool retval = false;
+    int dropped = 0;
+    unsigned int saved = 0;
+    int indx;
+
+    reach_definitions();
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	fc_defn_t *defn = &defns[indx];
+	char *stand_in = stand_in_for( defn->definer);
+	if ( defn->reached || ! defn->headerless || ( stand_in == NULL ) )
+	{
+	    continue;
+	}
+	defn->dropped = true;
+	dropped++;
+	{
+	    unsigned int span = items[defn->last_item].ob_off
+	                          + items[defn->last_item].length
+				  - items[defn->first_item].ob_off;
+	    if ( *stand_in != 0 )  span--;
+	    saved += span;
+	    if ( verbose )
+	    {
+		printf( "    Dropped unused  %s  (FCode 0x%03x, %d bytes)\n",
+		    defn->name != NULL ? defn->name : "(unnamed)",
+			defn->fcode, span);
+	    }
+	}
+    }
+
+    if ( dropped > 0 )
+    {
+	retval = true;
+	if ( ( ! dense_fcode_numbers ) && compact_fcodes() && verbose )
+	{
+	    printf( "    FCode numbers of remaining definitions compacted.\n");
+	}
+    }
+    if ( verbose )
+    {
+	printf( "toke: dropped %d unused headerless definition%s "
+		"(%d bytes).\n", dropped, dropped == 1 ? "" : "s", saved);
+    }
+    return ( retval );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  item_hash
+ *      Synopsis:       Return a hash of an item's bytes and of the
+ *                          definition it refers to.
+ *
+ **************************************************************************** */
+
+static u32 item_hash( u8 *body, int indx)
+{
+    fc_item_t *item = &items[indx];
+    u32 hash = 2166136261U;
+    unsigned int pos;
+
+    for ( pos = item->ob_off ; pos < item->ob_off + item->length ; pos++ )
+    {
+	hash = ( hash ^ body[pos] ) * 16777619U;
+    }
+    hash = ( hash ^ (u32)item->ref_defn ) * 16777619U;
+    return ( hash );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  sequences_match
+ *      Synopsis:       Indicate whether the sequences of the given number
+ *                          of items starting at the two given items are
+ *                          identical, including what they refer to.
+ *
+ **************************************************************************** */
+
+static bool sequences_match( u8 *body, int first, int second, int count)
+{
+    int indx;
+    for ( indx = 0 ; indx < count ; indx++ )
+    {
+	fc_item_t *one = &items[first + indx];
+	fc_item_t *other = &items[second + indx];
+	if ( ( one->length != other->length ) ||
+	     ( one->ref_defn != other->ref_defn ) ||
+	     ( memcmp( body + one->ob_off, body + other->ob_off,
+			   one->length) != 0 ) )
+	{
+	    return ( false );
+	}
+    }
+    return ( true );
+}
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          fc_window_t           A candidate sequence of items, for sorting
+ *                                    identical candidates together.
+ *
+ **************************************************************************** */
+
+typedef struct fc_window {
+	u32    hash;
+	int    start;
+} fc_window_t;
+
+static int compare_windows( const void *one, const void *other)
+{
+    const fc_window_t *win_a = one;
+    const fc_window_t *win_b = other;
+    if ( win_a->hash != win_b->hash )
+    {
+	return ( win_a->hash < win_b->hash ? -1 : 1 );
+    }
+    return ( win_a->start - win_b->start );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  mark_unsafe_callees
+ *      Synopsis:       Mark the colon-definitions that, when called, act
+ *                          upon their caller's Return-Stack frame.
+ *
+ *      Outputs:
+ *         Supplied Pointers:
+ *             unsafe[]               TRUE for each such definition
+ *
+ *      Process Explanation:
+ *          A definition that takes more from the Return Stack than it
+ *              put there (e.g.,  r> drop  to exit from its caller) would
+ *              behave differently if it were called from a factored
+ *              definition instead of from the original caller.  The
+ *              count is taken in the order of the tokens, without
+ *              regard to control-flow, so any imbalance is suspect.
+ *
+ **************************************************************************** */
+
+static void mark_unsafe_callees( bool *unsafe)
+{
+    u16 to_r = fcode_by_name( ">r");
+    u16 r_from = fcode_by_name( "r>");
+    u16 r_fetch = fcode_by_name( "r@");
+    int indx;
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	fc_defn_t *defn = &defns[indx];
+	int depth = 0;
+	int item;
+
+	unsafe[indx] = false;
+	if ( role_of( defn->definer) != ROLE_COLON )  continue;
+	for ( item = defn->tokn_item + 2 ; item < defn->last_item ; item++ )
+	{
+	    u16 fcode = items[item].fcode;
+	    if ( fcode == to_r )
+	    {
+		depth++;
+	    }else{
+		if ( ( fcode == r_from ) || ( fcode == r_fetch ) )
+		{
+		    if ( depth <= 0 )  unsafe[indx] = true;
+		    if ( fcode == r_from )  depth--;
+		}
+	    }
+	}
+	if ( depth != 0 )  unsafe[indx] = true;
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  factorable_runs
+ *      Synopsis:       For each item, count the items, starting with it,
+ *                          that may be factored out together.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             unsafe                 Colon-definitions unsafe to call from
+ *                                        a factored definition
+ *             is_target              Items that are targets of branches
+ *
+ *      Outputs:
+ *         Supplied Pointers:
+ *             run[]                  The count for each item
+ *
+ *      Process Explanation:
+ *          Only items within the body of one colon-definition qualify.
+ *          Branches, and tokens that use the Return Stack or the loop
+ *              frame, are excluded, as are  b(case)  and  b(endcase)  and
+ *              references to the definition itself or to definitions that
+ *              are unsafe to call from elsewhere.
+ *          A branch may target the first item of a sequence, but not any
+ *              other item within it.
+ *          Items already factored out do not qualify again, nor do calls
+ *              that are to be expanded in place.
+ *
+ **************************************************************************** */
+
+static void factorable_runs( bool *unsafe, bool *is_target, int *run)
+{
+    int indx;
+
+    for ( indx = num_items - 1 ; indx >= 0 ; indx-- )
+    {
+	fc_item_t *item = &items[indx];
+	fc_defn_t *defn;
+	fc_role_t role = role_of( item->fcode);
+	bool eligible = true;
+
+	run[indx] = 0;
+	if ( item->in_defn < 0 )  continue;
+	defn = &defns[item->in_defn];
+
+	if ( defn->dropped || ( role_of( defn->definer) != ROLE_COLON ) ||
+	     ( indx <= defn->tokn_item + 1 ) || ( indx >= defn->last_item ) ||
+	     item->consumed || ( item->inlined >= 0 ) )
+	{
+	    eligible = false;
+	}
+	switch ( role )
+	{
+	    case ROLE_BRANCH:
+	    case ROLE_RSTACK:
+	    case ROLE_CASE:
+	    case ROLE_INSTANCE:
+		eligible = false;
+		break;
+	    default:
+		break;
+	}
+	if ( ( item->ref_defn >= 0 ) &&
+	     ( ( item->ref_defn == item->in_defn ) || unsafe[item->ref_defn] ) )
+	{
+	    eligible = false;
+	}
+
+	if ( eligible )
+	{
+	    run[indx] = 1;
+	    if ( ( indx + 1 < num_items ) && ( run[indx + 1] > 0 ) &&
+	         ( items[indx + 1].in_defn == item->in_defn ) &&
+		 ( ! is_target[indx + 1] ) )
+	    {
+		run[indx] += run[indx + 1];
+	    }
+	}
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  sequence_bytes
+ *      Synopsis:       Return the number of bytes in a sequence of items.
+ *
+ **************************************************************************** */
+
+static int sequence_bytes( int start, int count)
+{
+    fc_item_t *last = &items[start + count - 1];
+    return ( (int)( last->ob_off + last->length - items[start].ob_off ) );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  factoring_savings
+ *      Synopsis:       Return the number of bytes that would be saved by
+ *                          factoring out a sequence of the given size
+ *                          that occurs the given number of times.
+ *
+ *      Process Explanation:
+ *          Each occurrence is replaced by a two-byte call; the new
+ *              definition costs its body plus a  new-token , its two-byte
+ *              FCode number, a  b(:)  and a  b(;) .
+ *
+ **************************************************************************** */
+
+static int factoring_savings( int seq_bytes, int places)
+{
+    return ( ( places * seq_bytes ) - ( places * 2 ) - ( seq_bytes + 5 ) );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  factor_common_seqs
+ *      Synopsis:       The "Factor-Common-Sequences" pass.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             body                   The image body
+ *         Global Variables:
+ *             factor_min_savings     Least number of bytes that factoring
+ *                                        a sequence must save
+ *             planned_next           Source of FCode numbers for the new
+ *                                        definitions
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if the image needs rewriting
+ *         Local Static Variables:
+ *             defns                  A new, "synthetic" definition for
+ *                                        each sequence factored out
+ *             items[].replaced_by    Set for the first item of each
+ *                                        occurrence of such a sequence
+ *             items[].consumed       Set for each item of each occurrence
+ *         Printout (if verbose):
+ *             Each sequence factored out, with the bytes it saves, and
+ *                 a summary.
+ *
+ *      Process Explanation:
+ *          Repeatedly find the sequence (of up to  FACTOR_MAX_ITEMS  items)
+ *              whose factoring would save the most bytes, and factor it
+ *              out of every place it occurs (without overlap), until no
+ *              sequence would save at least the threshold number of bytes.
+ *          Candidates of each length are found by hashing every eligible
+ *              window of that length and sorting the windows by hash, so
+ *              identical sequences end up next to each other.
+ *          The new definition is written immediately before the definition
+ *              that contains the first occurrence.  Everything the sequence
+ *              refers to has been defined by then, because a sequence may
+ *              not refer to the definition containing it.
+ *          FCode numbers for the new definitions are taken from where
+ *              the FCode-token Assignment Counter is planned to be, skipping
+ *              any number in use in the image.  They are committed to the
+ *              Counter only if the image is rewritten.  If the numbers run
+ *              out, factoring stops.  These numbers serve to keep the new
+ *              definitions apart; they are reassigned in order of placement
+ *              afterwards, by  renumber_in_order() .
+ *
+ **************************************************************************** */
+
+#define FACTOR_MAX_ITEMS  32
+
+static bool factor_common_seqs( u8 *body)
+{
+    static u8 in_use[(FCODE_LIMIT+1)/8];
+    bool *unsafe = safe_malloc( (num_defns + 1) * sizeof(bool),
+				"factoring common sequences");
+    bool *is_target = safe_malloc( (num_items + 1) * sizeof(bool),
+				   "factoring common sequences");
+    int *run = safe_malloc( (num_items + 1) * sizeof(int),
+			    "factoring common sequences");
+    u32 *prefix = safe_malloc( (num_items + 1) * sizeof(u32),
+			       "factoring common sequences");
+    fc_window_t *windows = safe_malloc( (num_items + 1) * sizeof(fc_window_t),
+					"factoring common sequences");
+    int threshold = factor_min_savings > 0 ? factor_min_savings : 1;
+    int factored = 0;
+    int total_saved = 0;
+    int indx;
+
+    mark_unsafe_callees( unsafe);
+
+    memset( is_target, 0, (num_items + 1) * sizeof(bool));
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	if ( items[indx].offs_len != 0 )  is_target[items[indx].target] = true;
+    }
+
+    /*  Running hash of the items:  prefix[n] covers items  0 .. n-1   */
+    prefix[0] = 0;
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	prefix[indx + 1] = prefix[indx] * 31U + item_hash( body, indx);
+    }
+
+    memset( in_use, 0, sizeof(in_use));
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	u16 fc = defns[indx].nu_fcode;
+	if ( ( ! defns[indx].dropped ) && ( fc <= FCODE_LIMIT ) )
+	{
+	    in_use[fc >> 3] |= ( 1 << (fc & 7) );
+	}
+    }
+
+    while ( true )
+    {
+	int best_saving = 0;
+	int best_count = 0;
+	int best_start = -1;
+	int count;
+
+	factorable_runs( unsafe, is_target, run);
+
+	for ( count = 1 ; count <= FACTOR_MAX_ITEMS ; count++ )
+	{
+	    u32 power = 1;
+	    int num_windows = 0;
+	    int group;
+
+	    for ( indx = 0 ; indx < count ; indx++ )  power *= 31U;
+	    for ( indx = 0 ; indx + count <= num_items ; indx++ )
+	    {
+		if ( run[indx] >= count )
+		{
+		    windows[num_windows].hash =
+			prefix[indx + count] - prefix[indx] * power;
+		    windows[num_windows].start = indx;
+		    num_windows++;
+		}
+	    }
+	    if ( num_windows < 2 )  break;
+	    qsort( windows, num_windows, sizeof(fc_window_t), compare_windows);
+
+	    for ( group = 0 ; group < num_windows ; )
+	    {
+		int leader = windows[group].start;
+		int seq_bytes = sequence_bytes( leader, count);
+		int places = 1;
+		int last_end = leader + count;
+		int member;
+		int saving;
+
+		for ( member = group + 1 ;
+		      ( member < num_windows ) &&
+		          ( windows[member].hash == windows[group].hash ) ;
+			      member++ )
+		{
+		    int start = windows[member].start;
+		    if ( ( start >= last_end ) &&
+		         sequences_match( body, leader, start, count) )
+		    {
+			places++;
+			last_end = start + count;
+		    }
+		}
+		saving = factoring_savings( seq_bytes, places);
+		if ( ( places > 1 ) && ( saving > best_saving ) )
+		{
+		    best_saving = saving;
+		    best_count = count;
+		    best_start = leader;
+		}
+		group = member;
+	    }
+	}
+
+	if ( ( best_start < 0 ) || ( best_saving < threshold ) )  break;
+
+	/*  Choose an FCode number for the new definition  */
+	while ( ( planned_next <= FCODE_LIMIT ) &&
+		( ( in_use[planned_next >> 3] & ( 1 << (planned_next & 7) ) ) ||
+		      is_pinned( planned_next) ) )
+	{
+	    planned_next++;
+	}
+	if ( planned_next > FCODE_LIMIT )
+	{
+	    tokenization_error( WARNING,
+		"No FCode numbers left for factored definitions.\n");
+	    break;
+	}
+
+	{
+	    int nu_defn = num_defns;
+	    int first_defn = items[best_start].in_defn;
+	    int seq_bytes = sequence_bytes( best_start, best_count);
+	    int places = 0;
+	    int last_end = 0;
+	    fc_defn_t *defn = new_defn();
+
+	    defn->first_item = defns[first_defn].first_item;
+	    defn->tokn_item  = defn->first_item;
+	    defn->last_item  = defn->first_item;
+	    defn->fcode      = planned_next;
+	    defn->nu_fcode   = planned_next;
+	    defn->definer    = fcode_by_name( "b(:)");
+	    defn->headerless = true;
+	    defn->reached    = true;
+	    defn->synthetic  = true;
+	    defn->src_item   = best_start;
+	    defn->src_count  = best_count;
+	    in_use[planned_next >> 3] |= ( 1 << (planned_next & 7) );
+	    planned_next++;
+
+	    for ( indx = best_start ; indx + best_count <= num_items ; indx++ )
+	    {
+		if ( ( indx >= last_end ) && ( run[indx] >= best_count ) &&
+		     sequences_match( body, best_start, indx, best_count) )
+		{
+		    int item;
+		    items[indx].replaced_by = nu_defn;
+		    for ( item = indx ; item < indx + best_count ; item++ )
+		    {
+			items[item].consumed = true;
+		    }
+		    places++;
+		    last_end = indx + best_count;
+		}
+	    }
+
+	    best_saving = factoring_savings( seq_bytes, places);
+	    total_saved += best_saving;
+	    factored++;
+	    if ( verbose )
+	    {
+		printf( "    Factored %d-token sequence (%d bytes) "
+		    "from %d places into FCode 0x%03x, first in  %s ;  "
+			"%d bytes saved\n",
+			    best_count, seq_bytes, places, defns[nu_defn].fcode,
+				defns[first_defn].name != NULL ?
+				    defns[first_defn].name : "(unnamed)",
+					best_saving);
+	    }
+	}
+    }
+
+    if ( verbose )
+    {
+	printf( "toke: factored %d common sequence%s (%d bytes saved).\n",
+	    factored, factored == 1 ? "" : "s", total_saved);
+    }
+
+    free( unsafe);
+    free( is_target);
+    free( run);
+    free( prefix);
+    free( windows);
+    return ( factored > 0 );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  inline_body_size
+ *      Synopsis:       Return the size of the body of a colon-definition
+ *                          as it would be written in place of a call to it,
+ *                          or -1 if it may not be written in place.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             defn_indx              Index of the definition
+ *             unsafe                 Colon-definitions unsafe to call from
+ *                                        a definition other than their own
+ *                                        caller
+ *             defs_of                For each FCode number, the number of
+ *                                        definitions given it in the image
+ *
+ *      Process Explanation:
+ *          The body may contain only tokens without operands, literals,
+ *              strings and the token-operands of  b(')  and  b(to) .
+ *          A reference within the body is written as the same token at
+ *              the place of the call, so the token must not be given to
+ *              any other definition in the image.  The body may not call
+ *              the definition itself, nor a definition that acts upon its
+ *              caller's Return-Stack frame.
+ *          Calls within the body that are themselves to be expanded in
+ *              place count at the size of their own expansion.  Because
+ *              a reference always follows its definition, a definition's
+ *              callees have been examined before it is.
+ *
+ **************************************************************************** */
+
+static int inline_body_size( int defn_indx, bool *unsafe, int *defs_of)
+{
+    fc_defn_t *defn = &defns[defn_indx];
+    int size = 0;
+    int indx;
+
+    for ( indx = defn->tokn_item + 2 ; indx < defn->last_item ; indx++ )
+    {
+	fc_item_t *item = &items[indx];
+	int refd = item->ref_defn;
+
+	switch ( role_of( item->fcode) )
+	{
+	    case ROLE_PLAIN:
+	    case ROLE_LITERAL:
+	    case ROLE_STRING:
+	    case ROLE_TICK:
+	    case ROLE_TO:
+		break;
+	    default:
+		return ( -1 );
+	}
+	if ( refd >= 0 )
+	{
+	    if ( ( refd == defn_indx ) || unsafe[refd] ||
+		 ( defs_of[defns[refd].fcode] != 1 ) )
+	    {
+		return ( -1 );
+	    }
+	}else{
+	    if ( ( item->fcode >= FCODE_START ) ||
+		 ( item->opnd_tok >= FCODE_START ) )
+	    {
+		return ( -1 );
+	    }
+	}
+	if ( item->inlined >= 0 )
+	{
+	    size += defns[item->inlined].inline_bytes;
+	}else{
+	    size += (int)item->length;
+	}
+    }
+    return ( size );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  inline_tiny_defns
+ *      Synopsis:       The "Inline-Tiny-Headerless" pass.
+ *
+ *      Inputs:
+ *         Global Variables:
+ *             inline_max_bytes       Largest body to be written in place
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if the image needs rewriting
+ *         Local Static Variables:
+ *             defns[].inline_bytes   Set for each definition that qualifies
+ *             defns[].dropped        Set for each definition left without
+ *                                        references
+ *             items[].inlined        Set for each call to be expanded
+ *         Printout (if verbose):
+ *             Each definition expanded, with the number of calls, and a
+ *                 summary with the net change in the size of the image.
+ *
+ *      Process Explanation:
+ *          Only headerless colon-definitions qualify; a headered one would
+ *              have to be kept anyway.  Calls from top-level code, and from
+ *              definitions already dropped, are not expanded.
+ *          A definition is dropped if every remaining reference to it is a
+ *              call that is expanded and it need not be kept for any other
+ *              reason (e.g., its token is the object of  b(')  ).  Its
+ *              body is still copied, from where it was, into the places
+ *              where it is expanded.
+ *          The net change counts each expansion in a definition that is
+ *              written, less the bytes of each definition dropped.
+ *
+ **************************************************************************** */
+
+static bool inline_tiny_defns( void)
+{
+    static int defs_of[FCODE_LIMIT+1];
+    bool *unsafe = safe_malloc( (num_defns + 1) * sizeof(bool),
+				"expanding definitions in place");
+    bool *keep = safe_malloc( (num_defns + 1) * sizeof(bool),
+			      "expanding definitions in place");
+    int *sites = safe_malloc( (num_defns + 1) * sizeof(int),
+			      "expanding definitions in place");
+    int expanded = 0;
+    int num_sites = 0;
+    int dropped = 0;
+    int delta = 0;
+    int indx;
+
+    mark_unsafe_callees( unsafe);
+    memset( defs_of, 0, sizeof(defs_of));
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	if ( defns[indx].fcode <= FCODE_LIMIT )  defs_of[defns[indx].fcode]++;
+    }
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	fc_defn_t *defn = &defns[indx];
+	int size;
+	int call;
+
+	sites[indx] = 0;
+	if ( defn->dropped || defn->synthetic || ! defn->headerless ||
+	     ( role_of( defn->definer) != ROLE_COLON ) ||
+	     ( defn->first_item != defn->tokn_item ) )
+	{
+	    continue;
+	}
+	size = inline_body_size( indx, unsafe, defs_of);
+	if ( ( size < 0 ) || ( size > inline_max_bytes ) )  continue;
+	defn->inline_bytes = size;
+
+	for ( call = defn->last_item + 1 ; call < num_items ; call++ )
+	{
+	    fc_item_t *item = &items[call];
+	    fc_defn_t *caller;
+
+	    if ( ( item->ref_defn != indx ) || ( item->fcode < FCODE_START ) ||
+		 ( item->in_defn < 0 ) )
+	    {
+		continue;
+	    }
+	    caller = &defns[item->in_defn];
+	    if ( caller->dropped || ( role_of( caller->definer) != ROLE_COLON ) )
+	    {
+		continue;
+	    }
+	    item->inlined = indx;
+	    sites[indx]++;
+	}
+	if ( sites[indx] > 0 )
+	{
+	    expanded++;
+	    num_sites += sites[indx];
+	}
+    }
+
+    /*  Find the definitions still referenced other than by expanded calls  */
+    memset( keep, 0, (num_defns + 1) * sizeof(bool));
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	fc_item_t *item = &items[indx];
+	if ( ( item->ref_defn < 0 ) ||
+	     ( ( item->in_defn >= 0 ) && defns[item->in_defn].dropped ) )
+	{
+	    continue;
+	}
+	if ( item->inlined != item->ref_defn )  keep[item->ref_defn] = true;
+    }
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	fc_defn_t *defn = &defns[indx];
+	bool drop_it = ( sites[indx] > 0 ) && ! keep[indx] && ! defn->root;
+	unsigned int span = items[defn->last_item].ob_off
+	                      + items[defn->last_item].length
+			      - items[defn->first_item].ob_off;
+
+	if ( sites[indx] == 0 )  continue;
+	if ( drop_it )
+	{
+	    defn->dropped = true;
+	    dropped++;
+	    delta -= (int)span;
+	}
+	if ( verbose )
+	{
+	    printf( "    Inlined  %s  (FCode 0x%03x, %d bytes) at %d call "
+		"site%s%s\n",
+		    defn->name != NULL ? defn->name : "(unnamed)",
+			defn->fcode, defn->inline_bytes, sites[indx],
+			    sites[indx] == 1 ? "" : "s",
+				drop_it ? "; dropped" : "");
+	}
+    }
+
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	fc_item_t *item = &items[indx];
+	if ( ( item->inlined < 0 ) ||
+	     ( ( item->in_defn >= 0 ) && defns[item->in_defn].dropped ) )
+	{
+	    continue;
+	}
+	delta += defns[item->inlined].inline_bytes - (int)item->length;
+    }
+
+    if ( ( dropped > 0 ) && ( ! dense_fcode_numbers ) &&
+	 compact_fcodes() && verbose )
+    {
+	printf( "    FCode numbers of remaining definitions compacted.\n");
+    }
+    if ( verbose )
+    {
+	printf( "toke: inlined %d definition%s at %d call site%s "
+	    "(net %+d bytes).\n",
+		expanded, expanded == 1 ? "" : "s",
+		    num_sites, num_sites == 1 ? "" : "s", delta);
+    }
+
+    free( unsafe);
+    free( keep);
+    free( sites);
+    return ( num_sites > 0 );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_inlined_uses
+ *      Synopsis:       Record the references made by a body expanded in
+ *                          place as being made at the place of the call.
+ *
+ **************************************************************************** */
+
+static void note_inlined_uses( int *last_use, int defn_indx, int at)
+{
+    fc_defn_t *defn = &defns[defn_indx];
+    int indx;
+
+    for ( indx = defn->tokn_item + 2 ; indx < defn->last_item ; indx++ )
+    {
+	if ( items[indx].ref_defn >= 0 )  last_use[items[indx].ref_defn] = at;
+	if ( items[indx].inlined >= 0 )
+	{
+	    note_inlined_uses( last_use, items[indx].inlined, at);
+	}
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  compare_placement
+ *      Synopsis:       Order definitions (given by index) by their place
+ *                          in the replacement body.  A factored definition
+ *                          is placed before the definition whose first
+ *                          item it was recorded with, and factored
+ *                          definitions at the same place are in order of
+ *                          their creation.
+ *
+ **************************************************************************** */
+
+static int compare_placement( const void *one, const void *other)
+{
+    int defn_a = *(const int *)one;
+    int defn_b = *(const int *)other;
+    if ( defns[defn_a].first_item != defns[defn_b].first_item )
+    {
+	return ( defns[defn_a].first_item - defns[defn_b].first_item );
+    }
+    if ( defns[defn_a].synthetic != defns[defn_b].synthetic )
+    {
+	return ( defns[defn_a].synthetic ? -1 : 1 );
+    }
+    return ( defn_a - defn_b );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_range_move
+ *      Synopsis:       Record that the end of a Range of the image moves
+ *                          with the renumbering.  Report whether the move
+ *                          can be made.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_next               The number that followed the last one
+ *                                        assigned in the Range
+ *             nu_next                The number that follows the last one
+ *                                        it is given after renumbering
+ *
+ *      Outputs:
+ *         Returned Value:            FALSE if the Range would grow
+ *                                        into another
+ *         Local Static Variables:
+ *             range_moves            An entry may be added
+ *             num_range_moves        May be incremented
+ *
+ *      Process Explanation:
+ *          A Range that is closed by an explicitly-set number may only be
+ *              carried past its end if the numbers beyond it do not
+ *              belong to another Range.
+ *
+ **************************************************************************** */
+
+static bool note_range_move( u16 old_next, u16 nu_next)
+{
+    if ( ! fcode_range_can_grow( old_next, nu_next) )  return ( false );
+    if ( nu_next != old_next )
+    {
+	range_moves[num_range_moves].old_next = old_next;
+	range_moves[num_range_moves].nu_next = nu_next;
+	num_range_moves++;
+    }
+    return ( true );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  renumber_in_order
+ *      Synopsis:       The "Dense-FCode-Numbers" pass.  Also serves to
+ *                          number factored definitions in sequence with
+ *                          the others when that pass is not enabled.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             densely                TRUE to close every hole in the
+ *                                        numbers; FALSE to move numbers
+ *                                        only as far as the factored
+ *                                        definitions require
+ *         Local Static Variables:
+ *             image_first_fcode      Where the count starts
+ *             counter_follows        Whether the count may run on into
+ *                                        the Assignment Counter
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if the image needs rewriting
+ *         Local Static Variables:
+ *             defns[].nu_fcode       Set for every remaining definition
+ *             planned_next           May be moved to follow the last number
+ *                                        given out
+ *             range_moves            The earlier Ranges of the image whose
+ *                                        ends are to be moved
+ *         Printout (if verbose):
+ *             A map of the numbers before and after, and a summary.
+ *
+ *      Error Detection:
+ *          If the numbers run past the Standard limit, or from a Range
+ *              that an explicitly-set number closed into another, or an
+ *              explicitly-set number would displace a definition that is
+ *              still referenced, issue a WARNING and leave the numbers as
+ *              the earlier passes left them.
+ *
+ *      Process Explanation:
+ *          Numbers are assigned in order of placement in the replacement
+ *              body, so that factored definitions are numbered in sequence
+ *              with the others; otherwise, the Detokenizer would see each
+ *              definition after a factored one as a possible overlap.
+ *              If not  densely , a definition keeps its number unless the
+ *              count has already passed it.
+ *          The count starts from the first number the image was given,
+ *              so that an image that continues the numbering of an
+ *              earlier one in the same file does not reuse its numbers.
+ *          A number, once given out, is not given out again except
+ *              where the User's explicitly-set number demands it; that
+ *              is only permitted if the earlier holder of the number is
+ *              not referenced after the point of the new definition.
+ *              References are resolved to definitions before renumbering,
+ *              so a reference always follows its own definition's new
+ *              number.
+ *          An explicitly-set number closes the Range that precedes it; the
+ *              end of that Range, and that of the last Range if the
+ *              Counter has since been moved elsewhere, are moved along
+ *              with the numbers.  If the Counter still follows the image,
+ *              it is planned to follow the last number given out.
+ *
+ **************************************************************************** */
+
+static bool renumber_in_order( bool densely)
+{
+    static int nu_owner[FCODE_LIMIT+1];
+    int *last_use;
+    int *order;
+    u16 *prior_fcode;
+    u16 counter = image_first_fcode;
+    u16 seg_next = image_first_fcode;
+    u16 old_high = 0;
+    u16 nu_high = 0;
+    bool changed = false;
+    bool fits = true;
+    int indx;
+
+    if ( num_defns == 0 )  return ( false );
+
+    range_moves = realloc( range_moves,
+			       ( num_defns + 1 ) * sizeof(fc_range_move_t));
+    if ( range_moves == NULL )
+    {
+	tokenization_error( FATAL, "Out of memory reassigning FCode numbers");
+    }
+    last_use = safe_malloc( num_defns * sizeof(int),
+			    "reassigning FCode numbers");
+    order = safe_malloc( num_defns * sizeof(int),
+			 "reassigning FCode numbers");
+    prior_fcode = safe_malloc( num_defns * sizeof(u16),
+			       "reassigning FCode numbers");
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	last_use[indx] = -1;
+	order[indx] = indx;
+	prior_fcode[indx] = defns[indx].nu_fcode;
+    }
+    qsort( order, num_defns, sizeof(int), compare_placement);
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	if ( items[indx].ref_defn >= 0 )  last_use[items[indx].ref_defn] = indx;
+	if ( items[indx].replaced_by >= 0 )
+	{
+	    last_use[items[indx].replaced_by] = indx;
+	}
+	if ( items[indx].inlined >= 0 )
+	{
+	    note_inlined_uses( last_use, items[indx].inlined, indx);
+	}
+    }
+    for ( indx = 0 ; indx <= FCODE_LIMIT ; indx++ )
+    {
+	nu_owner[indx] = -1;
+    }
+
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	fc_defn_t *defn = &defns[order[indx]];
+	bool pinned = is_pinned( defn->fcode);
+	u16 want;
+	int holder;
+
+	if ( defn->anchored )
+	{
+	    /*  The Range before it ended with the definition before it  */
+	    if ( order[indx] > 0 )
+	    {
+		fits = note_range_move( defns[order[indx] - 1].fcode + 1,
+					    seg_next);
+	    }else{
+		/*  No Range of the image to hold what was placed before it  */
+		fits = ( seg_next == image_first_fcode );
+	    }
+	    if ( ! fits )  break;
+	    counter = defn->fcode;
+	    seg_next = counter;
+	}
+	if ( defn->dropped )  continue;
+
+	if ( pinned || defn->anchored )
+	{
+	    want = defn->fcode;
+	}else{
+	    if ( ( ! densely ) && ( ! defn->synthetic ) &&
+		 ( defn->fcode > counter ) )
+	    {
+		counter = defn->fcode;
+	    }
+	    while ( ( counter <= FCODE_LIMIT ) &&
+		    ( ( nu_owner[counter] != -1 ) || is_pinned( counter) ) )
+	    {
+		counter++;
+	    }
+	    want = counter;
+	}
+	if ( want > FCODE_LIMIT )
+	{
+	    fits = false;
+	    break;
+	}
+	holder = nu_owner[want];
+	if ( ( holder != -1 ) && ( last_use[holder] > defn->tokn_item ) )
+	{
+	    fits = false;
+	    break;
+	}
+	defn->nu_fcode = want;
+	nu_owner[want] = order[indx];
+	if ( ! pinned )  counter = want + 1;
+	if ( want >= seg_next )  seg_next = want + 1;
+
+	if ( defn->fcode > old_high )  old_high = defn->fcode;
+	if ( want > nu_high )  nu_high = want;
+	if ( want != defn->fcode )  changed = true;
+    }
+    free( last_use);
+
+    if ( fits && ! counter_follows )
+    {
+	/*  The last Range ended with the last definition the Tokenizer made  */
+	indx = num_defns - 1;
+	while ( ( indx > 0 ) && defns[indx].synthetic )  indx--;
+	fits = note_range_move( defns[indx].fcode + 1, seg_next);
+    }
+
+    if ( ! fits )
+    {
+	tokenization_error( WARNING,
+	    "Explicitly-set FCode numbers prevent reassignment in order "
+		"of placement; leaving FCode numbers unchanged.\n");
+	for ( indx = 0 ; indx < num_defns ; indx++ )
+	{
+	    defns[indx].nu_fcode = prior_fcode[indx];
+	}
+	num_range_moves = 0;
+	free( order);
+	free( prior_fcode);
+	return ( false );
+    }
+
+    if ( verbose )
+    {
+	printf( "    FCode number map:\n");
+	for ( indx = 0 ; indx < num_defns ; indx++ )
+	{
+	    fc_defn_t *defn = &defns[order[indx]];
+	    if ( defn->dropped )  continue;
+	    printf( "        0x%03x -> 0x%03x%s  %s\n",
+		defn->fcode, defn->nu_fcode,
+		    defn->anchored ? " (fixed)" :
+			is_pinned( defn->fcode) ? " (F['])" : "",
+			    defn->name != NULL ? defn->name :
+				defn->synthetic ? "(factored)" : "(unnamed)");
+	}
+	printf( "toke: highest FCode number was 0x%03x; now 0x%03x.\n",
+	    old_high, nu_high);
+    }
+
+    free( order);
+    free( prior_fcode);
+
+    if ( counter_follows )  planned_next = seg_next;
+    return ( changed );
+}
+
+/* **************************************************************************
+ *
+ *      Support routines for writing the replacement body.
+ *
+ **************************************************************************** */
+
+static void out_byte( u8 data)
+{
+    if ( nu_body_len == nu_body_size )
+    {
+	nu_body_size = nu_body_size ? nu_body_size * 2 : 0x10000;
+	nu_body_buf = realloc( nu_body_buf, nu_body_size);
+	if ( nu_body_buf == NULL )
+	{
+	    tokenization_error( FATAL, "Out of memory rewriting FCode image");
+	}
+    }
+    nu_body_buf[nu_body_len++] = data;
+}
+
+static void out_fcode( u16 tok)
+{
+    if ( tok >> 8 )  out_byte( tok >> 8);
+    out_byte( tok & 0xff);
+}
+
+/*  The new number of the token referenced by an item, or its old one  */
+static u16 renumbered( u16 tok, int ref_defn)
+{
+    if ( ( tok >= FCODE_START ) && ( ref_defn >= 0 ) )
+    {
+	tok = defns[ref_defn].nu_fcode;
+    }
+    return ( tok );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  write_item
+ *      Synopsis:       Write one item into the replacement body,
+ *                          renumbering the token it refers to.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             body                   The original image body
+ *             indx                   Index of the item
+ *             nu_offs_fld            Where to record the position of a
+ *                                        branch's FCode-offset field
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Supplied Pointers:
+ *             nu_offs_fld[indx]      Set if the item is a branch; the
+ *                                        FCode-offset is written as zero
+ *                                        and filled in afterwards.
+ *
+ **************************************************************************** */
+
+static void write_item( u8 *body, int indx, unsigned int *nu_offs_fld)
+{
+    fc_item_t *item = &items[indx];
+    unsigned int opnd = item->ob_off;
+    fc_role_t role = role_of( item->fcode);
+
+    /*  Skip over the token itself in the original  */
+    opnd += ( item->fcode > 0xff ) ? 2 : 1;
+
+    switch ( role )
+    {
+	case ROLE_NEW_TOKEN:
+	case ROLE_NAMED_TOKEN:
+	    out_fcode( item->fcode);
+	    if ( role == ROLE_NAMED_TOKEN )
+	    {
+		unsigned int str_len = 1 + body[opnd];
+		while ( str_len-- > 0 )  out_byte( body[opnd++]);
+	    }
+	    out_fcode( defns[item->in_defn].nu_fcode);
+	    break;
+
+	case ROLE_TICK:
+	case ROLE_TO:
+	    out_fcode( item->fcode);
+	    out_fcode( renumbered( item->opnd_tok, item->ref_defn));
+	    break;
+
+	case ROLE_BRANCH:
+	    out_fcode( item->fcode);
+	    nu_offs_fld[indx] = nu_body_len;
+	    out_byte( 0);
+	    if ( item->offs_len == 2 )  out_byte( 0);
+	    break;
+
+	default:
+	    out_fcode( renumbered( item->fcode, item->ref_defn));
+	    while ( opnd < item->ob_off + item->length )
+	    {
+		out_byte( body[opnd++]);
+	    }
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  write_inlined_body
+ *      Synopsis:       Write the body of a definition into the replacement
+ *                          body in place of a call to it.
+ *
+ *      Process Explanation:
+ *          Calls within the body that are themselves expanded in place are
+ *              expanded here as well.  The body contains no branches.
+ *
+ **************************************************************************** */
+
+static void write_inlined_body( u8 *body, int defn_indx)
+{
+    fc_defn_t *defn = &defns[defn_indx];
+    int indx;
+
+    for ( indx = defn->tokn_item + 2 ; indx < defn->last_item ; indx++ )
+    {
+	if ( items[indx].inlined >= 0 )
+	{
+	    write_inlined_body( body, items[indx].inlined);
+	}else{
+	    write_item( body, indx, NULL);
+	}
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  write_factored_defn
+ *      Synopsis:       Write a definition made by factoring a common
+ *                          sequence into the replacement body.
+ *
+ *      Process Explanation:
+ *          The body is a copy of one occurrence of the sequence, which
+ *              contains no branches.
+ *
+ **************************************************************************** */
+
+static void write_factored_defn( u8 *body, fc_defn_t *defn)
+{
+    int indx;
+
+    out_fcode( fcode_by_name( "new-token"));
+    out_fcode( defn->nu_fcode);
+    out_fcode( defn->definer);
+    for ( indx = defn->src_item ;
+	  indx < defn->src_item + defn->src_count ; indx++ )
+    {
+	write_item( body, indx, NULL);
+    }
+    out_fcode( fcode_by_name( "b(;)"));
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  write_image_body
+ *      Synopsis:       Write the replacement body from the lists of
+ *                          items and definitions.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             body                   The original image body
+ *             len                    Its length
+ *
+ *      Outputs:
+ *         Returned Value:            FALSE if a branch no longer fits
+ *                                        in its FCode-offset
+ *         Local Static Variables:
+ *             nu_body_buf            The replacement body
+ *             nu_body_len            Its length
+ *
+ *      Process Explanation:
+ *          Dropped definitions are replaced by their stand-in, if any.
+ *          Factored definitions are written before the item recorded
+ *              for them, and each occurrence of a factored sequence is
+ *              replaced by a call to its definition.
+ *          A call that is expanded in place is replaced by a copy of the
+ *              body of the definition it calls.
+ *          Tokens that refer to a renumbered definition are renumbered.
+ *          The new position of every item is recorded as it is written;
+ *              a dropped item's new position is where its replacement
+ *              (if any) begins.  After all the items are written, every
+ *              FCode-offset is recalculated from the new positions of the
+ *              branch and its target.  The sizes of the offsets do not
+ *              change, so the positions do not depend on their values.
+ *
+ **************************************************************************** */
+
+static bool write_image_body( u8 *body, unsigned int len)
+{
+    unsigned int *nu_off = safe_malloc( (num_items + 1) * sizeof(int),
+					"rewriting FCode image");
+    unsigned int *nu_offs_fld = safe_malloc( (num_items + 1) * sizeof(int),
+					     "rewriting FCode image");
+    int *synths = safe_malloc( (num_defns + 1) * sizeof(int),
+			       "rewriting FCode image");
+    int num_synths = 0;
+    int next_synth = 0;
+    bool retval = true;
+    int indx;
+
+    /*  Factored definitions, in order of their placement  */
+    for ( indx = 0 ; indx < num_defns ; indx++ )
+    {
+	if ( defns[indx].synthetic )  synths[num_synths++] = indx;
+    }
+    qsort( synths, num_synths, sizeof(int), compare_placement);
+
+    nu_body_len = 0;
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	fc_item_t *item = &items[indx];
+
+	while ( ( next_synth < num_synths ) &&
+		( defns[synths[next_synth]].first_item == indx ) )
+	{
+	    write_factored_defn( body, &defns[synths[next_synth]]);
+	    next_synth++;
+	}
+
+	nu_off[indx] = nu_body_len;
+
+	if ( ( item->in_defn >= 0 ) && defns[item->in_defn].dropped )
+	{
+	    fc_defn_t *defn = &defns[item->in_defn];
+	    if ( indx == defn->first_item )
+	    {
+		char *stand_in = stand_in_for( defn->definer);
+		if ( *stand_in != 0 )  out_fcode( fcode_by_name( stand_in));
+	    }
+	    continue;
+	}
+
+	if ( item->consumed )
+	{
+	    if ( item->replaced_by >= 0 )
+	    {
+		out_fcode( defns[item->replaced_by].nu_fcode);
+	    }
+	    continue;
+	}
+
+	if ( item->inlined >= 0 )
+	{
+	    write_inlined_body( body, item->inlined);
+	    continue;
+	}
+
+	write_item( body, indx, nu_offs_fld);
+    }
+    nu_off[num_items] = nu_body_len;
+
+    /*  Whatever followed the end-token goes along unchanged  */
+    for ( indx = body_trailer ; indx < len ; indx++ )
+    {
+	out_byte( body[indx]);
+    }
+
+    /*  Recalculate the FCode-offsets  */
+    for ( indx = 0 ; indx < num_items ; indx++ )
+    {
+	fc_item_t *item = &items[indx];
+	int nu_offset;
+
+	if ( ( item->offs_len == 0 ) || item->consumed ||
+	     ( ( item->in_defn >= 0 ) && defns[item->in_defn].dropped ) )
+	{
+	    continue;
+	}
+	nu_offset = (int)nu_off[item->target] - (int)nu_offs_fld[indx];
+	if ( item->offs_len == 2 )
+	{
+	    if ( nu_offset != (s16)nu_offset )
+	    {
+		retval = false;
+		break;
+	    }
+	    nu_body_buf[nu_offs_fld[indx]] = ( nu_offset >> 8 ) & 0xff;
+	    nu_body_buf[nu_offs_fld[indx] + 1] = nu_offset & 0xff;
+	}else{
+	    if ( nu_offset != (s8)nu_offset )
+	    {
+		retval = false;
+		break;
+	    }
+	    nu_body_buf[nu_offs_fld[indx]] = nu_offset & 0xff;
+	}
+    }
+
+    free( nu_off);
+    free( nu_offs_fld);
+    free( synths);
+    return ( retval );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  run_image_passes
+ *      Synopsis:       Apply the enabled Whole-Image passes to the body
+ *                          of a finished FCode image.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             body                   The image body in the Output Buffer
+ *             body_ob_off            Its position in the Output Buffer
+ *             body_len               Its length, including the end-token
+ *         Local Static Variables:
+ *             raw_emission           If set, leave the image alone
+ *
+ *      Outputs:
+ *         Returned Value:            TRUE if a replacement body was made
+ *         Supplied Pointers:
+ *             *nu_body               The replacement body
+ *             *nu_len                Its length
+ *
+ *      Error Detection:
+ *          If the body cannot be read back, or a rewritten branch would
+ *              no longer fit in its FCode-offset, issue a WARNING and
+ *              leave the image unchanged.
+ *
+ *      Extraneous Remarks:
+ *          The replacement body belongs to this module; it is valid until
+ *              the next call.  The definition notes, which are kept in
+ *              Output Buffer positions, are not consulted after this.
+ *
+ **************************************************************************** */
+
+bool run_image_passes( u8 *body, unsigned int body_ob_off,
+                           unsigned int body_len,
+			       u8 **nu_body, unsigned int *nu_len)
+{
+    bool retval = false;
+    bool changed = false;
+    bool factored = false;
+    int indx;
+
+    if ( ! image_passes_wanted() )  return ( false );
+
+    if ( raw_emission )
+    {
+	tokenization_error( WARNING,
+	    "Raw bytes were emitted into this image; "
+		"skipping Whole-Image passes.\n");
+	return ( false );
+    }
+
+    init_specials();
+
+    /*  Notes are kept by Output Buffer position; make them body-relative  */
+    for ( indx = 0 ; indx < num_notes ; indx++ )
+    {
+	defn_notes[indx].ob_off -= body_ob_off;
+    }
+
+    if ( ! read_image_body( body, body_len) )
+    {
+	tokenization_error( WARNING,
+	    "Could not analyze FCode image; "
+		"skipping Whole-Image passes.\n");
+	return ( false );
+    }
+
+    compacted_next = 0;
+    planned_next = nextfcode;
+    counter_follows = ( num_defns > 0 ) &&
+			  ( nextfcode == defns[num_defns - 1].fcode + 1 );
+    num_range_moves = 0;
+    if ( drop_unused_headerless )
+    {
+	changed = drop_unused_defns() || changed;
+    }
+    if ( inline_tiny_headerless )
+    {
+	changed = inline_tiny_defns() || changed;
+    }
+    if ( factor_common_sequences )
+    {
+	factored = factor_common_seqs( body);
+	changed = factored || changed;
+    }
+    if ( dense_fcode_numbers || factored )
+    {
+	changed = renumber_in_order( dense_fcode_numbers) || changed;
+    }
+
+    if ( changed )
+    {
+	if ( write_image_body( body, body_len) )
+	{
+	    *nu_body = nu_body_buf;
+	    *nu_len = nu_body_len;
+	    commit_next_fcode();
+	    retval = true;
+	}else{
+	    tokenization_error( WARNING,
+		"Rewritten branch would not fit its FCode-offset; "
+		    "leaving image unchanged.\n");
+	}
+    }
+    return ( retval );
+}
@@ -0,0 +1,79 @@
+#ifndef _TOKE_FCIMAGE_H
+#define _TOKE_FCIMAGE_H
+
+/*
+ *                     OpenBIOS - free your system!
+ *                         ( FCode tokenizer )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Function Prototypes for the Whole-Image passes that are run
+ *          over the buffered FCode of an image when it is finished.
+ *
+ **************************************************************************** */
+
+#include "types.h"
+#include "scanner.h"
+
+/* ************************************************************************** *
+ *
+ *      Macros:
+ *          FACTOR_MIN_SAVINGS_DEFAULT   Least number of bytes that factoring
+ *                                           out a common sequence must save,
+ *                                           unless set otherwise by the User
+ *          INLINE_MAX_BYTES_DEFAULT     Largest body of a definition that
+ *                                           will be expanded in place,
+ *                                           unless set otherwise by the User
+ *
+ **************************************************************************** */
+
+#define FACTOR_MIN_SAVINGS_DEFAULT   8
+#define INLINE_MAX_BYTES_DEFAULT     4
+
+/* ************************************************************************** *
+ *
+ *      Global Variables Exported
+ *
+ **************************************************************************** */
+
+extern int factor_min_savings;
+extern int inline_max_bytes;
+
+
+/* ************************************************************************** *
+ *
+ *      Function Prototypes / Functions Exported:
+ *
+ **************************************************************************** */
+
+void start_image_notes( bool is_offs16);
+void note_definition( unsigned int ob_off, u16 fcode,
+                          char *name, headeredness hdr);
+void note_pinned_fcode( u16 fcode);
+void note_raw_emission( void);
+bool image_passes_wanted( void);
+bool run_image_passes( u8 *body, unsigned int body_ob_off,
+                           unsigned int body_len,
+			       u8 **nu_body, unsigned int *nu_len);
+
+#endif   /*  _TOKE_FCIMAGE_H    */
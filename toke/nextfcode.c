@@ -73,6 +73,17 @@
  *                                   errors.
  *          bump_fcode           Increment the next FCode number prior to the
  *                                    next assignment.
+ *          anchor_next_fcode    Record that the next FCode number was
+ *                                    set explicitly by the User.
+ *          next_fcode_is_anchored   Indicate whether the next FCode number
+ *                                    was set explicitly by the User.
+ *          compact_next_fcode   Retract the next FCode number after the
+ *                                    assignments at the end of the Current
+ *                                    Range have been compacted.
+ *          fcode_range_can_grow Indicate whether an earlier Range could be
+ *                                    carried further without overlap.
+ *          move_fcode_range_end Move the end of an earlier Range after
+ *                                    its assignments have been renumbered.
  *
  **************************************************************************** */
 
@@ -192,6 +203,10 @@ typedef struct fcode_range
  *     current_fc_range          Pointer to the entry in the linked list of
  *                                   Ranges that contains the Current Range.
  *
+ *     next_fcode_anchored       TRUE if the User explicitly set the next
+ *                                   FCode number, and it has not yet been
+ *                                   assigned.
+ *
  **************************************************************************** */
 
 static bool           ranges_exist      = false;
@@ -205,6 +220,8 @@ static int            first_fcr_linenum = 0;
 static fcode_range_t *first_fc_range    = NULL;
 static fcode_range_t *current_fc_range  = NULL;
 
+static bool           next_fcode_anchored = false;
+
 /* **************************************************************************
  *
  *      Function name:  reset_fcode_ranges
@@ -291,6 +308,7 @@ void reset_fcode_ranges( void)
     }
     first_fcr_linenum = lineno;
     nextfcode         = FCODE_START;
+    next_fcode_anchored = false;
 }
 
 /* **************************************************************************
@@ -690,6 +708,9 @@ void assigning_fcode( void)
  *         Returned Value:               NONE
  *         Global Variables:
  *             nextfcode                 Incremented
+ *         Local Static Variables:
+ *             next_fcode_anchored       Cleared; the anchored number
+ *                                           has been assigned.
  *
  *      Extraneous Remarks:
  *          This looks like a no-brainer now, but if we ever need this
@@ -702,4 +723,253 @@ void assigning_fcode( void)
 void bump_fcode( void)
 {
     nextfcode++;
+    next_fcode_anchored = false;
+}
+
+
+/* **************************************************************************
+ *
+ *      Function name:  anchor_next_fcode
+ *      Synopsis:       Record that the next FCode number was set explicitly
+ *                          by the User, and must be assigned as-is even if
+ *                          the numbers are later reassigned densely.
+ *
+ *      Associated Tokenizer directives:        next-fcode  fcode-pop
+ *
+ *      Inputs:
+ *         Parameters:                   NONE
+ *
+ *      Outputs:
+ *         Returned Value:               NONE
+ *         Local Static Variables:
+ *             next_fcode_anchored       Set to TRUE
+ *
+ **************************************************************************** */
+
+void anchor_next_fcode( void)
+{
+    next_fcode_anchored = true;
+}
+
+
+/* **************************************************************************
+ *
+ *      Function name:  next_fcode_is_anchored
+ *      Synopsis:       Indicate whether the FCode number about to be
+ *                          assigned was set explicitly by the User.
+ *
+ *      Outputs:
+ *         Returned Value:               TRUE if so.
+ *
+ **************************************************************************** */
+
+bool next_fcode_is_anchored( void)
+{
+    return ( next_fcode_anchored );
+}
+
+
+/* **************************************************************************
+ *
+ *      Function name:  compact_next_fcode
+ *      Synopsis:       Retract the next assignable FCode number after the
+ *                          numbers assigned at the end of the Current Range
+ *                          have been compacted.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_next                  The number that would have followed
+ *                                           the last one assigned in the image
+ *             nu_next                   The number that follows the last one
+ *                                           assigned after compaction
+ *         Global Variables:
+ *             nextfcode                 The next FCode-number to be assigned
+ *         Local Static Variables:
+ *             ranges_exist              TRUE if FCode Ranges have been created
+ *             range_start               First FCode in the only range
+ *             current_fc_range          Pointer to the current Range
+ *
+ *      Outputs:
+ *         Returned Value:               NONE
+ *         Global Variables:
+ *             nextfcode                 May be retracted to  nu_next
+ *         Local Static Variables:
+ *                    One of these two may be retracted to match
+ *             range_end                       ... if  ranges_exist  is FALSE
+ *             current_fc_range->fcr_end       ... if  ranges_exist  is TRUE
+ *
+ *      Process Explanation:
+ *          Only retract if the Assignment Counter still continues from the
+ *              last number assigned in the image, i.e., if there has been no
+ *              intervening change of Range.  Retracting the end of the
+ *              Current Range keeps the final tally and the Overlap test
+ *              consistent with the numbers actually in use.
+ *          If no numbers remain assigned in the Current Range, its end
+ *              reverts to zero, just as though none had been assigned.
+ *
+ **************************************************************************** */
+
+void compact_next_fcode( u16 old_next, u16 nu_next)
+{
+    if ( ( nextfcode == old_next ) && ( nu_next < old_next ) )
+    {
+	u16 range_first = ranges_exist ? current_fc_range->fcr_start
+	                               : range_start;
+	u16 nu_end = ( nu_next > range_first ) ? nu_next - 1 : 0;
+
+	if ( ranges_exist )
+	{
+	    current_fc_range->fcr_end = nu_end;
+	}else{
+	    range_end = nu_end;
+	}
+	nextfcode = nu_next;
+	changes_listed = false;
+    }
+}
+
+
+/* **************************************************************************
+ *
+ *      Function name:  find_range_ending
+ *      Synopsis:       Return a pointer to the latest Range whose last
+ *                          assignment is the given FCode, if any.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             end_fcode                  FCode to look for
+ *         Local Static Variables:
+ *             first_fc_range             Start of Ranges to search
+ *
+ *      Outputs:
+ *         Returned Value:                Pointer to the Range, or NULL
+ *
+ *      Process Explanation:
+ *          Only meaningful if  ranges_exist  is TRUE.
+ *
+ **************************************************************************** */
+
+static fcode_range_t *find_range_ending( u16 end_fcode)
+{
+    fcode_range_t *retval = NULL;
+    fcode_range_t *test_range = first_fc_range;
+    while ( test_range != NULL )
+    {
+	if ( test_range->fcr_end == end_fcode )
+	{
+	    retval = test_range;
+	}
+	test_range = test_range->fcr_next;
+    }
+    return( retval);
+}
+
+
+/* **************************************************************************
+ *
+ *      Function name:  fcode_range_can_grow
+ *      Synopsis:       Indicate whether the Range that ends at a given
+ *                          number could be carried further without
+ *                          overlapping any other Range.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_next                  The number that follows the last
+ *                                           one assigned in the Range
+ *             nu_next                   The number that would follow it
+ *         Local Static Variables:
+ *             ranges_exist              If not TRUE, there is no other Range
+ *             first_fc_range            Start of Ranges to test
+ *
+ *      Outputs:
+ *         Returned Value:               TRUE if no other Range has an
+ *                                           assignment among the numbers
+ *                                           from  old_next  up to  nu_next
+ *
+ **************************************************************************** */
+
+bool fcode_range_can_grow( u16 old_next, u16 nu_next)
+{
+    bool retval = true;
+    if ( ranges_exist && ( nu_next > old_next ) )
+    {
+	fcode_range_t *own_range = find_range_ending( old_next - 1);
+	fcode_range_t *test_range = first_fc_range;
+	while ( test_range != NULL )
+	{
+	    if ( ( test_range != own_range ) &&
+	         ( test_range->fcr_end != 0 ) &&
+	         ( test_range->fcr_start < nu_next ) &&
+	         ( test_range->fcr_end >= old_next ) )
+	    {
+		retval = false;
+		break;
+	    }
+	    test_range = test_range->fcr_next;
+	}
+    }
+    return( retval);
+}
+
+
+/* **************************************************************************
+ *
+ *      Function name:  move_fcode_range_end
+ *      Synopsis:       Move the end of the Range that ends at a given
+ *                          number, after the assignments in it have been
+ *                          renumbered, without touching the next assignable
+ *                          FCode number.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             old_next                  The number that followed the last
+ *                                           one assigned in the Range
+ *             nu_next                   The number that follows the last
+ *                                           one assigned after renumbering
+ *         Local Static Variables:
+ *             ranges_exist              TRUE if FCode Ranges have been created
+ *             range_start               First FCode in the only range
+ *             range_end                 Last FCode in the only range
+ *
+ *      Outputs:
+ *         Returned Value:               NONE
+ *         Local Static Variables:
+ *                    One of these two may be moved
+ *             range_end                       ... if  ranges_exist  is FALSE
+ *             fcr_end  of the Range           ... if  ranges_exist  is TRUE
+ *             changes_listed            Reset to FALSE
+ *
+ *      Process Explanation:
+ *          This serves for a Range that was closed by a change of Range
+ *              (e.g., by  next-fcode ) after its last assignment, whose
+ *              end  compact_next_fcode()  therefore does not reach.
+ *          The Range is identified by its last assignment.  If more than
+ *              one Range ends there, the latest one is meant.  If none
+ *              does, there is nothing to move.
+ *          The calling routine will have made sure, by means of
+ *               fcode_range_can_grow() , that a Range that grows does
+ *              not come to overlap another.
+ *
+ **************************************************************************** */
+
+void move_fcode_range_end( u16 old_next, u16 nu_next)
+{
+    u16 old_end = old_next - 1;
+
+    if ( !ranges_exist )
+    {
+	if ( range_end == old_end )
+	{
+	    range_end = ( nu_next > range_start ) ? nu_next - 1 : 0;
+	    changes_listed = false;
+	}
+    }else{
+	fcode_range_t *found_range = find_range_ending( old_end);
+	if ( found_range != NULL )
+	{
+	    found_range->fcr_end = ( nu_next > found_range->fcr_start ) ?
+	                               nu_next - 1 : 0;
+	    changes_listed = false;
+	}
+    }
 }
@@ -58,6 +58,11 @@ void list_fcode_ranges( bool final_tally);
 void set_next_fcode( u16  new_fcode);
 void assigning_fcode( void);
 void bump_fcode( void);
+void anchor_next_fcode( void);
+bool next_fcode_is_anchored( void);
+void compact_next_fcode( u16 old_next, u16 nu_next);
+bool fcode_range_can_grow( u16 old_next, u16 nu_next);
+void move_fcode_range_end( u16 old_next, u16 nu_next);
 
 /* **************************************************************************
  *
@@ -33,6 +33,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #ifdef __GLIBC__
 #define __USE_XOPEN_EXTENDED
 #endif
@@ -57,6 +59,8 @@
 #include "devnode.h"
 #include "tracesyms.h"
 #include "nextfcode.h"
+#include "fcimage.h"
+#include "sizemap.h"
 
 #include "parselocals.h"
 
@@ -107,6 +111,7 @@ static u16  last_colon_fcode;  /*  FCode-number assigned to last colon-def'n  */
 
 static bool do_not_overload = true ;  /*  False to suspend dup-name-test     */
 static bool got_until_eof = false ;   /*  TRUE to signal "unterminated"      */
+static size_t statbuf_size = 0;       /*  Current allocated size of statbuf  */
 
 static unsigned int last_colon_do_depth = 0;
 
@@ -223,6 +228,66 @@ bool skip_until( char lim_ch)
 }
 
 
+/* **************************************************************************
+ *
+ *      Function name:  room_in_statbuf
+ *      Synopsis:       Make sure the string being accumulated in statbuf
+ *                          has room for the given number of additional
+ *                          bytes, plus a terminating null.  Enlarge the
+ *                          buffer if it does not.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             nu_bytes          Number of bytes about to be added
+ *             walk              Pointer to pointer to the position
+ *                                   in  statbuf  where they will go
+ *         Local Static Variables:
+ *             statbuf_size      Current allocated size of  statbuf
+ *
+ *      Outputs:
+ *         Returned Value:       NONE
+ *         Global Variables:
+ *             statbuf           May be relocated
+ *         Local Static Variables:
+ *             statbuf_size      May be increased
+ *         Supplied Pointers:
+ *             *walk             Re-aimed into the relocated buffer
+ *
+ *      Error Detection:
+ *          FATAL if  realloc()  fails.
+ *
+ *      Process Explanation:
+ *          The buffer is doubled until it fits, so a long string costs
+ *              only a handful of reallocations.  It never shrinks; the
+ *              routines that gather single words into  statbuf  rely
+ *              on its being at least  GET_BUF_MAX  bytes.
+ *
+ **************************************************************************** */
+
+static void room_in_statbuf( size_t nu_bytes, u8 **walk )
+{
+    size_t used = *walk - statbuf;
+    size_t needed = used + nu_bytes + 1;
+
+    if ( needed > statbuf_size )
+    {
+	size_t nu_size = statbuf_size;
+	u8 *nu_buf;
+
+	while ( nu_size < needed )  nu_size *= 2;
+	nu_buf = realloc( statbuf, nu_size);
+	if ( nu_buf == NULL )
+	{
+	    tokenization_error( FATAL,
+		"Could not reallocate %lu bytes for string buffer",
+		    (unsigned long)nu_size);
+	}
+	statbuf = nu_buf;
+	statbuf_size = nu_size;
+	*walk = statbuf + used;
+    }
+}
+
 /* **************************************************************************
  *
  *      Function name:  get_until
@@ -250,9 +315,9 @@ bool skip_until( char lim_ch)
  *                                 not a sufficient indication.
  *
  *      Error Detection:
- *          If string overflows  statbuf  allocation, ERROR, and 
- *              return "no string" (i.e., length = 0).
- *          Otherwise, if delimiter not found before eof, keep string.
+ *          If the string is longer than the  statbuf  allocation, the
+ *              buffer is enlarged to hold it.
+ *          If delimiter not found before eof, keep string.
  *              Protection against PC pointer-over-run past END is
  *              provided by  skip_until() .  Reaching END will be
  *              handled by calling routine; pass indication along
@@ -274,6 +339,7 @@ bool skip_until( char lim_ch)
 static signed long get_until(char needle)
 {                                                                               
 	u8 *safe;                                                         
+	u8 *walk;
 	unsigned long len = 0;
 
 	safe=pc;
@@ -281,12 +347,8 @@ static signed long get_until(char needle)
 	got_until_eof = skip_until(needle);
 
 	len = pc - safe;
-	if (len >= GET_BUF_MAX )
-	{
-	    tokenization_error( TKERROR,
-		"get_until buffer overflow.  Max is %d.\n", GET_BUF_MAX-1 );
-	    len = GET_BUF_MAX-1;
-}
+	walk = statbuf;
+	room_in_statbuf( len, &walk);
 
 	memcpy(statbuf, safe, len);
 	statbuf[len]=0;
@@ -406,6 +468,11 @@ void push_source( void (*res_func)(_PTR), _PTR res_parm, bool file_chg )
     new_sav_src->resump_param = res_parm;
 
     saved_source = new_sav_src;
+
+    if ( file_chg )
+    {
+	note_size_source_change();
+    }
 }
 
 /* **************************************************************************
@@ -499,6 +566,7 @@ static bool pop_source( void )
 	    }
 	}
 
+	note_size_source_change();
 	if ( saved_source->resump_func != NULL )
 	{
 	    saved_source->resump_func( saved_source->resump_param);
@@ -907,31 +975,67 @@ static void string_remark(char *errmsg_txt)
 }
 
 
-/*  Convert the given string to a number in the supplied base   */
-/*  Allow -- and ignore -- embedded periods.    */
-/*  The  endptr  param represents a pointer that will be updated
- *      with the address of the first non-numeric character encountered,
- *      (unless it is a NULL, in which case it is ignored).
- */
-/*  There is no test for a completely invalid string;
- *  the calling routine is responsible for ascertaining
- *  the validity of the string being passed.
- */
-static long parse_number(u8 *start, u8 **endptr, int lbase) 
+/* **************************************************************************
+ *
+ *      Function name:  parse_number
+ *      Synopsis:       Convert the given string to a number in the
+ *                          supplied base.  Allow -- and ignore --
+ *                          embedded periods.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             start             Pointer to the string to convert
+ *             limit             Pointer past which not to look.  The
+ *                                   string also ends at a null-byte.
+ *             endptr            Pointer to pointer to update with the
+ *                                   address of the first non-numeric
+ *                                   character encountered.  If NULL,
+ *                                   it is ignored.
+ *             lbase             Numeric base
+ *             ovfl              Pointer to a flag to set if the number
+ *                                   does not fit in an FCode cell.
+ *                                   If NULL, it is ignored.
+ *
+ *      Outputs:
+ *         Returned Value:       The number.  If it overflowed, the
+ *                                   low-order bits of it.
+ *         Supplied Pointers:
+ *             *endptr           As described above.
+ *             *ovfl             As described above.
+ *
+ *      Error Detection:
+ *          There is no test for a completely invalid string;
+ *              the calling routine is responsible for ascertaining
+ *              the validity of the string being passed.
+ *
+ *      Process Explanation:
+ *          A leading minus-sign negates the result.
+ *          Overflow is tested before each digit is accumulated, against
+ *              the largest value an FCode cell (32 bits) can hold, so
+ *              the test does not depend on the size of a  long  on
+ *              the host.  The accumulation is unsigned, so the low-order
+ *              bits are the same as they would have been in a  long .
+ *
+ **************************************************************************** */
+
+#define  FCODE_CELL_MAX   0xffffffffUL
+
+static long parse_number(u8 *start, u8 *limit, u8 **endptr,
+                              int lbase, bool *ovfl)
 {
-	long val = 0;
+	unsigned long val = 0;
+	bool overflow = false;
 	bool negative = false ;
-	int  curr;
+	int  curr = 0;
 	u8 *nptr=start;
 
-	curr = *nptr;
-	if (curr == '-')
+	if ( (nptr < limit) && (*nptr == '-') )
 	{
 		negative = true ;
 		nptr++;
 	}
 	
-	for (curr = *nptr; (curr = *nptr); nptr++) {
+	for ( ; (nptr < limit) && (curr = *nptr); nptr++) {
 		if ( curr == '.' )
 			continue;
 		if ( curr >= '0' && curr <= '9')
@@ -946,32 +1050,36 @@ static long parse_number(u8 *start, u8 **endptr, int lbase)
 		if (curr >= lbase)
 			break;
 		
+		if ( val > ( FCODE_CELL_MAX - curr ) / lbase )
+			overflow = true;
 		val *= lbase;
 		val += curr;
 	}
 
 #ifdef DEBUG_SCANNER
-	if (curr)
+	if ( (nptr < limit) && *nptr )
 		printf( "%s:%d: warning: couldn't parse number '%s' (%d/%d)\n",
-				iname, lineno, start,curr,lbase);
+				iname, lineno, start, *nptr, lbase);
 #endif
 
 	if (endptr)
 		*endptr=nptr;
+	if (ovfl)
+		*ovfl=overflow;
 
 	if (negative)
 	{
 		val = -val;
 	}
-	return val;
+	return (long)val;
 }
 
 /* **************************************************************************
  *
  *      Function name:  add_byte_to_string
  *      Synopsis:       Add the given byte (or character) to the string
- *                          being accumulated in statbuf, but protect
- *                          against a buffer overflow.
+ *                          being accumulated in statbuf, enlarging
+ *                          the buffer as needed.
  *
  *      Inputs:
  *         Parameters:
@@ -981,29 +1089,70 @@ static long parse_number(u8 *start, u8 **endptr, int lbase)
  *                                   is to be placed
  *         Global Variables:
  *             statbuf           Buffer where the string is accumulated
- *         Macros:
- *             GET_BUF_MAX       Size of the buffer
  *
  *      Outputs:
  *         Returned Value:       NONE
  *         Supplied Pointers:
  *             **walk            Given character is placed here
- *             *walk             Incremented in any case
- *
- *      Error Detection:
- *          If  walk  has reached end of string buffer, do not place
- *              the character, but continue to increment  walk .
- *              Calling routine will detect overflow.
+ *             *walk             Incremented
  *
  **************************************************************************** */
 				
 static void add_byte_to_string( u8 nu_byte, u8 **walk )
 {
-    if ( *walk - statbuf < GET_BUF_MAX )
+    room_in_statbuf( 1, walk);
+    *((*walk)++) = nu_byte;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  add_run_to_string
+ *      Synopsis:       Copy a run of ordinary characters from the input
+ *                          into the string being accumulated in statbuf
+ *
+ *      Inputs:
+ *         Parameters:
+ *             special           String of the characters that end a run
+ *             walk              Pointer to pointer to the position
+ *                                   in  statbuf  where the run goes
+ *         Global Variables:
+ *             pc                Input-source Scanning pointer; points
+ *                                   at the first character of the run
+ *             end               End of input-source buffer
+ *
+ *      Outputs:
+ *         Returned Value:       NONE
+ *         Global Variables:
+ *             pc                Points to last character copied
+ *         Supplied Pointers:
+ *             *walk             Advanced by the length of the run
+ *
+ *      Process Explanation:
+ *          The character at PC is always taken, whatever it is; the run
+ *              continues up to the next character in the  special  set.
+ *          The search is left to  strcspn() , which the C library does
+ *              a word (or a vector register) at a time, rather than the
+ *              byte-at-a-time  switch  in  get_string() .  It stops on
+ *              the null-byte that  init_stream  forces at the end of
+ *              the input buffer, if not before; we also hold it to END
+ *              for good measure.
+ *          Leaving PC on the last character copied lets the caller's
+ *              usual advance-and-check-for-END step take over from here.
+ *
+ **************************************************************************** */
+
+static void add_run_to_string( const char *special, u8 **walk )
+{
+    size_t run_len = 1 + strcspn( (char *)pc + 1, special);
+
+    if ( run_len > (size_t)(end - pc) )
     {
-	**walk = nu_byte;
-	}
-    (*walk)++;
+	run_len = end - pc;
+    }
+    room_in_statbuf( run_len, walk);
+    memcpy( *walk, pc, run_len);
+    *walk += run_len;
+    pc += run_len - 1;
 }
 
 /* **************************************************************************
@@ -1044,13 +1193,10 @@ static void add_byte_to_string( u8 nu_byte, u8 **walk )
  *              special-character or even of an "( ... ) hex-sequence,
  *              so don't swallow it up.
  *
- *      Still to be done:
- *          Better protection against PC pointer-over-run past END.
- *              Currently, this works, but it's held together by threads:
- *              Because  init_stream  forces a null-byte at the end of
- *              the input buffer, parse_number() exits immediately upon
- *              encountering it.  This situation could be covered more
- *              robustly...
+ *      Protection against PC pointer-over-run past END:
+ *          parse_number() is held to END.  It would stop there anyway,
+ *              because  init_stream  forces a null-byte at the end of
+ *              the input buffer.
  *
  **************************************************************************** */
 
@@ -1092,15 +1238,16 @@ static void c_string_escape( u8 **walk)
 	     */
 	    {
 		long lval;
+		bool ovfl;
 		u8 *sav_pc = pc;
-		lval=parse_number(pc, &pc, base);
+		lval=parse_number(pc, end, &pc, base, &ovfl);
 		val = (u8)lval;
 #ifdef DEBUG_SCANNER
 				if (verbose)
 					printf( "%s:%d: debug: escape code "
 						"0x%x\n",iname, lineno, val);
 #endif
-		if ( lval > 0x0ff )
+		if ( ( lval > 0x0ff ) || ovfl )
 		{
 		    tokenization_error ( WARNING,
 			"Numeric String after \\ overflows byte.  "
@@ -1286,8 +1433,8 @@ static bool get_sequence(u8 **walk)
 	}
 	if ( ready_to_parse )
 	{
-	    u8 val = parse_number(pval, NULL, 16);
-	    *((*walk)++)=val;
+	    u8 val = parse_number(pval, pval + 2, NULL, 16, NULL);
+	    add_byte_to_string( val, walk);
 #ifdef DEBUG_SCANNER
 		printf(" %02x",val);
 #endif
@@ -1453,7 +1600,13 @@ static signed long get_string( bool pack_str)
 				break;
 			    }
 			}
-			add_byte_to_string( c, &walk);
+			if ( c == '\n' )
+			{
+			    add_byte_to_string( c, &walk);
+			}else{
+			    add_run_to_string( c_style_string_escape ?
+				"\"\n\\" : "\"\n", &walk);
+			}
 		}
 		/*  Advance past the char processed, unless we're done.     */
 		if ( run ) pc++;
@@ -1473,12 +1626,6 @@ static signed long get_string( bool pack_str)
 	warn_if_multiline( "string", start_lineno);
 
 	len = walk - statbuf;
-	if (len >= GET_BUF_MAX )
-	{
-	    tokenization_error ( TKERROR,
-		"get_string buffer overflow.  Max is %d\n.", GET_BUF_MAX-1 );
-	    len = GET_BUF_MAX-1;
-	}
 #ifdef DEBUG_SCANNER
 	if (verbose)
 		printf("%s:%d: debug: scanned string: '%s'\n", 
@@ -1681,6 +1828,10 @@ void skip_user_message( tic_param_t pfield )
  *             *result             The converted number, if valid
  *                                     otherwise undefined
  *
+ *      Error Detection:
+ *          A valid number too large for a 32-bit FCode cell gets
+ *              a WARNING; its low-order 32 bits are used.
+ *
  *      Revision History:
  *          Updated Mon, 28 Mar 2005 by David L. Paktor
  *              Always use the current base.
@@ -1691,10 +1842,12 @@ void skip_user_message( tic_param_t pfield )
 bool get_number( long *result)
 {
     u8 *until;
+    u8 *word_end = statbuf + strlen((char *)statbuf);
     long val;
+    bool ovfl;
     bool retval = false ;
 
-    val = parse_number(statbuf, &until, base);
+    val = parse_number(statbuf, word_end, &until, base, &ovfl);
 	
 #ifdef DEBUG_SCANNER
     printf("%s:%d: debug: parsing number: base 0x%x, val 0x%lx, "
@@ -1705,8 +1858,15 @@ bool get_number( long *result)
     /*  If number-parsing ended before the end of the input word,
      *      then the input word was not a valid number.
      */
-    if (until==(statbuf+strlen((char *)statbuf)))
+    if ( until == word_end )
     {
+	if ( ovfl )
+	{
+	    val = (long)(u32)val;
+	    tokenization_error ( WARNING,
+		"Number %s does not fit in a 32-bit cell.  Using 0x%lx.\n",
+		    statbuf, (unsigned long)val);
+	}
 	*result=val;
 	retval = true;
     }
@@ -1881,6 +2041,7 @@ static void ascii_left_number( char *in_str)
 void init_scanner(void)
 {
 	statbuf=safe_malloc(GET_BUF_MAX, "initting scanner");
+	statbuf_size = GET_BUF_MAX;
 }
 
 /* **************************************************************************
@@ -2339,6 +2500,61 @@ static void ret_stk_access_rpt( void)
 
 
 
+/* **************************************************************************
+ *
+ *          ENCODE-FILE support.
+ *
+ *          The FCodes that make up the encoding are looked up once,
+ *              rather than by name for every chunk.
+ *
+ **************************************************************************** */
+
+static u16 b_quote_fcode;
+static u16 encode_bytes_fcode;
+static u16 encode_plus_fcode;
+static bool encode_fcodes_ready = false;
+
+static u16 encode_fcode_by_name( char *fc_name)
+{
+    tic_hdr_t *found = lookup_token( fc_name);
+    if ( found == NULL )
+    {
+	tokenization_error( FATAL, "Did not recognize FCode name %s", fc_name);
+    }
+    return ( (u16)found->pfield.deflt_elem );
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  encode_chunk
+ *      Synopsis:       Encode one chunk of the file's contents, and
+ *                          join it to what has been encoded before.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             chunk             Pointer to the bytes of the chunk
+ *             len               Its length; no more than STRING_LEN_MAX
+ *             chunk_num         Its position, counting from one
+ *
+ *      Outputs:
+ *         Returned Value:       NONE
+ *         FCode Output Buffer:
+ *             b(") <string> encode-bytes , followed by  encode+
+ *                 for all but the first chunk.
+ *
+ **************************************************************************** */
+
+static void encode_chunk( u8 *chunk, size_t len, unsigned long chunk_num)
+{
+    emit_fcode( b_quote_fcode);
+    emit_string( chunk, len);
+    emit_fcode( encode_bytes_fcode);
+    if ( chunk_num > 1 )
+    {
+	emit_fcode( encode_plus_fcode);
+    }
+}
+
 /* **************************************************************************
  *
  *      Function name:  encode_file
@@ -2351,30 +2567,74 @@ static void ret_stk_access_rpt( void)
  *      Error Detection:
  *          Handled by support routines.
  *
+ *      Process Explanation:
+ *          A regular file is mapped into memory and encoded directly
+ *              from there, so even a large one is neither read through
+ *              a small buffer nor copied in its entirety.  Anything
+ *              that cannot be mapped -- a pipe, say, or an empty file --
+ *              is read a chunk at a time into  statbuf , as before.
+ *          Either way, the chunks are STRING_LEN_MAX bytes, except the
+ *              last, and the FCode produced is the same.
+ *
  **************************************************************************** */
 
 static void encode_file( const char *filename )
 {
 	FILE *f;
 	size_t s;
-	int num_encoded=0;
+	unsigned long num_chunks = 0;
+	unsigned long num_encoded = 0;
 	
 	tokenization_error( INFO, "ENCODing File %s\n", filename );
 
 	f = open_expanded_file( filename, "rb", "encoding");
 	if( f != NULL )
 	{
-	    while( (s=fread(statbuf, 1, STRING_LEN_MAX, f)) )
+	    struct stat finfo;
+	    u8 *mapped = NULL;
+
+	    if ( ! encode_fcodes_ready )
+	    {
+		b_quote_fcode      = encode_fcode_by_name( "b(\")");
+		encode_bytes_fcode = encode_fcode_by_name( "encode-bytes");
+		encode_plus_fcode  = encode_fcode_by_name( "encode+");
+		encode_fcodes_ready = true;
+	    }
+	    start_size_encode( filename);
+
+	    if ( ( fstat( fileno( f), &finfo) == 0 )
+		 && S_ISREG( finfo.st_mode) && ( finfo.st_size > 0 ) )
+	    {
+		mapped = mmap( NULL, finfo.st_size, PROT_READ,
+			 MAP_PRIVATE, fileno( f), 0);
+		if ( mapped == MAP_FAILED )
+		{
+		    mapped = NULL;
+		}
+	    }
+
+	    if ( mapped != NULL )
 	    {
-		    emit_token("b(\")");
-		    emit_string(statbuf, s);
-		    emit_token("encode-bytes");
-		    if( num_encoded )
-			    emit_token("encode+");
+		size_t flen = finfo.st_size;
+		while ( num_encoded < flen )
+		{
+		    s = flen - num_encoded;
+		    if ( s > STRING_LEN_MAX )  s = STRING_LEN_MAX;
+		    encode_chunk( mapped + num_encoded, s, ++num_chunks);
+		    num_encoded += s;
+		}
+		munmap( mapped, flen);
+	    }else{
+		while( (s=fread(statbuf, 1, STRING_LEN_MAX, f)) )
+		{
+		    encode_chunk( statbuf, s, ++num_chunks);
 		    num_encoded += s;
+		}
 	    }
 	    fclose( f );
-	    tokenization_error ( INFO, "ENCODed %d bytes.\n", num_encoded);
+
+	    end_size_encode();
+	    tokenization_error ( INFO, "ENCODed %lu bytes.\n", num_encoded);
 	}
 }
 
@@ -3227,6 +3487,10 @@ static bool create_word(fwtoken definer)
 
 	    check_name_length( wlen);
 
+	    /*  Note it for the Whole-Image passes and the Size-Map  */
+	    note_definition( opc, nextfcode, statbuf, hdr_flag);
+	    note_size_definition( nextfcode, statbuf, hdr_flag, definer);
+
 	    /*  Emit appropriate FCodes:  Type of def'n,   */
 	    switch ( hdr_flag )
 	    {
@@ -3577,6 +3841,7 @@ static void fcode_starter( const char *token_name, int spread, bool is_offs16)
 	}else{
 	    set_next_fcode( nextfcode);
 	}
+	start_image_notes( is_offs16);
     }
 }
 
@@ -4082,8 +4347,7 @@ static bool abort_quote( fwtoken tok)
 
 	    if ( sun_style_abort_quote )  emit_if();
 
-	    emit_token("b(\")");
-	    emit_string(statbuf, wlen);
+	    emit_string_literal(statbuf, wlen);
 	
 	    if ( sun_style_abort_quote )  emit_token("type");
 
@@ -4304,12 +4568,15 @@ static  bool string_err_check( bool is_paren,
 
 /* **************************************************************************
  *
- *      Function name:  handle_internal
- *      Synopsis:       Perform the functions associated with FORTH words
- *                      that do not map directly to a single token.  This
- *                      is the functions that will go into the FUNCT field
- *                      of entries in the "FWords" and "Shared Words" lists.
- *      
+ *      The FWord Handlers
+ *
+ *      Each of the FORTH words that do not map directly to a single token
+ *          (the "FWords" and the "Shared Words") has its own handler,
+ *          which performs the functions associated with that word.
+ *          The handler is given in the FUNCT (and, where appropriate, the
+ *          IGN_FUNC) field of the word's entry in the lists in  dictionary.c
+ *          so that invoking the word is a single indirect call.
+ *
  *      Inputs:
  *         Parameters:
  *             pfield               Param-field of the  tic_hdr_t  -type entry
@@ -4326,14 +4593,6 @@ static  bool string_err_check( bool is_paren,
  *      Error Detection:
  *          Too numerous to list here...
  *
- *      Process Explanation:
- *          Recast the type of the param-field of a  tic_hdr_t -type
- *              entry and rename it "tok".
- *          The "tok" will be used as the control-expression for a
- *              SWITCH statement with a large number of CASE labels.
- *              Both "FWords" and "shared_words" list entries will
- *              be processed by this routine.
- *      
  *      Revision History:
  *      Updated Wed, 20 Jul 2005 by David L. Paktor
  *          Put handling of  ABORT"  under control of a run-time
@@ -4344,270 +4603,296 @@ static  bool string_err_check( bool is_paren,
  *          Convert to handler for  tic_hdr_t  type vocab entries.
  *
  *      Extraneous Remarks:
- *          We would prefer to keep this function private, so we will
- *              declare its prototype here and in the one other file
- *              where we need it, namely, dictionary.c, rather than
- *              exporting it widely in a  .h  file.
+ *          We would prefer to keep these functions private, so we will
+ *              declare their prototypes in the one other file where we
+ *              need them, namely, dictionary.c, rather than exporting
+ *              them widely in a  .h  file.
+ *          A word whose FWord Token has no handler of its own is given
+ *              fw_other() , which covers the remaining Tokens.
  *
  **************************************************************************** */
 
-void handle_internal( tic_param_t pfield);
-void handle_internal( tic_param_t pfield)
+void fw_begin( tic_param_t pfield)
 {
-	fwtoken tok = pfield.fw_token;
-
-	signed long wlen;
-	unsigned int sav_lineno = lineno;    /*  For error message  */
+	emit_begin();
+}
 
-	bool handy_toggle = true ;   /*  Various uses...   */
-	bool handy_toggle_too = true ;   /*  Various other uses...   */
-	char *handy_string = "";
-	int handy_int = 0;
-	
-#ifdef DEBUG_SCANNER
-	printf("%s:%d: debug: tokenizing control word '%s'\n",
-						iname, lineno, statbuf);
-#endif
-	switch (tok) {
-	case BEGIN:
-		emit_begin();
-		break;
+void fw_buffer( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(buffer:)");
+	    end_size_definition();
+	}
+}
 
-	case BUFFER:
-		if ( create_word(tok) )
-		{
-		emit_token("b(buffer:)");
-		}
-		break;
+void fw_const( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(constant)");
+	    end_size_definition();
+	}
+}
 
-	case CONST:
-		if ( create_word(tok) )
-		{
-		emit_token("b(constant)");
-		}
-		break;
+void fw_colon( tic_param_t pfield)
+{
+	/*  Collect error- -detection or -reporting items,
+	 *      but don't commit until we're sure the
+	 *      creation was a success.
+	 */
+	u16 maybe_last_colon_fcode = nextfcode ;
+	unsigned int maybe_last_colon_lineno = lineno;
+	unsigned int maybe_last_colon_abs_token_no = abs_token_no;
+	unsigned int maybe_last_colon_do_depth = do_loop_depth;
+	/*  last_colon_defname
+	 *     has to wait until after call to  create_word()
+	 */
 
-	case COLON:
-		{
-		    /*  Collect error- -detection or -reporting items,
-		     *      but don't commit until we're sure the
-		     *      creation was a success.
-		     */
-		    u16 maybe_last_colon_fcode = nextfcode ;
-		    unsigned int maybe_last_colon_lineno = lineno;
-		    unsigned int maybe_last_colon_abs_token_no = abs_token_no;
-		    unsigned int maybe_last_colon_do_depth = do_loop_depth;
-		    /*  last_colon_defname
-		     *     has to wait until after call to  create_word()
-		     */
-
-		    if ( create_word(tok) )
-		    {
-			last_colon_fcode = maybe_last_colon_fcode;
-			last_colon_lineno = maybe_last_colon_lineno;
-			last_colon_abs_token_no = maybe_last_colon_abs_token_no;
-			last_colon_do_depth = maybe_last_colon_do_depth;
-			collect_input_filename( &last_colon_filename);
-			/*  Now we can get  last_colon_defname  */
-			if ( last_colon_defname != NULL )
-			{
-			    free( last_colon_defname);
-			}
-			last_colon_defname = strdup(statbuf);
+	if ( create_word( pfield.fw_token) )
+	{
+	    last_colon_fcode = maybe_last_colon_fcode;
+	    last_colon_lineno = maybe_last_colon_lineno;
+	    last_colon_abs_token_no = maybe_last_colon_abs_token_no;
+	    last_colon_do_depth = maybe_last_colon_do_depth;
+	    collect_input_filename( &last_colon_filename);
+	    /*  Now we can get  last_colon_defname  */
+	    if ( last_colon_defname != NULL )
+	    {
+		free( last_colon_defname);
+	    }
+	    last_colon_defname = strdup(statbuf);
 
-		emit_token("b(:)");
-		incolon=true;
-			hide_last_colon();
-			lastcolon = opc;
-		    }
-		}
-		break;
-	
-	case SEMICOLON:
-		if ( test_in_colon("SEMICOLON", true, TKERROR, NULL) )
-		{
-		    ret_stk_balance_rpt( "termination,", true);
-		    /*  Clear Control Structures just back to where
-		     *      the current Colon-definition began.
-		     */
-		    clear_control_structs_to_limit(
-			"End of colon-definition", last_colon_abs_token_no);
-
-		    if ( ibm_locals )
-		    {
-			finish_locals();
-			forget_locals();
-		    }
+	    emit_token("b(:)");
+	    incolon=true;
+	    hide_last_colon();
+	    lastcolon = opc;
+	}
+}
 
-		emit_token("b(;)");
-		incolon=false;
-		    reveal_last_colon();
-		}
-		break;
+void fw_semicolon( tic_param_t pfield)
+{
+	if ( test_in_colon("SEMICOLON", true, TKERROR, NULL) )
+	{
+	    ret_stk_balance_rpt( "termination,", true);
+	    /*  Clear Control Structures just back to where
+	     *      the current Colon-definition began.
+	     */
+	    clear_control_structs_to_limit(
+		"End of colon-definition", last_colon_abs_token_no);
 
-	case CREATE:
-		if ( create_word(tok) )
-		{
-		emit_token("b(create)");
-		}
-		break;
+	    if ( ibm_locals )
+	    {
+		finish_locals();
+		forget_locals();
+	    }
 
-	case DEFER:
-		if ( create_word(tok) )
-		{
-		emit_token("b(defer)");
-		}
-		break;
+	    emit_token("b(;)");
+	    incolon=false;
+	    end_size_definition();
+	    reveal_last_colon();
+	}
+}
 
-	case ALLOW_MULTI_LINE:
-		report_multiline = false;
-		break;
+void fw_create( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(create)");
+	    end_size_definition();
+	}
+}
 
-	case OVERLOAD:
-		if ( test_in_colon(statbuf, false, WARNING, NULL) )
-		{
-		    do_not_overload = false;
-		}
-		break;
+void fw_defer( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(defer)");
+	    end_size_definition();
+	}
+}
 
-	case DEFINED:
-		if (get_word_in_line( statbuf) )
-		{
-		    eval_user_symbol(statbuf);
-		}
-		break;
+void fw_allow_multi_line( tic_param_t pfield)
+{
+	report_multiline = false;
+}
 
-	case CL_FLAG:
-		if (get_word_in_line( statbuf) )
-		{
-		     set_cl_flag( statbuf, true);
-		}
-		break;
+void fw_overload( tic_param_t pfield)
+{
+	if ( test_in_colon(statbuf, false, WARNING, NULL) )
+	{
+	    do_not_overload = false;
+	}
+}
 
-	case SHOW_CL_FLAGS:
-		show_all_cl_flag_settings( true);
-		break;
+void fw_defined( tic_param_t pfield)
+{
+	if (get_word_in_line( statbuf) )
+	{
+	    eval_user_symbol(statbuf);
+	}
+}
 
-	case FIELD:
-		if ( create_word(tok) )
-		{
-		emit_token("b(field)");
-		}
-		break;
+void fw_cl_flag( tic_param_t pfield)
+{
+	if (get_word_in_line( statbuf) )
+	{
+	    set_cl_flag( statbuf, true);
+	}
+}
 
-	case VALUE:
-		if ( create_word(tok) )
-		{
-		emit_token("b(value)");
-		}
-		break;
-		
-	case VARIABLE:
-		if ( create_word(tok) )
-		{
-		emit_token("b(variable)");
-		}
-		break;
+void fw_show_cl_flags( tic_param_t pfield)
+{
+	show_all_cl_flag_settings( true);
+}
 
-	case AGAIN:
-		emit_again();
-		break;
+void fw_field( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(field)");
+	    end_size_definition();
+	}
+}
 
-	case ALIAS:
-		create_alias();
-		break;
+void fw_value( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(value)");
+	    end_size_definition();
+	}
+}
 
-	case CONTROL:
-		if ( get_word_in_line( statbuf) )
-		{
-		    emit_literal(statbuf[0]&0x1f);
-		}
-		break;
+void fw_variable( tic_param_t pfield)
+{
+	if ( create_word( pfield.fw_token) )
+	{
+	    emit_token("b(variable)");
+	    end_size_definition();
+	}
+}
 
-	case DO:
-		emit_token("b(do)");
-		mark_do();
-		break;
+void fw_again( tic_param_t pfield)
+{
+	emit_again();
+}
 
-	case CDO:
-		emit_token("b(?do)");
-		mark_do();
-		break;
+void fw_alias( tic_param_t pfield)
+{
+	create_alias();
+}
 
-	case ELSE:
-		emit_else();
-		break;
+void fw_control( tic_param_t pfield)
+{
+	if ( get_word_in_line( statbuf) )
+	{
+	    emit_literal(statbuf[0]&0x1f);
+	}
+}
 
-	case CASE:
-		emit_case();
-		break;
+void fw_do( tic_param_t pfield)
+{
+	emit_token("b(do)");
+	mark_do();
+}
 
-	case ENDCASE:
-		emit_endcase();
-		break;
+void fw_cdo( tic_param_t pfield)
+{
+	emit_token("b(?do)");
+	mark_do();
+}
 
-	case NEW_DEVICE:
-		handy_toggle = false;
-	case FINISH_DEVICE:
-		finish_or_new_device( handy_toggle );
-		break;
+void fw_else( tic_param_t pfield)
+{
+	emit_else();
+}
 
-	case FLITERAL:
-		{
-		    u32 val;
-		    val = dpop();
-		    emit_literal(val);
-		}
-		break;
+void fw_case( tic_param_t pfield)
+{
+	emit_case();
+}
 
-	case OF:
-		emit_of();
-		break;
+void fw_endcase( tic_param_t pfield)
+{
+	emit_endcase();
+}
 
-	case ENDOF:
-		emit_endof();
-		break;
-		
-	case EXTERNAL:
-		set_hdr_flag( FLAG_EXTERNAL );
-		break;
-		
-	case HEADERLESS:
-		set_hdr_flag( FLAG_HEADERLESS );
-		break;
-	
-	case HEADERS:
-		set_hdr_flag( FLAG_HEADERS );
-		break;
+void fw_new_device( tic_param_t pfield)
+{
+	finish_or_new_device( false );
+}
 
-	case DECIMAL:
-		/* in a definition this is expanded as macro "10 base !" */
-		base_change ( 0x0a );
-		break;
-		
-	case HEX:
-		base_change ( 0x10 );
-		break;
+void fw_finish_device( tic_param_t pfield)
+{
+	finish_or_new_device( true );
+}
 
-	case OCTAL:
-		base_change ( 0x08 );
-		break;
+void fw_fliteral( tic_param_t pfield)
+{
+	u32 val;
+	val = dpop();
+	emit_literal(val);
+}
 
-	case OFFSET16:
-		if (!offs16)
-		{
-		    tokenization_error(INFO, "Switching to 16-bit offsets.\n");
-		}else{
-		    tokenization_error(WARNING,
-			"Call of OFFSET16 is redundant.\n");
-		}
-		emit_token("offset16");
-		offs16=true;
-		break;
+void fw_of( tic_param_t pfield)
+{
+	emit_of();
+}
 
-	case IF:
-		emit_if();
-		break;
+void fw_endof( tic_param_t pfield)
+{
+	emit_endof();
+}
+
+void fw_external( tic_param_t pfield)
+{
+	set_hdr_flag( FLAG_EXTERNAL );
+}
+
+void fw_headerless( tic_param_t pfield)
+{
+	set_hdr_flag( FLAG_HEADERLESS );
+}
+
+void fw_headers( tic_param_t pfield)
+{
+	set_hdr_flag( FLAG_HEADERS );
+}
+
+void fw_decimal( tic_param_t pfield)
+{
+	/* in a definition this is expanded as macro "10 base !" */
+	base_change ( 0x0a );
+}
+
+void fw_hex( tic_param_t pfield)
+{
+	base_change ( 0x10 );
+}
+
+void fw_octal( tic_param_t pfield)
+{
+	base_change ( 0x08 );
+}
+
+void fw_offset16( tic_param_t pfield)
+{
+	if (!offs16)
+	{
+	    tokenization_error(INFO, "Switching to 16-bit offsets.\n");
+	}else{
+	    tokenization_error(WARNING,
+		"Call of OFFSET16 is redundant.\n");
+	}
+	emit_token("offset16");
+	offs16=true;
+}
+
+void fw_if( tic_param_t pfield)
+{
+	emit_if();
+}
 
 /* **************************************************************************
  *
@@ -4616,569 +4901,641 @@ void handle_internal( tic_param_t pfield)
  *              or before Loop Elements like I and J or UNLOOP or LEAVE.
  *
  **************************************************************************** */
-	case UNLOOP:
-		emit_token("unloop");
-		must_be_deep_in_do(1);
-		break;
+void fw_unloop( tic_param_t pfield)
+{
+	emit_token("unloop");
+	must_be_deep_in_do(1);
+}
 
-	case LEAVE:
-		emit_token("b(leave)");
-		must_be_deep_in_do(1);
-		break;
+void fw_leave( tic_param_t pfield)
+{
+	emit_token("b(leave)");
+	must_be_deep_in_do(1);
+}
 
-	case LOOP_I:
-		emit_token("i");
-		must_be_deep_in_do(1);
-		break;
+void fw_loop_i( tic_param_t pfield)
+{
+	emit_token("i");
+	must_be_deep_in_do(1);
+}
 
-	case LOOP_J:
-		emit_token("j");
-		must_be_deep_in_do(2);
-		break;
-		
-	case LOOP:
-		emit_token("b(loop)");
-		resolve_loop();
-		break;
-		
-	case PLUS_LOOP:
-		emit_token("b(+loop)");
-		resolve_loop();
-		break;
+void fw_loop_j( tic_param_t pfield)
+{
+	emit_token("j");
+	must_be_deep_in_do(2);
+}
 
+void fw_loop( tic_param_t pfield)
+{
+	emit_token("b(loop)");
+	resolve_loop();
+}
 
-	case INSTANCE:
-		{
-		    bool set_instance_state = false;
-		    bool emit_instance = true;
-		    /*  We will treat "instance" in a colon-definition as
-		     *      an error, but allow it to be emitted if we're
-		     *      ignoring errors; if we're not ignoring errors,
-		     *      there's no output anyway...
-		     */
-		    if ( test_in_colon(statbuf, false, TKERROR, NULL) )
-		    {   /*   We are in interpretation (not colon) state.  */
-			/*  "Instance" not allowed during "global" scope  */ 
-			if ( scope_is_global )
-			{
-			    glob_not_allowed( WARNING, false );
-			    emit_instance = false;
-			}else{
-			    set_instance_state = true;
-			}
-		    }
-		    if ( emit_instance )
-		    {
-			if ( set_instance_state )
-			{
-			    /*  "Instance" isn't cumulative....  */
-			    if ( is_instance )
-			    {
-				unresolved_instance( WARNING);
-			    }
-			    collect_input_filename( &instance_filename);
-			    instance_lineno = lineno;
-			    is_instance = true;
-			    dev_change_instance_warning = true;
-			}
-			emit_token("instance");
-		    }
-		}
-		break;
-		
-	case GLOB_SCOPE:
-		if ( test_in_colon(statbuf, false, TKERROR, NULL) )
-		{
-		    if ( !is_instance )
-		    {
-			enter_global_scope();
-		    }else{
-			tokenization_error( TKERROR,
-			    "Global Scope not allowed.  "
-			    "\"Instance\" is in effect; issued" );
-			just_where_started( instance_filename,
-					        instance_lineno );
-		    }
-		}
-		break;
+void fw_plus_loop( tic_param_t pfield)
+{
+	emit_token("b(+loop)");
+	resolve_loop();
+}
 
-	case DEV_SCOPE:
-		if ( test_in_colon(statbuf, false, TKERROR, NULL) )
+void fw_instance( tic_param_t pfield)
+{
+	bool set_instance_state = false;
+	bool emit_instance = true;
+	/*  We will treat "instance" in a colon-definition as
+	 *      an error, but allow it to be emitted if we're
+	 *      ignoring errors; if we're not ignoring errors,
+	 *      there's no output anyway...
+	 */
+	if ( test_in_colon(statbuf, false, TKERROR, NULL) )
+	{   /*   We are in interpretation (not colon) state.  */
+	    /*  "Instance" not allowed during "global" scope  */
+	    if ( scope_is_global )
+	    {
+		glob_not_allowed( WARNING, false );
+		emit_instance = false;
+	    }else{
+		set_instance_state = true;
+	    }
+	}
+	if ( emit_instance )
+	{
+	    if ( set_instance_state )
+	    {
+		/*  "Instance" isn't cumulative....  */
+		if ( is_instance )
 		{
-		    resume_device_scope();
+		    unresolved_instance( WARNING);
 		}
-		break;
+		collect_input_filename( &instance_filename);
+		instance_lineno = lineno;
+		is_instance = true;
+		dev_change_instance_warning = true;
+	    }
+	    emit_token("instance");
+	}
+}
 
-	case TICK:             /*    '    */
-		test_in_colon(statbuf, false, WARNING, "[']");
-	case BRACK_TICK:       /*   [']   */
-		{
-		    tic_hdr_t *token_entry;
-		    if ( get_token( &token_entry) )
-		    {
-			emit_token("b(')");
-			/* Emit the token; warning or whatever comes gratis */
-			token_entry->funct( token_entry->pfield);
-		    }
-		}
-		break;
+void fw_glob_scope( tic_param_t pfield)
+{
+	if ( test_in_colon(statbuf, false, TKERROR, NULL) )
+	{
+	    if ( !is_instance )
+	    {
+		enter_global_scope();
+	    }else{
+		tokenization_error( TKERROR,
+		    "Global Scope not allowed.  "
+		    "\"Instance\" is in effect; issued" );
+		just_where_started( instance_filename,
+				        instance_lineno );
+	    }
+	}
+}
 
-	case F_BRACK_TICK:     /*  F['] <name>
-	        		*     emits the token-number for <name>
-				*  Mainly useful to compute the argument
-				*     to   get-token   or  set-token
-				*/
-		{
-		    tic_hdr_t *token_entry;
-		    if ( get_token( &token_entry) )
-		    {
-			/*  "Obsolete" warning doesn't come gratis here...  */
-			token_entry_warning( token_entry);
-			/*  In Tokenizer-Escape mode, push the token  */
-			if ( in_tokz_esc )
-			{
-			    dpush( token_entry->pfield.deflt_elem);
-			}else{
-			    emit_literal( token_entry->pfield.deflt_elem);
-			}
-		    }
-		}
-		break;
+void fw_dev_scope( tic_param_t pfield)
+{
+	if ( test_in_colon(statbuf, false, TKERROR, NULL) )
+	{
+	    resume_device_scope();
+	}
+}
+
+void fw_brack_tick( tic_param_t pfield)      /*   [']   */
+{
+	tic_hdr_t *token_entry;
+	if ( get_token( &token_entry) )
+	{
+	    emit_token("b(')");
+	    /* Emit the token; warning or whatever comes gratis */
+	    token_entry->funct( token_entry->pfield);
+	}
+}
+
+void fw_tick( tic_param_t pfield)            /*    '    */
+{
+	test_in_colon(statbuf, false, WARNING, "[']");
+	fw_brack_tick( pfield);
+}
+
+void fw_f_brack_tick( tic_param_t pfield)    /*  F['] <name>
+					*     emits the token-number for <name>
+					*  Mainly useful to compute the argument
+					*     to   get-token   or  set-token
+					*/
+{
+	tic_hdr_t *token_entry;
+	if ( get_token( &token_entry) )
+	{
+	    /*  "Obsolete" warning doesn't come gratis here...  */
+	    token_entry_warning( token_entry);
+	    /*  The number is exposed; it must not change  */
+	    note_pinned_fcode( token_entry->pfield.deflt_elem);
+	    /*  In Tokenizer-Escape mode, push the token  */
+	    if ( in_tokz_esc )
+	    {
+		dpush( token_entry->pfield.deflt_elem);
+	    }else{
+		emit_literal( token_entry->pfield.deflt_elem);
+	    }
+	}
+}
+
+void fw_ascii( tic_param_t pfield)
+{
+	if ( get_word_in_line( statbuf) )
+	{
+	    emit_literal(statbuf[0]);
+	}
+}
+
+void fw_char( tic_param_t pfield)
+{
+	test_in_colon(statbuf, false, WARNING, "[CHAR]" );
+	fw_ascii( pfield);
+}
+
+void fw_cchar( tic_param_t pfield)
+{
+	test_in_colon(statbuf, true, WARNING, "CHAR" );
+	fw_ascii( pfield);
+}
+
+void fw_until( tic_param_t pfield)
+{
+	emit_until();
+}
+
+void fw_while( tic_param_t pfield)
+{
+	emit_while();
+}
+
+void fw_repeat( tic_param_t pfield)
+{
+	emit_repeat();
+}
+
+void fw_then( tic_param_t pfield)
+{
+	emit_then();
+}
+
+void fw_to( tic_param_t pfield)
+{
+	if ( validate_to_target() )
+	{
+	    emit_token("b(to)");
+	}
+}
+
+void fw_is( tic_param_t pfield)
+{
+	tokenization_error ( INFO,
+	     "Substituting  TO  for deprecated  IS\n");
+	fw_to( pfield);
+}
 
-	case CHAR:
-		handy_toggle = false;
-	case CCHAR:
-		test_in_colon(statbuf, handy_toggle, WARNING,
-		    handy_toggle ? "CHAR" : "[CHAR]" );
-	case ASCII:
-		if ( get_word_in_line( statbuf) )
+void fw_fload( tic_param_t pfield)
+{
+	if ( get_word_in_line( statbuf) )
+	{
+	    bool stream_ok ;
+
+	    push_source( close_stream, NULL, true) ;
+
+	    tokenization_error( INFO, "FLOADing %s\n", statbuf );
+
+	    stream_ok = init_stream( statbuf );
+	    if ( !stream_ok )
+	    {
+		drop_source();
+	    }
+	}
+}
+
+/*  Double-Quote ( " ) string and Dot-Quote  ( ." ) string   */
+static void quote_string( bool type_it)
+{
+	signed long wlen;
+	wlen=get_string( true);
+	emit_string_literal(statbuf, wlen);
+	if ( type_it )
+	{
+	    emit_token("type");
+	}
+}
+
+void fw_string( tic_param_t pfield)
+{
+	quote_string( false);
+}
+
+void fw_pstring( tic_param_t pfield)
+{
+	quote_string( true);
+}
+
+/*  Ess-Quote  ( s"  ) string and Dot-Paren  .(   string  */
+static void delimited_string( bool is_paren)
+{
+	signed long wlen;
+	unsigned int sav_lineno = lineno;    /*  For error message  */
+	if (*pc++=='\n') lineno++;
+	{
+	    unsigned int strt_lineno = lineno;
+	    wlen = get_until( is_paren ? ')' : '"' );
+	    if ( string_err_check( is_paren,
+	             sav_lineno, strt_lineno) )
+	    {
+		emit_string_literal(statbuf, wlen);
+		if ( is_paren )
 		{
-		    emit_literal(statbuf[0]);
+		    emit_token("type");
 		}
-		break;
-		
-	case UNTIL:
-		emit_until();
-		break;
+	    }
+	}
+}
+
+void fw_sstring( tic_param_t pfield)
+{
+	delimited_string( false);
+}
+
+void fw_pbstring( tic_param_t pfield)
+{
+	delimited_string( true);
+}
+
+void fw_func_name( tic_param_t pfield)
+{
+	if ( in_tokz_esc )
+	{
+	    if ( incolon )
+	    {
+		tokenization_error( P_MESSAGE, "Currently" );
+	    }else{
+		tokenization_error( P_MESSAGE, "After" );
+	    }
+	    in_last_colon( incolon);
+	}else{
+	    emit_string_literal( last_colon_defname,
+	        strlen( last_colon_defname) );
+	    /*  if ( hdr_flag == FLAG_HEADERLESS ) { WARNING } */
+	}
+}
+
+void fw_ifile_name( tic_param_t pfield)
+{
+	emit_string_literal( iname, strlen( iname) );
+}
+
+void fw_iline_num( tic_param_t pfield)
+{
+	emit_literal( lineno);
+}
+
+void fw_hexval( tic_param_t pfield)
+{
+	base_val (0x10);
+}
+
+void fw_decval( tic_param_t pfield)
+{
+	base_val (0x0a);
+}
+
+void fw_octval( tic_param_t pfield)
+{
+	base_val (8);
+}
+
+void fw_asc_num( tic_param_t pfield)
+{
+	if (get_word_in_line( statbuf) )
+	{
+	    if ( pfield.fw_token == ASC_NUM )
+	    {
+		ascii_right_number( statbuf);
+	    } else {
+		ascii_left_number( statbuf);
+	    }
+	}
+}
+
+/*  Conditional directives out of context  */
+void fw_condl_ender( tic_param_t pfield)
+{
+	tokenization_error ( TKERROR,
+	    "No conditional preceding %s directive\n",
+		strupr(statbuf) );
+}
 
-	case WHILE:
-		emit_while();
-		break;
-		
-	case REPEAT:
-		emit_repeat();
-		break;
-		
-	case THEN:
-		emit_then();
-		break;
+void fw_push_fcode( tic_param_t pfield)
+{
+	tokenization_error( INFO,
+	    "FCode-token Assignment Counter of 0x%x "
+	    "has been saved on stack.\n", nextfcode );
+	dpush( (long)nextfcode );
+}
 
-	case IS:
-		tokenization_error ( INFO,
-		     "Substituting  TO  for deprecated  IS\n");
-	case TO:
-		if ( validate_to_target() )
-		{
-		emit_token("b(to)");
-		}
-		break;
+void fw_pop_fcode( tic_param_t pfield)
+{
+	pop_next_fcode();
+}
 
-	case FLOAD:
-		if ( get_word_in_line( statbuf) )
-		{
-		    bool stream_ok ;
-			
-		    push_source( close_stream, NULL, true) ;
-			
-		    tokenization_error( INFO, "FLOADing %s\n", statbuf );
-			
-		    stream_ok = init_stream( statbuf );
-		    if ( !stream_ok )
-		    {
-			drop_source();
-		    }
-		}
-		break;
+void fw_reset_fcode( tic_param_t pfield)
+{
+	tokenization_error( INFO,
+	    "Encountered %s.  Resetting FCode-token "
+		"Assignment Counter.  ", strupr(statbuf) );
+	list_fcode_ranges( false);
+	reset_fcode_ranges();
+}
 
-	case STRING:         /*  Double-Quote ( " ) string  */
-		handy_toggle = false;
-	case PSTRING:        /*  Dot-Quote  ( ." ) string   */
-		wlen=get_string( true);
-		emit_token("b(\")");
-		emit_string(statbuf, wlen);
-		if ( handy_toggle )
-		{
-		    emit_token("type");
-		}
-		break;
+void fw_exit( tic_param_t pfield)
+{
+	if ( test_in_colon( statbuf, true, TKERROR, NULL)
+	     || noerrors )
+	{
+	    ret_stk_balance_rpt( NULL, false);
+	    if ( ibm_locals )
+	    {
+		finish_locals ();
+	    }
+	    emit_token("exit");
+	}
+}
 
-	case SSTRING:        /*  Ess-Quote  ( s"  ) string  */
-		handy_toggle = false;
-	case PBSTRING:       /*  Dot-Paren  .(   string  */
-		if (*pc++=='\n') lineno++;
-		{
-		    unsigned int strt_lineno = lineno;
-		    wlen = get_until( handy_toggle ? ')' : '"' );
-		    if ( string_err_check( handy_toggle,
-		             sav_lineno, strt_lineno) )
-		    {
-		emit_token("b(\")");
-			emit_string(statbuf, wlen);
-			if ( handy_toggle )
-			{
-		emit_token("type");
-			}
-		    }
-		}
-		break;
+void fw_escapetok( tic_param_t pfield)
+{
+	enter_tokz_esc();
+}
 
-	case FUNC_NAME:
-		    if ( in_tokz_esc )
-		    {
-		    if ( incolon )
-		    {
-			tokenization_error( P_MESSAGE, "Currently" );
-		    }else{
-			tokenization_error( P_MESSAGE, "After" );
-		    }
-		    in_last_colon( incolon);
-		    }else{
-		emit_token("b(\")");
-			emit_string( last_colon_defname,
-		            strlen( last_colon_defname) );
-			/*  if ( hdr_flag == FLAG_HEADERLESS ) { WARNING } */
-		    }
-		break;
+void fw_version1( tic_param_t pfield)
+{
+	fcode_starter( "version1", 1, false) ;
+	tokenization_error( INFO, "Using version1 header "
+	    "(8-bit offsets).\n");
+}
 
-	case IFILE_NAME:
-		emit_token("b(\")");
-		emit_string( iname, strlen( iname) );
-		break;
+void fw_start1( tic_param_t pfield)
+{
+	fcode_starter( "start1", 1, true);
+}
 
-	case ILINE_NUM:
-		emit_literal( lineno);
-		break;
-			
-	case HEXVAL:
-		base_val (0x10);
-		break;
-		
-	case DECVAL:
-		base_val (0x0a);
-		break;
-		
-	case OCTVAL:
-		base_val (8);
-		break;
+void fw_start0( tic_param_t pfield)
+{
+	fcode_starter( "start0", 0, true);
+}
 
-	case ASC_LEFT_NUM:
-		handy_toggle = false;
-	case ASC_NUM:
-		if (get_word_in_line( statbuf) )
-		{
-		    if ( handy_toggle )
-		    {
-			ascii_right_number( statbuf);
-			} else {
-			ascii_left_number( statbuf);
-			}
-		}
-		break;
+void fw_start2( tic_param_t pfield)
+{
+	fcode_starter( "start2", 2, true);
+}
 
-	case CONDL_ENDER:   /*  Conditional directives out of context  */
-	case CONDL_ELSE:
-		tokenization_error ( TKERROR,
-		    "No conditional preceding %s directive\n",
-			strupr(statbuf) );
-		break;
+void fw_start4( tic_param_t pfield)
+{
+	fcode_starter( "start4", 4, true);
+}
 
-	case PUSH_FCODE:
-		tokenization_error( INFO,
-		    "FCode-token Assignment Counter of 0x%x "
-		    "has been saved on stack.\n", nextfcode );
-		dpush( (long)nextfcode );
-		break;
+void fw_end0( tic_param_t pfield)
+{
+	bool is_end0 = ( pfield.fw_token != END1 );
+	if ( ! is_end0 )
+	{
+	    tokenization_error( WARNING,
+		"Appearance of END1 in FCode source code "
+		    "is not intended by IEEE 1275-1994\n");
+	}else{
+	    you_are_here();
+	}
+	emit_token( is_end0 ? "end0" : "end1" );
+	fcode_ender();
+	FFLUSH_STDOUT
+}
 
-	case POP_FCODE:
-		pop_next_fcode();
-		break;
+void fw_recurse( tic_param_t pfield)
+{
+	if ( test_in_colon(statbuf, true, TKERROR, NULL ) )
+	{
+	    emit_fcode(last_colon_fcode);
+	}
+}
 
-	case RESET_FCODE:
-		tokenization_error( INFO,
-		    "Encountered %s.  Resetting FCode-token "
-			"Assignment Counter.  ", strupr(statbuf) );
-		list_fcode_ranges( false);
-		reset_fcode_ranges();
-		break;
-		
-	case EXIT:
-		if ( test_in_colon( statbuf, true, TKERROR, NULL)
-		     || noerrors )
-		{
-		    ret_stk_balance_rpt( NULL, false);
-		    if ( ibm_locals )
-		    {
-			finish_locals ();
-		    }
-		    emit_token("exit");
-		}
-		break;
+void fw_recursive( tic_param_t pfield)
+{
+	if ( test_in_colon(statbuf, true, TKERROR, NULL ) )
+	{
+	    reveal_last_colon();
+	}
+}
 
-	case ESCAPETOK:
-		enter_tokz_esc();
-		break;
-	
-	case VERSION1:
-	case FCODE_V1:
-		fcode_starter( "version1", 1, false) ;
-		tokenization_error( INFO, "Using version1 header "
-		    "(8-bit offsets).\n");
-		break;
-	
-	case START1:
-	case FCODE_V2:
-	case FCODE_V3: /* Full IEEE 1275 */
-		fcode_starter( "start1", 1, true);
-		break;
-		
-	case START0:
-		fcode_starter( "start0", 0, true);
-		break;
-		
-	case START2:
-		fcode_starter( "start2", 2, true);
-		break;
-		
-	case START4:
-		fcode_starter( "start4", 4, true);
-		break;
-		
-	case END1:
-		tokenization_error( WARNING, 
-		    "Appearance of END1 in FCode source code "
-			"is not intended by IEEE 1275-1994\n");
-		handy_toggle = false;
-	case END0:
-	case FCODE_END:
-		if ( handy_toggle )
-		{
-		    you_are_here();
-		}
-		emit_token( handy_toggle ? "end0" : "end1" );
-		fcode_ender();
-		FFLUSH_STDOUT
-		break;
+/* **************************************************************************
+ *
+ *      The Return-Stack words share their processing.
+ *          Parameters:
+ *              ret_stk_word     The token to emit
+ *              access_rpt       TRUE to call  ret_stk_access_rpt()
+ *              depth_bump       If non-zero, passed to  bump_ret_stk_depth()
+ *
+ **************************************************************************** */
 
-	case RECURSE:
-		if ( test_in_colon(statbuf, true, TKERROR, NULL ) )
-		{
-		    emit_fcode(last_colon_fcode);
-		}
-		break;
-		
+static void ret_stk_op( char *ret_stk_word, bool access_rpt, int depth_bump)
+{
+	bool allowed = allow_ret_stk_interp;
+	if ( ! allowed )
+	{
+	    allowed = test_in_colon(statbuf, true, TKERROR, NULL );
+	}
+	if ( allowed || noerrors )
+	{
+	    if ( access_rpt )
+	    {
+		ret_stk_access_rpt();
+	    }
+	    if ( depth_bump != 0 )
+	    {
+		bump_ret_stk_depth( depth_bump);
+	    }
+	    emit_token( ret_stk_word);
+	}
+}
 
-	case RECURSIVE:
-		if ( test_in_colon(statbuf, true, TKERROR, NULL ) )
-		{
-		    reveal_last_colon();
-		}
-		break;
+void fw_ret_stk_fetch( tic_param_t pfield)
+{
+	ret_stk_op( "r@", true, 0);
+}
 
-	case RET_STK_FETCH:
-		/*  handy_toggle controls reloading other "handy_"s
-		 *  handy_toggle_too controls calling ret_stk_access_rpt()
-		 *  handy_int, if non-zero, passed to bump_ret_stk_depth()
-		 */
-		/*  First in series doesn't need to check handy_toggle  */
-		handy_string = "r@";
-		    /*  Will call ret_stk_access_rpt()       */
-		    /*  handy_toggle_too  is already TRUE    */
-		    /*  Will not call bump_ret_stk_depth()   */
-		    /*  handy_int  is already zero    */
-		handy_toggle = false;
-	case RET_STK_FROM:
-		if ( handy_toggle )
-		{
-		    handy_string = "r>";
-		    /*  Will call ret_stk_access_rpt()  */
-		    /*  handy_toggle_too  is already TRUE    */
-		    /*  Will call bump_ret_stk_depth( -1)    */
-		    handy_int = -1;
-		    handy_toggle = false;
-		}
-	case RET_STK_TO:
-		if ( handy_toggle )
-		{
-		    handy_string = ">r";
-		    /*  Will not call ret_stk_access_rpt()   */
-		    handy_toggle_too  = false;
-		    /*  Will call bump_ret_stk_depth( 1)     */
-		    handy_int =  1;
-		    /*  Last in series doesn't need to reset handy_toggle  */
-		}
+void fw_ret_stk_from( tic_param_t pfield)
+{
+	ret_stk_op( "r>", true, -1);
+}
 
-		/*  handy_toggle  is now free for other use  */
-		handy_toggle = allow_ret_stk_interp;
-		if ( ! handy_toggle )
-		{
-		    handy_toggle = test_in_colon(statbuf, true, TKERROR, NULL );
-		}
-		if ( handy_toggle || noerrors )
-		{
-		    if ( handy_toggle_too )
-		    {
-			ret_stk_access_rpt();
-		    }
-		    if ( handy_int != 0 )
-		    {
-			bump_ret_stk_depth( handy_int);
-		    }
-		    emit_token( handy_string);
-		}
-		break;
+void fw_ret_stk_to( tic_param_t pfield)
+{
+	ret_stk_op( ">r", false, 1);
+}
 
-	case PCIHDR:
-		emit_pcihdr();
-		break;
-	
-	case PCIEND:
-		finish_pcihdr();
-		reset_fcode_ranges();
-		FFLUSH_STDOUT
-		break;
+void fw_pcihdr( tic_param_t pfield)
+{
+	emit_pcihdr();
+}
 
-	case PCIREV:
-		pci_image_rev = dpop();
-		tokenization_error( INFO,
-		    "PCI header revision=0x%04x%s\n", pci_image_rev,
-			big_end_pci_image_rev ?
-			    ".  Will be saved in Big-Endian format."
-			    : ""  );
-		break;
+void fw_pciend( tic_param_t pfield)
+{
+	finish_pcihdr();
+	reset_fcode_ranges();
+	FFLUSH_STDOUT
+}
 
-	case NOTLAST:
-		handy_toggle = false;
-	case ISLAST:
-		dpush(handy_toggle);
-	case SETLAST:
-		{
-		    u32 val = dpop();
-		    bool new_pili = ( (val != 0) );
-		    if ( pci_is_last_image != new_pili )
-		    {
-			tokenization_error( INFO,
-			    new_pili ?
-				"Last image for PCI header.\n" :
-				"PCI header not last image.\n" );
-			pci_is_last_image = new_pili;
-		    }
-		}
+void fw_pcirev( tic_param_t pfield)
+{
+	pci_image_rev = dpop();
+	tokenization_error( INFO,
+	    "PCI header revision=0x%04x%s\n", pci_image_rev,
+		big_end_pci_image_rev ?
+		    ".  Will be saved in Big-Endian format."
+		    : ""  );
+}
+
+void fw_setlast( tic_param_t pfield)
+{
+	u32 val;
+	bool new_pili;
+	switch ( pfield.fw_token )
+	{
+	    case NOTLAST:
+		val = false;
 		break;
-		
-	case SAVEIMG:
-		if (get_word_in_line( statbuf) )
-		{
-		    free(oname);
-		    oname = strdup( statbuf );
-		    tokenization_error( INFO,
-			"Output is redirected to file:  %s\n", oname);
-		}
+	    case ISLAST:
+		val = true;
 		break;
+	    default:
+		val = dpop();
+	}
+	new_pili = ( (val != 0) );
+	if ( pci_is_last_image != new_pili )
+	{
+	    tokenization_error( INFO,
+		new_pili ?
+		    "Last image for PCI header.\n" :
+		    "PCI header not last image.\n" );
+	    pci_is_last_image = new_pili;
+	}
+}
 
-	case RESETSYMBS:
-		tokenization_error( INFO,
-		    "Resetting symbols defined in %s mode.\n",
-			in_tokz_esc ? "tokenizer-escape" : "\"normal\"");
-		if ( in_tokz_esc )
-		{
-		    reset_tokz_esc();
-		}else{
-		    reset_normal_vocabs();
-		}	
-		break;
+void fw_saveimg( tic_param_t pfield)
+{
+	if (get_word_in_line( statbuf) )
+	{
+	    free(oname);
+	    oname = strdup( statbuf );
+	    tokenization_error( INFO,
+		"Output is redirected to file:  %s\n", oname);
+	}
+}
 
-	case FCODE_DATE:
-		handy_toggle = false;
-	case FCODE_TIME:
-		{
-			time_t tt;
-		    char temp_buffr[32];
-			
-			tt=time(NULL);
-		    if ( handy_toggle )
-		    {
-			strftime(temp_buffr, 32, "%T %Z", localtime(&tt));
-		    }else{
-			strftime(temp_buffr, 32, "%m/%d/%Y", localtime(&tt));
-		    }
-		    if ( in_tokz_esc )
-		    {
-			tokenization_error( MESSAGE, temp_buffr);
-		    }else{
-			emit_token("b(\")");
-			emit_string((u8 *)temp_buffr, strlen(temp_buffr) );
-		    }
-		}
-		break;
+void fw_resetsymbs( tic_param_t pfield)
+{
+	tokenization_error( INFO,
+	    "Resetting symbols defined in %s mode.\n",
+		in_tokz_esc ? "tokenizer-escape" : "\"normal\"");
+	if ( in_tokz_esc )
+	{
+	    reset_tokz_esc();
+	}else{
+	    reset_normal_vocabs();
+	}
+}
 
-	case ENCODEFILE:
-		if (get_word_in_line( statbuf) )
-		{
-		encode_file( (char*)statbuf );
-		}
-		break;
+void fw_fcode_date( tic_param_t pfield)
+{
+	time_t tt;
+	char temp_buffr[32];
 
-	default:
-	    /*  IBM-style Locals, under control of a switch  */
-	    if ( ibm_locals )
-	    {
-		bool found_it = true;
-		switch (tok) {
-		    case CURLY_BRACE:
-			declare_locals( false);
-			break;
-		    case DASH_ARROW:
-			assign_local();
-			break;
-		    default:
-			found_it = false;
+	tt=time(NULL);
+	if ( pfield.fw_token == FCODE_TIME )
+	{
+	    strftime(temp_buffr, 32, "%T %Z", localtime(&tt));
+	}else{
+	    strftime(temp_buffr, 32, "%m/%d/%Y", localtime(&tt));
+	}
+	if ( in_tokz_esc )
+	{
+	    tokenization_error( MESSAGE, temp_buffr);
+	}else{
+	    emit_string_literal((u8 *)temp_buffr, strlen(temp_buffr) );
 	}
-		if ( found_it ) break;
 }
 
-	    /*  Down here, we have our last chance to recognize a token.
-	     *      If  abort_quote  is disallowed, we will still consume
-	     *      the string.  In case the string spans more than one
-	     *      line, we want to make sure the line number displayed
-	     *      in the error-message is the one on which the disallowed
-	     *       abort_quote  token appeared, not the one where the
-	     *      string ended; therefore, we might need to be able to
-	     *      "fake-out" the line number...
-	     */
+void fw_encodefile( tic_param_t pfield)
 {
-		bool fake_out_lineno = false;
-		unsigned int save_lineno = lineno;
-		unsigned int true_lineno;
-		if ( abort_quote( tok) )
-		{   break;
-		}else{
-		    if ( tok == ABORTTXT )  fake_out_lineno = true;
-		}
-		true_lineno = lineno;
+	if (get_word_in_line( statbuf) )
+	{
+	    encode_file( (char*)statbuf );
+	}
+}
+
+/* **************************************************************************
+ *
+ *      Handler for the FWords that are only recognized conditionally,
+ *          and for any FWord that has no handler of its own.
+ *
+ **************************************************************************** */
+
+void fw_other( tic_param_t pfield)
+{
+	fwtoken tok = pfield.fw_token;
+
+	/*  IBM-style Locals, under control of a switch  */
+	if ( ibm_locals )
+	{
+	    bool found_it = true;
+	    switch (tok) {
+		case CURLY_BRACE:
+		    declare_locals( false);
+		    break;
+		case DASH_ARROW:
+		    assign_local();
+		    break;
+		default:
+		    found_it = false;
+	    }
+	    if ( found_it ) return;
+	}
 
-		if ( fake_out_lineno )  lineno = save_lineno;
-		tokenization_error ( TKERROR,
-		    "Unimplemented control word '%s'\n", strupr(statbuf) );
-		if ( fake_out_lineno )  lineno = true_lineno;
+	/*  Down here, we have our last chance to recognize a token.
+	 *      If  abort_quote  is disallowed, we will still consume
+	 *      the string.  In case the string spans more than one
+	 *      line, we want to make sure the line number displayed
+	 *      in the error-message is the one on which the disallowed
+	 *       abort_quote  token appeared, not the one where the
+	 *      string ended; therefore, we might need to be able to
+	 *      "fake-out" the line number...
+	 */
+	{
+	    bool fake_out_lineno = false;
+	    unsigned int save_lineno = lineno;
+	    unsigned int true_lineno;
+	    if ( abort_quote( tok) )
+	    {   return;
+	    }else{
+		if ( tok == ABORTTXT )  fake_out_lineno = true;
 	    }
+	    true_lineno = lineno;
+
+	    if ( fake_out_lineno )  lineno = save_lineno;
+	    tokenization_error ( TKERROR,
+		"Unimplemented control word '%s'\n", strupr(statbuf) );
+	    if ( fake_out_lineno )  lineno = true_lineno;
 	}
 }
-	
+
 /* **************************************************************************
  *
  *      Function name:  skip_string
  *      Synopsis:       When Ignoring, skip various kinds of strings.  Maps
- *                          to string-handlers in handle_internal()...
+ *                          to the string-handlers among the FWord handlers...
  *
  *      Associated FORTH words:                 Double-Quote ( " ) string
  *                                              Dot-Quote  ( ." ) string
@@ -5363,7 +5720,7 @@ bool filter_comments( u8 *inword)
 	    retval = true;
 	}else{
 	    /*  Permit the "allow-multiline-comments" directive  */
-	    if ( found->funct == handle_internal )
+	    if ( is_fword_funct( found) )
 	    {
 	        if ( found->pfield.fw_token == ALLOW_MULTI_LINE )
 		{
@@ -5446,6 +5803,13 @@ void tokenize_one_word( signed long wlen )
     if ( found != NULL )
     {
 	tic_found = found;
+#ifdef DEBUG_SCANNER
+	if ( is_fword_funct( found) )
+	{
+	    printf("%s:%d: debug: tokenizing control word '%s'\n",
+						iname, lineno, statbuf);
+	}
+#endif
 	if ( found->tracing)
 	{
 	    invoking_traced_name( found);
@@ -0,0 +1,771 @@
+/*
+ *                     OpenBIOS - free your system!
+ *                         ( FCode tokenizer )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Size-Map of the FCode images written to a Binary Output File.
+ *
+ *      When the "-M" switch is given, every byte of an FCode image is
+ *          charged to the part of the source that produced it, so that
+ *          the User can see where the space in a size-limited ROM goes:
+ *
+ *          The FCode Header:  the FCode-Starter token and the header
+ *              structure that follows it.
+ *          A definition:  from its  new-token , named-token  or
+ *              external-token  up to and including its definer token,
+ *              or, for a colon-definition, its  b(;)  .  The bytes of
+ *              its name, if it is headered, are part of it.
+ *          An ENCODE-FILE:  all the bytes of the encoded file's strings
+ *              and of the tokens that join them.
+ *          Top-level code:  everything else, i.e., the bytes emitted in
+ *              interpretation state, charged to the source file that
+ *              was being read when they were emitted.
+ *
+ *      The bytes taken by string literals  (b(") , its count-byte and
+ *          the string)  are also counted for each part separately.
+ *
+ *      When the image is finished, the parts are shown in a table on
+ *          Standard Output, largest first, and listed in the order of
+ *          their position in the image in the Size-Map file, which has
+ *          the name of the Binary Output File with the extension  .sizes
+ *          and is meant to be read by other programs.  Its format is
+ *          described in the User's Guide.
+ *
+ *      The sizes are taken as the image was tokenized.  The Whole-Image
+ *          passes may shrink it afterwards; when they do, the report
+ *          says so and gives the final size, but the figures for the
+ *          parts are not corrected for what the passes rewrote.
+ *
+ *      Each image is reported from  finish_fcodehdr() , as soon as its
+ *          fcode-end  is processed, rather than from  finish_headers() ;
+ *          the bytes of a PCI Header are thus not charged to any part.
+ *
+ **************************************************************************** */
+
+/* **************************************************************************
+ *
+ *      Functions Exported:
+ *          init_size_map          Start the Size-Map for a new Binary
+ *                                     Output File.
+ *          start_size_map         Start the map of a new FCode image.
+ *          note_size_definition   A definition is being created.
+ *          end_size_definition    The definition is complete.
+ *          start_size_encode      An ENCODE-FILE is being processed.
+ *          end_size_encode        The ENCODE-FILE is complete.
+ *          note_size_source_change   The source file is about to change.
+ *          note_string_literal    Count the bytes of a string literal.
+ *          finish_size_map        Show and write the map of an image.
+ *          close_size_map         Release the map of the Output File.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "toke.h"
+#include "sizemap.h"
+#include "emit.h"
+#include "errhandler.h"
+#include "stream.h"
+
+/* **************************************************************************
+ *
+ *          Global Variables Imported
+ *              size_map           TRUE if a Size-Map was requested
+ *              opc                Output Buffer Position Counter
+ *              iname              Current input file name
+ *              lineno             Current line number
+ *
+ **************************************************************************** */
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          size_kind_t            Which part of the source is charged
+ *
+ **************************************************************************** */
+
+typedef enum size_kind {
+	SIZE_HEADER ,        /*  The FCode Header                          */
+	SIZE_DEFINITION ,    /*  A definition made through  create_word()  */
+	SIZE_ENCODED ,       /*  An ENCODE-FILE                            */
+	SIZE_TOP_LEVEL       /*  Top-level code of one source file         */
+} size_kind_t;
+
+/* **************************************************************************
+ *
+ *      Internal (Static) Structure:
+ *          size_entry_t           One part of an image
+ *
+ *   Fields:
+ *       kind                 Which part it is
+ *       ob_off               Its first byte in the Output Buffer; for
+ *                                top-level code, that of its first run
+ *       bytes                Number of bytes charged to it
+ *       strings              Number of those that are string literals
+ *       fcode                FCode number of a definition
+ *       hdr                  Headered-ness of a definition
+ *       definer              Name of the definer of a definition, or
+ *                                NULL.  Not allocated.
+ *       name                 Name of a definition or of an encoded file,
+ *                                or NULL
+ *       ifile                Source file, or NULL for the FCode Header
+ *       line_no              Line number in the source file, or zero
+ *                                for top-level code and the FCode Header
+ *
+ **************************************************************************** */
+
+typedef struct size_entry {
+	size_kind_t    kind;
+	unsigned int   ob_off;
+	unsigned int   bytes;
+	unsigned int   strings;
+	u16            fcode;
+	headeredness   hdr;
+	char          *definer;
+	char          *name;
+	char          *ifile;
+	unsigned int   line_no;
+} size_entry_t;
+
+/* **************************************************************************
+ *
+ *              Internal Static Variables
+ *     map_file               Size-Map file of the current Output File,
+ *                                or NULL.  Opened and closed by  stream.c
+ *     image_open             TRUE while an FCode image is being mapped
+ *     image_num              Number of the image within the Output File
+ *     image_start            Position of the image's FCode-Starter
+ *     size_entries           The parts of the current image
+ *     num_entries            Number of parts
+ *     entries_size           Allocated size of the list
+ *     open_defn              Index of the definition being created, or -1
+ *     open_encode            Index of the ENCODE-FILE being processed,
+ *                                or -1
+ *     run_start              Start of the current run of top-level code
+ *     string_bytes           Running count of string-literal bytes
+ *     part_strings           Value of  string_bytes  when the current
+ *                                part or run began
+ *
+ **************************************************************************** */
+
+static FILE *map_file = NULL;
+static bool image_open = false;
+static int image_num = 0;
+static unsigned int image_start = 0;
+static size_entry_t *size_entries = NULL;
+static int num_entries = 0;
+static int entries_size = 0;
+static int open_defn = -1;
+static int open_encode = -1;
+static unsigned int run_start = 0;
+static unsigned int string_bytes = 0;
+static unsigned int part_strings = 0;
+
+/* **************************************************************************
+ *
+ *      Function name:  new_entry
+ *      Synopsis:       Add a part to the map of the current image.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             kind                   Which part it is
+ *             ob_off                 Position of its first byte
+ *             name                   Its name, or NULL
+ *             ifile                  Its source file, or NULL
+ *             line_no                Its line number, or zero
+ *
+ *      Outputs:
+ *         Returned Value:            Index of the new entry; its other
+ *                                        fields are cleared
+ *         Memory Allocated
+ *             Copies of the name and of the file name
+ *         When Freed?
+ *             By  clear_entries() , at the start of the next image or
+ *                 when the Output File is closed.
+ *
+ **************************************************************************** */
+
+static int new_entry( size_kind_t kind, unsigned int ob_off,
+                          const char *name, const char *ifile,
+			      unsigned int line_no)
+{
+    size_entry_t *entry;
+
+    if ( num_entries == entries_size )
+    {
+	entries_size = entries_size ? entries_size * 2 : 64;
+	size_entries = realloc( size_entries,
+				    entries_size * sizeof(size_entry_t));
+	if ( size_entries == NULL )
+	{
+	    tokenization_error( FATAL, "Out of memory mapping sizes");
+	}
+    }
+    entry = &size_entries[num_entries];
+    memset( entry, 0, sizeof(size_entry_t));
+    entry->kind    = kind;
+    entry->ob_off  = ob_off;
+    entry->name    = name  != NULL ? strdup( name)  : NULL;
+    entry->ifile   = ifile != NULL ? strdup( ifile) : NULL;
+    entry->line_no = line_no;
+    return ( num_entries++ );
+}
+
+static void clear_entries( void)
+{
+    int indx;
+    for ( indx = 0 ; indx < num_entries ; indx++ )
+    {
+	free( size_entries[indx].name);
+	free( size_entries[indx].ifile);
+    }
+    num_entries = 0;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  end_run
+ *      Synopsis:       Charge the current run of top-level code to the
+ *                          source file that is being read, and start
+ *                          a new run.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             end_off                End of the run
+ *         Global Variables:
+ *             iname                  Current input file name
+ *         Local Static Variables:
+ *             run_start              Start of the run
+ *             part_strings           String-literal count at its start
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             size_entries           Top-level entry for the file is
+ *                                        created, if need be, and added to
+ *             run_start              Set to  end_off
+ *             part_strings           Set to the current count
+ *
+ *      Process Explanation:
+ *          Nothing is charged while a definition or an ENCODE-FILE is
+ *              open; its bytes are charged to it when it is complete.
+ *
+ **************************************************************************** */
+
+static void end_run( unsigned int end_off)
+{
+    const char *ifile = iname != NULL ? iname : "";
+    int indx;
+
+    if ( ( open_defn != -1 ) || ( open_encode != -1 ) )  return;
+
+    if ( end_off > run_start )
+    {
+	for ( indx = 0 ; indx < num_entries ; indx++ )
+	{
+	    if ( ( size_entries[indx].kind == SIZE_TOP_LEVEL )
+		 && ( strcmp( size_entries[indx].ifile, ifile) == 0 ) )
+	    {
+		break;
+	    }
+	}
+	if ( indx == num_entries )
+	{
+	    indx = new_entry( SIZE_TOP_LEVEL, run_start, NULL, ifile, 0);
+	}
+	size_entries[indx].bytes   += end_off - run_start;
+	size_entries[indx].strings += string_bytes - part_strings;
+    }
+    run_start = end_off;
+    part_strings = string_bytes;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  close_part
+ *      Synopsis:       Complete the definition or ENCODE-FILE that is
+ *                          open, and start a new run of top-level code.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             indx_ptr               Pointer to  open_defn  or  open_encode
+ *             end_off                End of the part
+ *
+ **************************************************************************** */
+
+static void close_part( int *indx_ptr, unsigned int end_off)
+{
+    if ( *indx_ptr != -1 )
+    {
+	size_entry_t *entry = &size_entries[*indx_ptr];
+	entry->bytes   = end_off - entry->ob_off;
+	entry->strings = string_bytes - part_strings;
+	*indx_ptr = -1;
+	run_start = end_off;
+	part_strings = string_bytes;
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  init_size_map
+ *      Synopsis:       Start the Size-Map for a new Binary Output File.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             map_file_ptr           The Size-Map file, already opened,
+ *                                        or NULL if it could not be.
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             map_file               Set from the parameter
+ *             image_num              Reset
+ *         File Output:
+ *             A line of comment naming the fields of the records.
+ *
+ **************************************************************************** */
+
+void init_size_map( FILE *map_file_ptr)
+{
+    map_file = map_file_ptr;
+    image_num = 0;
+    image_open = false;
+    if ( map_file != NULL )
+    {
+	fprintf( map_file, "# record\toffset\tbytes\tstrings\tfcode"
+			       "\theaders\ttype\tname\tfile\tline\n");
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  start_size_map
+ *      Synopsis:       Start the map of a new FCode image.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             start_ob_off           Position of the FCode-Starter token
+ *             body_ob_off            Position of the first byte after
+ *                                         the FCode Header
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             size_entries           Emptied; entry for the FCode Header
+ *             image_open             TRUE
+ *             image_num              Incremented
+ *
+ **************************************************************************** */
+
+void start_size_map( unsigned int start_ob_off, unsigned int body_ob_off)
+{
+    int indx;
+
+    if ( ! size_map )  return;
+
+    clear_entries();
+    image_open = true;
+    image_num++;
+    image_start = start_ob_off;
+    open_defn = -1;
+    open_encode = -1;
+
+    indx = new_entry( SIZE_HEADER, start_ob_off, NULL, NULL, 0);
+    size_entries[indx].bytes = body_ob_off - start_ob_off;
+
+    run_start = body_ob_off;
+    part_strings = string_bytes;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_size_definition
+ *      Synopsis:       A definition is being created:  the  new-token  or
+ *                          named-token  or  external-token  is about to
+ *                          be written.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             fcode                  FCode number being assigned
+ *             name                   Name of the definition
+ *             hdr                    Its headered-ness
+ *             definer                The definer that is creating it
+ *         Global Variables:
+ *             opc                    Output Buffer Position Counter
+ *             iname                  Current input file name
+ *             lineno                 Current line number
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             open_defn              Index of the new entry
+ *
+ *      Error Detection:
+ *          A definition that is still open (i.e., an incomplete colon
+ *              definition, which has already been reported) is taken
+ *              to end here.
+ *
+ **************************************************************************** */
+
+void note_size_definition( u16 fcode, char *name,
+                               headeredness hdr, fwtoken definer)
+{
+    size_entry_t *entry;
+    char *defn_type_name = NULL;
+
+    if ( ! image_open )  return;
+
+    close_part( &open_defn, opc);
+    end_run( opc);
+
+    open_defn = new_entry( SIZE_DEFINITION, opc, name,
+			       iname != NULL ? iname : "", lineno);
+    entry = &size_entries[open_defn];
+    entry->fcode = fcode;
+    entry->hdr   = hdr;
+    definer_name( definer, &defn_type_name);
+    entry->definer = defn_type_name;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  end_size_definition
+ *      Synopsis:       The definition that is being created is complete:
+ *                          its definer token, or its  b(;)  has been
+ *                          written.
+ *
+ **************************************************************************** */
+
+void end_size_definition( void)
+{
+    if ( ! image_open )  return;
+    close_part( &open_defn, opc);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  start_size_encode
+ *      Synopsis:       An ENCODE-FILE is about to be written.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             filename               Name of the file being encoded
+ *
+ *      Process Explanation:
+ *          Inside a definition, the encoded file is charged to the
+ *              definition, like any other byte of it.
+ *
+ **************************************************************************** */
+
+void start_size_encode( const char *filename)
+{
+    if ( ! image_open )  return;
+    if ( open_defn != -1 )  return;
+
+    end_run( opc);
+    open_encode = new_entry( SIZE_ENCODED, opc, filename,
+				 iname != NULL ? iname : "", lineno);
+    size_entries[open_encode].definer = "ENCODE-FILE";
+}
+
+void end_size_encode( void)
+{
+    if ( ! image_open )  return;
+    close_part( &open_encode, opc);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_size_source_change
+ *      Synopsis:       The source file is about to change (either to a
+ *                          new one or back to a saved one), so charge
+ *                          the top-level code written so far to the
+ *                          one that is being read now.
+ *
+ **************************************************************************** */
+
+void note_size_source_change( void)
+{
+    if ( ! image_open )  return;
+    end_run( opc);
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  note_string_literal
+ *      Synopsis:       Count the bytes of a string literal, just written.
+ *
+ **************************************************************************** */
+
+void note_string_literal( unsigned int num_bytes)
+{
+    string_bytes += num_bytes;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  compare_sizes
+ *      Synopsis:       Order the parts of an image for the table:  largest
+ *                          first, and in the order of their position
+ *                          in the image when equal in size.
+ *
+ **************************************************************************** */
+
+static int compare_sizes( const void *one, const void *other)
+{
+    const size_entry_t *entry_1 = (const size_entry_t *)one;
+    const size_entry_t *entry_2 = (const size_entry_t *)other;
+
+    if ( entry_1->bytes != entry_2->bytes )
+    {
+	return ( entry_1->bytes > entry_2->bytes ? -1 : 1 );
+    }
+    if ( entry_1->ob_off != entry_2->ob_off )
+    {
+	return ( entry_1->ob_off < entry_2->ob_off ? -1 : 1 );
+    }
+    return ( 0 );
+}
+
+static char *headers_name( headeredness hdr)
+{
+    switch ( hdr )
+    {
+	case FLAG_HEADERS:
+	    return ( "headered" );
+	case FLAG_EXTERNAL:
+	    return ( "external" );
+	default:
+	    return ( "headerless" );
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  write_size_records
+ *      Synopsis:       Write the map of the current image to the Size-Map
+ *                          file, one record per line, with its fields
+ *                          separated by tabs.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             tokenized_len          Length of the image as tokenized
+ *             final_len              Its length after the passes
+ *
+ *      Process Explanation:
+ *          The image record gives the image number, its position in the
+ *              Output File, and the two lengths.  It is followed by one
+ *              record per part, in the order of their position.  A field
+ *              that does not apply to a part is written as a dash.
+ *
+ **************************************************************************** */
+
+static void write_size_records( unsigned int tokenized_len,
+                                    unsigned int final_len)
+{
+    int indx;
+
+    fprintf( map_file, "image\t%d\t%u\t%u\t%u\n",
+		 image_num, image_start, tokenized_len, final_len);
+
+    for ( indx = 0 ; indx < num_entries ; indx++ )
+    {
+	size_entry_t *entry = &size_entries[indx];
+	char *record;
+
+	switch ( entry->kind )
+	{
+	    case SIZE_HEADER:       record = "header";   break;
+	    case SIZE_DEFINITION:   record = "defn";     break;
+	    case SIZE_ENCODED:      record = "encode";   break;
+	    default:                record = "top";      break;
+	}
+	fprintf( map_file, "%s\t%u\t%u\t%u\t", record,
+		     entry->ob_off, entry->bytes, entry->strings);
+	if ( entry->kind == SIZE_DEFINITION )
+	{
+	    fprintf( map_file, "0x%03x\t%s\t", entry->fcode,
+			 headers_name( entry->hdr));
+	}else{
+	    fprintf( map_file, "-\t-\t");
+	}
+	fprintf( map_file, "%s\t%s\t%s\t",
+		     entry->definer != NULL ? entry->definer : "-",
+		     entry->name    != NULL ? entry->name    : "-",
+		     entry->ifile   != NULL ? entry->ifile   : "-");
+	if ( entry->line_no != 0 )
+	{
+	    fprintf( map_file, "%u\n", entry->line_no);
+	}else{
+	    fprintf( map_file, "-\n");
+	}
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  show_size_table
+ *      Synopsis:       Print the map of the current image on Standard
+ *                          Output, as a table, largest part first.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             tokenized_len          Length of the image as tokenized
+ *             final_len              Its length after the passes
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             size_entries           Sorted
+ *
+ **************************************************************************** */
+
+static void show_size_table( unsigned int tokenized_len,
+                                 unsigned int final_len)
+{
+    unsigned int total_strings = 0;
+    unsigned int total_encoded = 0;
+    int num_defns = 0;
+    int indx;
+
+    qsort( size_entries, num_entries, sizeof(size_entry_t), compare_sizes);
+
+    printf( "\nSize map of FCode image %d at offset %u, %u bytes:\n",
+		image_num, image_start, tokenized_len);
+    printf( "  Bytes      %%  Strings  Offset  FCode  Headers     "
+		"Type         Name\n");
+
+    for ( indx = 0 ; indx < num_entries ; indx++ )
+    {
+	size_entry_t *entry = &size_entries[indx];
+	double percent = tokenized_len == 0 ? 0.0
+			 : ( 100.0 * entry->bytes ) / tokenized_len;
+
+	total_strings += entry->strings;
+	printf( "%7u  %5.1f  %7u  %6u  ",
+		    entry->bytes, percent, entry->strings, entry->ob_off);
+	switch ( entry->kind )
+	{
+	    case SIZE_HEADER:
+		printf( "%5s  %-10s  %s\n", "", "", "(FCode header)");
+		break;
+	    case SIZE_TOP_LEVEL:
+		printf( "%5s  %-10s  %-12s %s\n", "", "", "(top level)",
+			    entry->ifile);
+		break;
+	    case SIZE_ENCODED:
+		total_encoded += entry->bytes;
+		printf( "%5s  %-10s  %-12s %s  (%s, line %u)\n", "", "",
+			    entry->definer, entry->name,
+				entry->ifile, entry->line_no);
+		break;
+	    default:
+		num_defns++;
+		printf( "0x%03x  %-10s  %-12s %s  (%s, line %u)\n",
+			    entry->fcode, headers_name( entry->hdr),
+				entry->definer, entry->name,
+				    entry->ifile, entry->line_no);
+	}
+    }
+
+    printf( "%d definition%s.  %u bytes of string literals",
+		num_defns, num_defns == 1 ? "" : "s", total_strings);
+    if ( total_encoded != 0 )
+    {
+	printf( ", %u bytes of ENCODE-FILE data", total_encoded);
+    }
+    printf( ".\n");
+    if ( final_len != tokenized_len )
+    {
+	printf( "The Whole-Image passes changed the image to %u bytes;  "
+		    "the sizes above are as tokenized.\n", final_len);
+    }
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  finish_size_map
+ *      Synopsis:       The FCode image is finished:  complete its map,
+ *                          show it and write it to the Size-Map file.
+ *
+ *      Inputs:
+ *         Parameters:
+ *             tokenized_end          End of the image as tokenized,
+ *                                        before the Whole-Image passes
+ *             final_end              End of the image after them
+ *
+ *      Outputs:
+ *         Returned Value:            NONE
+ *         Local Static Variables:
+ *             image_open             FALSE
+ *         File Output:
+ *             The records of the image, to the Size-Map file, if open
+ *         Printout:
+ *             The table of the image
+ *
+ *      Process Explanation:
+ *          A colon-definition that was never completed (an Error that has
+ *              already been reported) extends to the end of the image.
+ *
+ **************************************************************************** */
+
+void finish_size_map( unsigned int tokenized_end, unsigned int final_end)
+{
+    if ( ! image_open )  return;
+
+    close_part( &open_encode, tokenized_end);
+    close_part( &open_defn, tokenized_end);
+    end_run( tokenized_end);
+
+    if ( map_file != NULL )
+    {
+	write_size_records( tokenized_end - image_start,
+				final_end - image_start);
+    }
+    show_size_table( tokenized_end - image_start, final_end - image_start);
+
+    image_open = false;
+}
+
+/* **************************************************************************
+ *
+ *      Function name:  close_size_map
+ *      Synopsis:       Release the map when the Output File is closed.
+ *                          The Size-Map file itself is closed by the
+ *                          routine that opened it.
+ *
+ **************************************************************************** */
+
+void close_size_map( void)
+{
+    clear_entries();
+    free( size_entries);
+    size_entries = NULL;
+    entries_size = 0;
+    image_open = false;
+    map_file = NULL;
+}
@@ -0,0 +1,58 @@
+#ifndef _TOKE_SIZEMAP_H
+#define _TOKE_SIZEMAP_H
+
+/*
+ *                     OpenBIOS - free your system!
+ *                         ( FCode tokenizer )
+ *
+ *  This program is part of a free implementation of the IEEE 1275-1994
+ *  Standard for Boot (Initialization Configuration) Firmware.
+ *
+ *  Copyright (C) 2001-2010 Stefan Reinauer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; version 2 of the License.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA, 02110-1301 USA
+ *
+ */
+
+/* **************************************************************************
+ *
+ *      Function Prototypes for the Size-Map of the FCode images
+ *          written to a Binary Output File.
+ *
+ **************************************************************************** */
+
+#include <stdio.h>
+
+#include "types.h"
+#include "scanner.h"
+
+/* ************************************************************************** *
+ *
+ *      Function Prototypes / Functions Exported:
+ *
+ **************************************************************************** */
+
+void init_size_map( FILE *map_file);
+void start_size_map( unsigned int start_ob_off, unsigned int body_ob_off);
+void note_size_definition( u16 fcode, char *name,
+                               headeredness hdr, fwtoken definer);
+void end_size_definition( void);
+void start_size_encode( const char *filename);
+void end_size_encode( void);
+void note_size_source_change( void);
+void note_string_literal( unsigned int num_bytes);
+void finish_size_map( unsigned int tokenized_end, unsigned int final_end);
+void close_size_map( void);
+
+#endif   /*  _TOKE_SIZEMAP_H    */
@@ -42,6 +42,7 @@
 #include "stream.h"
 #include "errhandler.h"
 #include "toke.h"
+#include "sizemap.h"
 
 /* **************************************************************************
  *
@@ -117,6 +118,8 @@ void init_emit( void);
  *     missing_list_name    Name of the Missing-Files-List File
  *     missing_list_file    (Pointer to) File-Structure for Missing-List File
  *     no_files_missing     TRUE if able to load all files
+ *     size_map_name        Name of the Size-Map File
+ *     size_map_file        (Pointer to) File-Structure for the Size-Map File
  *
  **************************************************************************** */
 
@@ -127,6 +130,8 @@ static FILE *depncy_file;
 static char *missing_list_name;
 static FILE *missing_list_file;
 static bool no_files_missing = true;
+static char *size_map_name;
+static FILE *size_map_file;
 
 /* **************************************************************************
  *
@@ -1297,6 +1302,7 @@ static char *extend_filename( const char *base_name, const char *new_ext)
  *         Global Variables:
  *             fload_list               Whether to create an FLoad-List file
  *             dependency_list          Whether to create a Dependency-List file
+ *             size_map                 Whether to create a Size-Map file
  *         Local Static Variables:
  *             include_list_full_path   Full Path to the Input Source File;
  *                                          should still be valid from opening
@@ -1318,11 +1324,14 @@ static char *extend_filename( const char *base_name, const char *new_ext)
  *             missing_list_name        Name of the Missing-Files-List File
  *             missing_list_file        Missing-Files-List File Structure
  *             no_files_missing         Initialized to TRUE
+ *             size_map_name            Name of the Size-Map File
+ *             size_map_file            Size-Map File Structure pointer
  *         Memory Allocated
  *             Binary Output File Name Buffer
  *             FCode Output Buffer
  *             FLoad List File Name Buffer
  *             Dependency List File Name Buffer
+ *             Size-Map File Name Buffer
  *             
  *         When Freed?
  *             In  close_output()
@@ -1363,6 +1372,9 @@ static char *extend_filename( const char *base_name, const char *new_ext)
  *          The Missing-Files-List File will be created if either option was
  *              specified.  Its name will be derived similarly, with an
  *              extension of  .fl.missing
+ *          If the "-M" command-line option was specified, the Size-Map File
+ *              will be created, with an extension of  .sizes  and handed
+ *              to  init_size_map()  which writes to it.
  *
  **************************************************************************** */
 
@@ -1398,6 +1410,13 @@ void init_output( const char *in_name, const char *out_name )
 	    depncy_file = fopen( depncy_list_name,"w");
 	    printf("  Dependency-list to %s ", depncy_list_name);
 	}
+	if ( size_map )
+	{
+	    size_map_name = extend_filename( oname, ".sizes");
+	    size_map_file = fopen( size_map_name,"w");
+	    printf("  Size-map to %s ", size_map_name);
+	    init_size_map( size_map_file);
+	}
 	printf("\n");
 
 	add_to_load_lists( in_name);
@@ -1425,6 +1444,11 @@ void init_output( const char *in_name, const char *out_name )
 		    "Dependency-List");
 		free( depncy_list_name);
 }
+	    if ( size_map && (size_map_file == NULL) )
+	    {
+	    	could_not_open( TKERROR, size_map_name, "Size-Map");
+		free( size_map_name);
+	    }
 
 	    if ( fload_list || dependency_list )
 	    {
@@ -1614,12 +1638,24 @@ bool close_output(void)
 	free( missing_list_name);
     }
 
+    if ( size_map )
+    {
+	close_size_map();
+    }
+    if ( size_map_file != NULL )
+    {
+	fclose( size_map_file);
+	free( size_map_name);
+    }
+
     load_list_file = NULL;
     load_list_name = NULL;
     missing_list_file = NULL;
     missing_list_name = NULL;
     depncy_file = NULL;
     depncy_list_name = NULL;
+    size_map_file = NULL;
+    size_map_name = NULL;
 
     return ( retval );
 }
@@ -54,6 +54,7 @@
 #include "usersymbols.h"
 #include "clflags.h"
 #include "tracesyms.h"
+#include "fcimage.h"
 
 #define CORE_COPYR   "(C) Copyright 2001-2010 Stefan Reinauer.\n" \
 		     "(C) Copyright 2006 coresystems GmbH"
@@ -71,6 +72,8 @@
  *        noerrors         If true, create binary even if error(s) encountered.
  *        fload_list       If true, create an "FLoad-List" file
  *        dependency_list  If true, create a "Dependencies-List" file
+ *        size_map         If true, report the size of each definition
+ *                             and create a "Size-Map" file
  *
  **************************************************************************** */
 
@@ -78,6 +81,7 @@ bool verbose         = false;
 bool noerrors        = false;
 bool fload_list      = false;
 bool dependency_list = false;
+bool size_map        = false;
 
 /* **************************************************************************
  *
@@ -120,18 +124,22 @@ static void print_copyright(void)
 
 static void usage(char *name)
 {
-	printf("usage: %s [-v] [-i] [-l] [-P] [-o target] <[-d name[=value]]> "
+	printf("usage: %s [-v] [-i] [-l] [-P] [-M] [-o target] <[-d name[=value]]> "
 				"<[-f [no]flagname]> <[-I dir-path]> "
-				"<[-T symbol]> <forth-file>\n\n",name);
+				"<[-T symbol]> <[-S bytes]> <[-N bytes]> "
+				"<forth-file>\n\n",name);
 	printf("  -v|--verbose          print Advisory messages\n");
 	printf("  -i|--ignore-errors    don't suppress output after errors\n");
 	printf("  -l|--load-list        create list of FLoaded file names\n");
 	printf("  -P|--dependencies     create dePendency-list file\n");
+	printf("  -M|--size-map         report the size of each definition\n");
 	printf("  -o|--output-name      send output to filename given\n");
 	printf("  -d|--define           create user-defined symbol\n");
 	printf("  -f|--flag             set (or clear) Special-Feature flag\n");
 	printf("  -I|--Include          add a directory to the Include-List\n");
 	printf("  -T|--Trace            add a symbol to the Trace List\n");
+	printf("  -S|--min-savings      least bytes saved by a factored sequence\n");
+	printf("  -N|--inline-max       largest body of an inlined definition\n");
 	printf("  -h|--help             print this help message\n\n");
 	printf("  -f|--flag    help     Help for Special-Feature flags\n");
 }
@@ -155,6 +163,9 @@ static void usage(char *name)
  *                noerrors           set by "-i" switch
  *                fload_list         set by "-l" switch
  *                dependency_list    set by "-P" switch
+ *                size_map           set by "-M" switch
+ *                factor_min_savings set by "-S" switch
+ *                inline_max_bytes   set by "-N" switch
  *         Internal Static Variables
  *                outputname         set by "-o" switch
  *         Internal System Variable
@@ -194,10 +205,13 @@ static void usage(char *name)
  *               I
  *               l
  *               P
+ *               M
  *               o
  *               d
  *               f
  *               T
+ *               S
+ *               N
  *           The conditions they set remain in effect through
  *               the entire program run.
  *
@@ -227,7 +241,7 @@ static void usage(char *name)
 
 static void get_args( int argc, char **argv )
 {
-	const char *optstring="vhilPo:d:f:I:T:?";
+	const char *optstring="vhilPMo:d:f:I:T:S:N:?";
 	int c;
 	int argindx = 0;
 	bool inval_opt = false;
@@ -243,11 +257,14 @@ static void get_args( int argc, char **argv )
 			{ "ignore-errors", 0, 0, 'i' },
 			{ "load-list",     0, 0, 'l' },
 			{ "dependencies",  0, 0, 'P' },
+			{ "size-map",      0, 0, 'M' },
 			{ "output-name",   1, 0, 'o' },
 			{ "define",        1, 0, 'd' },
 			{ "flag",          1, 0, 'f' },
 			{ "Include",       1, 0, 'I' },
 			{ "Trace",         1, 0, 'T' },
+			{ "min-savings",   1, 0, 'S' },
+			{ "inline-max",    1, 0, 'N' },
 			{ 0, 0, 0, 0 }
 		};
 
@@ -276,6 +293,9 @@ static void get_args( int argc, char **argv )
 		case 'P':
 			dependency_list = true;
 			break;
+		case 'M':
+			size_map = true;
+			break;
 		case 'd':
 			{
 			    char *user_symb = optarg;
@@ -294,6 +314,34 @@ static void get_args( int argc, char **argv )
 		case 'T':
 			add_to_trace_list(optarg);
 			break;
+		case 'S':
+			{
+			    char *endp;
+			    long min_savings = strtol(optarg, &endp, 0);
+			    if ( ( *endp != 0 ) || ( min_savings < 1 ) )
+			    {
+				printf ("Invalid minimum savings:  %s\n",
+				    optarg);
+				inval_opt = true;
+			    }else{
+				factor_min_savings = (int)min_savings;
+			    }
+			}
+			break;
+		case 'N':
+			{
+			    char *endp;
+			    long max_bytes = strtol(optarg, &endp, 0);
+			    if ( ( *endp != 0 ) || ( max_bytes < 0 ) )
+			    {
+				printf ("Invalid inline size limit:  %s\n",
+				    optarg);
+				inval_opt = true;
+			    }else{
+				inline_max_bytes = (int)max_bytes;
+			    }
+			}
+			break;
 		case '?':
 			/*  Distinguish between a '?' from the user
 			 *  and one  getopt()  returned
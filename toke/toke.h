@@ -47,5 +47,6 @@ extern bool verbose;
 extern bool noerrors;
 extern bool fload_list;
 extern bool dependency_list;
+extern bool size_map;
 
 #endif   /* _TOKE_TOKE_H */
@@ -56,6 +56,7 @@
 #include "strsubvocab.h"
 #include "nextfcode.h"
 #include "tracesyms.h"
+#include "fcimage.h"
 
 #undef TOKZTEST     /*  Define for testing only; else undef   */
 #ifdef TOKZTEST         /*  For testing only   */
@@ -299,6 +300,10 @@ static bool get_fcode_from_stack( u16 *the_num, bool setting_fc)
  *         Printout:
  *             Advisory showing change in FCode token Assignment Counter
  *
+ *      Process Explanation:
+ *          The number is "anchored":  it will be assigned to the next
+ *              definition even when the numbers are reassigned densely.
+ *
  **************************************************************************** */
 
 static void tokz_esc_next_fcode( tic_param_t pfield )
@@ -320,6 +325,7 @@ static void tokz_esc_next_fcode( tic_param_t pfield )
 			    test_fcode );
 	    set_next_fcode( test_fcode);
 	}
+	anchor_next_fcode();
     }
 }
 
@@ -338,6 +344,10 @@ static void tokz_esc_next_fcode( tic_param_t pfield )
  *         Printout:
  *             Advisory showing FCode being emitted.
  *
+ *      Process Explanation:
+ *          The token's meaning is unknown to the Whole-Image passes,
+ *              so record it as a raw emission, as  emit-byte  does.
+ *
  **************************************************************************** */
 
 static void tokz_emit_fcode( tic_param_t pfield )
@@ -349,6 +359,7 @@ static void tokz_emit_fcode( tic_param_t pfield )
 	tokenization_error( INFO,
 	    "Emitting FCode value of 0x%x\n", test_fcode);
 	emit_fcode( test_fcode);
+	note_raw_emission();
     }
 }
 
@@ -416,8 +427,7 @@ static void  tokz_esc_noop ( tic_param_t pfield )
    {
       int lenny ;
       lenny = strlen ( pfield.chr_ptr );
-      emit_token("b(\")");
-      emit_string(pfield.chr_ptr, lenny);
+      emit_string_literal(pfield.chr_ptr, lenny);
    }
 
 #endif                  /*  For testing only   */
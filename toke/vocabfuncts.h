@@ -80,6 +80,7 @@ void token_entry_warning( tic_hdr_t *t_entry);
 
 tic_hdr_t *lookup_shared_word( char *tname);
 tic_hdr_t *lookup_shared_f_exec_word( char *tname);
+bool is_fword_funct( tic_hdr_t *t_entry);
 
 void init_dictionary( void );
 void reset_normal_vocabs( void );